@@ -17,10 +17,12 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/ascii.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "tensorflow/core/common_runtime/collective_executor_mgr.h"
@@ -52,6 +54,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/costmodel.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_partition.h"
 #include "tensorflow/core/graph/subgraph.h"
@@ -66,6 +69,7 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/nccl/collective_communicator.h"
@@ -156,6 +160,39 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Gives the nodes of `graph_def` that are not in `graph_nodes` and were named
+// by the partitioner, i.e. whose names end in "/_<n>", fresh names from
+// `new_name`.  Those names are only unique among the graphs of the session
+// that created them, and the kernels of stateful nodes such as _Send and
+// _Recv are cached by node name in the device's OpSegment.
+void RenamePartitionNodes(const std::unordered_set<string>& graph_nodes,
+                          const std::function<string(const string&)>& new_name,
+                          GraphDef* graph_def) {
+  std::unordered_map<string, string> renamed;
+  for (NodeDef& node : *graph_def->mutable_node()) {
+    if (graph_nodes.count(node.name()) > 0) continue;
+    const size_t pos = node.name().rfind("/_");
+    if (pos == string::npos || pos + 2 == node.name().size()) continue;
+    const string& name = node.name();
+    if (!std::all_of(name.begin() + pos + 2, name.end(), absl::ascii_isdigit)) {
+      continue;
+    }
+    string fresh_name = new_name(name.substr(0, pos));
+    renamed[name] = fresh_name;
+    node.set_name(std::move(fresh_name));
+  }
+  if (renamed.empty()) return;
+  for (NodeDef& node : *graph_def->mutable_node()) {
+    for (string& input : *node.mutable_input()) {
+      const TensorId id = ParseTensorName(input);
+      auto it = renamed.find(string(id.node()));
+      if (it != renamed.end()) {
+        input = TensorId(it->second, id.index()).ToString();
+      }
+    }
+  }
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -803,6 +840,16 @@ Status DirectSession::RunInternal(
 
     mutex_lock l(executor_lock_);
     run_state.collector->BuildCostModel(&cost_model_manager_, device_to_graph);
+    for (const auto& item : executors_and_keys->items) {
+      const CostModel* cost_model =
+          cost_model_manager_.FindOrCreateCostModel(item.graph.get());
+      for (const Node* n : item.graph->nodes()) {
+        if (cost_model->TotalCount(n) > 0) {
+          measured_node_costs_[n->name()] = {cost_model->TotalCount(n),
+                                             cost_model->TotalTime(n)};
+        }
+      }
+    }
 
     // annotate stats onto cost graph.
     CostGraphDef* cost_graph = run_metadata->mutable_cost_graph();
@@ -1349,11 +1396,55 @@ Status DirectSession::CreateExecutors(
       }
     }
   }
-  ek->items.reserve(graphs.size());
+  TF_RETURN_IF_ERROR(CreatePartitionExecutors(
+      &graphs, /*optimize_graphs=*/true, ek.get(), func_info.get()));
+
+  // Cache the mapping from input/output names to graph elements to
+  // avoid recomputing it every time.
+  if (!run_state_args->is_partial_run) {
+    // For regular `Run()`, we use the function calling convention, and so
+    // maintain a mapping from input/output names to
+    // argument/return-value ordinal index.
+    for (int i = 0; i < callable_options.feed().size(); ++i) {
+      const string& input = callable_options.feed(i);
+      ek->input_name_to_index[input] = i;
+    }
+    for (int i = 0; i < callable_options.fetch().size(); ++i) {
+      const string& output = callable_options.fetch(i);
+      ek->output_name_to_index[output] = i;
+    }
+  } else {
+    // For `PRun()`, we use the rendezvous calling convention, and so
+    // maintain a mapping from input/output names to rendezvous keys.
+    //
+    // We always use the first device as the device name portion of the
+    // key, even if we're feeding another graph.
+    for (int i = 0; i < callable_options.feed().size(); ++i) {
+      const string& input = callable_options.feed(i);
+      ek->input_name_to_rendezvous_key[input] = GetRendezvousKey(
+          input, device_set_.client_device()->attributes(), FrameAndIter(0, 0));
+    }
+    for (int i = 0; i < callable_options.fetch().size(); ++i) {
+      const string& output = callable_options.fetch(i);
+      ek->output_name_to_rendezvous_key[output] =
+          GetRendezvousKey(output, device_set_.client_device()->attributes(),
+                           FrameAndIter(0, 0));
+    }
+  }
+
+  *out_executors_and_keys = std::move(ek);
+  *out_func_info = std::move(func_info);
+  return OkStatus();
+}
+
+Status DirectSession::CreatePartitionExecutors(
+    std::unordered_map<string, std::unique_ptr<Graph>>* graphs,
+    bool optimize_graphs, ExecutorsAndKeys* ek, FunctionInfo* func_info) {
+  ek->items.reserve(graphs->size());
   const auto& optimizer_opts =
       options_.config.graph_options().optimizer_options();
 
-  int graph_def_version = graphs.begin()->second->versions().producer();
+  int graph_def_version = graphs->begin()->second->versions().producer();
 
   const auto* session_metadata =
       options_.config.experimental().has_session_metadata()
@@ -1370,7 +1461,7 @@ Status DirectSession::CreateExecutors(
           }}));
 
   GraphOptimizer optimizer(optimizer_opts);
-  for (auto iter = graphs.begin(); iter != graphs.end(); ++iter) {
+  for (auto iter = graphs->begin(); iter != graphs->end(); ++iter) {
     const string& partition_name = iter->first;
     std::unique_ptr<Graph>& partition_graph = iter->second;
 
@@ -1414,12 +1505,14 @@ Status DirectSession::CreateExecutors(
         delete kernel;
     };
 
-    optimizer.Optimize(lib, options_.env, device, &partition_graph,
-                       GraphOptimizer::Options());
+    if (optimize_graphs) {
+      optimizer.Optimize(lib, options_.env, device, &partition_graph,
+                         GraphOptimizer::Options());
+    }
 
     // TensorFlow Debugger (tfdbg) inserts debug nodes in the graph.
     const DebugOptions& debug_options =
-        options.callable_options.run_options().debug_options();
+        ek->callable_options.run_options().debug_options();
     if (!debug_options.debug_tensor_watch_opts().empty()) {
       TF_RETURN_IF_ERROR(DecorateAndPublishGraphForDebug(
           debug_options, partition_graph.get(), params.device));
@@ -1429,6 +1522,23 @@ Status DirectSession::CreateExecutors(
                                          device->name(),
                                          partition_graph.get()));
 
+    // Seeds the cost model with what earlier steps measured, for executors
+    // that plan their schedule at construction.
+    CostModel cost_model(/*is_global=*/false);
+    {
+      mutex_lock l(executor_lock_);
+      if (!measured_node_costs_.empty()) {
+        cost_model.InitFromGraph(*partition_graph);
+        for (const Node* n : partition_graph->nodes()) {
+          auto it = measured_node_costs_.find(n->name());
+          if (it == measured_node_costs_.end()) continue;
+          cost_model.RecordCount(n, it->second.first);
+          cost_model.RecordTime(n, it->second.second);
+        }
+        params.cost_model = &cost_model;
+      }
+    }
+
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
@@ -1440,41 +1550,6 @@ Status DirectSession::CreateExecutors(
     }
   }
 
-  // Cache the mapping from input/output names to graph elements to
-  // avoid recomputing it every time.
-  if (!run_state_args->is_partial_run) {
-    // For regular `Run()`, we use the function calling convention, and so
-    // maintain a mapping from input/output names to
-    // argument/return-value ordinal index.
-    for (int i = 0; i < callable_options.feed().size(); ++i) {
-      const string& input = callable_options.feed(i);
-      ek->input_name_to_index[input] = i;
-    }
-    for (int i = 0; i < callable_options.fetch().size(); ++i) {
-      const string& output = callable_options.fetch(i);
-      ek->output_name_to_index[output] = i;
-    }
-  } else {
-    // For `PRun()`, we use the rendezvous calling convention, and so
-    // maintain a mapping from input/output names to rendezvous keys.
-    //
-    // We always use the first device as the device name portion of the
-    // key, even if we're feeding another graph.
-    for (int i = 0; i < callable_options.feed().size(); ++i) {
-      const string& input = callable_options.feed(i);
-      ek->input_name_to_rendezvous_key[input] = GetRendezvousKey(
-          input, device_set_.client_device()->attributes(), FrameAndIter(0, 0));
-    }
-    for (int i = 0; i < callable_options.fetch().size(); ++i) {
-      const string& output = callable_options.fetch(i);
-      ek->output_name_to_rendezvous_key[output] =
-          GetRendezvousKey(output, device_set_.client_device()->attributes(),
-                           FrameAndIter(0, 0));
-    }
-  }
-
-  *out_executors_and_keys = std::move(ek);
-  *out_func_info = std::move(func_info);
   return OkStatus();
 }
 
@@ -1874,6 +1949,154 @@ Status DirectSession::MakeCallable(const CallableOptions& callable_options,
   return OkStatus();
 }
 
+Status DirectSession::GetGraphFingerprint(
+    uint64* fingerprint, std::unordered_set<string>* node_names) {
+  if (finalized_) {
+    return errors::FailedPrecondition("Session has been finalized.");
+  }
+  const GraphDef& graph_def = *execution_state_->original_graph_def();
+  *fingerprint = DeterministicProtoHash64(graph_def);
+  if (node_names != nullptr) {
+    node_names->reserve(graph_def.node_size());
+    for (const NodeDef& node : graph_def.node()) {
+      node_names->insert(node.name());
+    }
+  }
+  return OkStatus();
+}
+
+Status DirectSession::ExportCallableState(CallableHandle handle,
+                                          CallableState* state) {
+  TF_RETURN_IF_ERROR(CheckNotClosed());
+  std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
+  std::shared_ptr<FunctionInfo> function_info;
+  {
+    mutex_lock l(callables_lock_);
+    if (handle >= next_callable_handle_) {
+      return errors::InvalidArgument("No such callable handle: ", handle);
+    }
+    auto it = callables_.find(handle);
+    if (it == callables_.end()) {
+      return errors::InvalidArgument(
+          "Attempted to export callable after handle was released: ", handle);
+    }
+    executors_and_keys = it->second.executors_and_keys;
+    function_info = it->second.function_info;
+  }
+  const ExecutorsAndKeys& ek = *executors_and_keys;
+  if (!ek.callable_options.run_options()
+           .debug_options()
+           .debug_tensor_watch_opts()
+           .empty()) {
+    return errors::InvalidArgument(
+        "Cannot export the state of a callable that watches tensors for the "
+        "debugger.");
+  }
+
+  state->Clear();
+  *state->mutable_callable_options() = ek.callable_options;
+  for (const PerPartitionExecutorsAndLib& item : ek.items) {
+    if (item.graph == nullptr) {
+      return errors::FailedPrecondition(
+          "Cannot export the state of a callable whose partition graphs were "
+          "not kept; set "
+          "ConfigProto.experimental.disable_output_partition_graphs to "
+          "false.");
+    }
+    item.graph->ToGraphDef(
+        &(*state->mutable_partition_graphs())[item.device->name()]);
+  }
+  *state->mutable_library() = function_info->flib_def->ToProto();
+  for (DataType dtype : ek.input_types) state->add_input_types(dtype);
+  for (DataType dtype : ek.output_types) state->add_output_types(dtype);
+  state->set_collective_graph_key(ek.collective_graph_key);
+
+  mutex_lock l(graph_state_lock_);
+  uint64 fingerprint;
+  TF_RETURN_IF_ERROR(GetGraphFingerprint(&fingerprint, nullptr));
+  state->set_graph_fingerprint(fingerprint);
+  state->mutable_stateful_placements()->insert(stateful_placements_.begin(),
+                                               stateful_placements_.end());
+  return OkStatus();
+}
+
+Status DirectSession::MakeCallableFromState(const CallableState& state,
+                                            CallableHandle* out_handle) {
+  TF_RETURN_IF_ERROR(CheckNotClosed());
+  TF_RETURN_IF_ERROR(CheckGraphCreated("MakeCallableFromState()"));
+  if (state.partition_graphs().empty()) {
+    return errors::InvalidArgument("Callable state has no partition graphs.");
+  }
+
+  std::unordered_set<string> graph_nodes;
+  {
+    mutex_lock l(graph_state_lock_);
+    uint64 fingerprint;
+    TF_RETURN_IF_ERROR(GetGraphFingerprint(&fingerprint, &graph_nodes));
+    if (fingerprint != state.graph_fingerprint()) {
+      return errors::InvalidArgument(
+          "Callable state was exported from a session with a different "
+          "graph.");
+    }
+    for (const auto& placement_pair : state.stateful_placements()) {
+      auto iter = stateful_placements_.find(placement_pair.first);
+      if (iter == stateful_placements_.end()) {
+        stateful_placements_.insert(placement_pair);
+      } else if (iter->second != placement_pair.second) {
+        return errors::InvalidArgument(
+            "Stateful placement mismatch. Current assignment of ",
+            placement_pair.first, " to ", iter->second, " does not match ",
+            placement_pair.second);
+      }
+    }
+  }
+
+  std::unique_ptr<FunctionInfo> func_info(new FunctionInfo);
+  std::unique_ptr<ExecutorsAndKeys> ek(new ExecutorsAndKeys);
+  ek->callable_options = state.callable_options();
+  for (int dtype : state.input_types()) {
+    ek->input_types.push_back(static_cast<DataType>(dtype));
+  }
+  for (int dtype : state.output_types()) {
+    ek->output_types.push_back(static_cast<DataType>(dtype));
+  }
+  ek->collective_graph_key = state.collective_graph_key();
+  func_info->flib_def.reset(
+      new FunctionLibraryDefinition(OpRegistry::Global(), state.library()));
+
+  auto new_name = [this](const string& prefix) {
+    return strings::StrCat(prefix, "/_", edge_name_counter_.fetch_add(1));
+  };
+  std::unordered_map<string, std::unique_ptr<Graph>> graphs;
+  for (const auto& partition : state.partition_graphs()) {
+    GraphDef graph_def = partition.second;
+    RenamePartitionNodes(graph_nodes, new_name, &graph_def);
+    std::unique_ptr<Graph> device_graph(new Graph(func_info->flib_def.get()));
+    device_graph->SetConstructionContext(ConstructionContext::kDirectSession);
+    GraphConstructorOptions device_opts;
+    device_opts.allow_internal_ops = true;
+    device_opts.expect_device_spec = true;
+    TF_RETURN_IF_ERROR(ConvertGraphDefToGraph(
+        device_opts, std::move(graph_def), device_graph.get()));
+    graphs.emplace(partition.first, std::move(device_graph));
+  }
+  TF_RETURN_IF_ERROR(CreatePartitionExecutors(
+      &graphs, /*optimize_graphs=*/false, ek.get(), func_info.get()));
+
+  for (int i = 0; i < ek->callable_options.feed().size(); ++i) {
+    ek->input_name_to_index[ek->callable_options.feed(i)] = i;
+  }
+  for (int i = 0; i < ek->callable_options.fetch().size(); ++i) {
+    ek->output_name_to_index[ek->callable_options.fetch(i)] = i;
+  }
+  {
+    mutex_lock l(callables_lock_);
+    *out_handle = next_callable_handle_++;
+    callables_[*out_handle] = {std::move(ek), std::move(func_info)};
+  }
+  return OkStatus();
+}
+
 class DirectSession::RunCallableCallFrame : public CallFrameInterface {
  public:
   RunCallableCallFrame(DirectSession* session,
@@ -43,6 +43,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/callable_state.pb.h"
 #include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
@@ -133,6 +134,22 @@ class DirectSession : public Session {
 
   ::tensorflow::Status ReleaseCallable(CallableHandle handle) override;
 
+  // Writes the placed, optimized and partitioned graphs of the callable
+  // `handle` to `state`, so that a later session created from the same graph
+  // and options can recreate the callable with MakeCallableFromState().
+  // Requires the partition graphs to be kept, i.e.
+  // `ConfigProto.experimental.disable_output_partition_graphs` to be false,
+  // and fails for callables that watch tensors for the debugger.
+  ::tensorflow::Status ExportCallableState(CallableHandle handle,
+                                           CallableState* state);
+
+  // Like MakeCallable(), but creates the executors from the partition graphs
+  // in `state` instead of placing, optimizing and partitioning the session's
+  // graph again.  Fails if `state` was exported from a session with a
+  // different graph.
+  ::tensorflow::Status MakeCallableFromState(const CallableState& state,
+                                             CallableHandle* out_handle);
+
   ::tensorflow::Status Finalize() override;
 
   const SessionOptions& options() const { return options_; }
@@ -253,6 +270,19 @@ class DirectSession : public Session {
       std::unique_ptr<FunctionInfo>* out_func_info,
       RunStateArgs* run_state_args);
 
+  // Creates the executors of `ek` for the partition graphs in `graphs`, using
+  // the function library in `func_info->flib_def`.  The partitions are
+  // optimized with the GraphOptimizer first if `optimize_graphs` is true.
+  ::tensorflow::Status CreatePartitionExecutors(
+      std::unordered_map<string, std::unique_ptr<Graph>>* graphs,
+      bool optimize_graphs, ExecutorsAndKeys* ek, FunctionInfo* func_info);
+
+  // Returns the fingerprint of the session's graph, and the names of its
+  // nodes if `node_names` is not null.
+  ::tensorflow::Status GetGraphFingerprint(
+      uint64* fingerprint, std::unordered_set<string>* node_names)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
+
   // Creates several graphs given the existing graph_def_ and the
   // input feeds and fetches, given 'devices'. The graphs share a common
   // function library 'flib_def'.
@@ -422,6 +452,13 @@ class DirectSession : public Session {
   // Manages all the cost models for the graphs executed in this session.
   CostModelManager cost_model_manager_;
 
+  // The execution count and total time of each node measured by the cost
+  // models above, by node name. Executors created later that plan ahead (e.g.
+  // "STATIC_PLAN") are given a cost model seeded from it. Only filled in when
+  // GraphOptions.build_cost_model is set.
+  std::unordered_map<string, std::pair<int32, Microseconds>>
+      measured_node_costs_ TF_GUARDED_BY(executor_lock_);
+
   // For testing collective graph key generation.
   mutex collective_graph_key_lock_;
   int64_t collective_graph_key_ TF_GUARDED_BY(collective_graph_key_lock_) = -1;
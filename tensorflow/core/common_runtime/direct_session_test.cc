@@ -27,6 +27,7 @@ limitations under the License.
 #include "absl/strings/match.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/external_tensor_buffer.h"
 #include "tensorflow/core/common_runtime/function_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -43,11 +44,15 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/stacktrace.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/callable_state.pb.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/public/session.h"
@@ -199,6 +204,98 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_Callable) {
   }
 }
 
+TEST_F(DirectSessionMinusAXTest, CallableState) {
+  Initialize({3, 2, -1, 0});
+  const CallableOptions callable_options =
+      MakeCallableOptions({x_}, {y_neg_ + ":0"}, {});
+  Tensor x(DT_FLOAT, TensorShape({2, 1}));
+  test::FillValues<float>(&x, {1, 2});
+
+  CallableState state;
+  {
+    auto session = CreateSession();
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def_));
+    Session::CallableHandle handle;
+    TF_ASSERT_OK(session->MakeCallable(callable_options, &handle));
+    TF_ASSERT_OK(static_cast<DirectSession*>(session.get())
+                     ->ExportCallableState(handle, &state));
+    // y_neg runs on a different device than y.
+    EXPECT_EQ(2, state.partition_graphs_size());
+  }
+  const string path = io::JoinPath(testing::TmpDir(), "callable_state.pb");
+  TF_ASSERT_OK(WriteBinaryProto(Env::Default(), path, state));
+  CallableState restored_state;
+  TF_ASSERT_OK(ReadBinaryProto(Env::Default(), path, &restored_state));
+
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  // A callable created first gives the new session's partition nodes the same
+  // names as those in the restored state.
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(session->MakeCallable(
+      MakeCallableOptions({}, {y_neg_ + ":0"}, {}), &handle));
+  Session::CallableHandle restored_handle;
+  TF_ASSERT_OK(static_cast<DirectSession*>(session.get())
+                   ->MakeCallableFromState(restored_state, &restored_handle));
+
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->RunCallable(handle, {}, &outputs, nullptr));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({-5, 1}, TensorShape({2, 1})), outputs[0]);
+
+    TF_ASSERT_OK(
+        session->RunCallable(restored_handle, {x}, &outputs, nullptr));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({-7, 1}, TensorShape({2, 1})), outputs[0]);
+  }
+  TF_ASSERT_OK(session->ReleaseCallable(restored_handle));
+}
+
+TEST_F(DirectSessionMinusAXTest, CallableStateErrors) {
+  Initialize({3, 2, -1, 0});
+  CallableState state;
+  {
+    auto session = CreateSession();
+    TF_ASSERT_OK(session->Create(def_));
+    Session::CallableHandle handle;
+    TF_ASSERT_OK(session->MakeCallable(
+        MakeCallableOptions({}, {y_neg_ + ":0"}, {}), &handle));
+    auto* direct_session = static_cast<DirectSession*>(session.get());
+    TF_ASSERT_OK(direct_session->ExportCallableState(handle, &state));
+    TF_ASSERT_OK(session->ReleaseCallable(handle));
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        direct_session->ExportCallableState(handle, &state)));
+  }
+
+  // The state of a callable cannot be restored into a session whose graph
+  // differs.
+  Initialize({3, 2, -1, 1});
+  auto session = CreateSession();
+  TF_ASSERT_OK(session->Create(def_));
+  Session::CallableHandle handle;
+  Status s = static_cast<DirectSession*>(session.get())
+                 ->MakeCallableFromState(state, &handle);
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "different graph"));
+
+  // Exporting needs the partition graphs.
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->set_disable_output_partition_graphs(
+      true);
+  session.reset(NewSession(options));
+  TF_ASSERT_OK(session->Create(def_));
+  TF_ASSERT_OK(session->MakeCallable(
+      MakeCallableOptions({}, {y_neg_ + ":0"}, {}), &handle));
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      static_cast<DirectSession*>(session.get())
+          ->ExportCallableState(handle, &state)));
+}
+
 TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_OptimizeForStaticGraph) {
   Initialize({3, 2, -1, 0});
   SessionOptions options(DefaultSessionOptions());
@@ -229,6 +326,31 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_OptimizeForStaticGraph) {
       absl::StrContains(s.error_message(), "optimize_for_static_graph"));
 }
 
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_StaticPlanWithCostModel) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options(DefaultSessionOptions());
+  options.config.mutable_experimental()->set_executor_type("STATIC_PLAN");
+  options.config.mutable_graph_options()->set_build_cost_model(1);
+  auto session = absl::WrapUnique(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // The first signature measures the node costs; the executors of the second
+  // are planned with them.
+  RunOptions run_options;
+  RunMetadata run_metadata;
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run(run_options, {}, {y_ + ":0"}, {y_neg_}, &outputs,
+                            &run_metadata));
+  EXPECT_GT(run_metadata.cost_graph().node_size(), 0);
+  TF_ASSERT_OK(session->Run(run_options, {}, {y_ + ":0", z_ + ":0"}, {},
+                            &outputs, &run_metadata));
+
+  ASSERT_EQ(2, outputs.size());
+  EXPECT_FLOAT_EQ(5.0, outputs[0].matrix<float>()(0, 0));
+  EXPECT_FLOAT_EQ(-5.0, outputs[1].matrix<float>()(0, 0));
+}
+
 TEST_F(DirectSessionMinusAXTest,
        RunSimpleNetwork_DisableOutputPartitionGraphs) {
   Initialize({3, 2, -1, 0});
@@ -996,6 +1118,69 @@ TEST(DirectSessionTest, MultipleFeedTest_Callable) {
   EXPECT_TRUE(absl::StrContains(s.error_message(), "fed more than once"));
 }
 
+TEST(DirectSessionTest, FeedExternalBuffer) {
+  Graph g(OpRegistry::Global());
+  Tensor value(DT_FLOAT, TensorShape({256}));
+  value.flat<float>().setZero();
+  Node* x = test::graph::Constant(&g, value);
+  Node* identity = test::graph::Identity(&g, x);
+  Node* sum = test::graph::Add(&g, x, x);
+  GraphDef def;
+  g.ToGraphDef(&def);
+
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  const size_t num_bytes = 256 * sizeof(float);
+  float* data = static_cast<float*>(
+      port::AlignedMalloc(num_bytes, std::max(1, EIGEN_MAX_ALIGN_BYTES)));
+  for (int i = 0; i < 256; ++i) data[i] = i;
+  int num_done = 0;
+  {
+    Tensor feed;
+    TF_ASSERT_OK(TensorFromExternalBuffer(DT_FLOAT, TensorShape({256}), data,
+                                          num_bytes, [&num_done]() {
+                                            ++num_done;
+                                          },
+                                          &feed));
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{x->name(), feed}},
+                              {identity->name() + ":0", sum->name() + ":0"},
+                              {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    // The feed was not copied.
+    EXPECT_EQ(data, outputs[0].flat<float>().data());
+    EXPECT_EQ(510.0f, outputs[1].flat<float>()(255));
+    // The caller's memory was not used as the output of Add.
+    EXPECT_EQ(255.0f, data[255]);
+    feed = Tensor();
+    // `outputs[0]` still refers to the buffer.
+    EXPECT_EQ(0, num_done);
+  }
+  EXPECT_EQ(1, num_done);
+  port::AlignedFree(data);
+}
+
+TEST(DirectSessionTest, FeedExternalBufferErrors) {
+  const size_t num_bytes = 64 * sizeof(float);
+  char* data = static_cast<char*>(
+      port::AlignedMalloc(num_bytes + 1, std::max(1, EIGEN_MAX_ALIGN_BYTES)));
+  Tensor t;
+  bool done = false;
+  auto set_done = [&done]() { done = true; };
+  EXPECT_TRUE(errors::IsInvalidArgument(TensorFromExternalBuffer(
+      DT_FLOAT, TensorShape({65}), data, num_bytes, set_done, &t)));
+  EXPECT_TRUE(errors::IsInvalidArgument(TensorFromExternalBuffer(
+      DT_STRING, TensorShape({2}), data, num_bytes, set_done, &t)));
+  if (EIGEN_MAX_ALIGN_BYTES > 1) {
+    EXPECT_TRUE(errors::IsInvalidArgument(TensorFromExternalBuffer(
+        DT_UINT8, TensorShape({8}), data + 1, num_bytes, set_done, &t)));
+  }
+  EXPECT_FALSE(done);
+  port::AlignedFree(data);
+}
+
 TEST(DirectSessionTest, TestTensorConnectionUseTwice) {
   Graph graph(OpRegistry::Global());
 
@@ -2728,6 +2913,92 @@ void BM_FeedFetchCallableSingleThreadExecutor(
                            /* use_single_threaded_executor */ true);
 }
 
+// Feeds a tensor of `num_mb` MB that arrives in a request buffer, either by
+// copying the buffer into a new tensor or by wrapping it with
+// TensorFromExternalBuffer().
+void BM_FeedLargeTensor(::testing::benchmark::State& state) {
+  const bool use_external_buffer = state.range(0);
+  const int64_t num_elements = state.range(1) * (1 << 20) / sizeof(float);
+  const size_t num_bytes = num_elements * sizeof(float);
+
+  Graph g(OpRegistry::Global());
+  Tensor value(DT_FLOAT, TensorShape({num_elements}));
+  value.flat<float>().setZero();
+  Node* x = test::graph::Constant(&g, value);
+  Node* identity = test::graph::Identity(&g, x);
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  std::unique_ptr<Session> session(NewSession(SessionOptions()));
+  TF_CHECK_OK(session->Create(gd));
+
+  void* request =
+      port::AlignedMalloc(num_bytes, std::max(1, EIGEN_MAX_ALIGN_BYTES));
+  memset(request, 0, num_bytes);
+  for (auto s : state) {
+    Tensor feed;
+    if (use_external_buffer) {
+      TF_CHECK_OK(TensorFromExternalBuffer(DT_FLOAT,
+                                           TensorShape({num_elements}), request,
+                                           num_bytes, nullptr, &feed));
+    } else {
+      feed = Tensor(DT_FLOAT, TensorShape({num_elements}));
+      memcpy(feed.data(), request, num_bytes);
+    }
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({{x->name(), feed}}, {identity->name() + ":0"},
+                             {}, &outputs));
+  }
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+  port::AlignedFree(request);
+}
+
+// Measures the time from creating a session for a graph of `num_nodes` nodes
+// to the end of the first run of a callable, which is created either with
+// MakeCallable() or from a state exported by an earlier session.
+void BM_TimeToFirstRun(::testing::benchmark::State& state) {
+  const bool from_state = state.range(0);
+  const int num_nodes = state.range(1);
+
+  Graph g(OpRegistry::Global());
+  Tensor value(DT_FLOAT, TensorShape({16}));
+  value.flat<float>().setZero();
+  Node* x = test::graph::Constant(&g, value);
+  Node* y = x;
+  for (int i = 0; i < num_nodes; ++i) {
+    y = test::graph::Unary(&g, i % 2 == 0 ? "Neg" : "Square", y);
+  }
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  CallableOptions callable_options;
+  callable_options.add_feed(x->name());
+  callable_options.add_fetch(y->name() + ":0");
+
+  CallableState callable_state;
+  {
+    std::unique_ptr<Session> session(NewSession(SessionOptions()));
+    TF_CHECK_OK(session->Create(gd));
+    Session::CallableHandle handle;
+    TF_CHECK_OK(session->MakeCallable(callable_options, &handle));
+    TF_CHECK_OK(static_cast<DirectSession*>(session.get())
+                    ->ExportCallableState(handle, &callable_state));
+  }
+
+  for (auto s : state) {
+    std::unique_ptr<Session> session(NewSession(SessionOptions()));
+    TF_CHECK_OK(session->Create(gd));
+    Session::CallableHandle handle;
+    if (from_state) {
+      TF_CHECK_OK(static_cast<DirectSession*>(session.get())
+                      ->MakeCallableFromState(callable_state, &handle));
+    } else {
+      TF_CHECK_OK(session->MakeCallable(callable_options, &handle));
+    }
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->RunCallable(handle, {value}, &outputs, nullptr));
+  }
+  state.SetLabel(from_state ? "from_state" : "make_callable");
+}
+
 BENCHMARK(BM_FeedFetch)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 BENCHMARK(BM_FeedFetchCallable)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 BENCHMARK(BM_FeedFetchCallableSingleThread)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
@@ -2736,6 +3007,16 @@ BENCHMARK(BM_FeedFetchCallableSingleThreadExecutor)
     ->Arg(2)
     ->Arg(5)
     ->Arg(10);
+BENCHMARK(BM_FeedLargeTensor)
+    ->ArgPair(0, 4)
+    ->ArgPair(1, 4)
+    ->ArgPair(0, 64)
+    ->ArgPair(1, 64);
+BENCHMARK(BM_TimeToFirstRun)
+    ->ArgPair(0, 100)
+    ->ArgPair(1, 100)
+    ->ArgPair(0, 2000)
+    ->ArgPair(1, 2000);
 
 }  // namespace
 
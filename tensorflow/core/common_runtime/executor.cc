@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <cstring>
 #include <memory>
 #include <vector>
 
@@ -34,7 +35,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/common_runtime/work_stealing_scheduler.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -45,6 +48,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/op_segment.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/framework/types.h"
@@ -61,11 +65,13 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/profile_utils/cpu_utils.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/thread_annotations.h"
@@ -78,6 +84,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/util/determinism.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/managed_stack_trace.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
 
@@ -143,9 +150,42 @@ struct KernelTimer {
 typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
 typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
 
+// Upper bound on the number of workers (and per-worker ready queues) a single
+// step uses in work-stealing mode.
+constexpr int kMaxWorkStealingLanes = 64;
+
+// Name of the pseudo-node under which a step's arena statistics are saved.
+constexpr char kStepArenaNodeName[] = "_StepArena";
+
+// Returns true if the steps of an executor built from `p` should serve their
+// temporaries from a StepArenaAllocator. Only CPU devices are supported.
+bool UseStepArena(const LocalExecutorParams& p) {
+  if (p.device == nullptr || p.device->device_type() != DEVICE_CPU) {
+    return false;
+  }
+  bool use_step_arena = false;
+  Status status = ReadBoolFromEnvVar(kStepArenaEnvVar,
+                                     /*default_val=*/false, &use_step_arena);
+  if (!status.ok()) {
+    LOG(ERROR) << "Executor: " << status.error_message();
+  }
+  return use_step_arena;
+}
+
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  // If `work_stealing` is true, ready nodes that are not run inline are handed
+  // to a per-step WorkStealingScheduler instead of being dispatched to the
+  // runner one closure per node.
+  explicit ExecutorImpl(const LocalExecutorParams& p,
+                        bool work_stealing = false)
+      : immutable_state_(p),
+        work_stealing_(work_stealing) {
+    if (UseStepArena(p)) {
+      step_arena_pool_ = std::make_unique<StepArenaPool>(
+          p.device->GetAllocator(AllocatorAttributes()));
+    }
+  }
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
@@ -223,6 +263,10 @@ class ExecutorImpl : public Executor {
 
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  const bool work_stealing_;
+  // If non-null, every step serves its temporaries from an arena taken from
+  // this pool.
+  std::unique_ptr<StepArenaPool> step_arena_pool_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
@@ -281,7 +325,9 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                bool work_stealing = false,
+                StepArenaPool* step_arena_pool = nullptr);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -293,6 +339,13 @@ class ExecutorState {
       typename PropagatorStateType::TaggedNodeReadyQueue TaggedNodeReadyQueue;
   typedef typename PropagatorStateType::TaggedNodeSeq TaggedNodeSeq;
 
+  // A ready node queued in `work_stealing_scheduler_`.
+  struct ScheduledNode {
+    TaggedNode tagged_node;
+    int64_t scheduled_nsec;
+  };
+  typedef WorkStealingScheduler<ScheduledNode> Scheduler;
+
   struct AsyncState;
 
   // Process a ready node in current thread.
@@ -343,6 +396,17 @@ class ExecutorState {
   template <typename Closure>
   void RunTask(Closure&& c, int sample_rate = 0);
 
+  // Dispatches `tagged_node` to another thread, through
+  // `work_stealing_scheduler_` when it is set and otherwise with RunTask().
+  // `scheduler` must be a reference to `work_stealing_scheduler_` owned by the
+  // caller: once the last outstanding node has been dispatched, `this` may be
+  // deleted before this method returns.
+  void ScheduleNode(Scheduler* scheduler, const TaggedNode& tagged_node,
+                    int64_t scheduled_nsec, int sample_rate);
+
+  // Saves the statistics of `step_arena_` to `stats_collector_`.
+  void SaveStepArenaStats();
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
@@ -395,6 +459,17 @@ class ExecutorState {
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
 
+  // Non-null iff the executor runs in work-stealing mode. Shared with the
+  // scheduler's workers, which may outlive this object.
+  std::shared_ptr<Scheduler> work_stealing_scheduler_;
+
+  // Non-null iff the temporaries of this step are served from a per-step
+  // arena. Returned to its pool after `propagator_` is destroyed, which reuses
+  // it if no tensor outlives the step.
+  StepArenaPool::ArenaPtr step_arena_;
+  // Only set if `step_arena_` and `stats_collector_` are non-null.
+  int64_t step_start_nanos_ = 0;
+
   PropagatorStateType propagator_;
 
   // Invoked when the execution finishes.
@@ -415,7 +490,8 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats, bool work_stealing,
+    StepArenaPool* step_arena_pool)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -450,6 +526,21 @@ ExecutorState<PropagatorStateType>::ExecutorState(
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (work_stealing && !run_all_kernels_inline_) {
+    const int num_lanes =
+        std::max(1, std::min(port::MaxParallelism(), kMaxWorkStealingLanes));
+    work_stealing_scheduler_ = std::make_shared<Scheduler>(
+        num_lanes, runner_,
+        [this](const ScheduledNode& node) {
+          Process(node.tagged_node, node.scheduled_nsec);
+        });
+  }
+  if (step_arena_pool != nullptr) {
+    step_arena_ = step_arena_pool->Get();
+    if (stats_collector_) {
+      step_start_nanos_ = Env::Default()->NowNanos();
+    }
+  }
 }
 
 template <class PropagatorStateType>
@@ -458,6 +549,37 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
     device_context_->Unref();
   }
   delete slice_reader_cache_;
+  if (step_arena_ != nullptr && stats_collector_) {
+    SaveStepArenaStats();
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::SaveStepArenaStats() {
+  const StepArenaAllocator::ArenaStats arena_stats =
+      step_arena_->GetArenaStats();
+  const int64_t step_nanos = Env::Default()->NowNanos() - step_start_nanos_;
+  auto* summary = new NodeExecStats;
+  summary->set_node_name(kStepArenaNodeName);
+  summary->set_all_start_micros(step_start_nanos_ / 1000);
+  summary->set_all_start_nanos(step_start_nanos_);
+  summary->set_op_end_rel_micros(step_nanos / 1000);
+  summary->set_op_end_rel_nanos(step_nanos);
+  summary->set_all_end_rel_micros(step_nanos / 1000);
+  summary->set_all_end_rel_nanos(step_nanos);
+
+  AllocatorMemoryUsed* arena = summary->add_memory();
+  arena->set_allocator_name(step_arena_->Name());
+  arena->set_total_bytes(arena_stats.arena_bytes);
+  arena->set_peak_bytes(arena_stats.bytes_reserved);
+  arena->set_num_allocations(arena_stats.num_arena_allocs);
+
+  AllocatorMemoryUsed* backing = summary->add_memory();
+  backing->set_allocator_name(step_arena_->backing()->Name());
+  backing->set_num_allocations(arena_stats.num_backing_allocs);
+
+  stats_collector_->SaveStepSummary(immutable_state_.params().device->name(),
+                                    summary);
 }
 
 template <class PropagatorStateType>
@@ -484,6 +606,19 @@ void ExecutorState<PropagatorStateType>::RunTask(Closure&& c, int sample_rate) {
   });
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ScheduleNode(
+    Scheduler* scheduler, const TaggedNode& tagged_node,
+    int64_t scheduled_nsec, int sample_rate) {
+  if (scheduler != nullptr &&
+      scheduler->Schedule(ScheduledNode{tagged_node, scheduled_nsec})) {
+    return;
+  }
+  // The scheduler is full (or disabled): fall back to one closure per node.
+  RunTask(std::bind(&ExecutorState::Process, this, tagged_node, scheduled_nsec),
+          sample_rate);
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
   TaggedNodeSeq ready;
@@ -876,6 +1011,10 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
 
       // Set up compute params.
       params.op_kernel = item.kernel;
+      // Kernels that may keep their temporaries past the step allocate them
+      // from the device instead of the step arena.
+      params.temp_allocator =
+          item.may_retain_temps ? nullptr : step_arena_.get();
       params.frame_iter = propagator_.GetFrameAndIter(tagged_node);
       params.is_input_dead = is_input_dead;
       params.output_attr_array = item.output_attrs();
@@ -1120,6 +1259,28 @@ Status ExecutorState<PropagatorStateType>::ProcessOutputs(
                                           ctx->step_id(), i, to_log);
           }
         } else {
+          if (TF_PREDICT_FALSE(step_arena_ != nullptr) &&
+              item.outputs_may_escape && val.tensor->IsInitialized() &&
+              step_arena_->Owns(val.tensor->tensor_data().data())) {
+            // A temporary passed on as an output that may outlive the step,
+            // e.g. as a fetched value, moves out of the step arena. Other
+            // outputs are handed to their consumers as they are. The arena
+            // only serves small memcpy-able tensors on CPU.
+            Tensor copy(ctx->get_allocator(out->alloc_attr), dtype,
+                        val.tensor->shape());
+            if (!copy.IsInitialized()) {
+              s.Update(errors::ResourceExhausted(
+                  "OOM when copying output ", i, " of ",
+                  FormatNodeDefForError(item.kernel->def()),
+                  " out of the step arena"));
+              delete val.tensor;
+              continue;
+            }
+            std::memcpy(const_cast<char*>(copy.tensor_data().data()),
+                        val.tensor->tensor_data().data(),
+                        val.tensor->TotalBytes());
+            *val.tensor = std::move(copy);
+          }
           // NOTE that std::move is used here, so val.tensor goes to
           // uninitialized state (val.tensor->IsInitialized return false).
           out->state = Entry::State::HAS_VALUE;
@@ -1272,11 +1433,16 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   } else {
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
+    // Keeps the scheduler alive even if dispatching the last node lets the
+    // step complete and delete `this`.
+    std::shared_ptr<Scheduler> scheduler = work_stealing_scheduler_;
     if (inline_ready == nullptr) {
-      // Schedule to run all the ready ops in thread pool.
+      // Schedule to run all the ready ops in thread pool. In work-stealing
+      // mode they are queued on the scheduler's lanes, so that a worker runs
+      // many of them back to back instead of paying one runner closure each.
       for (auto& tagged_node : *ready) {
-        RunTask([=]() { Process(tagged_node, scheduled_nsec); },
-                /*sample_rate=*/ready->size());
+        ScheduleNode(scheduler.get(), tagged_node, scheduled_nsec,
+                     /*sample_rate=*/ready->size());
       }
     } else {
       for (auto& tagged_node : *ready) {
@@ -1302,11 +1468,11 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       }
     }
     if (!expensive_nodes.empty()) {
-      if (expensive_nodes.size() < kInlineScheduleReadyThreshold) {
+      if (scheduler != nullptr ||
+          expensive_nodes.size() < kInlineScheduleReadyThreshold) {
         for (auto& tagged_node : expensive_nodes) {
-          RunTask(std::bind(&ExecutorState::Process, this, tagged_node,
-                            scheduled_nsec),
-                  /*sample_rate=*/expensive_nodes.size());
+          ScheduleNode(scheduler.get(), tagged_node, scheduled_nsec,
+                       /*sample_rate=*/expensive_nodes.size());
         }
       } else {
         // There are too many ready expensive nodes. Schedule them in child
@@ -1484,24 +1650,31 @@ void ExecutorState<PropagatorStateType>::Finish() {
 
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
   if (OpOrderDeterminismRequired()) {
-    (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+    (new ExecutorState<OrderedPropagatorState>(
+         args, immutable_state_, &kernel_stats_, /*work_stealing=*/false,
+         step_arena_pool_.get()))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_,
+                                        work_stealing_,
+                                        step_arena_pool_.get()))
         ->RunAsync(std::move(done));
   } else {
     (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+                                              &kernel_stats_, work_stealing_,
+                                              step_arena_pool_.get()))
         ->RunAsync(std::move(done));
   }
 }
 
 }  // namespace
 
-Status NewLocalExecutor(const LocalExecutorParams& params, const Graph& graph,
-                        Executor** executor) {
-  ExecutorImpl* impl = new ExecutorImpl(params);
+namespace {
+
+Status NewLocalExecutorImpl(const LocalExecutorParams& params,
+                            const Graph& graph, bool work_stealing,
+                            Executor** executor) {
+  ExecutorImpl* impl = new ExecutorImpl(params, work_stealing);
   const Status s = impl->Initialize(graph);
   if (s.ok()) {
     *executor = impl;
@@ -1511,6 +1684,13 @@ Status NewLocalExecutor(const LocalExecutorParams& params, const Graph& graph,
   return s;
 }
 
+}  // namespace
+
+Status NewLocalExecutor(const LocalExecutorParams& params, const Graph& graph,
+                        Executor** executor) {
+  return NewLocalExecutorImpl(params, graph, /*work_stealing=*/false, executor);
+}
+
 Status CreateNonCachedKernel(Device* device, FunctionLibraryRuntime* flib,
                              const std::shared_ptr<const NodeProperties>& props,
                              int graph_def_version, OpKernel** kernel) {
@@ -1546,6 +1726,31 @@ class DefaultExecutorRegistrar {
 };
 static DefaultExecutorRegistrar registrar;
 
+// Registers the "WORK_STEALING" executor: the default executor, but with ready
+// nodes handed between a bounded set of per-step workers through per-worker
+// deques (see WorkStealingScheduler) rather than one runner closure per node.
+// This reduces contention on the shared thread pool queue for wide graphs of
+// small kernels.
+class WorkStealingExecutorRegistrar {
+ public:
+  WorkStealingExecutorRegistrar() {
+    ExecutorFactory::Register("WORK_STEALING", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      Executor* ret = nullptr;
+      TF_RETURN_IF_ERROR(NewLocalExecutorImpl(params, graph,
+                                              /*work_stealing=*/true, &ret));
+      out_executor->reset(ret);
+      return OkStatus();
+    }
+  };
+};
+static WorkStealingExecutorRegistrar work_stealing_registrar;
+
 }  // namespace
 
 }  // namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor.h"
 
 #include <algorithm>
+#include <atomic>
 
 #include "tensorflow/cc/framework/ops.h"
 #include "tensorflow/cc/ops/array_ops.h"
@@ -25,22 +26,28 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/test.h"
@@ -72,8 +79,10 @@ class ExecutorTest : public ::testing::Test {
     delete exec_;
   }
 
-  // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
+  // Resets executor_ with a new executor based on a graph 'gdef'. A non-empty
+  // `executor_type` selects a registered ExecutorFactory.
+  void Create(std::unique_ptr<const Graph> graph,
+              const string& executor_type = "") {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
@@ -88,7 +97,13 @@ class ExecutorTest : public ::testing::Test {
     };
     rendez_ = NewLocalRendezvous();
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    if (executor_type.empty()) {
+      TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    } else {
+      std::unique_ptr<Executor> executor;
+      TF_CHECK_OK(NewExecutor(executor_type, params, *graph, &executor));
+      exec_ = executor.release();
+    }
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
@@ -435,6 +450,191 @@ TEST_F(ExecutorTest, NoInputTensors) {
   TF_ASSERT_OK(Run(rendez_));
 }
 
+TEST_F(ExecutorTest, WorkStealingRandomTree) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "WORK_STEALING");
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
+TEST_F(ExecutorTest, WorkStealingWideGraphRepeatedSteps) {
+  // Many independent roots, each feeding a few identities, run for several
+  // steps to exercise stealing and worker shutdown between steps.
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  for (int i = 0; i < 1024; ++i) {
+    Node* const_node = test::graph::Constant(g.get(), VI(i));
+    for (int j = 0; j < 4; ++j) {
+      test::graph::Identity(g.get(), const_node);
+    }
+  }
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g), "WORK_STEALING");
+  for (int step = 0; step < 20; ++step) {
+    TF_ASSERT_OK(Run(rendez_));
+  }
+}
+
+TEST_F(ExecutorTest, StepArenaStats) {
+  setenv(kStepArenaEnvVar, "true", /*overwrite=*/1);
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(64, g.get());
+  Create(std::move(g));
+  unsetenv(kStepArenaEnvVar);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(64.0, V(out));
+
+  step_stats_collector_.Finalize();
+  int num_summaries = 0;
+  for (const auto& dev_stats : step_stats_.dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      if (node_stats.node_name() != "_StepArena") continue;
+      ++num_summaries;
+      ASSERT_EQ(2, node_stats.memory_size());
+      EXPECT_EQ("step_arena", node_stats.memory(0).allocator_name());
+      EXPECT_GE(node_stats.all_end_rel_nanos(), 0);
+    }
+  }
+  EXPECT_EQ(1, num_summaries);
+}
+
+// The buffer of the last temporary allocated by DoubleThroughTempOp.
+std::atomic<const void*> last_double_temp{nullptr};
+
+// Doubles its input into a temporary, which it then passes on as its output.
+class DoubleThroughTempOp : public OpKernel {
+ public:
+  explicit DoubleThroughTempOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    Tensor temp;
+    OP_REQUIRES_OK(ctx, ctx->allocate_temp(DT_FLOAT, TensorShape({}), &temp));
+    temp.scalar<float>()() = 2 * ctx->input(0).scalar<float>()();
+    last_double_temp = temp.tensor_data().data();
+    ctx->set_output(0, temp);
+  }
+};
+
+REGISTER_OP("DoubleThroughTemp").Input("x: float").Output("y: float");
+REGISTER_KERNEL_BUILDER(Name("DoubleThroughTemp").Device(DEVICE_CPU),
+                        DoubleThroughTempOp);
+
+// The buffer and value of the last input seen by RecordInputOp.
+std::atomic<const void*> last_recorded_input{nullptr};
+std::atomic<float> last_recorded_value{0};
+
+class RecordInputOp : public OpKernel {
+ public:
+  explicit RecordInputOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    last_recorded_input = ctx->input(0).tensor_data().data();
+    last_recorded_value = ctx->input(0).scalar<float>()();
+  }
+};
+
+REGISTER_OP("RecordInput").Input("x: float");
+REGISTER_KERNEL_BUILDER(Name("RecordInput").Device(DEVICE_CPU),
+                        RecordInputOp);
+
+// Keeps nothing, but is stateful, so its inputs may outlive the step.
+class RetainInputOp : public OpKernel {
+ public:
+  explicit RetainInputOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
+  void Compute(OpKernelContext* ctx) override {}
+};
+
+REGISTER_OP("RetainInput").Input("x: float").SetIsStateful();
+REGISTER_KERNEL_BUILDER(Name("RetainInput").Device(DEVICE_CPU),
+                        RetainInputOp);
+
+TEST_F(ExecutorTest, StepArenaTempPassedOnAsOutput) {
+  setenv(kStepArenaEnvVar, "true", /*overwrite=*/1);
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* v = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  for (int i = 0; i < 4; ++i) {
+    TF_ASSERT_OK(NodeBuilder(g->NewName("n"), "DoubleThroughTemp")
+                     .Input(v)
+                     .Finalize(g.get(), &v));
+  }
+  test::graph::Send(g.get(), v, "b", BOB, 1, ALICE);
+  Create(std::move(g));
+  unsetenv(kStepArenaEnvVar);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  // The value is sent out of the step, so it must have been moved out of the
+  // arena.
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(16.0, V(out));
+
+  step_stats_collector_.Finalize();
+  int64_t num_arena_allocs = -1;
+  for (const auto& dev_stats : step_stats_.dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      if (node_stats.node_name() != "_StepArena") continue;
+      num_arena_allocs = node_stats.memory(0).num_allocations();
+    }
+  }
+  EXPECT_EQ(4, num_arena_allocs);
+  EXPECT_NE(last_double_temp.load(), out.tensor_data().data());
+}
+
+TEST_F(ExecutorTest, StepArenaForwardsTempsThatDoNotEscape) {
+  setenv(kStepArenaEnvVar, "true", /*overwrite=*/1);
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* v = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK(NodeBuilder(g->NewName("n"), "DoubleThroughTemp")
+                     .Input(v)
+                     .Finalize(g.get(), &v));
+  }
+  Node* record;
+  TF_ASSERT_OK(NodeBuilder(g->NewName("n"), "RecordInput")
+                   .Input(v)
+                   .Finalize(g.get(), &record));
+  Create(std::move(g));
+  unsetenv(kStepArenaEnvVar);
+  for (int step = 0; step < 3; ++step) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0 + step), false));
+    TF_ASSERT_OK(Run(rendez_));
+    // The temporary reached its consumer without a copy.
+    EXPECT_EQ(last_double_temp.load(), last_recorded_input.load());
+    EXPECT_EQ(4 * (1.0 + step), last_recorded_value.load());
+  }
+
+  // Later steps reuse the chunk of the first one.
+  step_stats_collector_.Finalize();
+  std::vector<int64_t> num_backing_allocs;
+  for (const auto& dev_stats : step_stats_.dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      if (node_stats.node_name() != "_StepArena") continue;
+      num_backing_allocs.push_back(node_stats.memory(1).num_allocations());
+    }
+  }
+  EXPECT_EQ(std::vector<int64_t>({1, 0, 0}), num_backing_allocs);
+}
+
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
 // control dependencies.
@@ -516,6 +716,115 @@ BENCHMARK(BM_const_identity)
     ->ArgPair(100, 1)
     ->ArgPair(100, 100);
 
+// Runs 256 chains of 8 kernels that pass a temporary on as their output, with
+// the temporaries served from the device (range(0) == 0) or a step arena (1).
+// If range(1) == 1, every chain ends in a stateful op, so the outputs of its
+// kernels may escape the step and are copied out of the arena.
+static void BM_StepArenaChains(::testing::benchmark::State& state) {
+  const bool use_arena = state.range(0) != 0;
+  const bool escape = state.range(1) != 0;
+  constexpr int kChains = 256;
+  constexpr int kDepth = 8;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  for (int i = 0; i < kChains; ++i) {
+    Node* v = test::graph::Constant(g, V(1.0));
+    for (int j = 0; j < kDepth; ++j) {
+      TF_CHECK_OK(NodeBuilder(g->NewName("n"), "DoubleThroughTemp")
+                      .Input(v)
+                      .Finalize(g, &v));
+    }
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"),
+                            escape ? "RetainInput" : "RecordInput")
+                    .Input(v)
+                    .Finalize(g, nullptr));
+  }
+  FixupSourceAndSinkEdges(g);
+  if (use_arena) setenv(kStepArenaEnvVar, "true", /*overwrite=*/1);
+  test::Benchmark bm("cpu", g, /*old_benchmark_api=*/false);
+  unsetenv(kStepArenaEnvVar);
+  bm.Run(state);
+  state.SetItemsProcessed(kChains * kDepth *
+                          static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_StepArenaChains)
+    ->UseRealTime()
+    ->ArgPair(0, 0)
+    ->ArgPair(1, 0)
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 1);
+
+// Measures the per-step latency of a wide graph of small kernels on a dedicated
+// pool of `num_threads` threads, for the default (range(1) == 0) and the
+// work-stealing (range(1) == 1) executor.
+static void BM_WideGraphStepLatency(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const bool work_stealing = state.range(1) != 0;
+  constexpr int kWidth = 1024;
+  constexpr int kOutputsPerConst = 4;
+
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  for (int i = 0; i < kWidth; ++i) {
+    Node* const_node = test::graph::Constant(g.get(), Tensor(i));
+    for (int j = 0; j < kOutputsPerConst; ++j) {
+      test::graph::Identity(g.get(), const_node);
+    }
+  }
+  FixupSourceAndSinkEdges(g.get());
+
+  std::unique_ptr<Device> device(DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0"));
+  thread::ThreadPool pool(Env::Default(), "wide_graph", num_threads);
+  const int version = g->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  std::unique_ptr<Executor> executor;
+  TF_CHECK_OK(NewExecutor(work_stealing ? "WORK_STEALING" : "", params, *g,
+                          &executor));
+
+  Rendezvous* rendez = NewLocalRendezvous();
+  Executor::Args args;
+  args.rendezvous = rendez;
+  args.runner = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+
+  std::vector<double> step_usecs;
+  for (auto s : state) {
+    const uint64 start_nsec = Env::Default()->NowNanos();
+    TF_CHECK_OK(executor->Run(args));
+    step_usecs.push_back((Env::Default()->NowNanos() - start_nsec) / 1e3);
+  }
+  executor.reset();
+  rendez->Unref();
+
+  std::sort(step_usecs.begin(), step_usecs.end());
+  auto percentile = [&step_usecs](double p) {
+    return step_usecs[std::min(step_usecs.size() - 1,
+                               static_cast<size_t>(p * step_usecs.size()))];
+  };
+  if (!step_usecs.empty()) {
+    state.counters["step_p50_us"] = percentile(0.5);
+    state.counters["step_p99_us"] = percentile(0.99);
+  }
+  state.SetLabel(work_stealing ? "WORK_STEALING" : "DEFAULT");
+  state.SetItemsProcessed((1 + kOutputsPerConst) * kWidth *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_WideGraphStepLatency)
+    ->UseRealTime()
+    ->ArgsProduct({{1, 2, 4, 8, 16, 32, 64}, {0, 1}});
+
 static void BM_FeedInputFetchOutput(::testing::benchmark::State& state) {
   Graph* g = new Graph(OpRegistry::Global());
   // z = x + y: x and y are provided as benchmark inputs.  z is the
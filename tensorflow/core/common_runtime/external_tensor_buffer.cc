@@ -0,0 +1,84 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/external_tensor_buffer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
+
+namespace tensorflow {
+namespace {
+
+// A TensorBuffer over memory owned by the caller, which is notified when the
+// buffer is no longer referenced.
+class ExternalTensorBuffer : public TensorBuffer {
+ public:
+  ExternalTensorBuffer(void* data, size_t num_bytes, std::function<void()> done)
+      : TensorBuffer(data), num_bytes_(num_bytes), done_(std::move(done)) {}
+
+  ~ExternalTensorBuffer() override {
+    if (done_) done_();
+  }
+
+  size_t size() const override { return num_bytes_; }
+  TensorBuffer* root_buffer() override { return this; }
+
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(num_bytes_);
+    proto->set_allocator_name("external");
+  }
+
+  // Prevents kernels from forwarding the buffer to their outputs and
+  // overwriting the caller's memory.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const size_t num_bytes_;
+  std::function<void()> done_;
+};
+
+}  // namespace
+
+Status TensorFromExternalBuffer(DataType dtype, const TensorShape& shape,
+                                void* data, size_t num_bytes,
+                                std::function<void()> done, Tensor* out) {
+  if (!DataTypeCanUseMemcpy(dtype)) {
+    return errors::InvalidArgument("Cannot wrap an external buffer as a ",
+                                   DataTypeString(dtype), " tensor");
+  }
+  const size_t required_bytes = shape.num_elements() * DataTypeSize(dtype);
+  if (num_bytes < required_bytes) {
+    return errors::InvalidArgument("External buffer of ", num_bytes,
+                                   " bytes is too small for a ",
+                                   DataTypeString(dtype), " tensor of shape ",
+                                   shape.DebugString());
+  }
+  if (reinterpret_cast<uintptr_t>(data) % std::max(1, EIGEN_MAX_ALIGN_BYTES) !=
+      0) {
+    return errors::InvalidArgument("External buffer at ", data,
+                                   " is not aligned to ", EIGEN_MAX_ALIGN_BYTES,
+                                   " bytes");
+  }
+  auto* buf = new ExternalTensorBuffer(data, num_bytes, std::move(done));
+  *out = Tensor(dtype, shape, buf);
+  buf->Unref();
+  return OkStatus();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,50 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_EXTERNAL_TENSOR_BUFFER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_EXTERNAL_TENSOR_BUFFER_H_
+
+#include <functional>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+
+// Wraps `num_bytes` of host memory at `data`, which the caller owns (e.g. a
+// shared-memory region filled by another process, or the payload of a
+// request), as a tensor of `dtype` and `shape` without copying it.  The
+// result can be passed as a feed to Session::Run() or Session::RunCallable();
+// on CPU devices the kernels that consume it read the caller's memory
+// directly.
+//
+// `done` is called exactly once, when the last reference to the buffer goes
+// away: that is after the step that consumed the feed has completed and the
+// caller has dropped both `*out` and any fetched output that aliases it (e.g.
+// the output of an Identity of the feed).  The memory must stay valid and
+// unmodified until then.  Kernels never write to the buffer in place.
+//
+// `data` must be aligned to EIGEN_MAX_ALIGN_BYTES and `dtype` must be a type
+// whose values are plain bytes (i.e. not DT_STRING, DT_RESOURCE or
+// DT_VARIANT).  On error, `done` is not called.
+Status TensorFromExternalBuffer(DataType dtype, const TensorShape& shape,
+                                void* data, size_t num_bytes,
+                                std::function<void()> done, Tensor* out);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_EXTERNAL_TENSOR_BUFFER_H_
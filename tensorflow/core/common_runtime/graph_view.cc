@@ -80,6 +80,12 @@ OutputAndControlEdges CountOutputEdges(const Node* n) {
   }
   return OutputAndControlEdges(num_output_edges, num_output_control_edges);
 }
+
+// True iff a kernel may hold on to a tensor it allocated through an input or
+// output of type `dt`, e.g. by storing it in a resource or a variant.
+bool MayRetainTemps(DataType dt) {
+  return IsRefType(dt) || dt == DT_RESOURCE || dt == DT_VARIANT;
+}
 }  // namespace
 
 size_t GraphView::NodeItemBytes(const Node* n) {
@@ -194,10 +200,13 @@ char* GraphView::InitializeNode(char* ptr, const Node* n) {
   DCHECK_LT(DataType_MAX, 255);  // Must fit in uint8
   uint8* input_types = item->input_type_base();
   item->is_any_input_ref_typed = false;
+  item->may_retain_temps = n->op_def().is_stateful();
+  item->outputs_may_escape = false;
   for (int i = 0; i < num_inputs; i++) {
     input_types[i] = static_cast<uint8>(n->input_type(i));
     DCHECK_EQ(item->input_type(i), n->input_type(i));
     item->is_any_input_ref_typed |= IsRefType(n->input_type(i));
+    item->may_retain_temps |= MayRetainTemps(n->input_type(i));
   }
 
   // Check ScopedAllocatorAttrs and forward_from.  Also assign output_types.
@@ -214,6 +223,7 @@ char* GraphView::InitializeNode(char* ptr, const Node* n) {
     for (int i = 0; i < num_outputs; ++i) {
       output_types[i] = static_cast<uint8>(n->output_type(i));
       DCHECK_EQ(item->output_type(i), n->output_type(i));
+      item->may_retain_temps |= MayRetainTemps(n->output_type(i));
 
       forward_from[i] = OpKernelContext::Params::kNoReservation;
       if (sa_status.ok()) {
@@ -285,9 +295,40 @@ Status GraphView::Initialize(const Graph* g) {
     }
   }
   CHECK_EQ(ptr, space_ + total_bytes);
+  MarkEscapingOutputs(g);
   return OkStatus();
 }
 
+void GraphView::MarkEscapingOutputs(const Graph* g) {
+  // A kernel may pass an input buffer on as an output, so the outputs of a
+  // node escape if any of its consumers may retain them, or if the outputs
+  // of any of its consumers escape.
+  std::vector<const Node*> worklist;
+  for (const Node* n : g->nodes()) {
+    for (const Edge* e : n->out_edges()) {
+      if (e->IsControlEdge()) continue;
+      const NodeItem* dst = node(e->dst()->id());
+      if (dst->may_retain_temps || e->dst()->IsFunctionCall()) {
+        node(n->id())->outputs_may_escape = true;
+        worklist.push_back(n);
+        break;
+      }
+    }
+  }
+  while (!worklist.empty()) {
+    const Node* n = worklist.back();
+    worklist.pop_back();
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge()) continue;
+      NodeItem* src = node(e->src()->id());
+      if (!src->outputs_may_escape) {
+        src->outputs_may_escape = true;
+        worklist.push_back(e->src());
+      }
+    }
+  }
+}
+
 namespace {
 // If a Node has been marked to use a ScopedAllocator x for output i, then
 // sc_attr will contain the subsequence (i, x) at an even offset.  This function
@@ -85,6 +85,12 @@ struct NodeItem {
                                     // node's input types.
   bool is_distributed_communication : 1;  // True iff the op is registered to
                                           // use distributed communication.
+  // True iff the op is stateful, or has a ref, resource or variant input or
+  // output, through which the kernel may keep a temporary beyond the step.
+  bool may_retain_temps : 1;
+  // True iff the outputs of the node may reach a node that may retain them or
+  // a function call, possibly through nodes that forward their inputs.
+  bool outputs_may_escape : 1;
 
   // The kernel for this node.
   OpKernel* kernel = nullptr;
@@ -242,6 +248,8 @@ class GraphView {
  private:
   char* InitializeNode(char* ptr, const Node* n);
   size_t NodeItemBytes(const Node* n);
+  // Sets `outputs_may_escape` on every node once all nodes are initialized.
+  void MarkEscapingOutputs(const Graph* g);
 
   int32 num_nodes_ = 0;
   uint32* node_offsets_ = nullptr;  // array of size "num_nodes_"
@@ -23,6 +23,7 @@ namespace tsl {
 class Status;
 }
 namespace tensorflow {
+class CostModel;
 class Device;
 class StepStatsCollector;
 class SessionMetadata;
@@ -52,6 +53,13 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // Optional per-node execution cost estimates for the graph. Executors that
+  // precompute a schedule (e.g. the "STATIC_PLAN" executor) use it when set;
+  // others ignore it. DirectSession sets it from the costs measured by earlier
+  // steps when GraphOptions.build_cost_model is on. Not owned, and only valid
+  // until NewExecutor() returns, so executors must not read it afterwards.
+  const CostModel* cost_model = nullptr;
 };
 
 }  // end namespace tensorflow
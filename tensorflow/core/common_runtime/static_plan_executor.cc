@@ -0,0 +1,791 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_plan_executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/entry.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
+#include "tensorflow/core/common_runtime/renamed_device.h"
+#include "tensorflow/core/common_runtime/single_threaded_executor.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/costmodel.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+const char kStaticPlanMaxPartitionsEnvVar[] =
+    "TF_STATIC_PLAN_EXECUTOR_MAX_PARTITIONS";
+
+namespace {
+
+typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
+typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
+
+static const string& kStaticPlanExecutor = *new string("STATIC_PLAN");
+
+// Cost estimates, in microseconds, used by the list scheduler when the cost
+// model has no data for a node.
+constexpr int64_t kDefaultCheapKernelCostUsecs = 1;
+constexpr int64_t kDefaultExpensiveKernelCostUsecs = 10;
+
+// Estimated delay for a value produced in one partition to be usable in
+// another one (an atomic update and, possibly, a thread hand-off).
+constexpr int64_t kCrossPartitionCostUsecs = 5;
+
+// Estimated cost of starting one more partition for a step, i.e. of one more
+// closure going through the runner.
+constexpr int64_t kPartitionStartCostUsecs = 10;
+
+constexpr int64_t kMaxDefaultPartitions = 8;
+
+int64_t MaxPartitions() {
+  static const int64_t max_partitions = []() {
+    int64_t value;
+    Status s = ReadInt64FromEnvVar(kStaticPlanMaxPartitionsEnvVar,
+                                   /*default_val=*/0, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      value = 0;
+    }
+    if (value <= 0) {
+      value = std::min<int64_t>(port::MaxParallelism(), kMaxDefaultPartitions);
+    }
+    return std::max<int64_t>(value, 1);
+  }();
+  return max_partitions;
+}
+
+// Returns `params` without `cost_model`, which is only valid while the
+// executor is created.
+LocalExecutorParams WithoutCostModel(LocalExecutorParams params) {
+  params.cost_model = nullptr;
+  return params;
+}
+
+class StaticPlanExecutorImpl : public Executor {
+ public:
+  explicit StaticPlanExecutorImpl(const LocalExecutorParams& params)
+      : params_(WithoutCostModel(params)), cost_model_(params.cost_model) {}
+
+  ~StaticPlanExecutorImpl() override {
+    for (const KernelState& kernel_state : kernels_) {
+      params_.delete_kernel(kernel_state.kernel);
+    }
+    for (const ConstTensorKernelState& kernel_state : const_tensor_kernels_) {
+      params_.delete_kernel(kernel_state.kernel);
+    }
+  }
+
+  Status Initialize(const Graph& graph);
+
+  void RunAsync(const Args& args, DoneCallback done) override;
+
+ private:
+  struct StepState;
+
+  // Computes `partitions_`, `KernelState::partition`,
+  // `KernelState::remote_successors` and `initial_pending_counts_` from the
+  // topologically sorted `kernels_`.
+  void BuildPlan(const std::vector<Node*>& nodes_with_kernels,
+                 const absl::flat_hash_map<Node*, size_t>& node_to_index_map);
+
+  int64_t EstimateCostUsecs(const Node& node, OpKernel* kernel) const;
+
+  // Runs the kernels of partition `p` in order, starting at
+  // `step->resume_positions[p]`, until the end of the partition or until a
+  // kernel whose inputs are not ready yet. If `resumed` is true, the inputs
+  // of the first kernel are known to be ready.
+  void RunPartition(StepState* step, int p, bool resumed) const;
+
+  // Runs kernel `i` and forwards its outputs to the inputs of its consumers.
+  Status RunKernel(StepState* step, size_t i, OpKernelContext::Params* params,
+                   TensorValueVec* node_inputs,
+                   AllocatorAttributeVec* input_alloc_attrs) const;
+
+  const LocalExecutorParams params_;
+  // The costs to plan with, from `LocalExecutorParams::cost_model`. Reset by
+  // Initialize(), as the caller may destroy them afterwards.
+  const CostModel* cost_model_;
+
+  // All following members are read-only after Initialize().
+
+  // The sum of the number of inputs for each kernel. This determines the
+  // length of the flat `inputs` vector of a step; see the layout described in
+  // single_threaded_executor.cc.
+  size_t total_num_inputs_;
+
+  // Represents cached graph structure state for each kernel.
+  struct KernelState {
+    // The kernel object. Not owned.
+    //
+    // This pointer is managed by `params_.create_kernel()` and
+    // `params_.delete_kernel()`.
+    OpKernel* kernel;
+
+    // These fields determine the range of elements in `inputs` that corresponds
+    // to the inputs of `kernel`.
+    size_t input_start_index;
+    size_t num_inputs;
+
+    size_t num_outputs;
+
+    // For the `j`th output of `kernel`, `output_locations[j]` contains the
+    // locations in the flat `inputs` vector to which that output must be
+    // copied.
+    std::vector<std::vector<size_t>>
+        output_locations;  // Length = `num_outputs`.
+
+    // Memory space information for each output of `kernel`.
+    std::vector<AllocatorAttributes>
+        output_alloc_attrs;  // Length = `num_outputs`.
+
+    // The partition that runs `kernel`.
+    int partition = 0;
+
+    // Index of this kernel's pending count in `initial_pending_counts_`, or -1
+    // if all of its predecessors run in the same partition.
+    int32 pending_index = -1;
+
+    // Kernels in other partitions that depend on this kernel (deduplicated).
+    std::vector<int32> remote_successors;
+  };
+  // In topological order.
+  std::vector<KernelState> kernels_;
+
+  // For each partition, the indices in `kernels_` of the kernels it runs, in
+  // topological order.
+  std::vector<std::vector<int32>> partitions_;
+
+  // For each kernel with a predecessor in another partition, one more than the
+  // number of such predecessors: the extra count is decremented by the kernel's
+  // own partition when it reaches the kernel.
+  std::vector<int32> initial_pending_counts_;
+
+  // For the `i`th argument, `arg_output_locations_[i]` contains the locations
+  // in the flat `inputs` vector to which that argument must be copied.
+  std::vector<std::vector<size_t>>
+      arg_output_locations_;  // Length = `num_args`.
+
+  // Represents cached graph structure state for each kernel that produces
+  // a single constant-valued tensor.
+  struct ConstTensorKernelState {
+    // The kernel object. Not owned.
+    OpKernel* kernel;
+
+    // The cached value of `kernel->const_tensor()`. Kept as a `Tensor` so that
+    // the reference count on the buffer stays above 1 and consumers never
+    // forward (and mutate) it.
+    Tensor const_tensor;
+
+    // Locations in the flat `inputs` vector to which the output is copied.
+    std::vector<size_t> output_locations;
+  };
+  std::vector<ConstTensorKernelState> const_tensor_kernels_;
+
+  // Memory space information for each input, in the same order as the flat
+  // `inputs` vector.
+  std::vector<AllocatorAttributes>
+      input_alloc_attrs_;  // Length = `total_num_inputs_`.
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticPlanExecutorImpl);
+};
+
+// The state of one step. Owned by the step's partitions: the last partition to
+// finish deletes it.
+struct StaticPlanExecutorImpl::StepState {
+  StepState(size_t num_inputs, size_t num_partitions,
+            const std::vector<int32>& initial_pending_counts,
+            const Args& args, DoneCallback done)
+      : inputs(num_inputs),
+        pending_counts(new std::atomic<int32>[initial_pending_counts.size()]),
+        resume_positions(num_partitions, 0),
+        num_running_partitions(num_partitions),
+        runner(args.runner),
+        done(std::move(done)) {
+    for (size_t i = 0; i < initial_pending_counts.size(); ++i) {
+      pending_counts[i].store(initial_pending_counts[i],
+                              std::memory_order_relaxed);
+    }
+  }
+
+  ~StepState() {
+    if (params.op_device_context != nullptr) {
+      params.op_device_context->Unref();
+    }
+  }
+
+  void Abort(const Status& s) {
+    mutex_lock l(mu);
+    if (status.ok()) status = s;
+    aborted.store(true, std::memory_order_relaxed);
+  }
+
+  // The flat input vector; each element is written by the partition running
+  // its producer and read by the partition running its consumer, ordered by
+  // the consumer's pending count when they differ.
+  std::vector<Entry> inputs;
+  std::unique_ptr<std::atomic<int32>[]> pending_counts;
+  // Position in `partitions_[p]` of the next kernel to run. Only accessed by
+  // the thread currently running partition `p`.
+  std::vector<size_t> resume_positions;
+  std::atomic<int> num_running_partitions;
+  std::atomic<bool> aborted{false};
+
+  // Parameters shared by all kernels; copied by each partition run.
+  OpKernelContext::Params params;
+  Device* device = nullptr;
+  Args::Runner runner;
+  std::unique_ptr<Device> user_device;
+  DoneCallback done;
+
+  mutex mu;
+  Status status TF_GUARDED_BY(mu);
+};
+
+Status StaticPlanExecutorImpl::Initialize(const Graph& graph) {
+  // Topologicially sort `graph` to get a sequence of OpKernels.
+  std::vector<Node*> ordered_nodes;
+  ordered_nodes.reserve(graph.num_nodes());
+  GetReversePostOrder(graph, &ordered_nodes);
+  int ordered_nodes_size = ordered_nodes.size();
+  if (ordered_nodes_size != graph.num_nodes()) {
+    return errors::InvalidArgument("Graph had ", graph.num_nodes(),
+                                   " but reverse post-order had ",
+                                   ordered_nodes.size());
+  }
+
+  kernels_.reserve(ordered_nodes.size() - 2);
+  std::vector<Node*> nodes_with_kernels;
+  std::vector<Node*> nodes_with_const_tensor_kernels;
+  nodes_with_kernels.reserve(ordered_nodes.size() - 2);
+
+  std::map<size_t, Node*> arg_index_to_node_map;
+  absl::flat_hash_map<Node*, size_t> node_to_index_map;
+
+  // Create the kernel and input-related structures for each node in `graph`.
+  for (Node* n : ordered_nodes) {
+    if (n->IsSource() || n->IsSink()) {
+      continue;
+    }
+    TF_RETURN_IF_ERROR(ValidateOpIsSafeForSyncExecution(
+        *n, params_.allow_control_flow_sync_execution));
+    if (n->IsArg()) {
+      int32_t arg_index;
+      TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "index", &arg_index));
+      if (arg_index < 0) {
+        return errors::InvalidArgument("Invalid argument index ", arg_index,
+                                       " in node ", n->name());
+      }
+      arg_index_to_node_map[arg_index] = n;
+      // Arguments are forwarded directly to their consumers.
+      continue;
+    }
+
+    OpKernel* kernel;
+    TF_RETURN_IF_ERROR(params_.create_kernel(n->properties(), &kernel));
+
+    const Tensor* const_tensor;
+    if (n->num_outputs() == 1 && (const_tensor = kernel->const_tensor())) {
+      // Constants are evaluated once and forwarded to their consumers at the
+      // start of every step.
+      const_tensor_kernels_.push_back({});
+      nodes_with_const_tensor_kernels.push_back(n);
+      ConstTensorKernelState& kernel_state = const_tensor_kernels_.back();
+      kernel_state.kernel = kernel;
+      kernel_state.const_tensor = *const_tensor;
+    } else {
+      const size_t kernel_index = kernels_.size();
+      kernels_.push_back({});
+      nodes_with_kernels.push_back(n);
+      KernelState& kernel_state = kernels_[kernel_index];
+      kernel_state.kernel = kernel;
+      kernel_state.num_inputs = n->num_inputs();
+      kernel_state.num_outputs = n->num_outputs();
+      node_to_index_map[n] = kernel_index;
+      if (kernel_index == 0) {
+        kernel_state.input_start_index = 0;
+      } else {
+        const KernelState& previous_kernel_state = kernels_[kernel_index - 1];
+        kernel_state.input_start_index =
+            previous_kernel_state.input_start_index +
+            previous_kernel_state.num_inputs;
+      }
+    }
+  }
+
+  // Build the mapping from each Arg node output to the input slot for the
+  // corresponding destination node.
+  if (!arg_index_to_node_map.empty()) {
+    const size_t num_args = arg_index_to_node_map.rbegin()->first + 1;
+    arg_output_locations_.resize(num_args);
+    for (const auto& arg_index_node_pair : arg_index_to_node_map) {
+      const size_t arg_index = arg_index_node_pair.first;
+      const Node* arg_node = arg_index_node_pair.second;
+      arg_output_locations_[arg_index].reserve(arg_node->out_edges().size());
+      for (const Edge* e : arg_node->out_edges()) {
+        if (e->src_output() == Graph::kControlSlot) {
+          continue;
+        } else if (e->src_output() != 0) {
+          return errors::Internal("Invalid output index ", e->src_output(),
+                                  " from argument node ", arg_index);
+        }
+        arg_output_locations_[arg_index].push_back(
+            kernels_[node_to_index_map[e->dst()]].input_start_index +
+            e->dst_input());
+      }
+    }
+  }
+
+  // Build the mapping from each const tensor kernel to the input slot for the
+  // corresponding destination node.
+  for (size_t i = 0; i < const_tensor_kernels_.size(); ++i) {
+    Node* n = nodes_with_const_tensor_kernels[i];
+    ConstTensorKernelState& kernel_state = const_tensor_kernels_[i];
+    for (const Edge* e : n->out_edges()) {
+      if (e->src_output() == Graph::kControlSlot) {
+        continue;
+      } else if (e->src_output() != 0) {
+        return errors::Internal("Invalid output index ", e->src_output(),
+                                " from node ", n->DebugString());
+      }
+      kernel_state.output_locations.push_back(
+          kernels_[node_to_index_map[e->dst()]].input_start_index +
+          e->dst_input());
+    }
+  }
+
+  // Build the mapping from each node output to the input slot for the
+  // corresponding destination node, and the allocator attributes of each
+  // output.
+  for (size_t i = 0; i < kernels_.size(); ++i) {
+    Node* n = nodes_with_kernels[i];
+    KernelState& kernel_state = kernels_[i];
+    kernel_state.output_locations.resize(kernel_state.num_outputs);
+    for (const Edge* e : n->out_edges()) {
+      if (!e->IsControlEdge()) {
+        kernel_state.output_locations[e->src_output()].push_back(
+            kernels_[node_to_index_map[e->dst()]].input_start_index +
+            e->dst_input());
+      }
+    }
+
+    kernel_state.output_alloc_attrs.resize(kernel_state.num_outputs);
+    AllocatorAttributes* attrs = kernel_state.output_alloc_attrs.data();
+    OpKernel* op_kernel = kernel_state.kernel;
+    for (int out = 0; out < n->num_outputs(); out++) {
+      DCHECK_LT(out, op_kernel->output_memory_types().size());
+      bool on_host = op_kernel->output_memory_types()[out] == HOST_MEMORY;
+      if (on_host) {
+        AllocatorAttributes h;
+        h.set_on_host(on_host);
+        attrs[out].Merge(h);
+      }
+    }
+  }
+
+  if (!kernels_.empty()) {
+    const KernelState& last_kernel_state = kernels_.back();
+    total_num_inputs_ =
+        last_kernel_state.input_start_index + last_kernel_state.num_inputs;
+    input_alloc_attrs_.resize(total_num_inputs_);
+    for (size_t i = 0; i < kernels_.size(); ++i) {
+      for (size_t j = 0; j < kernels_[i].output_locations.size(); ++j) {
+        for (size_t output_location : kernels_[i].output_locations[j]) {
+          input_alloc_attrs_[output_location] =
+              kernels_[i].output_alloc_attrs[j];
+        }
+      }
+    }
+  } else {
+    total_num_inputs_ = 0;
+  }
+
+  BuildPlan(nodes_with_kernels, node_to_index_map);
+  cost_model_ = nullptr;
+  return OkStatus();
+}
+
+int64_t StaticPlanExecutorImpl::EstimateCostUsecs(const Node& node,
+                                                  OpKernel* kernel) const {
+  if (cost_model_ != nullptr && cost_model_->TotalCount(&node) > 0) {
+    return std::max<int64_t>(1, cost_model_->TimeEstimate(&node).value());
+  }
+  return kernel->IsExpensive() ? kDefaultExpensiveKernelCostUsecs
+                               : kDefaultCheapKernelCostUsecs;
+}
+
+void StaticPlanExecutorImpl::BuildPlan(
+    const std::vector<Node*>& nodes_with_kernels,
+    const absl::flat_hash_map<Node*, size_t>& node_to_index_map) {
+  const int num_partitions = static_cast<int>(std::max<int64_t>(
+      1, std::min<int64_t>(MaxPartitions(), kernels_.size())));
+
+  // Greedy list scheduling over the topological order: every kernel goes to
+  // the partition where it is expected to start earliest.
+  std::vector<std::vector<int32>> predecessors(kernels_.size());
+  std::vector<int64_t> finish_usecs(kernels_.size(), 0);
+  std::vector<int64_t> partition_free_usecs(num_partitions, 0);
+  std::vector<bool> partition_used(num_partitions, false);
+  std::vector<int64_t> data_ready_usecs(num_partitions);
+  partitions_.assign(num_partitions, {});
+  for (size_t i = 0; i < kernels_.size(); ++i) {
+    const Node* n = nodes_with_kernels[i];
+    std::vector<int32>& preds = predecessors[i];
+    for (const Edge* e : n->in_edges()) {
+      // Edges from the source, arguments and constants are satisfied before
+      // any partition starts.
+      auto it = node_to_index_map.find(e->src());
+      if (it != node_to_index_map.end()) {
+        preds.push_back(static_cast<int32>(it->second));
+      }
+    }
+    std::sort(preds.begin(), preds.end());
+    preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+
+    std::fill(data_ready_usecs.begin(), data_ready_usecs.end(), 0);
+    for (int32 pred : preds) {
+      for (int p = 0; p < num_partitions; ++p) {
+        const int64_t ready =
+            finish_usecs[pred] +
+            (kernels_[pred].partition == p ? 0 : kCrossPartitionCostUsecs);
+        data_ready_usecs[p] = std::max(data_ready_usecs[p], ready);
+      }
+    }
+    int best = -1;
+    int64_t best_start = 0;
+    for (int p = 0; p < num_partitions; ++p) {
+      int64_t start = std::max(partition_free_usecs[p], data_ready_usecs[p]);
+      if (!partition_used[p] && p != 0) start += kPartitionStartCostUsecs;
+      if (best < 0 || start < best_start) {
+        best = p;
+        best_start = start;
+      }
+    }
+    KernelState& kernel_state = kernels_[i];
+    kernel_state.partition = best;
+    finish_usecs[i] = best_start + EstimateCostUsecs(*n, kernel_state.kernel);
+    partition_free_usecs[best] = finish_usecs[i];
+    partition_used[best] = true;
+    partitions_[best].push_back(static_cast<int32>(i));
+  }
+
+  // Drop unused partitions. Partition 0 is kept even if the graph has no
+  // kernels, so that every step has a partition that finishes it.
+  std::vector<int> new_partition_ids(num_partitions, -1);
+  std::vector<std::vector<int32>> used_partitions;
+  for (int p = 0; p < num_partitions; ++p) {
+    if (p == 0 || !partitions_[p].empty()) {
+      new_partition_ids[p] = used_partitions.size();
+      used_partitions.push_back(std::move(partitions_[p]));
+    }
+  }
+  partitions_ = std::move(used_partitions);
+  for (KernelState& kernel_state : kernels_) {
+    kernel_state.partition = new_partition_ids[kernel_state.partition];
+  }
+
+  // Only dependencies that cross partitions need synchronization; the order
+  // within a partition already satisfies the others.
+  for (size_t i = 0; i < kernels_.size(); ++i) {
+    int32 num_remote_predecessors = 0;
+    for (int32 pred : predecessors[i]) {
+      if (kernels_[pred].partition != kernels_[i].partition) {
+        kernels_[pred].remote_successors.push_back(static_cast<int32>(i));
+        ++num_remote_predecessors;
+      }
+    }
+    if (num_remote_predecessors > 0) {
+      kernels_[i].pending_index = initial_pending_counts_.size();
+      initial_pending_counts_.push_back(num_remote_predecessors + 1);
+    }
+  }
+
+  VLOG(1) << "Static plan: " << kernels_.size() << " kernels in "
+          << partitions_.size() << " partitions, "
+          << initial_pending_counts_.size()
+          << " kernels with cross-partition inputs.";
+}
+
+void StaticPlanExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  auto* step = new StepState(total_num_inputs_, partitions_.size(),
+                             initial_pending_counts_, args, std::move(done));
+  std::vector<Entry>& inputs = step->inputs;
+
+  // Override intra op thread pool if requested.
+  Device* device = params_.device;
+  if (args.user_intra_op_threadpool != nullptr) {
+    step->user_device = RenamedDevice::NewRenamedDevice(
+        device->name(), device, /*owns_underlying=*/false,
+        /*isolate_session_state=*/false, args.user_intra_op_threadpool);
+    device = step->user_device.get();
+  }
+  step->device = device;
+
+  // Prepare the parameters that will be the same for all kernels.
+  OpKernelContext::Params& params = step->params;
+  params.step_id = args.step_id;
+  params.device = device;
+  params.log_memory = false;
+  params.rendezvous = args.rendezvous;
+  params.session_state = args.session_state;
+  params.session_metadata = params_.session_metadata;
+  params.tensor_store = args.tensor_store;
+  params.cancellation_manager = args.cancellation_manager;
+  params.call_frame = args.call_frame;
+  params.function_library = params_.function_library;
+  params.resource_manager = device->resource_manager();
+  params.step_container = args.step_container;
+  params.collective_executor = args.collective_executor;
+  params.stack_trace = args.stack_trace;
+  params.slice_reader_cache = nullptr;
+  params.runner = &step->runner;
+  params.run_all_kernels_inline = args.run_all_kernels_inline;
+  params.stats_collector = args.stats_collector;
+  params.executor_type = &kStaticPlanExecutor;
+  // The graph is loopless and condless.
+  params.frame_iter = FrameAndIter(0, 0);
+  params.is_input_dead = false;
+  params.forward_from_array = nullptr;
+  device->TryGetDeviceContext(&params.op_device_context).IgnoreError();
+
+  const size_t received_args =
+      args.call_frame ? args.call_frame->num_args() : 0;
+  Status s;
+  if (TF_PREDICT_FALSE(arg_output_locations_.size() > received_args)) {
+    s = errors::InvalidArgument("Expected ", arg_output_locations_.size(),
+                                " arguments, but only received ",
+                                received_args, ".");
+  }
+
+  // Forward arguments and constants directly to the inputs of the kernels
+  // that consume them, as the single-threaded executor does.
+  for (size_t i = 0; s.ok() && i < arg_output_locations_.size(); ++i) {
+    const size_t num_destinations = arg_output_locations_[i].size();
+    if (num_destinations == 0) continue;
+    if (args.call_frame->CanConsumeArg(i)) {
+      Entry& first_input = inputs[arg_output_locations_[i][0]];
+      first_input.state = Entry::State::HAS_VALUE;
+      first_input.val.Init();
+      args.call_frame->ConsumeArg(i, first_input.val.get());
+      for (size_t j = 1; j < num_destinations; ++j) {
+        Entry& input = inputs[arg_output_locations_[i][j]];
+        input.state = Entry::State::HAS_VALUE;
+        input.val.Init(*first_input.val);
+      }
+    } else {
+      const Tensor* arg;
+      s = args.call_frame->GetArg(i, &arg);
+      if (!s.ok()) break;
+      for (size_t j = 0; j < num_destinations; ++j) {
+        Entry& input = inputs[arg_output_locations_[i][j]];
+        input.state = Entry::State::HAS_VALUE;
+        input.val.Init(*arg);
+      }
+    }
+  }
+  if (!s.ok()) {
+    DoneCallback done_cb = std::move(step->done);
+    delete step;
+    done_cb(s);
+    return;
+  }
+  for (const ConstTensorKernelState& kernel_state : const_tensor_kernels_) {
+    for (size_t location : kernel_state.output_locations) {
+      Entry& input = inputs[location];
+      input.state = Entry::State::HAS_CONST_TENSOR;
+      input.const_tensor = &kernel_state.const_tensor;
+    }
+  }
+
+  // `step` may be deleted as soon as the last partition has been started.
+  const int num_partitions = partitions_.size();
+  for (int p = 0; p < num_partitions; ++p) {
+    args.runner(
+        [this, step, p]() { RunPartition(step, p, /*resumed=*/false); });
+  }
+}
+
+void StaticPlanExecutorImpl::RunPartition(StepState* step, int p,
+                                          bool resumed) const {
+  const std::vector<int32>& partition = partitions_[p];
+  OpKernelContext::Params params = step->params;
+  TensorValueVec node_inputs;
+  AllocatorAttributeVec input_alloc_attrs;
+
+  const size_t first = step->resume_positions[p];
+  for (size_t pos = first; pos < partition.size(); ++pos) {
+    const int32 i = partition[pos];
+    const KernelState& kernel_state = kernels_[i];
+    if (kernel_state.pending_index >= 0 && !(resumed && pos == first)) {
+      // Record where to resume before publishing our arrival: the partition
+      // that brings the count to zero continues from here.
+      step->resume_positions[p] = pos;
+      if (step->pending_counts[kernel_state.pending_index].fetch_sub(
+              1, std::memory_order_acq_rel) != 1) {
+        return;
+      }
+    }
+
+    if (TF_PREDICT_TRUE(!step->aborted.load(std::memory_order_relaxed))) {
+      Status s =
+          RunKernel(step, i, &params, &node_inputs, &input_alloc_attrs);
+      if (TF_PREDICT_FALSE(!s.ok())) step->Abort(s);
+    } else {
+      // After an error the remaining kernels are skipped, but the partitions
+      // still walk their lists so that every partition terminates.
+      for (size_t j = 0; j < kernel_state.num_inputs; ++j) {
+        step->inputs[kernel_state.input_start_index + j].ClearVal();
+      }
+    }
+
+    for (int32 successor : kernel_state.remote_successors) {
+      const KernelState& successor_state = kernels_[successor];
+      if (step->pending_counts[successor_state.pending_index].fetch_sub(
+              1, std::memory_order_acq_rel) == 1) {
+        const int q = successor_state.partition;
+        step->runner(
+            [this, step, q]() { RunPartition(step, q, /*resumed=*/true); });
+      }
+    }
+  }
+
+  if (step->num_running_partitions.fetch_sub(1) == 1) {
+    Status s;
+    {
+      mutex_lock l(step->mu);
+      s = step->status;
+    }
+    DoneCallback done = std::move(step->done);
+    delete step;
+    done(s);
+  }
+}
+
+Status StaticPlanExecutorImpl::RunKernel(
+    StepState* step, size_t i, OpKernelContext::Params* params,
+    TensorValueVec* node_inputs,
+    AllocatorAttributeVec* input_alloc_attrs) const {
+  const KernelState& kernel_state = kernels_[i];
+  std::vector<Entry>& inputs = step->inputs;
+  const size_t input_start_index = kernel_state.input_start_index;
+  const size_t num_inputs = kernel_state.num_inputs;
+  const size_t num_outputs = kernel_state.num_outputs;
+
+  node_inputs->clear();
+  node_inputs->resize(num_inputs);
+  input_alloc_attrs->clear();
+  input_alloc_attrs->resize(num_inputs);
+  for (size_t j = 0; j < num_inputs; ++j) {
+    Entry& input = inputs[input_start_index + j];
+    switch (input.state) {
+      case Entry::State::HAS_CONST_TENSOR:
+        (*node_inputs)[j].tensor = const_cast<Tensor*>(input.const_tensor);
+        break;
+      case Entry::State::HAS_VALUE:
+        (*node_inputs)[j].tensor = input.val.get();
+        break;
+      default:
+        DCHECK(false) << "Input did not have a valid value.";
+    }
+    (*input_alloc_attrs)[j] = input_alloc_attrs_[input_start_index + j];
+  }
+  params->inputs = *node_inputs;
+  params->input_alloc_attrs = *input_alloc_attrs;
+  params->op_kernel = kernel_state.kernel;
+  params->output_attr_array = kernel_state.output_alloc_attrs.data();
+  OpKernelContext ctx(params, num_outputs);
+
+  step->device->Compute(kernel_state.kernel, &ctx);
+
+  // Free the inputs to the current kernel.
+  for (size_t j = 0; j < num_inputs; ++j) {
+    inputs[input_start_index + j].ClearVal();
+  }
+  TF_RETURN_IF_ERROR(ctx.status());
+
+  // Forward the outputs of the kernel to the inputs of subsequent kernels.
+  for (size_t j = 0; j < num_outputs; ++j) {
+    TensorValue val = ctx.release_output(j);
+    const size_t num_destinations = kernel_state.output_locations[j].size();
+    if (num_destinations > 0) {
+      for (size_t k = 0; k < num_destinations - 1; ++k) {
+        Entry& input = inputs[kernel_state.output_locations[j][k]];
+        input.state = Entry::State::HAS_VALUE;
+        if (val.tensor != nullptr) {
+          input.val.Init(*val.tensor);
+        } else {
+          input.val.Init(Tensor(kernel_state.kernel->output_type(j)));
+        }
+      }
+      // Move the value to the last consumer to avoid the cost of copying it.
+      Entry& input =
+          inputs[kernel_state.output_locations[j][num_destinations - 1]];
+      input.state = Entry::State::HAS_VALUE;
+      if (val.tensor != nullptr) {
+        input.val.Init(std::move(*val.tensor));
+      } else {
+        input.val.Init(Tensor(kernel_state.kernel->output_type(j)));
+      }
+    }
+    delete val.tensor;
+  }
+  return OkStatus();
+}
+
+class StaticPlanExecutorRegistrar {
+ public:
+  StaticPlanExecutorRegistrar() {
+    ExecutorFactory::Register(kStaticPlanExecutor, new Factory());
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      Executor* ret;
+      TF_RETURN_IF_ERROR(NewStaticPlanExecutor(params, graph, &ret));
+      out_executor->reset(ret);
+      return OkStatus();
+    }
+  };
+};
+static StaticPlanExecutorRegistrar registrar;
+
+}  // namespace
+
+Status NewStaticPlanExecutor(const LocalExecutorParams& params,
+                             const Graph& graph, Executor** executor) {
+  auto impl = std::make_unique<StaticPlanExecutorImpl>(params);
+  TF_RETURN_IF_ERROR(impl->Initialize(graph));
+  *executor = impl.release();
+  return OkStatus();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,54 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_PLAN_EXECUTOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_PLAN_EXECUTOR_H_
+
+#include "tensorflow/core/common_runtime/executor.h"
+
+namespace tensorflow {
+
+// Name of the environment variable that bounds the number of partitions (and
+// hence of threads used by one step) of a static plan. Defaults to
+// min(port::MaxParallelism(), 8).
+extern const char kStaticPlanMaxPartitionsEnvVar[];
+
+// Creates a new `Executor` that runs `graph` according to a schedule computed
+// once, when the executor is created, instead of tracking readiness with
+// per-node pending counts on every step.
+//
+// The kernels are sorted topologically and split into a few "partitions" by a
+// list-scheduling heuristic: each kernel goes to the partition where it is
+// expected to start earliest, given per-kernel cost estimates (taken from
+// `params.cost_model` when it has data for the node, and from
+// `OpKernel::IsExpensive()` otherwise) and a fixed penalty for handing a value
+// to another partition. Each partition is a fixed list of kernels that runs in
+// order on one `runner` thread. Only kernels with an input produced in another
+// partition carry an atomic pending count; a partition that reaches such a
+// kernel before its inputs are ready returns its thread and is resumed by the
+// partition that produces the last input, so no thread ever blocks.
+//
+// The executor is meant for small, acyclic graphs that run very many times,
+// such as serving signatures. It has the same restrictions as
+// NewSingleThreadedExecutor(): reference-typed edges, old-style control flow
+// and partitioned graphs (with "_Recv" nodes) are not supported, and neither
+// are memory logging, allocation forwarding, non-default device contexts or
+// `OpKernelContext::slice_reader_cache()`.
+Status NewStaticPlanExecutor(const LocalExecutorParams& params,
+                             const Graph& graph, Executor** executor);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_PLAN_EXECUTOR_H_
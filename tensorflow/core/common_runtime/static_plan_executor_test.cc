@@ -0,0 +1,316 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_plan_executor.h"
+
+#include <stdlib.h>
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/costmodel.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+class StaticPlanExecutorTest : public ::testing::Test {
+ protected:
+  StaticPlanExecutorTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:localhost/replica:0/task:0")),
+        thread_pool_(Env::Default(), "static_plan_test", 4) {
+    // Read once per process; allow several partitions even on small hosts.
+    setenv(kStaticPlanMaxPartitionsEnvVar, "4", /*overwrite=*/0);
+  }
+
+  // Resets `exec_` with a new executor for `graph`. If `cost_model` is set,
+  // it is used to partition the graph.
+  void Create(std::unique_ptr<const Graph> graph,
+              const CostModel* cost_model = nullptr) {
+    const int version = graph->versions().producer();
+    LocalExecutorParams params;
+    params.device = device_.get();
+    params.cost_model = cost_model;
+    params.create_kernel =
+        [this, version](const std::shared_ptr<const NodeProperties>& props,
+                        OpKernel** kernel) {
+          return CreateNonCachedKernel(device_.get(), nullptr, props, version,
+                                       kernel);
+        };
+    params.delete_kernel = [](OpKernel* kernel) {
+      DeleteNonCachedKernel(kernel);
+    };
+    TF_CHECK_OK(NewExecutor("STATIC_PLAN", params, *graph, &exec_));
+  }
+
+  Status Run(CallFrameInterface* call_frame, bool inline_runner = false) {
+    Executor::Args args;
+    args.call_frame = call_frame;
+    if (inline_runner) {
+      args.runner = [](std::function<void()> fn) { fn(); };
+    } else {
+      args.runner = [this](std::function<void()> fn) {
+        thread_pool_.Schedule(std::move(fn));
+      };
+    }
+    return exec_->Run(args);
+  }
+
+  std::unique_ptr<Device> device_;
+  thread::ThreadPool thread_pool_;
+  std::unique_ptr<Executor> exec_;
+};
+
+// A float val -> Tensor<float>
+Tensor V(const float val) {
+  Tensor tensor(DT_FLOAT, TensorShape({}));
+  tensor.scalar<float>()() = val;
+  return tensor;
+}
+
+// Tensor<float> -> a float val.
+float V(const Tensor& tensor) {
+  CHECK_EQ(tensor.dtype(), DT_FLOAT);
+  CHECK(TensorShapeUtils::IsScalar(tensor.shape()));
+  return tensor.scalar<float>()();
+}
+
+// Builds `num_branches` independent chains of `depth` additions of the single
+// argument, summed into the single return value, and a cost model that makes
+// every addition look expensive so that the branches land in different
+// partitions.
+void BuildBranches(int num_branches, int depth, Graph* g,
+                   CostModel* cost_model) {
+  Node* in = test::graph::Arg(g, 0, DT_FLOAT);
+  std::vector<Node*> adds;
+  Node* sum = nullptr;
+  for (int b = 0; b < num_branches; ++b) {
+    Node* v = in;
+    for (int d = 0; d < depth; ++d) {
+      v = test::graph::Add(g, v, in);
+      adds.push_back(v);
+    }
+    sum = sum == nullptr ? v : test::graph::Add(g, sum, v);
+  }
+  test::graph::Retval(g, 0, sum);
+  FixupSourceAndSinkEdges(g);
+  if (cost_model != nullptr) {
+    cost_model->InitFromGraph(*g);
+    for (Node* n : adds) {
+      cost_model->RecordCount(n, 1);
+      cost_model->RecordTime(n, Microseconds(1000));
+    }
+  }
+}
+
+TEST_F(StaticPlanExecutorTest, SimpleAdd) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Arg(g.get(), 0, DT_FLOAT);
+  auto in1 = test::graph::Arg(g.get(), 1, DT_FLOAT);
+  auto tmp = test::graph::Add(g.get(), in0, in1);
+  test::graph::Retval(g.get(), 0, tmp);
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g));
+  FunctionCallFrame call_frame({DT_FLOAT, DT_FLOAT}, {DT_FLOAT});
+  TF_ASSERT_OK(call_frame.SetArgs({V(1.0), V(2.0)}));
+  TF_ASSERT_OK(Run(&call_frame));
+  std::vector<Tensor> retvals;
+  TF_ASSERT_OK(call_frame.ConsumeRetvals(&retvals, false));
+  EXPECT_EQ(3.0, V(retvals[0]));
+}
+
+TEST_F(StaticPlanExecutorTest, RandomTree) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* in = test::graph::Arg(g.get(), 0, DT_FLOAT);
+  std::vector<Node*> nodes;
+  for (int i = 0; i < 1024; ++i) {
+    nodes.push_back(test::graph::Identity(g.get(), in, 0));
+  }
+  random::PhiloxRandom philox(0, 17);
+  random::SimplePhilox rnd(&philox);
+  while (nodes.size() > 1) {
+    int x = rnd.Uniform(nodes.size());
+    auto in0 = nodes[x];
+    nodes[x] = nodes.back();
+    nodes.resize(nodes.size() - 1);
+    x = rnd.Uniform(nodes.size());
+    nodes[x] = test::graph::Add(g.get(), in0, nodes[x]);
+  }
+  test::graph::Retval(g.get(), 0, nodes.back());
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g));
+  for (int step = 0; step < 10; ++step) {
+    FunctionCallFrame call_frame({DT_FLOAT}, {DT_FLOAT});
+    TF_ASSERT_OK(call_frame.SetArgs({V(1.0)}));
+    TF_ASSERT_OK(Run(&call_frame));
+    std::vector<Tensor> retvals;
+    TF_ASSERT_OK(call_frame.ConsumeRetvals(&retvals, false));
+    EXPECT_EQ(1024.0, V(retvals[0]));
+  }
+}
+
+TEST_F(StaticPlanExecutorTest, CrossPartitionDependencies) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto cost_model = std::make_unique<CostModel>(/*is_global=*/false);
+  BuildBranches(/*num_branches=*/4, /*depth=*/8, g.get(), cost_model.get());
+  Create(std::move(g), cost_model.get());
+  // The costs are only needed while the executor is created.
+  cost_model.reset();
+  for (bool inline_runner : {false, true}) {
+    for (int step = 0; step < 20; ++step) {
+      FunctionCallFrame call_frame({DT_FLOAT}, {DT_FLOAT});
+      TF_ASSERT_OK(call_frame.SetArgs({V(1.0)}));
+      TF_ASSERT_OK(Run(&call_frame, inline_runner));
+      std::vector<Tensor> retvals;
+      TF_ASSERT_OK(call_frame.ConsumeRetvals(&retvals, false));
+      // Each branch computes 1 + 8 * 1.
+      EXPECT_EQ(36.0, V(retvals[0]));
+    }
+  }
+}
+
+TEST_F(StaticPlanExecutorTest, OpError) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto zero = test::graph::Constant(g.get(), V(0.0));
+  auto inf = test::graph::Unary(g.get(), "Reciprocal", zero);
+  auto check = test::graph::CheckNumerics(g.get(), inf, "message");
+  auto two = test::graph::Constant(g.get(), V(2.0));
+  test::graph::Binary(g.get(), "Mul", check, two);
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g));
+  FunctionCallFrame call_frame({}, {});
+  EXPECT_TRUE(errors::IsInvalidArgument(Run(&call_frame)));
+}
+
+TEST_F(StaticPlanExecutorTest, OpErrorInOnePartition) {
+  // An error in one branch must not leave the other partitions waiting.
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  CostModel cost_model(/*is_global=*/false);
+  Node* in = test::graph::Arg(g.get(), 0, DT_FLOAT);
+  Node* bad = test::graph::CheckNumerics(
+      g.get(), test::graph::Unary(g.get(), "Reciprocal", in), "message");
+  Node* good = test::graph::Add(g.get(), in, in);
+  Node* sum = test::graph::Add(g.get(), bad, good);
+  test::graph::Retval(g.get(), 0, sum);
+  FixupSourceAndSinkEdges(g.get());
+  cost_model.InitFromGraph(*g);
+  for (Node* n : {bad, good}) {
+    cost_model.RecordCount(n, 1);
+    cost_model.RecordTime(n, Microseconds(1000));
+  }
+  Create(std::move(g), &cost_model);
+  FunctionCallFrame call_frame({DT_FLOAT}, {DT_FLOAT});
+  TF_ASSERT_OK(call_frame.SetArgs({V(0.0)}));
+  EXPECT_TRUE(errors::IsInvalidArgument(Run(&call_frame)));
+}
+
+TEST_F(StaticPlanExecutorTest, RejectsControlFlow) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* pred = test::graph::Constant(g.get(), test::AsScalar<bool>(true));
+  Node* in = test::graph::Constant(g.get(), V(1.0));
+  test::graph::Switch(g.get(), in, pred);
+  FixupSourceAndSinkEdges(g.get());
+  LocalExecutorParams params;
+  params.device = device_.get();
+  params.create_kernel = [this](
+                             const std::shared_ptr<const NodeProperties>& props,
+                             OpKernel** kernel) {
+    return CreateNonCachedKernel(device_.get(), nullptr, props,
+                                 TF_GRAPH_DEF_VERSION, kernel);
+  };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  Executor* executor = nullptr;
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      NewStaticPlanExecutor(params, *g, &executor)));
+}
+
+// Builds a small serving-style graph: `width` independent two-layer
+// MatMul + Relu towers over a [1, 128] input, summed at the end.
+Graph* ServingGraph(int width) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, TensorShape({1, 128}));
+  input.flat<float>().setRandom();
+  Node* x = test::graph::Constant(g, input);
+  Node* sum = nullptr;
+  for (int i = 0; i < width; ++i) {
+    Node* h = x;
+    for (int layer = 0; layer < 2; ++layer) {
+      Tensor weights(DT_FLOAT, TensorShape({128, 128}));
+      weights.flat<float>().setRandom();
+      h = test::graph::Matmul(g, h, test::graph::Constant(g, weights), false,
+                              false);
+      h = test::graph::Unary(g, "Relu", h);
+    }
+    sum = sum == nullptr ? h : test::graph::Add(g, sum, h);
+  }
+  FixupSourceAndSinkEdges(g);
+  return g;
+}
+
+static void BM_ServingGraph(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const char* executor_type;
+  switch (state.range(1)) {
+    case 0:
+      executor_type = "";
+      break;
+    case 1:
+      executor_type = "SINGLE_THREADED_EXECUTOR";
+      break;
+    default:
+      executor_type = "STATIC_PLAN";
+      break;
+  }
+  test::Benchmark("cpu", ServingGraph(width), /*options=*/nullptr,
+                  /*init=*/nullptr, /*rendez=*/nullptr, executor_type,
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetLabel(
+      strings::StrCat(executor_type[0] ? executor_type : "DEFAULT"));
+}
+
+// range(1): 0 = default executor, 1 = single-threaded, 2 = static plan.
+BENCHMARK(BM_ServingGraph)
+    ->UseRealTime()
+    ->ArgsProduct({{1, 4, 16}, {0, 1, 2}});
+
+}  // namespace
+}  // namespace tensorflow
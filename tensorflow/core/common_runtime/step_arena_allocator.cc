@@ -0,0 +1,187 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+const char kStepArenaEnvVar[] = "TF_EXECUTOR_USE_STEP_ARENA";
+
+namespace {
+
+constexpr int kChunkCountShift = 48;
+constexpr uint64 kOffsetMask = (uint64{1} << kChunkCountShift) - 1;
+constexpr int kMaxChunks = (1 << (64 - kChunkCountShift)) - 1;
+
+}  // namespace
+
+StepArenaAllocator::StepArenaAllocator(Allocator* backing, size_t chunk_size,
+                                       size_t max_bytes)
+    : backing_(backing),
+      chunk_size_(chunk_size),
+      max_chunks_(static_cast<int>(
+          std::min<size_t>(max_bytes / chunk_size, kMaxChunks))),
+      // No chunk yet, and an offset that sends the first request to AddChunk.
+      bump_(chunk_size),
+      chunks_(new std::atomic<char*>[std::max(max_chunks_, 1)]()) {
+  DCHECK(backing_ != nullptr);
+  DCHECK_GT(chunk_size_, 0);
+  DCHECK_LT(chunk_size_, kOffsetMask / 2);
+  if (max_chunks_ == 0) full_.store(true, std::memory_order_relaxed);
+}
+
+StepArenaAllocator::~StepArenaAllocator() {
+  mutex_lock l(grow_mu_);
+  for (int i = 0; i < num_allocated_chunks_; ++i) {
+    backing_->DeallocateRaw(chunks_[i].load(std::memory_order_relaxed));
+  }
+}
+
+void StepArenaAllocator::Release() { Unref(); }
+
+bool StepArenaAllocator::Reset() {
+  if (refs_.load(std::memory_order_acquire) != 1) return false;
+  mutex_lock l(grow_mu_);
+  // Without a chunk, the offset sends the first request to AddChunk.
+  bump_.store(num_allocated_chunks_ > 0 ? uint64{1} << kChunkCountShift
+                                        : chunk_size_,
+              std::memory_order_release);
+  full_.store(max_chunks_ == 0, std::memory_order_relaxed);
+  num_arena_allocs_.store(0, std::memory_order_relaxed);
+  arena_bytes_.store(0, std::memory_order_relaxed);
+  num_backing_allocs_.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+void StepArenaAllocator::Unref() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+void StepArenaAllocator::AddChunk(int num_chunks) {
+  mutex_lock l(grow_mu_);
+  if ((bump_.load(std::memory_order_relaxed) >> kChunkCountShift) !=
+      num_chunks) {
+    return;  // Another thread added one.
+  }
+  if (num_chunks == num_allocated_chunks_) {
+    char* chunk = nullptr;
+    if (num_chunks < max_chunks_) {
+      chunk = static_cast<char*>(
+          backing_->AllocateRaw(Allocator::kAllocatorAlignment, chunk_size_));
+    }
+    if (chunk == nullptr) {
+      full_.store(true, std::memory_order_relaxed);
+      return;
+    }
+    chunks_[num_chunks].store(chunk, std::memory_order_relaxed);
+    ++num_allocated_chunks_;
+    num_backing_allocs_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // Publishes the chunk with a fresh offset.
+  bump_.store(static_cast<uint64>(num_chunks + 1) << kChunkCountShift,
+              std::memory_order_release);
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  if (num_bytes > chunk_size_ / 4 ||
+      alignment > Allocator::kAllocatorAlignment) {
+    return nullptr;
+  }
+  // Chunks are aligned, so keeping every size a multiple of the alignment
+  // aligns every allocation.
+  const size_t size = (num_bytes + Allocator::kAllocatorAlignment - 1) &
+                      ~(Allocator::kAllocatorAlignment - 1);
+  while (!full_.load(std::memory_order_relaxed)) {
+    const uint64 bump = bump_.fetch_add(size, std::memory_order_acquire);
+    const int num_chunks = bump >> kChunkCountShift;
+    const size_t offset = bump & kOffsetMask;
+    if (offset + size <= chunk_size_) {
+      refs_.fetch_add(1, std::memory_order_relaxed);
+      num_arena_allocs_.fetch_add(1, std::memory_order_relaxed);
+      arena_bytes_.fetch_add(num_bytes, std::memory_order_relaxed);
+      return chunks_[num_chunks - 1].load(std::memory_order_relaxed) + offset;
+    }
+    AddChunk(num_chunks);
+  }
+  return nullptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  DCHECK(Owns(ptr));
+  Unref();
+}
+
+bool StepArenaAllocator::Owns(const void* ptr) const {
+  const char* p = static_cast<const char*>(ptr);
+  const int num_chunks = bump_.load(std::memory_order_acquire) >>
+                         kChunkCountShift;
+  for (int i = 0; i < num_chunks; ++i) {
+    const char* chunk = chunks_[i].load(std::memory_order_relaxed);
+    if (p >= chunk && p < chunk + chunk_size_) return true;
+  }
+  return false;
+}
+
+StepArenaAllocator::ArenaStats StepArenaAllocator::GetArenaStats() const {
+  ArenaStats stats;
+  stats.num_arena_allocs = num_arena_allocs_.load(std::memory_order_relaxed);
+  stats.arena_bytes = arena_bytes_.load(std::memory_order_relaxed);
+  stats.num_backing_allocs =
+      num_backing_allocs_.load(std::memory_order_relaxed);
+  stats.bytes_reserved =
+      (bump_.load(std::memory_order_acquire) >> kChunkCountShift) *
+      chunk_size_;
+  return stats;
+}
+
+StepArenaPool::StepArenaPool(Allocator* backing, int max_idle)
+    : backing_(backing), max_idle_(max_idle) {}
+
+StepArenaPool::~StepArenaPool() {
+  for (StepArenaAllocator* arena : idle_) arena->Release();
+}
+
+StepArenaPool::ArenaPtr StepArenaPool::Get() {
+  StepArenaAllocator* arena = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (!idle_.empty()) {
+      arena = idle_.back();
+      idle_.pop_back();
+    }
+  }
+  if (arena == nullptr) arena = new StepArenaAllocator(backing_);
+  return ArenaPtr(arena, Returner{this});
+}
+
+void StepArenaPool::Return(StepArenaAllocator* arena) {
+  if (arena->Reset()) {
+    mutex_lock l(mu_);
+    if (static_cast<int>(idle_.size()) < max_idle_) {
+      idle_.push_back(arena);
+      return;
+    }
+  }
+  arena->Release();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,176 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Name of the environment variable that, when set to true, makes executors on
+// CPU devices serve the temporaries of each step from a StepArenaAllocator.
+// Defaults to false.
+extern const char kStepArenaEnvVar[];
+
+// A bump allocator for the temporaries of one executor step.
+//
+// Memory is carved sequentially out of chunks of `chunk_size` bytes obtained
+// from a backing allocator, so a step that allocates many short-lived tensors
+// makes one backing allocator call per chunk instead of one per tensor.  The
+// bump pointer is advanced with an atomic add, so threads running the kernels
+// of a step concurrently do not serialize on a lock; only adding a chunk takes
+// one.  Freeing an arena allocation does not return memory to the backing
+// allocator until the arena is destroyed; Reset() reclaims the chunks for
+// the next step instead.
+//
+// The arena only serves requests of at most a quarter of a chunk, aligned to
+// at most Allocator::kAllocatorAlignment, while at most `max_bytes` of chunks
+// are reserved.  AllocateRaw() returns nullptr for any other request, without
+// calling the backing allocator, and the caller is expected to allocate from
+// the backing allocator itself.  Callers should likewise allocate memory that
+// may outlive the step, such as outputs, from the backing allocator.
+//
+// The arena is reference counted: the owner drops its reference with
+// Release() at the end of the step, and each outstanding allocation holds one
+// more.  All chunks are returned to the backing allocator when the last
+// reference goes away, so an allocation that does escape the step stays
+// valid.
+class StepArenaAllocator : public Allocator {
+ public:
+  static constexpr size_t kDefaultChunkSize = 256 << 10;
+  static constexpr size_t kDefaultMaxBytes = 64 << 20;
+
+  // Activity of the arena since its creation or last Reset().
+  struct ArenaStats {
+    // Allocations served from chunks, and the bytes they requested.
+    int64_t num_arena_allocs = 0;
+    int64_t arena_bytes = 0;
+    // Calls made to the backing allocator for chunks.
+    int64_t num_backing_allocs = 0;
+    // Total size of the chunks in use.
+    int64_t bytes_reserved = 0;
+  };
+
+  // `backing` is not owned and must outlive the arena.
+  explicit StepArenaAllocator(Allocator* backing,
+                              size_t chunk_size = kDefaultChunkSize,
+                              size_t max_bytes = kDefaultMaxBytes);
+
+  // Drops the owner's reference.  The arena must not be used for new
+  // allocations afterwards.
+  void Release();
+
+  // If no allocation is outstanding, makes all chunks available again, clears
+  // the statistics and returns true.  Otherwise returns false and leaves the
+  // arena unchanged.  Must not race with AllocateRaw().
+  bool Reset();
+
+  string Name() override { return "step_arena"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return backing_->GetMemoryType();
+  }
+
+  Allocator* backing() const { return backing_; }
+
+  // Returns true if `ptr` points into memory served by the arena.
+  bool Owns(const void* ptr) const;
+
+  ArenaStats GetArenaStats() const;
+
+ private:
+  ~StepArenaAllocator() override;
+
+  void Unref();
+
+  // Adds a chunk unless another thread already replaced chunk number
+  // `num_chunks`, or no more may be reserved.  Reuses a chunk kept by Reset()
+  // if there is one.
+  void AddChunk(int num_chunks);
+
+  Allocator* const backing_;
+  const size_t chunk_size_;
+  const int max_chunks_;
+
+  // One for the owner, plus one per outstanding allocation.
+  std::atomic<int64_t> refs_{1};
+
+  // The number of chunks in the high 16 bits, and the offset of the next
+  // allocation into the last one in the low 48 bits.  The offset runs past
+  // `chunk_size_` once concurrent requests exhaust the chunk.
+  std::atomic<uint64> bump_;
+  // The first `num_allocated_chunks_` entries are set, and do not change
+  // afterwards.  The first `bump_ >> 48` of them are in use.
+  std::unique_ptr<std::atomic<char*>[]> chunks_;
+  int num_allocated_chunks_ TF_GUARDED_BY(grow_mu_) = 0;
+  // Set once no more chunks may be added.
+  std::atomic<bool> full_{false};
+  mutex grow_mu_;
+
+  std::atomic<int64_t> num_arena_allocs_{0};
+  std::atomic<int64_t> arena_bytes_{0};
+  std::atomic<int64_t> num_backing_allocs_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+// Keeps the arenas of finished steps, so that the steps of an executor reuse
+// the chunks of earlier steps instead of allocating them again.  Thread-safe.
+class StepArenaPool {
+ public:
+  // Returns arenas to the pool they were taken from.
+  struct Returner {
+    void operator()(StepArenaAllocator* arena) const { pool->Return(arena); }
+    StepArenaPool* pool = nullptr;
+  };
+  using ArenaPtr = std::unique_ptr<StepArenaAllocator, Returner>;
+
+  // `backing` is not owned and must outlive the pool.  At most `max_idle`
+  // arenas are kept between steps.
+  explicit StepArenaPool(Allocator* backing, int max_idle = 4);
+  ~StepArenaPool();
+
+  // Returns an arena with no allocation outstanding.  The pool must outlive
+  // it.
+  ArenaPtr Get();
+
+ private:
+  // Keeps `arena` for a later step if it can be reset and there is room, and
+  // releases it otherwise.
+  void Return(StepArenaAllocator* arena);
+
+  Allocator* const backing_;
+  const int max_idle_;
+  mutex mu_;
+  std::vector<StepArenaAllocator*> idle_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
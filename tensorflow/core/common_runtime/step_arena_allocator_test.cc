@@ -0,0 +1,266 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <atomic>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the calls made to the CPU allocator.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocs;
+    ++num_live;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    --num_live;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  std::atomic<int> num_allocs{0};
+  std::atomic<int> num_live{0};
+};
+
+TEST(StepArenaAllocatorTest, ServesSmallAllocationsFromChunks) {
+  CountingAllocator backing;
+  auto* arena = new StepArenaAllocator(&backing, /*chunk_size=*/64 << 10);
+  std::set<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    void* p = arena->AllocateRaw(Allocator::kAllocatorAlignment, 500);
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) %
+                     Allocator::kAllocatorAlignment);
+    EXPECT_TRUE(ptrs.insert(p).second);
+    memset(p, i, 500);
+  }
+  // 100 * 512 bytes need one 64KB chunk.
+  EXPECT_EQ(1, backing.num_allocs);
+  StepArenaAllocator::ArenaStats stats = arena->GetArenaStats();
+  EXPECT_EQ(100, stats.num_arena_allocs);
+  EXPECT_EQ(100 * 500, stats.arena_bytes);
+  EXPECT_EQ(1, stats.num_backing_allocs);
+  EXPECT_EQ(64 << 10, stats.bytes_reserved);
+
+  for (void* p : ptrs) arena->DeallocateRaw(p);
+  EXPECT_EQ(1, backing.num_live);
+  arena->Release();
+  EXPECT_EQ(0, backing.num_live);
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentAllocations) {
+  CountingAllocator backing;
+  auto* arena = new StepArenaAllocator(&backing, /*chunk_size=*/16 << 10);
+  constexpr int kThreads = 8;
+  constexpr int kAllocsPerThread = 1000;
+  std::vector<std::vector<char*>> ptrs(kThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "arena_test", kThreads);
+    for (int t = 0; t < kThreads; ++t) {
+      pool.Schedule([arena, t, &ptrs]() {
+        for (int i = 0; i < kAllocsPerThread; ++i) {
+          char* p = static_cast<char*>(
+              arena->AllocateRaw(Allocator::kAllocatorAlignment, 100));
+          ASSERT_NE(nullptr, p);
+          memset(p, t, 100);
+          ptrs[t].push_back(p);
+        }
+      });
+    }
+  }
+  // Every allocation is intact, so none overlapped another.
+  for (int t = 0; t < kThreads; ++t) {
+    for (char* p : ptrs[t]) {
+      EXPECT_TRUE(arena->Owns(p));
+      for (int i = 0; i < 100; ++i) ASSERT_EQ(t, p[i]);
+    }
+  }
+  StepArenaAllocator::ArenaStats stats = arena->GetArenaStats();
+  EXPECT_EQ(kThreads * kAllocsPerThread, stats.num_arena_allocs);
+  EXPECT_EQ(backing.num_allocs, stats.num_backing_allocs);
+  for (const auto& thread_ptrs : ptrs) {
+    for (char* p : thread_ptrs) arena->DeallocateRaw(p);
+  }
+  arena->Release();
+  EXPECT_EQ(0, backing.num_live);
+}
+
+TEST(StepArenaAllocatorTest, LargeAndOveralignedRequestsAreNotServed) {
+  CountingAllocator backing;
+  auto* arena = new StepArenaAllocator(&backing, /*chunk_size=*/4096);
+  EXPECT_EQ(nullptr, arena->AllocateRaw(Allocator::kAllocatorAlignment, 2048));
+  EXPECT_EQ(nullptr, arena->AllocateRaw(4096, 100));
+  EXPECT_EQ(0, backing.num_allocs);
+  EXPECT_EQ(0, arena->GetArenaStats().num_arena_allocs);
+  int on_stack;
+  EXPECT_FALSE(arena->Owns(&on_stack));
+  arena->Release();
+}
+
+TEST(StepArenaAllocatorTest, MaxBytes) {
+  CountingAllocator backing;
+  auto* arena = new StepArenaAllocator(&backing, /*chunk_size=*/1024,
+                                       /*max_bytes=*/2048);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 10; ++i) {
+    ptrs.push_back(arena->AllocateRaw(Allocator::kAllocatorAlignment, 256));
+  }
+  // Two chunks hold eight requests; the arena declines the rest.
+  EXPECT_EQ(nullptr, ptrs[8]);
+  EXPECT_EQ(nullptr, ptrs[9]);
+  StepArenaAllocator::ArenaStats stats = arena->GetArenaStats();
+  EXPECT_EQ(8, stats.num_arena_allocs);
+  EXPECT_EQ(2048, stats.bytes_reserved);
+  EXPECT_EQ(2, stats.num_backing_allocs);
+  EXPECT_EQ(2, backing.num_allocs);
+  for (void* p : ptrs) arena->DeallocateRaw(p);
+  arena->Release();
+  EXPECT_EQ(0, backing.num_live);
+}
+
+TEST(StepArenaAllocatorTest, TensorsOutliveTheStep) {
+  CountingAllocator backing;
+  auto* arena = new StepArenaAllocator(&backing);
+  Tensor escaped(arena, DT_FLOAT, TensorShape({16}));
+  escaped.flat<float>().setConstant(1.0f);
+  {
+    Tensor temp(arena, DT_FLOAT, TensorShape({16}));
+    temp.flat<float>().setZero();
+  }
+  arena->Release();
+  // The chunk stays alive as long as `escaped` does.
+  EXPECT_EQ(1, backing.num_live);
+  EXPECT_EQ(1.0f, escaped.flat<float>()(15));
+  escaped = Tensor();
+  EXPECT_EQ(0, backing.num_live);
+}
+
+TEST(StepArenaAllocatorTest, ResetReusesChunks) {
+  CountingAllocator backing;
+  auto* arena = new StepArenaAllocator(&backing, /*chunk_size=*/1024);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 6; ++i) {
+    ptrs.push_back(arena->AllocateRaw(Allocator::kAllocatorAlignment, 256));
+  }
+  EXPECT_EQ(2, backing.num_allocs);
+  // An outstanding allocation keeps the arena as it is.
+  EXPECT_FALSE(arena->Reset());
+  for (void* p : ptrs) arena->DeallocateRaw(p);
+  EXPECT_TRUE(arena->Reset());
+  EXPECT_EQ(0, arena->GetArenaStats().num_arena_allocs);
+  EXPECT_EQ(0, arena->GetArenaStats().bytes_reserved);
+
+  // The next step is served from the same chunks, in the same order.
+  void* first = arena->AllocateRaw(Allocator::kAllocatorAlignment, 256);
+  EXPECT_EQ(ptrs[0], first);
+  ptrs.clear();
+  for (int i = 0; i < 8; ++i) {
+    ptrs.push_back(arena->AllocateRaw(Allocator::kAllocatorAlignment, 256));
+  }
+  // Nine requests need a third chunk, and only that one is new.
+  EXPECT_EQ(3, backing.num_allocs);
+  StepArenaAllocator::ArenaStats stats = arena->GetArenaStats();
+  EXPECT_EQ(9, stats.num_arena_allocs);
+  EXPECT_EQ(1, stats.num_backing_allocs);
+  EXPECT_EQ(3 * 1024, stats.bytes_reserved);
+  arena->DeallocateRaw(first);
+  for (void* p : ptrs) arena->DeallocateRaw(p);
+  arena->Release();
+  EXPECT_EQ(0, backing.num_live);
+}
+
+TEST(StepArenaAllocatorTest, PoolReusesIdleArenas) {
+  CountingAllocator backing;
+  {
+    StepArenaPool pool(&backing, /*max_idle=*/1);
+    StepArenaAllocator* reused;
+    {
+      StepArenaPool::ArenaPtr arena = pool.Get();
+      reused = arena.get();
+      arena->DeallocateRaw(
+          arena->AllocateRaw(Allocator::kAllocatorAlignment, 100));
+    }
+    EXPECT_EQ(1, backing.num_live);
+    Tensor escaped;
+    {
+      StepArenaPool::ArenaPtr arena = pool.Get();
+      EXPECT_EQ(reused, arena.get());
+      EXPECT_EQ(0, arena->GetArenaStats().num_backing_allocs);
+      escaped = Tensor(arena.get(), DT_FLOAT, TensorShape({16}));
+      escaped.flat<float>().setConstant(1.0f);
+    }
+    // The arena holding `escaped` is not reused, and lives as long as it.
+    StepArenaPool::ArenaPtr arena = pool.Get();
+    EXPECT_NE(reused, arena.get());
+    EXPECT_EQ(1.0f, escaped.flat<float>()(15));
+    escaped = Tensor();
+    EXPECT_EQ(0, backing.num_live);
+  }
+  EXPECT_EQ(0, backing.num_live);
+}
+
+// Allocates and frees `num_temps` temporaries of 1KB, as a step with that many
+// small kernels does, from the CPU allocator (range(0) == 0), a new arena per
+// step (1) or an arena reused through a StepArenaPool (2).
+static void BM_StepTemporaries(::testing::benchmark::State& state) {
+  const int mode = state.range(0);
+  const int num_temps = state.range(1);
+  std::vector<void*> ptrs(num_temps);
+  StepArenaPool pool(cpu_allocator());
+  for (auto s : state) {
+    StepArenaPool::ArenaPtr pooled_arena;
+    StepArenaAllocator* arena = nullptr;
+    if (mode == 1) {
+      arena = new StepArenaAllocator(cpu_allocator());
+    } else if (mode == 2) {
+      pooled_arena = pool.Get();
+      arena = pooled_arena.get();
+    }
+    Allocator* a = arena != nullptr ? arena : cpu_allocator();
+    for (int i = 0; i < num_temps; ++i) {
+      ptrs[i] = a->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+      // Keep every other temporary alive until the end of the step.
+      if (i % 2 == 1) a->DeallocateRaw(ptrs[i]);
+    }
+    for (int i = 0; i < num_temps; i += 2) a->DeallocateRaw(ptrs[i]);
+    if (mode == 1) arena->Release();
+  }
+  state.SetItemsProcessed(state.iterations() * num_temps);
+}
+BENCHMARK(BM_StepTemporaries)
+    ->ArgPair(0, 16)
+    ->ArgPair(1, 16)
+    ->ArgPair(2, 16)
+    ->ArgPair(0, 256)
+    ->ArgPair(1, 256)
+    ->ArgPair(2, 256);
+
+}  // namespace
+}  // namespace tensorflow
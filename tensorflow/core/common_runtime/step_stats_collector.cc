@@ -409,6 +409,11 @@ void StepStatsCollector::Save(const string& device,
   }
 }
 
+void StepStatsCollector::SaveStepSummary(const string& device,
+                                         NodeExecStats* step_summary) {
+  Save(device, step_summary);
+}
+
 void StepStatsCollector::SaveThreadName(const string& device,
                                         const uint32 thread_id,
                                         const string& thread_name) {
@@ -149,6 +149,15 @@ class StepStatsCollectorInterface {
   // "ResourceExhaustedError: OOM when allocating tensor ...
   // on /job:localhost/replica:0/task:0/device:GPU:0 by allocator GPU_0_bfc"
   virtual string ReportAllocsOnResourceExhausted(const string& err) = 0;
+
+  // Saves a summary of one executor step on `device`, such as its latency and
+  // the activity of its per-step allocators, in the form of statistics for a
+  // pseudo-node. Takes ownership of `step_summary`. The default implementation
+  // drops it.
+  virtual void SaveStepSummary(const string& device,
+                               NodeExecStats* step_summary) {
+    delete step_summary;
+  }
 };
 
 // StepStatsCollector manages the collection of a StepStats object.
@@ -177,6 +186,8 @@ class StepStatsCollector : public StepStatsCollectorInterface {
 
   NodeExecStatsInterface* CreateNodeExecStats(const NodeDef* node) override;
   string ReportAllocsOnResourceExhausted(const string& err) override;
+  void SaveStepSummary(const string& device,
+                       NodeExecStats* step_summary) override;
 
   // The following 2 Finalize methods populate the StepStats passed
   // from the constructor. Calling it more than once won't have any effect.
@@ -0,0 +1,264 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/types/optional.h"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/ThreadPool"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// WorkStealingScheduler runs the items of a single executor step on a bounded
+// set of workers that hand work to each other through per-worker deques
+// ("lanes") instead of going through the shared thread pool queue for every
+// item.
+//
+// A worker is a closure started through `runner` that owns one lane while it
+// runs.  The owner pushes and pops at the front of its lane without taking any
+// lock, so an item made ready by a kernel is usually run next on the same
+// thread while its inputs are still in cache.  Items scheduled from threads
+// that are not workers go to the back of a lane chosen round-robin, and idle
+// workers steal from the back of other lanes.  A worker exits once every lane
+// is empty, and new workers are started on demand, up to one per lane.
+//
+// Workers run on the threads of `runner`, which the scheduler does not pin.
+// If those threads are bound to NUMA nodes, as reported by
+// port::NUMAGetThreadNodeAffinity(), a worker prefers lanes last owned by a
+// thread on its own node, both when claiming a lane and when stealing.
+// Otherwise lanes are treated alike.
+//
+// The scheduler is reference counted: workers keep it alive, so `process` may
+// destroy the object that created the scheduler (e.g. when the last node of a
+// step completes).  `process` is never invoked once all scheduled work has
+// been processed.  Callers that schedule the last outstanding item must hold
+// their own reference across Schedule() for the same reason.
+//
+// Lane storage is allocated on first use, so a step that only ever needs a
+// couple of workers does not pay for every lane.
+template <typename Work>
+class WorkStealingScheduler
+    : public std::enable_shared_from_this<WorkStealingScheduler<Work>> {
+ public:
+  typedef std::function<void(std::function<void()>)> Runner;
+  typedef std::function<void(const Work&)> ProcessFn;
+
+  // Maximum number of items a single lane can hold.  Schedule() fails once
+  // the target lane is full and the caller should run the work some other
+  // way.
+  static constexpr unsigned kLaneCapacity = 256;
+
+  // Creates a scheduler with `num_lanes` lanes that starts workers through
+  // `runner` and runs `process` on every scheduled item.
+  WorkStealingScheduler(int num_lanes, Runner runner, ProcessFn process)
+      : num_lanes_(num_lanes),
+        runner_(std::move(runner)),
+        process_(std::move(process)),
+        lanes_(new std::atomic<Lane*>[num_lanes]) {
+    DCHECK_GT(num_lanes, 0);
+    for (int i = 0; i < num_lanes_; ++i) {
+      lanes_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~WorkStealingScheduler() {
+    for (int i = 0; i < num_lanes_; ++i) {
+      delete lanes_[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  int num_lanes() const { return num_lanes_; }
+
+  // Enqueues `w` and starts a worker if there is a free lane.  When called
+  // from a worker of this scheduler the item goes to the front of the
+  // worker's own lane, otherwise to the back of some lane.  Returns false,
+  // leaving the scheduler unchanged, if that lane is full.
+  bool Schedule(const Work& w) {
+    const CurrentLane& current = CurrentLaneSlot();
+    Lane* lane;
+    bool pushed;
+    if (current.scheduler == this) {
+      lane = GetOrCreateLane(current.lane);
+      pushed = !lane->queue.PushFront(w).has_value();
+    } else {
+      lane = GetOrCreateLane(static_cast<int>(
+          next_remote_lane_.fetch_add(1, std::memory_order_relaxed) %
+          num_lanes_));
+      pushed = !lane->queue.PushBack(w).has_value();
+    }
+    if (!pushed) return false;
+    // Pairs with the fence in RunWorker(): either we see the exiting worker's
+    // slot as free, or it sees the item we just pushed.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    MaybeStartWorker();
+    return true;
+  }
+
+  // Returns true if no lane holds any work.  The result is only a snapshot
+  // when other threads are scheduling concurrently.
+  bool Empty() const {
+    for (int i = 0; i < num_lanes_; ++i) {
+      const Lane* lane = lanes_[i].load(std::memory_order_acquire);
+      if (lane != nullptr && !lane->queue.Empty()) return false;
+    }
+    return true;
+  }
+
+ private:
+  struct Lane {
+    // Each element holds an optional so that `Work` itself need not be
+    // default constructible; an empty optional means "no work".
+    Eigen::RunQueue<absl::optional<Work>, kLaneCapacity> queue;
+    std::atomic<bool> owned{false};
+    // The NUMA node of the thread that last owned the lane.
+    std::atomic<int> numa_node{port::kNUMANoAffinity};
+  };
+
+  struct CurrentLane {
+    const WorkStealingScheduler* scheduler = nullptr;
+    int lane = -1;
+  };
+
+  static CurrentLane& CurrentLaneSlot() {
+    static thread_local CurrentLane current;
+    return current;
+  }
+
+  // Returns true if lane `i` was last owned on `numa_node`, which is known.
+  bool OnNode(int i, int numa_node) const {
+    if (numa_node == port::kNUMANoAffinity) return false;
+    const Lane* lane = lanes_[i].load(std::memory_order_acquire);
+    return lane != nullptr &&
+           lane->numa_node.load(std::memory_order_relaxed) == numa_node;
+  }
+
+  Lane* GetOrCreateLane(int i) {
+    Lane* lane = lanes_[i].load(std::memory_order_acquire);
+    if (lane != nullptr) return lane;
+    Lane* created = new Lane;
+    if (lanes_[i].compare_exchange_strong(lane, created,
+                                          std::memory_order_acq_rel)) {
+      return created;
+    }
+    delete created;
+    return lane;
+  }
+
+  // Reserves a worker slot.  Returns false if `num_lanes_` workers are
+  // already active; they keep running until every lane is drained.
+  bool TryAddWorker() {
+    int n = num_workers_.load(std::memory_order_relaxed);
+    while (n < num_lanes_) {
+      if (num_workers_.compare_exchange_weak(n, n + 1)) return true;
+    }
+    return false;
+  }
+
+  void MaybeStartWorker() {
+    if (!TryAddWorker()) return;
+    runner_([self = this->shared_from_this()]() { self->RunWorker(); });
+  }
+
+  // Claims an unowned lane, preferring lanes last owned on `numa_node`.
+  // Always succeeds eventually, because a lane is released before its worker
+  // slot and there are never more worker slots than lanes; until the lane is
+  // released, the thread yields between attempts.
+  int AcquireLane(int numa_node) {
+    const int num_passes = numa_node == port::kNUMANoAffinity ? 1 : 2;
+    while (true) {
+      for (int pass = 0; pass < num_passes; ++pass) {
+        for (int i = 0; i < num_lanes_; ++i) {
+          if (pass == 0 && num_passes == 2 && !OnNode(i, numa_node)) continue;
+          Lane* lane = GetOrCreateLane(i);
+          bool expected = false;
+          if (lane->owned.compare_exchange_strong(expected, true)) {
+            lane->numa_node.store(numa_node, std::memory_order_relaxed);
+            return i;
+          }
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // Pops from the front of `lane`, or steals from the back of another lane,
+  // trying lanes last owned on the same NUMA node first if it is known.
+  absl::optional<Work> Pop(int lane, int numa_node) {
+    absl::optional<Work> w =
+        lanes_[lane].load(std::memory_order_relaxed)->queue.PopFront();
+    if (w.has_value()) return w;
+    const int num_passes = numa_node == port::kNUMANoAffinity ? 1 : 2;
+    for (int pass = 0; pass < num_passes; ++pass) {
+      for (int i = 1; i < num_lanes_; ++i) {
+        const int victim = (lane + i) % num_lanes_;
+        if (num_passes == 2 && OnNode(victim, numa_node) != (pass == 0)) {
+          continue;
+        }
+        Lane* l = lanes_[victim].load(std::memory_order_acquire);
+        if (l == nullptr) continue;
+        w = l->queue.PopBack();
+        if (w.has_value()) return w;
+      }
+    }
+    return absl::nullopt;
+  }
+
+  // Body of a worker.  The caller holds a reference to `this` for the whole
+  // call.
+  void RunWorker() {
+    const int numa_node = port::NUMAGetThreadNodeAffinity();
+    CurrentLane& current = CurrentLaneSlot();
+    // Workers may nest when `runner_` executes closures inline.
+    const CurrentLane saved = current;
+    while (true) {
+      const int lane = AcquireLane(numa_node);
+      current = {this, lane};
+      while (absl::optional<Work> w = Pop(lane, numa_node)) {
+        process_(*w);
+      }
+      current = saved;
+      lanes_[lane].load(std::memory_order_relaxed)->owned.store(false);
+      num_workers_.fetch_sub(1);
+      // Work scheduled after the last Pop() but before the slot was released
+      // found no free slot and started no worker, so look once more.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (Empty() || !TryAddWorker()) break;
+    }
+  }
+
+  const int num_lanes_;
+  const Runner runner_;
+  const ProcessFn process_;
+  std::unique_ptr<std::atomic<Lane*>[]> lanes_;
+  std::atomic<int> num_workers_{0};
+  std::atomic<uint64> next_remote_lane_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(WorkStealingScheduler);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
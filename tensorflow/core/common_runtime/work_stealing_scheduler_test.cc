@@ -0,0 +1,116 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_scheduler.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// A work item that is not default constructible, like the executor's
+// TaggedNode.
+struct Item {
+  explicit Item(int id) : id(id) {}
+  int id;
+};
+
+typedef WorkStealingScheduler<Item> Scheduler;
+
+TEST(WorkStealingSchedulerTest, RunsEveryItemOnce) {
+  constexpr int kNumItems = 10000;
+  thread::ThreadPool pool(Env::Default(), "test", 8);
+  std::vector<std::atomic<int>> counts(kNumItems);
+  BlockingCounter done(kNumItems);
+  auto scheduler = std::make_shared<Scheduler>(
+      /*num_lanes=*/8,
+      [&pool](std::function<void()> fn) { pool.Schedule(std::move(fn)); },
+      [&](const Item& item) {
+        counts[item.id].fetch_add(1);
+        done.DecrementCount();
+      });
+  for (int i = 0; i < kNumItems; ++i) {
+    while (!scheduler->Schedule(Item(i))) {
+      Env::Default()->SleepForMicroseconds(10);
+    }
+  }
+  done.Wait();
+  for (int i = 0; i < kNumItems; ++i) {
+    EXPECT_EQ(1, counts[i].load()) << i;
+  }
+}
+
+TEST(WorkStealingSchedulerTest, ItemsScheduleMoreItems) {
+  // Each item with id > 1 schedules two children from inside a worker, which
+  // go to the worker's own lane and are stolen by the others.
+  constexpr int kDepth = 12;
+  constexpr int kNumItems = (1 << kDepth) - 1;
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  std::atomic<int> processed{0};
+  BlockingCounter done(kNumItems);
+  std::shared_ptr<Scheduler> scheduler;
+  std::function<void(int)> schedule;
+  scheduler = std::make_shared<Scheduler>(
+      /*num_lanes=*/4,
+      [&pool](std::function<void()> fn) { pool.Schedule(std::move(fn)); },
+      [&](const Item& item) {
+        if (item.id > 1) {
+          schedule(item.id - 1);
+          schedule(item.id - 1);
+        }
+        processed.fetch_add(1);
+        done.DecrementCount();
+      });
+  schedule = [&](int id) {
+    if (!scheduler->Schedule(Item(id))) {
+      // Lane full: run it directly, as the executor does.
+      pool.Schedule([&, id]() {
+        if (id > 1) {
+          schedule(id - 1);
+          schedule(id - 1);
+        }
+        processed.fetch_add(1);
+        done.DecrementCount();
+      });
+    }
+  };
+  schedule(kDepth);
+  done.Wait();
+  EXPECT_EQ(kNumItems, processed.load());
+}
+
+TEST(WorkStealingSchedulerTest, InlineRunner) {
+  // Workers nest when the runner runs closures on the calling thread.
+  std::vector<int> order;
+  auto scheduler = std::make_shared<Scheduler>(
+      /*num_lanes=*/2,
+      [](std::function<void()> fn) { fn(); },
+      [&order](const Item& item) { order.push_back(item.id); });
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(scheduler->Schedule(Item(i)));
+  }
+  EXPECT_EQ(10, order.size());
+  EXPECT_TRUE(scheduler->Empty());
+}
+
+}  // namespace
+}  // namespace tensorflow
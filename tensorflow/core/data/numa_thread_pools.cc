@@ -0,0 +1,146 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/numa_thread_pools.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Inspecting where memory resides is a system call, so only every
+// `kRecordElementPeriod`-th element is inspected.
+constexpr int64_t kRecordElementPeriod = 16;
+
+}  // namespace
+
+std::unique_ptr<NumaThreadPools> NumaThreadPools::Create(
+    Env* env, const std::string& name, int64_t private_threadpool_size) {
+  if (!port::NUMAEnabled()) {
+    VLOG(1) << "Not partitioning the threads of " << name
+            << " as the host has a single NUMA node.";
+    return nullptr;
+  }
+  return std::make_unique<NumaThreadPools>(env, name, port::NUMANumNodes(),
+                                           private_threadpool_size);
+}
+
+NumaThreadPools::NumaThreadPools(Env* env, const std::string& name,
+                                 int num_nodes,
+                                 int64_t private_threadpool_size)
+    : env_(env),
+      name_(name),
+      num_nodes_(num_nodes),
+      private_threadpool_size_(private_threadpool_size),
+      partitions_(num_nodes) {}
+
+int NumaThreadPools::CurrentNode() { return port::NUMAGetThreadNodeAffinity(); }
+
+NumaThreadPools::Partition* NumaThreadPools::GetPartition(int node) {
+  mutex_lock l(mu_);
+  std::unique_ptr<Partition>& partition = partitions_[node];
+  if (partition == nullptr) {
+    partition = std::make_unique<Partition>();
+    ThreadOptions thread_options;
+    thread_options.numa_node = node;
+    const std::string name = absl::StrCat(name_, "_numa_", node);
+    partition->unbounded_pool =
+        std::make_unique<UnboundedThreadPool>(env_, name, thread_options);
+    if (private_threadpool_size_ >= 0) {
+      partition->private_pool = std::make_unique<thread::ThreadPool>(
+          env_, thread_options, name,
+          private_threadpool_size_ > 0 ? private_threadpool_size_
+                                       : port::MaxParallelism(node));
+    }
+  }
+  return partition.get();
+}
+
+UnboundedThreadPool* NumaThreadPools::thread_pool(int node) {
+  DCHECK_GE(node, 0);
+  DCHECK_LT(node, num_nodes_);
+  return GetPartition(node)->unbounded_pool.get();
+}
+
+void NumaThreadPools::UpdateParams(int node, IteratorContext::Params* params) {
+  if (node < 0 || node >= num_nodes_) return;
+  Partition* partition = GetPartition(node);
+  params->thread_factory = partition->unbounded_pool->get_thread_factory();
+  params->thread_pool = partition->unbounded_pool.get();
+  if (partition->private_pool != nullptr) {
+    params->runner = [pool = partition->private_pool.get()](
+                         std::function<void()> c) {
+      pool->Schedule(std::move(c));
+    };
+    params->runner_threadpool_size = partition->private_pool->NumThreads();
+  }
+  // Only buffers the device would allocate from the default CPU allocator are
+  // moved to the node; e.g. GPU-compatible host memory is left alone.
+  if (params->allocator_getter) {
+    params->allocator_getter = [node, getter = params->allocator_getter](
+                                   AllocatorAttributes attrs) {
+      Allocator* allocator = getter(attrs);
+      if (allocator == cpu_allocator(port::kNUMANoAffinity)) {
+        return cpu_allocator(node);
+      }
+      return allocator;
+    };
+  }
+}
+
+void NumaThreadPools::RecordElement(int node,
+                                    const std::vector<Tensor>& element) {
+  if (node < 0) return;
+  {
+    mutex_lock l(mu_);
+    if (num_elements_++ % kRecordElementPeriod != 0) return;
+  }
+  int64_t local_bytes = 0;
+  int64_t remote_bytes = 0;
+  for (const Tensor& tensor : element) {
+    if (!DataTypeCanUseMemcpy(tensor.dtype()) || tensor.TotalBytes() == 0) {
+      continue;
+    }
+    const int memory_node = port::NUMAGetMemAffinity(tensor.data());
+    if (memory_node == port::kNUMANoAffinity) continue;
+    if (memory_node == node) {
+      local_bytes += tensor.TotalBytes();
+    } else {
+      remote_bytes += tensor.TotalBytes();
+    }
+  }
+  mutex_lock l(mu_);
+  stats_.local_bytes += local_bytes * kRecordElementPeriod;
+  stats_.remote_bytes += remote_bytes * kRecordElementPeriod;
+}
+
+NumaThreadPools::Stats NumaThreadPools::GetStats() const {
+  mutex_lock l(mu_);
+  return stats_;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,104 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_NUMA_THREAD_POOLS_H_
+#define TENSORFLOW_CORE_DATA_NUMA_THREAD_POOLS_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/data/unbounded_thread_pool.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Thread pools of an input pipeline, partitioned per NUMA node.
+//
+// The threads of each partition are pinned to their NUMA node. Work started
+// on behalf of a consumer pinned to a NUMA node, e.g. the inter-op thread that
+// copies elements to an accelerator attached to that node, runs on the
+// partition of that node and allocates its buffers from memory local to it.
+// Elements are thus produced on the node they are consumed on instead of
+// crossing the socket interconnect.
+class NumaThreadPools {
+ public:
+  // Traffic estimated from a sample of the consumed elements.
+  struct Stats {
+    // Bytes of consumed elements that reside on the consumer's NUMA node.
+    int64_t local_bytes = 0;
+    // Bytes of consumed elements that reside on another NUMA node.
+    int64_t remote_bytes = 0;
+  };
+
+  // Returns the NUMA thread pools of a pipeline, or nullptr if the host has a
+  // single NUMA node. If `private_threadpool_size` is non-negative, each
+  // partition also has a private thread pool of that size for running
+  // user-defined functions.
+  static std::unique_ptr<NumaThreadPools> Create(
+      Env* env, const std::string& name, int64_t private_threadpool_size);
+
+  NumaThreadPools(Env* env, const std::string& name, int num_nodes,
+                  int64_t private_threadpool_size);
+
+  int num_nodes() const { return num_nodes_; }
+
+  // Returns the NUMA node the calling thread is pinned to, or
+  // `port::kNUMANoAffinity` if it is not pinned.
+  static int CurrentNode();
+
+  // Returns the thread pool of the partition of `node`, whose threads are
+  // pinned to that node.
+  UnboundedThreadPool* thread_pool(int node);
+
+  // Updates `params` so that the work it starts runs on the partition of
+  // `node` and allocates host memory on that node.
+  void UpdateParams(int node, IteratorContext::Params* params);
+
+  // Records the location of the memory of `element`, which is consumed on
+  // `node`. Only a sample of the elements is inspected.
+  void RecordElement(int node, const std::vector<Tensor>& element);
+
+  Stats GetStats() const;
+
+ private:
+  struct Partition {
+    std::unique_ptr<UnboundedThreadPool> unbounded_pool;
+    std::unique_ptr<thread::ThreadPool> private_pool;
+  };
+
+  Partition* GetPartition(int node);
+
+  Env* const env_;
+  const std::string name_;
+  const int num_nodes_;
+  const int64_t private_threadpool_size_;
+
+  mutable mutex mu_;
+  // Partitions are created when work is first started on their node.
+  std::vector<std::unique_ptr<Partition>> partitions_ TF_GUARDED_BY(mu_);
+  int64_t num_elements_ TF_GUARDED_BY(mu_) = 0;
+  Stats stats_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_NUMA_THREAD_POOLS_H_
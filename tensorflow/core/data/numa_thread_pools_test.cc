@@ -0,0 +1,130 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/numa_thread_pools.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(NumaThreadPools, SingleNodeHost) {
+  if (port::NUMAEnabled()) {
+    GTEST_SKIP() << "The host has several NUMA nodes.";
+  }
+  EXPECT_EQ(NumaThreadPools::Create(Env::Default(), "test",
+                                    /*private_threadpool_size=*/-1),
+            nullptr);
+}
+
+TEST(NumaThreadPools, RunsWorkOnEveryNode) {
+  NumaThreadPools pools(Env::Default(), "test", /*num_nodes=*/2,
+                        /*private_threadpool_size=*/-1);
+  EXPECT_EQ(pools.num_nodes(), 2);
+  EXPECT_NE(pools.thread_pool(0), pools.thread_pool(1));
+  EXPECT_EQ(pools.thread_pool(1), pools.thread_pool(1));
+
+  constexpr int kNumTasks = 10;
+  BlockingCounter counter(pools.num_nodes() * kNumTasks);
+  std::atomic<int> num_done(0);
+  for (int node = 0; node < pools.num_nodes(); ++node) {
+    for (int i = 0; i < kNumTasks; ++i) {
+      pools.thread_pool(node)->Schedule([&]() {
+        ++num_done;
+        counter.DecrementCount();
+      });
+    }
+  }
+  counter.Wait();
+  EXPECT_EQ(num_done, pools.num_nodes() * kNumTasks);
+}
+
+TEST(NumaThreadPools, IgnoresUnpinnedConsumers) {
+  NumaThreadPools pools(Env::Default(), "test", /*num_nodes=*/2,
+                        /*private_threadpool_size=*/-1);
+  Tensor tensor(DT_FLOAT, TensorShape({1024}));
+  tensor.flat<float>().setZero();
+  for (int i = 0; i < 100; ++i) {
+    pools.RecordElement(port::kNUMANoAffinity, {tensor});
+  }
+  NumaThreadPools::Stats stats = pools.GetStats();
+  EXPECT_EQ(stats.local_bytes, 0);
+  EXPECT_EQ(stats.remote_bytes, 0);
+}
+
+// A synthetic pipeline whose consumer is pinned to the last NUMA node. Without
+// NUMA awareness, elements are produced on node 0 as when the pipeline threads
+// happen to run on the other socket; with it, they are produced on the
+// consumer's node, from memory local to it. Reports the fraction of the
+// consumed bytes that crossed nodes, which stays 0 on single-node hosts.
+void BM_NumaPipeline(::testing::benchmark::State& state) {
+  const bool numa_aware = state.range(0);
+  const int64_t element_size = state.range(1) * 1024 / sizeof(float);
+  NumaThreadPools pools(Env::Default(), "bm",
+                        std::max(2, port::NUMANumNodes()),
+                        /*private_threadpool_size=*/-1);
+  const int consumer_node = pools.num_nodes() - 1;
+  const int producer_node = numa_aware ? consumer_node : 0;
+  Allocator* allocator =
+      cpu_allocator(numa_aware ? consumer_node : port::kNUMANoAffinity);
+  port::NUMASetThreadNodeAffinity(consumer_node);
+
+  float total = 0;
+  for (auto s : state) {
+    Tensor element;
+    Notification produced;
+    pools.thread_pool(producer_node)->Schedule([&]() {
+      element = Tensor(allocator, DT_FLOAT, TensorShape({element_size}));
+      element.flat<float>().setConstant(1.0f);
+      produced.Notify();
+    });
+    produced.WaitForNotification();
+    Eigen::Tensor<float, 0, Eigen::RowMajor> sum = element.flat<float>().sum();
+    total += sum();
+    pools.RecordElement(consumer_node, {element});
+  }
+  port::NUMASetThreadNodeAffinity(port::kNUMANoAffinity);
+  CHECK_GT(total, 0);
+
+  NumaThreadPools::Stats stats = pools.GetStats();
+  const int64_t recorded_bytes = stats.local_bytes + stats.remote_bytes;
+  state.counters["remote_fraction"] =
+      recorded_bytes > 0 ? static_cast<double>(stats.remote_bytes) /
+                               static_cast<double>(recorded_bytes)
+                         : 0.0;
+  state.SetBytesProcessed(state.iterations() * element_size * sizeof(float));
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_NumaPipeline)
+    ->ArgPair(0, 64)
+    ->ArgPair(1, 64)
+    ->ArgPair(0, 4096)
+    ->ArgPair(1, 4096);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -24,9 +24,12 @@ limitations under the License.
 
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/numa_thread_pools.h"
 #include "tensorflow/core/data/rewrite_utils.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
+#include "tensorflow/core/framework/element_tracing.h"
 #include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/platform/env_time.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/refcount.h"
@@ -44,12 +47,21 @@ constexpr char kExperiments[] = "experiments";
 constexpr char kInjectPrefetchEligibleOpt[] = "inject_prefetch_eligible";
 constexpr char kIntraOpParallelism[] = "intra_op_parallelism";
 constexpr char kMemBandwidth[] = "mem_bw_used_megabytes_per_sec";
+constexpr char kNumaAware[] = "numa_aware";
+constexpr char kNumaRemoteBytes[] = "numa_remote_megabytes";
 constexpr char kPrivateThreadpoolSize[] = "threadpool_size";
 constexpr char kRamBudget[] = "ram_budget_megabytes";
 constexpr char kRamUsage[] = "ram_usage_megabytes";
 constexpr char kMaxBufferBytes[] = "max_buffered_megabytes";
 constexpr char kWarmStart[] = "warm_start";
 
+// With the `element_tracing` experiment, one in `kElementTracingSamplingPeriod`
+// elements is traced, and the critical path is logged every
+// `kElementTracingSummaryPeriodNanos`.
+constexpr int64_t kElementTracingSamplingPeriod = 100;
+constexpr int64_t kElementTracingSummaryPeriodNanos =
+    60 * EnvTime::kSecondsToNanos;
+
 // If value `x` matches `y`, returns default value `z`. Otherwise, return `x`.
 inline int64_t value_or_default(int64_t x, int64_t y, int64_t z) {
   return x == y ? z : x;
@@ -64,6 +76,7 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
     params->private_threadpool_size =
         options.threading_options().private_threadpool_size();
   }
+  params->numa_aware = options.threading_options().numa_aware();
   params->autotune = ShouldUseAutotuning(options);
   if (params->autotune) {
     params->autotune_algorithm = model::AutotuneAlgorithm::DEFAULT;
@@ -112,6 +125,9 @@ void AddTraceMetadata(const RootDataset::Params& params, const Options& options,
                                     params.private_threadpool_size, 0,
                                     port::MaxParallelism())))));
   }
+  if (params.numa_aware) {
+    trace_metadata->push_back(std::make_pair(kNumaAware, "true"));
+  }
   auto experiments = GetExperiments();
   if (!experiments.empty()) {
     trace_metadata->push_back(
@@ -156,6 +172,10 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
         model_->AddExperiment("autotune_buffer_optimization");
       }
     }
+    if (GetExperiments().contains("element_tracing")) {
+      element_tracer_ = std::make_shared<ElementTracer>(
+          kElementTracingSamplingPeriod, kElementTracingSummaryPeriodNanos);
+    }
     if (dataset()->params_.max_intra_op_parallelism >= 0) {
       max_intra_op_parallelism_ =
           value_or_default(dataset()->params_.max_intra_op_parallelism, 0,
@@ -169,6 +189,11 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
           Env::Default(), ThreadOptions{}, "data_private_threadpool",
           threadpool_size_);
     }
+    if (dataset()->params_.numa_aware) {
+      numa_thread_pools_ =
+          NumaThreadPools::Create(Env::Default(), "tf_data_numa",
+                                  dataset()->params_.private_threadpool_size);
+    }
     cancellation_manager_ = std::make_unique<CancellationManager>();
   }
 
@@ -181,6 +206,9 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(&iter_ctx, this,
                                                        prefix(), &input_impl_));
     ctx->MergeCheckpoint(iter_ctx.checkpoint());
+    if (element_tracer_ != nullptr) {
+      element_tracer_->SetConsumerPrefix(input_impl_->prefix());
+    }
     return OkStatus();
   }
 
@@ -199,6 +227,10 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     TF_RETURN_IF_ERROR(
         input_impl_->GetNext(&iter_ctx, out_tensors, end_of_sequence));
     ctx->MergeCheckpoint(iter_ctx.checkpoint());
+    if (numa_thread_pools_ != nullptr && !*end_of_sequence) {
+      numa_thread_pools_->RecordElement(NumaThreadPools::CurrentNode(),
+                                        *out_tensors);
+    }
     {
       mutex_lock l(mu_);
       end_time_usec_ = std::max(ctx->env()->NowMicros(), end_time_usec_);
@@ -251,6 +283,16 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
               "%lld", static_cast<long long>(
                           model_node()->TotalMaximumBufferedBytes() / 1.0e6))));
     }
+    if (numa_thread_pools_ != nullptr) {
+      NumaThreadPools::Stats stats = numa_thread_pools_->GetStats();
+      traceme_metadata.push_back(std::make_pair(
+          kNumaRemoteBytes,
+          strings::Printf(
+              "%lld out of %lld",
+              static_cast<long long>(stats.remote_bytes / 1.0e6),
+              static_cast<long long>(
+                  (stats.local_bytes + stats.remote_bytes) / 1.0e6))));
+    }
     return traceme_metadata;
   }
 
@@ -260,12 +302,17 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     if (dataset()->params_.autotune) {
       params.model = model_;
     }
+    params.element_tracer = element_tracer_;
     if (dataset()->params_.private_threadpool_size >= 0) {
       params.runner = [pool = thread_pool_.get()](std::function<void()> c) {
         pool->Schedule(std::move(c));
       };
       params.runner_threadpool_size = threadpool_size_;
     }
+    if (numa_thread_pools_ != nullptr) {
+      // Runs the work on the NUMA node of the consumer, if it is pinned to one.
+      numa_thread_pools_->UpdateParams(NumaThreadPools::CurrentNode(), &params);
+    }
     if (dataset()->params_.max_intra_op_parallelism >= 0) {
       params.runner =
           RunnerWithMaxParallelism(params.runner, max_intra_op_parallelism_);
@@ -299,6 +346,10 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   int64_t max_intra_op_parallelism_;
   int64_t threadpool_size_;
   std::unique_ptr<thread::ThreadPool> thread_pool_;
+  // Set if the pipeline threads are partitioned per NUMA node.
+  std::unique_ptr<NumaThreadPools> numa_thread_pools_;
+  // Set if sampled elements are traced through the pipeline.
+  std::shared_ptr<ElementTracer> element_tracer_;
 
   // The end time of the previous `GetNextInternal` call.
   uint64_t end_time_usec_ TF_GUARDED_BY(mu_) = 0;
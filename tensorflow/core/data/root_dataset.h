@@ -34,6 +34,7 @@ class RootDataset : public DatasetBase {
     int64_t autotune_ram_budget = 0;
     int64_t max_intra_op_parallelism = 1;
     int64_t private_threadpool_size = 0;
+    bool numa_aware = false;
   };
 
   static Status FromOptions(const DatasetBase* input, DatasetBase** output);
@@ -112,6 +112,10 @@ class CrossTrainerCache {
   StatusOr<std::shared_ptr<const ElementType>> Get(
       const std::string& trainer_id);
 
+  // Forgets the position of `trainer_id`, once the trainer stops reading. A
+  // later `Get` with the same ID reads from the start of the cached elements.
+  void RemoveTrainer(const std::string& trainer_id);
+
   // Cancels the cache with `status` and notifies the readers. After cancelling,
   // all `Get` calls will return `status`.
   // REQUIRES: !status.ok()
@@ -316,6 +320,13 @@ void CrossTrainerCache<ElementType>::FreeSpace(size_t new_element_size_bytes)
           << FormatBytes(cache_size_bytes_) << ".";
 }
 
+template <class ElementType>
+void CrossTrainerCache<ElementType>::RemoveTrainer(
+    const std::string& trainer_id) TF_LOCKS_EXCLUDED(mu_) {
+  mutex_lock l(mu_);
+  trainer_to_element_index_map_.erase(trainer_id);
+}
+
 template <class ElementType>
 void CrossTrainerCache<ElementType>::Cancel(Status status)
     TF_LOCKS_EXCLUDED(mu_) {
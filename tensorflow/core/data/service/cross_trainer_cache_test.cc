@@ -205,6 +205,17 @@ TEST(CrossTrainerCacheTest, NewTrainersStartLate) {
   }
 }
 
+TEST(CrossTrainerCacheTest, RemoveTrainer) {
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/1024, std::make_unique<InfiniteRange>());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_THAT(cache.Get("Trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  cache.RemoveTrainer("Trainer");
+  cache.RemoveTrainer("Unknown trainer");
+  EXPECT_THAT(cache.Get("Trainer"), IsOkAndHolds(Pointee(0)));
+}
+
 TEST(CrossTrainerCacheTest, AlternateTrainerExtendsCache) {
   // The cache size is smaller than one int64_t.
   CrossTrainerCache<int64_t> cache(
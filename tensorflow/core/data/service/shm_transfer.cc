@@ -0,0 +1,945 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_transfer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+#if defined(__linux__)
+namespace {
+
+// Payloads in the ring, and the tensor data in payloads, are aligned to this
+// many bytes.
+constexpr size_t kAlignment = 64;
+constexpr int kMaxBindAttempts = 100;
+constexpr uint64_t kMaxRequestBytes = 64 << 20;
+
+// Sent by the server when a client connects, together with the file
+// descriptor of the ring if `ring_bytes` > 0.
+struct Hello {
+  uint64_t ring_bytes;
+};
+
+enum ResponseFlags : uint32_t {
+  kEndOfSequence = 1,
+  kSkip = 2,
+  // The payload is in the ring at `position`. Otherwise it follows the header
+  // on the socket.
+  kInRing = 4,
+  // The payload is a serialized CompressedElement.
+  kCompressed = 8,
+};
+
+struct ResponseHeader {
+  // An error::Code. If not OK, an error message of `length` bytes follows.
+  int32_t code;
+  uint32_t flags;
+  int64_t element_index;
+  uint64_t position;
+  uint64_t length;
+};
+
+// An uncompressed element is encoded as the number of components (uint64),
+// then a ComponentHeader followed by `num_dims` int64 dimensions for each
+// component, then the data of the components at aligned offsets.
+struct ComponentHeader {
+  int32_t dtype;
+  int32_t num_dims;
+  // 1 if the data is a serialized TensorProto, for types that cannot be
+  // memcpy'd.
+  int32_t is_proto;
+  int32_t padding;
+  uint64_t data_offset;
+  uint64_t data_bytes;
+};
+
+size_t RoundUp(size_t n) { return (n + kAlignment - 1) & ~(kAlignment - 1); }
+
+Status ErrnoError(absl::string_view what) {
+  return errors::Unavailable("shm data transfer: ", what, ": ",
+                             strerror(errno));
+}
+
+// Fills in the address of the socket of the server listening on `port`. The
+// name is in the abstract namespace, so it disappears with the socket.
+void MakeSocketAddress(int port, sockaddr_un* addr, socklen_t* addr_len) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  const std::string name = absl::StrCat("tf_data_service_shm_", port);
+  memcpy(addr->sun_path + 1, name.data(), name.size());
+  *addr_len = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+}
+
+Status WriteFully(int socket, const void* data, size_t num_bytes) {
+  const char* p = static_cast<const char*>(data);
+  while (num_bytes > 0) {
+    ssize_t n = send(socket, p, num_bytes, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return ErrnoError("send");
+    }
+    p += n;
+    num_bytes -= n;
+  }
+  return OkStatus();
+}
+
+Status ReadFully(int socket, void* data, size_t num_bytes) {
+  char* p = static_cast<char*>(data);
+  while (num_bytes > 0) {
+    ssize_t n = recv(socket, p, num_bytes, 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return ErrnoError("recv");
+    }
+    if (n == 0) {
+      return errors::Unavailable("shm data transfer: connection closed");
+    }
+    p += n;
+    num_bytes -= n;
+  }
+  return OkStatus();
+}
+
+// A mapping of the shared-memory ring of a connection. Positions in the ring
+// grow monotonically; a payload at position `p` starts at offset
+// `p % size()` of the data area.
+class Ring {
+ public:
+  // Creates a new ring of at least `ring_bytes` bytes, and returns a file
+  // descriptor for it in `fd`.
+  static Status Create(size_t ring_bytes, int* fd, std::unique_ptr<Ring>* out);
+  // Maps the ring of `ring_bytes` bytes behind `fd`.
+  static Status Map(int fd, size_t ring_bytes, std::unique_ptr<Ring>* out);
+
+  ~Ring() { munmap(base_, kHeaderBytes + size_); }
+
+  size_t size() const { return size_; }
+  char* data(uint64_t position) {
+    return base_ + kHeaderBytes + position % size_;
+  }
+  // Position up to which the client has released the ring. Written by the
+  // client and read by the server.
+  std::atomic<uint64_t>* tail() {
+    return reinterpret_cast<std::atomic<uint64_t>*>(base_);
+  }
+
+ private:
+  static constexpr size_t kHeaderBytes = kAlignment;
+
+  Ring(char* base, size_t size) : base_(base), size_(size) {}
+
+  char* const base_;
+  const size_t size_;
+};
+
+Status Ring::Create(size_t ring_bytes, int* fd, std::unique_ptr<Ring>* out) {
+  static std::atomic<int64_t> counter{0};
+  ring_bytes = RoundUp(ring_bytes);
+  // The name is removed right away; the memory lives as long as a process
+  // maps it or holds a descriptor for it.
+  const std::string name =
+      absl::StrCat("/tf_data_shm_", getpid(), "_", counter.fetch_add(1));
+  *fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (*fd < 0) return ErrnoError("shm_open");
+  shm_unlink(name.c_str());
+  if (ftruncate(*fd, kHeaderBytes + ring_bytes) != 0) {
+    Status s = ErrnoError("ftruncate");
+    close(*fd);
+    *fd = -1;
+    return s;
+  }
+  Status s = Map(*fd, ring_bytes, out);
+  if (!s.ok()) {
+    close(*fd);
+    *fd = -1;
+    return s;
+  }
+  new ((*out)->tail()) std::atomic<uint64_t>(0);
+  return OkStatus();
+}
+
+Status Ring::Map(int fd, size_t ring_bytes, std::unique_ptr<Ring>* out) {
+  void* base = mmap(nullptr, kHeaderBytes + ring_bytes, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) return ErrnoError("mmap");
+  out->reset(new Ring(static_cast<char*>(base), ring_bytes));
+  return OkStatus();
+}
+
+Status SendHello(int socket, const Hello& hello, int ring_fd) {
+  msghdr msg = {};
+  iovec iov = {const_cast<Hello*>(&hello), sizeof(hello)};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  if (ring_fd >= 0) {
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &ring_fd, sizeof(int));
+  }
+  while (true) {
+    ssize_t n = sendmsg(socket, &msg, MSG_NOSIGNAL);
+    if (n == sizeof(hello)) return OkStatus();
+    if (n < 0 && errno == EINTR) continue;
+    return ErrnoError("sendmsg");
+  }
+}
+
+Status ReceiveHello(int socket, Hello* hello, int* ring_fd) {
+  *ring_fd = -1;
+  msghdr msg = {};
+  iovec iov = {hello, sizeof(*hello)};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t n;
+  do {
+    n = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) return ErrnoError("recvmsg");
+  if (n != sizeof(*hello)) {
+    return errors::Unavailable(
+        "shm data transfer: connection closed during handshake");
+  }
+  for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      memcpy(ring_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+  if (hello->ring_bytes > 0 && *ring_fd < 0) {
+    return errors::Internal("shm data transfer: server did not send its ring");
+  }
+  return OkStatus();
+}
+
+// Lays out an element and writes it to a payload.
+class ElementEncoder {
+ public:
+  // `components` must outlive the encoder.
+  Status Init(const std::vector<Tensor>& components);
+
+  bool compressed() const { return compressed_ != nullptr; }
+  size_t size() const { return size_; }
+
+  // Writes the payload to the `size()` bytes at `dest`, which must be aligned
+  // to kAlignment.
+  void Write(char* dest) const;
+
+ private:
+  const std::vector<Tensor>* components_ = nullptr;
+  const CompressedElement* compressed_ = nullptr;
+  std::vector<ComponentHeader> headers_;
+  // Serialized TensorProtos of the components that cannot be memcpy'd.
+  std::vector<std::string> protos_;
+  size_t size_ = 0;
+};
+
+Status ElementEncoder::Init(const std::vector<Tensor>& components) {
+  components_ = &components;
+  if (components.size() == 1 && components[0].dtype() == DT_VARIANT &&
+      TensorShapeUtils::IsScalar(components[0].shape())) {
+    const Variant& variant = components[0].scalar<Variant>()();
+    compressed_ = variant.get<CompressedElement>();
+    if (compressed_ == nullptr) {
+      return errors::FailedPrecondition(
+          "Expected dataset to produce a CompressedElement variant tensor, but "
+          "it produced ",
+          variant.TypeName());
+    }
+    size_ = compressed_->ByteSizeLong();
+    return OkStatus();
+  }
+
+  size_t offset = sizeof(uint64_t);
+  for (const Tensor& component : components) {
+    offset += sizeof(ComponentHeader) + component.dims() * sizeof(int64_t);
+  }
+  headers_.resize(components.size());
+  protos_.resize(components.size());
+  for (int i = 0; i < components.size(); ++i) {
+    const Tensor& component = components[i];
+    ComponentHeader& header = headers_[i];
+    header = {};
+    header.dtype = component.dtype();
+    header.num_dims = component.dims();
+    if (DataTypeCanUseMemcpy(component.dtype())) {
+      header.data_bytes = component.TotalBytes();
+    } else {
+      TensorProto proto;
+      component.AsProtoTensorContent(&proto);
+      proto.SerializeToString(&protos_[i]);
+      header.is_proto = 1;
+      header.data_bytes = protos_[i].size();
+    }
+    offset = RoundUp(offset);
+    header.data_offset = offset;
+    offset += header.data_bytes;
+  }
+  size_ = offset;
+  return OkStatus();
+}
+
+void ElementEncoder::Write(char* dest) const {
+  if (compressed_ != nullptr) {
+    compressed_->SerializeToArray(dest, size_);
+    return;
+  }
+  const uint64_t num_components = components_->size();
+  memcpy(dest, &num_components, sizeof(num_components));
+  char* p = dest + sizeof(num_components);
+  for (int i = 0; i < num_components; ++i) {
+    const Tensor& component = (*components_)[i];
+    const ComponentHeader& header = headers_[i];
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    for (int d = 0; d < header.num_dims; ++d) {
+      const int64_t dim = component.dim_size(d);
+      memcpy(p, &dim, sizeof(dim));
+      p += sizeof(dim);
+    }
+    if (header.is_proto) {
+      memcpy(dest + header.data_offset, protos_[i].data(), header.data_bytes);
+    } else if (header.data_bytes > 0) {
+      memcpy(dest + header.data_offset, component.tensor_data().data(),
+             header.data_bytes);
+    }
+  }
+}
+
+// Memory holding a payload on the client, in the ring or received from the
+// socket. `release` is called once no tensor refers to it.
+class PayloadBuffer : public core::RefCounted {
+ public:
+  PayloadBuffer(char* data, size_t size, std::function<void()> release)
+      : data_(data), size_(size), release_(std::move(release)) {}
+  ~PayloadBuffer() override { release_(); }
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  char* const data_;
+  const size_t size_;
+  const std::function<void()> release_;
+};
+
+// The data of a tensor inside a payload.
+class PayloadTensorBuffer : public TensorBuffer {
+ public:
+  PayloadTensorBuffer(PayloadBuffer* payload, char* data, size_t size)
+      : TensorBuffer(data), payload_(payload), size_(size) {
+    payload_->Ref();
+  }
+  ~PayloadTensorBuffer() override { payload_->Unref(); }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name(kShmTransferProtocol);
+  }
+
+ private:
+  PayloadBuffer* const payload_;
+  const size_t size_;
+};
+
+Status MalformedPayload() {
+  return errors::Internal("shm data transfer: malformed element payload");
+}
+
+Status DecodeElement(uint32_t flags, PayloadBuffer* payload,
+                     GetElementResult& result) {
+  char* const data = payload->data();
+  const size_t size = payload->size();
+  if (flags & kCompressed) {
+    CompressedElement compressed;
+    if (!compressed.ParseFromArray(data, size)) {
+      return errors::Internal("Failed to parse compressed element.");
+    }
+    Tensor tensor(DT_VARIANT, TensorShape{});
+    tensor.scalar<Variant>()() = std::move(compressed);
+    result.components.push_back(tensor);
+    return OkStatus();
+  }
+
+  uint64_t num_components;
+  if (size < sizeof(num_components)) return MalformedPayload();
+  memcpy(&num_components, data, sizeof(num_components));
+  size_t offset = sizeof(num_components);
+  result.components.reserve(num_components);
+  for (uint64_t i = 0; i < num_components; ++i) {
+    ComponentHeader header;
+    if (offset + sizeof(header) > size) return MalformedPayload();
+    memcpy(&header, data + offset, sizeof(header));
+    offset += sizeof(header);
+    if (header.num_dims < 0 ||
+        offset + header.num_dims * sizeof(int64_t) > size ||
+        header.data_offset > size ||
+        header.data_bytes > size - header.data_offset ||
+        !DataType_IsValid(header.dtype)) {
+      return MalformedPayload();
+    }
+    std::vector<int64_t> dims(header.num_dims);
+    memcpy(dims.data(), data + offset, header.num_dims * sizeof(int64_t));
+    offset += header.num_dims * sizeof(int64_t);
+
+    Tensor tensor;
+    if (header.is_proto) {
+      TensorProto proto;
+      if (!proto.ParseFromArray(data + header.data_offset,
+                                header.data_bytes) ||
+          !tensor.FromProto(proto)) {
+        return errors::Internal("Failed to parse tensor.");
+      }
+    } else {
+      const DataType dtype = static_cast<DataType>(header.dtype);
+      TensorShape shape;
+      TF_RETURN_IF_ERROR(TensorShape::BuildTensorShape(dims, &shape));
+      if (!DataTypeCanUseMemcpy(dtype) ||
+          header.data_bytes != shape.num_elements() * DataTypeSize(dtype)) {
+        return MalformedPayload();
+      }
+      auto* buf = new PayloadTensorBuffer(
+          payload, data + header.data_offset, header.data_bytes);
+      tensor = Tensor(dtype, shape, buf);
+      buf->Unref();
+    }
+    result.components.push_back(std::move(tensor));
+  }
+  return OkStatus();
+}
+
+class ShmDataTransferServer : public DataTransferServer {
+ public:
+  ShmDataTransferServer(GetElementT get_element,
+                        const ShmTransferOptions& options)
+      : get_element_(std::move(get_element)), options_(options) {}
+  ~ShmDataTransferServer() override;
+
+  Status Start() override;
+  int get_port() override { return port_; }
+
+  // Clients on other hosts cannot use the server.
+  StatusOr<std::string> GetCompatibilityInfo() const override {
+    return port::Hostname();
+  }
+
+ private:
+  void AcceptLoop();
+  void ServeConnection(int socket);
+  Status ServeRequests(int socket, Ring* ring);
+  // Finds room for `length` bytes in `ring` at or after `*head`, waiting for
+  // the client to release space for up to `options_.ring_full_timeout_us`.
+  // Returns false if there is no room.
+  bool ReserveRing(Ring* ring, uint64_t length, uint64_t* head,
+                   uint64_t* position);
+
+  const GetElementT get_element_;
+  const ShmTransferOptions options_;
+  int listen_socket_ = -1;
+  int port_ = 0;
+  std::unique_ptr<Thread> accept_thread_;
+
+  mutex mu_;
+  condition_variable connections_done_;
+  bool stopped_ TF_GUARDED_BY(mu_) = false;
+  absl::flat_hash_set<int> connections_ TF_GUARDED_BY(mu_);
+};
+
+ShmDataTransferServer::~ShmDataTransferServer() {
+  {
+    mutex_lock l(mu_);
+    stopped_ = true;
+    for (int socket : connections_) shutdown(socket, SHUT_RDWR);
+  }
+  if (listen_socket_ >= 0) shutdown(listen_socket_, SHUT_RDWR);
+  accept_thread_.reset();
+  {
+    mutex_lock l(mu_);
+    while (!connections_.empty()) connections_done_.wait(l);
+  }
+  if (listen_socket_ >= 0) close(listen_socket_);
+}
+
+Status ShmDataTransferServer::Start() {
+  listen_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_socket_ < 0) return ErrnoError("socket");
+  for (int attempt = 0; port_ == 0; ++attempt) {
+    if (attempt == kMaxBindAttempts) {
+      return errors::Unavailable("shm data transfer: no free port found");
+    }
+    const int port = 1 + random::New64() % 65535;
+    sockaddr_un addr;
+    socklen_t addr_len;
+    MakeSocketAddress(port, &addr, &addr_len);
+    if (bind(listen_socket_, reinterpret_cast<sockaddr*>(&addr), addr_len) ==
+        0) {
+      port_ = port;
+    } else if (errno != EADDRINUSE) {
+      return ErrnoError("bind");
+    }
+  }
+  if (listen(listen_socket_, SOMAXCONN) != 0) return ErrnoError("listen");
+  accept_thread_.reset(Env::Default()->StartThread(
+      {}, "tf_data_shm_transfer_accept", [this]() { AcceptLoop(); }));
+  VLOG(1) << "Started shm data transfer server on port " << port_;
+  return OkStatus();
+}
+
+void ShmDataTransferServer::AcceptLoop() {
+  while (true) {
+    const int socket = accept4(listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+    mutex_lock l(mu_);
+    if (stopped_) {
+      if (socket >= 0) close(socket);
+      return;
+    }
+    if (socket < 0) {
+      if (errno != EINTR) {
+        LOG(WARNING) << "shm data transfer server failed to accept: "
+                     << strerror(errno);
+        Env::Default()->SleepForMicroseconds(10 * 1000);
+      }
+      continue;
+    }
+    connections_.insert(socket);
+    Env::Default()->SchedClosure([this, socket]() {
+      ServeConnection(socket);
+      mutex_lock l(mu_);
+      connections_.erase(socket);
+      close(socket);
+      if (connections_.empty()) connections_done_.notify_all();
+    });
+  }
+}
+
+void ShmDataTransferServer::ServeConnection(int socket) {
+  std::unique_ptr<Ring> ring;
+  int ring_fd = -1;
+  if (options_.ring_bytes > 0) {
+    Status s = Ring::Create(options_.ring_bytes, &ring_fd, &ring);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to create shared-memory ring; sending elements "
+                   << "over the socket: " << s;
+    }
+  }
+  Hello hello = {ring ? ring->size() : 0};
+  Status s = SendHello(socket, hello, ring_fd);
+  if (ring_fd >= 0) close(ring_fd);
+  if (s.ok()) s = ServeRequests(socket, ring.get());
+  VLOG(2) << "shm data transfer connection closed: " << s;
+}
+
+bool ShmDataTransferServer::ReserveRing(Ring* ring, uint64_t length,
+                                        uint64_t* head, uint64_t* position) {
+  const uint64_t size = ring->size();
+  if (length > size) return false;
+  uint64_t pos = RoundUp(*head);
+  // Payloads are contiguous, so skip the end of the ring if it is too short.
+  if (pos % size + length > size) pos += size - pos % size;
+  const uint64_t deadline_us =
+      Env::Default()->NowMicros() + options_.ring_full_timeout_us;
+  while (pos + length - ring->tail()->load(std::memory_order_acquire) > size) {
+    if (Env::Default()->NowMicros() >= deadline_us) return false;
+    Env::Default()->SleepForMicroseconds(20);
+  }
+  *head = pos + length;
+  *position = pos;
+  return true;
+}
+
+Status ShmDataTransferServer::ServeRequests(int socket, Ring* ring) {
+  uint64_t ring_head = 0;
+  std::string request_bytes;
+  std::string inline_payload;
+  while (true) {
+    uint64_t request_length;
+    TF_RETURN_IF_ERROR(
+        ReadFully(socket, &request_length, sizeof(request_length)));
+    if (request_length > kMaxRequestBytes) {
+      return errors::InvalidArgument("GetElementRequest of ", request_length,
+                                     " bytes is too large");
+    }
+    request_bytes.resize(request_length);
+    TF_RETURN_IF_ERROR(
+        ReadFully(socket, request_bytes.data(), request_bytes.size()));
+
+    GetElementRequest request;
+    GetElementResult result;
+    ElementEncoder encoder;
+    Status s = request.ParseFromString(request_bytes)
+                   ? get_element_(&request, &result)
+                   : errors::InvalidArgument("Failed to parse request.");
+    if (s.ok() && !result.end_of_sequence && !result.skip) {
+      s = encoder.Init(result.components);
+    }
+    ResponseHeader header = {};
+    if (!s.ok()) {
+      header.code = static_cast<int32_t>(s.code());
+      header.length = s.error_message().size();
+      TF_RETURN_IF_ERROR(WriteFully(socket, &header, sizeof(header)));
+      TF_RETURN_IF_ERROR(
+          WriteFully(socket, s.error_message().data(), header.length));
+      continue;
+    }
+
+    header.element_index = result.element_index;
+    if (result.end_of_sequence) header.flags |= kEndOfSequence;
+    if (result.skip) header.flags |= kSkip;
+    if (result.end_of_sequence || result.skip) {
+      TF_RETURN_IF_ERROR(WriteFully(socket, &header, sizeof(header)));
+      continue;
+    }
+    if (encoder.compressed()) header.flags |= kCompressed;
+    header.length = encoder.size();
+    uint64_t position;
+    if (ring != nullptr &&
+        ReserveRing(ring, header.length, &ring_head, &position)) {
+      encoder.Write(ring->data(position));
+      header.flags |= kInRing;
+      header.position = position;
+      TF_RETURN_IF_ERROR(WriteFully(socket, &header, sizeof(header)));
+    } else {
+      inline_payload.resize(header.length + kAlignment);
+      char* dest = reinterpret_cast<char*>(
+          RoundUp(reinterpret_cast<uintptr_t>(inline_payload.data())));
+      encoder.Write(dest);
+      TF_RETURN_IF_ERROR(WriteFully(socket, &header, sizeof(header)));
+      TF_RETURN_IF_ERROR(WriteFully(socket, dest, header.length));
+    }
+  }
+}
+
+// The client's side of a ring. Payloads may be released in any order, but the
+// ring's tail only advances past a payload once all earlier payloads have
+// been released too.
+class ClientRing {
+ public:
+  explicit ClientRing(std::unique_ptr<Ring> ring) : ring_(std::move(ring)) {}
+
+  Ring* ring() const { return ring_.get(); }
+
+  void Received(uint64_t position, uint64_t length) {
+    mutex_lock l(mu_);
+    payloads_.push_back({position, position + length, false});
+  }
+
+  void Release(uint64_t position) {
+    mutex_lock l(mu_);
+    for (Payload& payload : payloads_) {
+      if (payload.position == position) {
+        payload.released = true;
+        break;
+      }
+    }
+    uint64_t tail = 0;
+    while (!payloads_.empty() && payloads_.front().released) {
+      tail = payloads_.front().end;
+      payloads_.pop_front();
+    }
+    if (tail > 0) ring_->tail()->store(tail, std::memory_order_release);
+  }
+
+ private:
+  struct Payload {
+    uint64_t position;
+    uint64_t end;
+    bool released;
+  };
+
+  const std::unique_ptr<Ring> ring_;
+  mutex mu_;
+  std::deque<Payload> payloads_ TF_GUARDED_BY(mu_);
+};
+
+class ShmDataTransferClient : public DataTransferClient {
+ public:
+  explicit ShmDataTransferClient(int port) : port_(port) {}
+  ~ShmDataTransferClient() override {
+    if (socket_ >= 0) close(socket_);
+  }
+
+  Status GetElement(const GetElementRequest& req,
+                    GetElementResult& result) override;
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel ShmDataTransferClient.";
+    mutex_lock l(cancel_mu_);
+    cancelled_ = true;
+    if (cancel_socket_ >= 0) shutdown(cancel_socket_, SHUT_RDWR);
+  }
+
+  Status CheckCompatibility(
+      const std::string& compatibility_info) const override {
+    if (compatibility_info != port::Hostname()) {
+      return errors::FailedPrecondition(
+          "The shm data transfer protocol requires the tf.data service worker "
+          "to run on the same host as the client, but the worker runs on ",
+          compatibility_info, " and the client on ", port::Hostname());
+    }
+    return OkStatus();
+  }
+
+  // Connects to the server.
+  Status Initialize() TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    return Connect();
+  }
+
+ private:
+  Status Connect() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  Status Exchange(const GetElementRequest& req, GetElementResult& result)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void Disconnect() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int port_;
+
+  // Serializes requests, which share the connection.
+  mutex mu_;
+  int socket_ TF_GUARDED_BY(mu_) = -1;
+  // Shared with the payloads in the ring, which may outlive the client.
+  std::shared_ptr<ClientRing> ring_ TF_GUARDED_BY(mu_);
+
+  mutex cancel_mu_;
+  bool cancelled_ TF_GUARDED_BY(cancel_mu_) = false;
+  // The connected socket, shut down by TryCancel() to interrupt requests.
+  int cancel_socket_ TF_GUARDED_BY(cancel_mu_) = -1;
+};
+
+Status ShmDataTransferClient::Connect() {
+  const int socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socket < 0) return ErrnoError("socket");
+  sockaddr_un addr;
+  socklen_t addr_len;
+  MakeSocketAddress(port_, &addr, &addr_len);
+  Hello hello;
+  int ring_fd = -1;
+  Status s;
+  if (connect(socket, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0) {
+    s = ErrnoError(absl::StrCat("connect to port ", port_));
+  }
+  if (s.ok()) s = ReceiveHello(socket, &hello, &ring_fd);
+  std::unique_ptr<Ring> ring;
+  if (s.ok() && ring_fd >= 0) {
+    s = Ring::Map(ring_fd, hello.ring_bytes, &ring);
+    close(ring_fd);
+  }
+  if (!s.ok()) {
+    close(socket);
+    return s;
+  }
+  socket_ = socket;
+  ring_ = ring ? std::make_shared<ClientRing>(std::move(ring)) : nullptr;
+  mutex_lock l(cancel_mu_);
+  cancel_socket_ = socket;
+  return OkStatus();
+}
+
+void ShmDataTransferClient::Disconnect() {
+  {
+    mutex_lock l(cancel_mu_);
+    cancel_socket_ = -1;
+  }
+  close(socket_);
+  socket_ = -1;
+  ring_.reset();
+}
+
+Status ShmDataTransferClient::GetElement(const GetElementRequest& req,
+                                         GetElementResult& result) {
+  VLOG(3) << "GetElement for task " << req.task_id() << " from shm worker "
+          << "server.";
+  {
+    mutex_lock l(cancel_mu_);
+    if (cancelled_) {
+      return errors::Cancelled("Client was cancelled.");
+    }
+  }
+  mutex_lock l(mu_);
+  // Reconnects if an earlier request lost the connection.
+  if (socket_ < 0) TF_RETURN_IF_ERROR(Connect());
+  Status s = Exchange(req, result);
+  if (!s.ok() && socket_ >= 0 && errors::IsUnavailable(s)) Disconnect();
+  return s;
+}
+
+Status ShmDataTransferClient::Exchange(const GetElementRequest& req,
+                                       GetElementResult& result) {
+  std::string request_bytes;
+  req.SerializeToString(&request_bytes);
+  const uint64_t request_length = request_bytes.size();
+  TF_RETURN_IF_ERROR(
+      WriteFully(socket_, &request_length, sizeof(request_length)));
+  TF_RETURN_IF_ERROR(
+      WriteFully(socket_, request_bytes.data(), request_bytes.size()));
+
+  ResponseHeader header;
+  TF_RETURN_IF_ERROR(ReadFully(socket_, &header, sizeof(header)));
+  if (header.code != 0) {
+    std::string message(header.length, '\0');
+    TF_RETURN_IF_ERROR(ReadFully(socket_, message.data(), message.size()));
+    return Status(static_cast<absl::StatusCode>(header.code), message);
+  }
+  result.element_index = header.element_index;
+  result.end_of_sequence = header.flags & kEndOfSequence;
+  result.skip = header.flags & kSkip;
+  if (result.end_of_sequence || result.skip) return OkStatus();
+
+  core::RefCountPtr<PayloadBuffer> payload;
+  if (header.flags & kInRing) {
+    if (ring_ == nullptr || header.length > ring_->ring()->size() ||
+        header.position % ring_->ring()->size() + header.length >
+            ring_->ring()->size()) {
+      return MalformedPayload();
+    }
+    ring_->Received(header.position, header.length);
+    payload.reset(new PayloadBuffer(
+        ring_->ring()->data(header.position), header.length,
+        [ring = ring_, position = header.position]() {
+          ring->Release(position);
+        }));
+  } else {
+    char* data = static_cast<char*>(port::AlignedMalloc(
+        std::max<size_t>(header.length, 1), kAlignment));
+    payload.reset(new PayloadBuffer(data, header.length,
+                                    [data]() { port::AlignedFree(data); }));
+    TF_RETURN_IF_ERROR(ReadFully(socket_, data, header.length));
+  }
+  return DecodeElement(header.flags, payload.get(), result);
+}
+
+}  // namespace
+
+Status NewShmDataTransferServer(DataTransferServer::GetElementT get_element,
+                                const ShmTransferOptions& options,
+                                std::shared_ptr<DataTransferServer>* out) {
+  *out = std::make_shared<ShmDataTransferServer>(std::move(get_element),
+                                                 options);
+  return OkStatus();
+}
+
+Status NewShmDataTransferClient(const std::string& address,
+                                std::unique_ptr<DataTransferClient>* out) {
+  const size_t colon = address.rfind(':');
+  int port;
+  if (colon == std::string::npos ||
+      !absl::SimpleAtoi(absl::string_view(address).substr(colon + 1), &port)) {
+    return errors::InvalidArgument(
+        "Expected an address of the form <host>:<port> for the shm data "
+        "transfer protocol, got ",
+        address);
+  }
+  auto client = std::make_unique<ShmDataTransferClient>(port);
+  TF_RETURN_IF_ERROR(client->Initialize());
+  *out = std::move(client);
+  return OkStatus();
+}
+
+#else  // defined(__linux__)
+
+Status NewShmDataTransferServer(DataTransferServer::GetElementT get_element,
+                                const ShmTransferOptions& options,
+                                std::shared_ptr<DataTransferServer>* out) {
+  return errors::Unimplemented(
+      "The shm data transfer protocol is only supported on Linux.");
+}
+
+Status NewShmDataTransferClient(const std::string& address,
+                                std::unique_ptr<DataTransferClient>* out) {
+  return errors::Unimplemented(
+      "The shm data transfer protocol is only supported on Linux.");
+}
+
+#endif  // defined(__linux__)
+
+namespace {
+
+class ShmTransferRegistrar {
+ public:
+  ShmTransferRegistrar() {
+    DataTransferServer::Register(
+        kShmTransferProtocol,
+        [](DataTransferServer::GetElementT get_element,
+           std::shared_ptr<DataTransferServer>* out) {
+          return NewShmDataTransferServer(std::move(get_element),
+                                          ShmTransferOptions(), out);
+        });
+    DataTransferClient::Register(
+        kShmTransferProtocol, [](DataTransferClient::Config config,
+                                 std::unique_ptr<DataTransferClient>* out) {
+          return NewShmDataTransferClient(config.address, out);
+        });
+  }
+};
+static ShmTransferRegistrar shm_transfer_registrar;
+
+}  // namespace
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,67 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+
+// Data transfer protocol for clients on the same host as the tf.data service
+// worker.
+//
+// A client connects to the worker over a Unix domain socket and sends its
+// GetElement requests over it. For every connection, the server creates a
+// shared-memory ring that the client maps. Elements are written to the ring
+// once, and the client wraps the ring memory of their tensors without copying
+// it; space in the ring is reclaimed when the client's tensors are destroyed.
+// Elements that do not fit in the ring, e.g. because the client holds on to
+// many earlier elements, are sent over the socket instead.
+//
+// The socket and the shared memory have no names in the filesystem, so
+// nothing is left behind when the worker or the client crashes. Only
+// supported on Linux.
+constexpr const char kShmTransferProtocol[] = "shm";
+
+struct ShmTransferOptions {
+  // Size of the shared-memory ring of each client connection. If 0, all
+  // elements are sent over the socket.
+  size_t ring_bytes = 64 << 20;
+  // How long the server waits for the client to free space in the ring before
+  // sending an element over the socket.
+  int64_t ring_full_timeout_us = 1000;
+};
+
+// Creates a "shm" transfer server that serves elements from `get_element`.
+// The server listens on the port returned by `get_port()` once started.
+Status NewShmDataTransferServer(DataTransferServer::GetElementT get_element,
+                                const ShmTransferOptions& options,
+                                std::shared_ptr<DataTransferServer>* out);
+
+// Creates a client for the "shm" transfer server whose port is the last
+// component of `address`, e.g. "localhost:1234".
+Status NewShmDataTransferClient(const std::string& address,
+                                std::unique_ptr<DataTransferClient>* out);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
@@ -0,0 +1,282 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_transfer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Produces `num_elements` elements, each made of an int64 vector of
+// `element_size` values equal to the element index and a string scalar.
+DataTransferServer::GetElementT RangeElements(int64_t num_elements,
+                                              int64_t element_size) {
+  auto next = std::make_shared<int64_t>(0);
+  return [=](const GetElementRequest* request, GetElementResult* result) {
+    if (*next == num_elements) {
+      result->end_of_sequence = true;
+      return OkStatus();
+    }
+    Tensor values(DT_INT64, TensorShape({element_size}));
+    values.flat<int64_t>().setConstant(*next);
+    result->components.push_back(values);
+    result->components.push_back(
+        test::AsScalar<tstring>(absl::StrCat("element ", *next)));
+    result->element_index = (*next)++;
+    return OkStatus();
+  };
+}
+
+std::shared_ptr<DataTransferServer> StartServer(
+    DataTransferServer::GetElementT get_element,
+    const ShmTransferOptions& options = ShmTransferOptions()) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_CHECK_OK(NewShmDataTransferServer(get_element, options, &server));
+  TF_CHECK_OK(server->Start());
+  return server;
+}
+
+std::unique_ptr<DataTransferClient> ConnectClient(DataTransferServer& server) {
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build(
+      kShmTransferProtocol,
+      {/*protocol=*/"", absl::StrCat("localhost:", server.get_port())},
+      &client));
+  return client;
+}
+
+void ExpectRangeElement(const GetElementResult& result, int64_t index,
+                        int64_t element_size) {
+  ASSERT_FALSE(result.end_of_sequence);
+  ASSERT_EQ(2, result.components.size());
+  EXPECT_EQ(index, result.element_index);
+  Tensor expected(DT_INT64, TensorShape({element_size}));
+  expected.flat<int64_t>().setConstant(index);
+  test::ExpectTensorEqual<int64_t>(expected, result.components[0]);
+  test::ExpectTensorEqual<tstring>(
+      test::AsScalar<tstring>(absl::StrCat("element ", index)),
+      result.components[1]);
+}
+
+TEST(ShmTransferTest, TransferUncompressedElements) {
+  auto server = StartServer(RangeElements(100, 1000));
+  auto client = ConnectClient(*server);
+  GetElementRequest request;
+  for (int64_t i = 0; i < 100; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(request, result));
+    ExpectRangeElement(result, i, 1000);
+  }
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(request, result));
+  EXPECT_TRUE(result.end_of_sequence);
+}
+
+TEST(ShmTransferTest, TransferCompressedElement) {
+  CompressedElement compressed;
+  compressed.set_data(std::string(10000, 'x'));
+  compressed.set_version(1);
+  auto server = StartServer(
+      [&compressed](const GetElementRequest*, GetElementResult* result) {
+        Tensor tensor(DT_VARIANT, TensorShape({}));
+        tensor.scalar<Variant>()() = compressed;
+        result->components.push_back(tensor);
+        return OkStatus();
+      });
+  auto client = ConnectClient(*server);
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ASSERT_EQ(1, result.components.size());
+  const CompressedElement* received =
+      result.components[0].scalar<Variant>()().get<CompressedElement>();
+  ASSERT_NE(nullptr, received);
+  EXPECT_EQ(compressed.data(), received->data());
+  EXPECT_EQ(1, received->version());
+}
+
+TEST(ShmTransferTest, ElementsOutliveRingSpace) {
+  // The ring fits about three elements. Elements that are kept alive block
+  // the ring, so later ones are sent over the socket, and the ring is used
+  // again once they are freed.
+  ShmTransferOptions options;
+  options.ring_bytes = 32 << 10;
+  options.ring_full_timeout_us = 0;
+  auto server = StartServer(RangeElements(200, 1000), options);
+  auto client = ConnectClient(*server);
+  std::vector<GetElementResult> kept;
+  for (int64_t i = 0; i < 200; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ExpectRangeElement(result, i, 1000);
+    if (i % 50 < 10) {
+      kept.push_back(std::move(result));
+    } else {
+      kept.clear();
+    }
+  }
+  client.reset();
+  // Elements stay valid after the client and server are gone.
+  server.reset();
+  for (int i = 0; i < kept.size(); ++i) {
+    ExpectRangeElement(kept[i], kept[i].element_index, 1000);
+  }
+}
+
+TEST(ShmTransferTest, NoRing) {
+  ShmTransferOptions options;
+  options.ring_bytes = 0;
+  auto server = StartServer(RangeElements(10, 100), options);
+  auto client = ConnectClient(*server);
+  for (int64_t i = 0; i < 10; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ExpectRangeElement(result, i, 100);
+  }
+}
+
+TEST(ShmTransferTest, PropagatesErrors) {
+  auto server = StartServer([](const GetElementRequest* request,
+                               GetElementResult* result) {
+    return errors::NotFound("task ", request->task_id(), " not found");
+  });
+  auto client = ConnectClient(*server);
+  GetElementRequest request;
+  request.set_task_id(7);
+  GetElementResult result;
+  Status s = client->GetElement(request, result);
+  EXPECT_TRUE(errors::IsNotFound(s)) << s;
+  EXPECT_EQ("task 7 not found", s.error_message());
+  // The connection is still usable.
+  EXPECT_TRUE(errors::IsNotFound(client->GetElement(request, result)));
+}
+
+TEST(ShmTransferTest, ServerShutdown) {
+  auto server = StartServer(RangeElements(10, 100));
+  auto client = ConnectClient(*server);
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  server.reset();
+  GetElementResult next;
+  EXPECT_TRUE(
+      errors::IsUnavailable(client->GetElement(GetElementRequest(), next)));
+  // The element received before the shutdown is still valid.
+  ExpectRangeElement(result, 0, 100);
+}
+
+TEST(ShmTransferTest, CancelledClient) {
+  auto server = StartServer(RangeElements(10, 100));
+  auto client = ConnectClient(*server);
+  client->TryCancel();
+  GetElementResult result;
+  EXPECT_TRUE(
+      errors::IsCancelled(client->GetElement(GetElementRequest(), result)));
+}
+
+TEST(ShmTransferTest, NoServer) {
+  std::unique_ptr<DataTransferClient> client;
+  EXPECT_TRUE(errors::IsUnavailable(DataTransferClient::Build(
+      kShmTransferProtocol, {"", "localhost:0"}, &client)));
+  EXPECT_TRUE(errors::IsInvalidArgument(DataTransferClient::Build(
+      kShmTransferProtocol, {"", "localhost"}, &client)));
+}
+
+TEST(ShmTransferTest, Compatibility) {
+  auto server = StartServer(RangeElements(10, 100));
+  auto client = ConnectClient(*server);
+  TF_ASSERT_OK_AND_ASSIGN(std::string info, server->GetCompatibilityInfo());
+  TF_EXPECT_OK(client->CheckCompatibility(info));
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      client->CheckCompatibility(absl::StrCat(info, "-other-host"))));
+}
+
+// Transfers elements of `num_kb` KB between a worker and a client, either
+// through the protos the gRPC transfer sends (without the network stack), or
+// through the shm transfer over the socket or the ring.
+enum TransferMode { kGrpcProtos = 0, kShmSocket = 1, kShmRing = 2 };
+
+void BM_TransferElement(::testing::benchmark::State& state) {
+  const TransferMode mode = static_cast<TransferMode>(state.range(0));
+  const int64_t element_size = state.range(1) * 1024 / sizeof(float);
+  Tensor element(DT_FLOAT, TensorShape({element_size}));
+  element.flat<float>().setConstant(1.0f);
+  auto get_element = [&element](const GetElementRequest*,
+                                GetElementResult* result) {
+    result->components.push_back(element);
+    return OkStatus();
+  };
+
+  std::shared_ptr<DataTransferServer> server;
+  std::unique_ptr<DataTransferClient> client;
+  if (mode != kGrpcProtos) {
+    ShmTransferOptions options;
+    options.ring_bytes = mode == kShmRing ? 64 << 20 : 0;
+    server = StartServer(get_element, options);
+    client = ConnectClient(*server);
+  }
+  GetElementRequest request;
+  for (auto s : state) {
+    GetElementResult result;
+    if (mode == kGrpcProtos) {
+      GetElementResult produced;
+      TF_CHECK_OK(get_element(&request, &produced));
+      GetElementResponse response;
+      produced.components[0].AsProtoTensorContent(
+          response.mutable_uncompressed()->add_components());
+      std::string wire = response.SerializeAsString();
+      GetElementResponse received;
+      CHECK(received.ParseFromString(wire));
+      result.components.emplace_back();
+      CHECK(result.components.back().FromProto(
+          received.uncompressed().components(0)));
+    } else {
+      TF_CHECK_OK(client->GetElement(request, result));
+    }
+    CHECK_EQ(element_size, result.components[0].NumElements());
+  }
+  state.SetBytesProcessed(state.iterations() * element_size * sizeof(float));
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TransferElement)
+    ->ArgPair(kGrpcProtos, 4)
+    ->ArgPair(kShmSocket, 4)
+    ->ArgPair(kShmRing, 4)
+    ->ArgPair(kGrpcProtos, 1024)
+    ->ArgPair(kShmSocket, 1024)
+    ->ArgPair(kShmRing, 1024);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
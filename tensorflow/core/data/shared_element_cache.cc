@@ -0,0 +1,127 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/shared_element_cache.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data {
+
+// Forwards the elements of a sequence, and records when it ends.
+class SharedElementCacheRegistry::EndTrackingSequence : public Sequence {
+ public:
+  EndTrackingSequence(std::unique_ptr<Sequence> sequence,
+                      std::shared_ptr<std::atomic<bool>> ended)
+      : sequence_(std::move(sequence)), ended_(std::move(ended)) {}
+
+  StatusOr<Element> GetNext() override {
+    StatusOr<Element> element = sequence_->GetNext();
+    if (errors::IsOutOfRange(element.status())) {
+      ended_->store(true, std::memory_order_release);
+    }
+    return element;
+  }
+
+  size_t GetElementSizeBytes(const Element& element) const override {
+    return sequence_->GetElementSizeBytes(element);
+  }
+
+ private:
+  const std::unique_ptr<Sequence> sequence_;
+  const std::shared_ptr<std::atomic<bool>> ended_;
+};
+
+SharedElementCacheRegistry* SharedElementCacheRegistry::Global() {
+  static SharedElementCacheRegistry* registry = new SharedElementCacheRegistry;
+  return registry;
+}
+
+std::shared_ptr<SharedElementCacheRegistry::Cache>
+SharedElementCacheRegistry::Lookup(uint64 fingerprint) {
+  auto it = caches_.find(fingerprint);
+  if (it == caches_.end()) return nullptr;
+  std::shared_ptr<Cache> cache = it->second.cache.lock();
+  if (cache == nullptr || cache->IsCancelled() ||
+      it->second.ended->load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return cache;
+}
+
+StatusOr<std::shared_ptr<SharedElementCacheRegistry::Cache>>
+SharedElementCacheRegistry::GetOrCreate(uint64 fingerprint,
+                                        size_t max_cache_size_bytes,
+                                        const SequenceFactory& create_sequence,
+                                        bool* created) {
+  *created = false;
+  {
+    mutex_lock l(mu_);
+    std::shared_ptr<Cache> cache = Lookup(fingerprint);
+    if (cache != nullptr) return cache;
+  }
+  if (max_cache_size_bytes == 0) {
+    return errors::InvalidArgument(
+        "The size of a shared element cache must be positive.");
+  }
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<Sequence> sequence, create_sequence());
+  auto ended = std::make_shared<std::atomic<bool>>(false);
+  auto cache = std::make_shared<Cache>(
+      max_cache_size_bytes,
+      std::make_unique<EndTrackingSequence>(std::move(sequence), ended));
+  std::shared_ptr<Cache> existing;
+  {
+    mutex_lock l(mu_);
+    existing = Lookup(fingerprint);
+    if (existing == nullptr) {
+      // Drops the entries of caches that are no longer in use.
+      absl::erase_if(caches_, [](const auto& entry) {
+        return entry.second.cache.expired();
+      });
+      caches_[fingerprint] = Entry{cache, std::move(ended)};
+      *created = true;
+      VLOG(2) << "Created a shared element cache for dataset " << fingerprint
+              << " with " << max_cache_size_bytes << " bytes of memory.";
+      return cache;
+    }
+  }
+  // Another iterator created the cache concurrently; `cache` and its sequence
+  // are destroyed outside of the lock.
+  return existing;
+}
+
+size_t SharedElementCacheRegistry::NumCaches() {
+  mutex_lock l(mu_);
+  size_t num_caches = 0;
+  for (const auto& [fingerprint, entry] : caches_) {
+    if (!entry.cache.expired()) ++num_caches;
+  }
+  return num_caches;
+}
+
+size_t SharedElementCacheRegistry::GetElementSizeBytes(const Element& element) {
+  size_t size_bytes = 0;
+  for (const Tensor& tensor : element) {
+    size_bytes += tensor.TotalBytes();
+  }
+  return size_bytes;
+}
+
+}  // namespace data
+}  // namespace tensorflow
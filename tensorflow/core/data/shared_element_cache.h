@@ -0,0 +1,101 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SHARED_ELEMENT_CACHE_H_
+#define TENSORFLOW_CORE_DATA_SHARED_ELEMENT_CACHE_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/data/service/cross_trainer_cache.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// Process-wide registry of sliding-window element caches, keyed by the
+// fingerprint of the dataset whose elements they hold.
+//
+// Iterators of the same dataset that run concurrently in a process, e.g. the
+// trials of a hyperparameter search sharing an input pipeline, read from the
+// same `CrossTrainerCache`: the first of them to reach an element produces it,
+// and the others read it from the cache while it remains in the window of
+// `max_cache_size_bytes`. Readers that fall further behind skip the elements
+// evicted from the window.
+//
+// The registry only holds weak references: a cache, and the sequence that
+// produces its elements, is destroyed with the last iterator that reads it.
+// Once the sequence of a cache ends, the registry stops handing the cache out,
+// so that later iterators, e.g. of the next epoch, read a new sequence from
+// the start instead of the end of the window of the previous one.
+//
+// The `SharedElementCacheRegistry` class is thread-safe.
+class SharedElementCacheRegistry {
+ public:
+  using Element = std::vector<Tensor>;
+  using Cache = CrossTrainerCache<Element>;
+  using Sequence = CachableSequence<Element>;
+  using SequenceFactory =
+      std::function<StatusOr<std::unique_ptr<Sequence>>()>;
+
+  // Returns the registry of the process.
+  static SharedElementCacheRegistry* Global();
+
+  // Returns the cache of the dataset with `fingerprint`. If there is none, or
+  // it was cancelled or its sequence ended, creates one of
+  // `max_cache_size_bytes` reading the sequence returned by `create_sequence`
+  // and sets `*created` to true. Sequences signal their end with an OutOfRange
+  // error.
+  //
+  // `create_sequence` runs without holding the registry lock, so that it may
+  // create the iterators of datasets that themselves use shared caches.
+  StatusOr<std::shared_ptr<Cache>> GetOrCreate(
+      uint64 fingerprint, size_t max_cache_size_bytes,
+      const SequenceFactory& create_sequence, bool* created);
+
+  // Returns the number of caches in use.
+  size_t NumCaches();
+
+  // Returns the estimated size of `element` in bytes.
+  static size_t GetElementSizeBytes(const Element& element);
+
+ private:
+  class EndTrackingSequence;
+
+  struct Entry {
+    std::weak_ptr<Cache> cache;
+    // Set by the sequence of the cache once it ends.
+    std::shared_ptr<std::atomic<bool>> ended;
+  };
+
+  // Returns the cache of `fingerprint` if it is in use, not cancelled and its
+  // sequence has not ended.
+  std::shared_ptr<Cache> Lookup(uint64 fingerprint)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutex mu_;
+  absl::flat_hash_map<uint64, Entry> caches_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SHARED_ELEMENT_CACHE_H_
@@ -28,6 +28,8 @@ limitations under the License.
 #include "absl/strings/str_cat.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -77,6 +79,47 @@ std::string ProtoSerializationErrorMessage(const TensorProto& proto,
   return error_message;
 }
 
+// Columns of columnar snapshot files, and the tensors in them, are aligned so
+// that tensors can alias the file memory.
+constexpr int64_t kColumnarAlignment = Allocator::kAllocatorAlignment;
+
+int64_t ColumnarAlignedSize(int64_t size) {
+  return (size + kColumnarAlignment - 1) & ~(kColumnarAlignment - 1);
+}
+
+// Allocates an aligned buffer of `size` bytes from the CPU allocator.
+std::shared_ptr<char> AllocateColumnBuffer(size_t size) {
+  return std::shared_ptr<char>(
+      static_cast<char*>(
+          cpu_allocator()->AllocateRaw(kColumnarAlignment, std::max<size_t>(
+                                                               size, 1))),
+      [](char* ptr) { cpu_allocator()->DeallocateRaw(ptr); });
+}
+
+// Tensor buffer that aliases a column of a columnar snapshot block, which is
+// kept alive by `column`. The memory may be read-only, so kernels must not
+// forward these buffers to their outputs.
+class ColumnarTensorBuffer : public TensorBuffer {
+ public:
+  ColumnarTensorBuffer(std::shared_ptr<const char> column, const char* data,
+                       size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        column_(std::move(column)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("SnapshotColumnarReader");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<const char> column_;
+  const size_t size_;
+};
+
 }  // namespace
 
 /* static */ constexpr const int64_t
@@ -127,6 +170,10 @@ Status Writer::Create(Env* env, const std::string& filename,
       *out_writer =
           std::make_unique<TFRecordWriter>(filename, compression_type);
       break;
+    case 3:
+      *out_writer =
+          std::make_unique<ColumnarWriter>(filename, compression_type, dtypes);
+      break;
     default:
       return errors::InvalidArgument("Snapshot writer version: ", version,
                                      " is not supported.");
@@ -360,6 +407,143 @@ Status CustomWriter::WriteRecord(const absl::Cord& data) {
 }
 #endif  // TF_CORD_SUPPORT
 
+ColumnarWriter::ColumnarWriter(const std::string& filename,
+                               const std::string& compression_type,
+                               const DataTypeVector& dtypes)
+    : filename_(filename),
+      compression_type_(compression_type),
+      dtypes_(dtypes) {}
+
+Status ColumnarWriter::Initialize(tensorflow::Env* env) {
+  if (compression_type_ != io::compression::kNone &&
+      compression_type_ != io::compression::kSnappy) {
+    return errors::InvalidArgument("Compression ", compression_type_,
+                                   " is not supported by snapshot version 3.");
+  }
+  // Offsets in the file must be known to align the columns, so the file is
+  // written from the start rather than appended to.
+  return env->NewWritableFile(filename_, &dest_);
+}
+
+Status ColumnarWriter::WriteTensors(const std::vector<Tensor>& tensors) {
+  if (tensors.size() != dtypes_.size()) {
+    return errors::InvalidArgument("Expected ", dtypes_.size(),
+                                   " tensors, got ", tensors.size());
+  }
+  for (int i = 0, end = tensors.size(); i < end; ++i) {
+    if (tensors[i].dtype() != dtypes_[i]) {
+      return errors::InvalidArgument(
+          "Expected a tensor of type ", DataTypeString(dtypes_[i]),
+          " for component ", i, ", got ", DataTypeString(tensors[i].dtype()));
+    }
+    block_bytes_ += tensors[i].TotalBytes();
+  }
+  block_.push_back(tensors);
+  if (block_bytes_ >= kBlockSizeBytes ||
+      static_cast<int64_t>(block_.size()) >= kMaxBlockElements) {
+    return FlushBlock();
+  }
+  return OkStatus();
+}
+
+Status ColumnarWriter::FlushBlock() {
+  if (block_.empty()) {
+    return OkStatus();
+  }
+  profiler::TraceMe activity("SnapshotColumnarWriter::FlushBlock",
+                             profiler::TraceMeLevel::kInfo);
+  experimental::ColumnarBlockMetadata metadata;
+  metadata.set_num_elements(block_.size());
+  std::vector<std::string> columns(dtypes_.size());
+  int64_t block_size = 0;
+  for (int i = 0, end = dtypes_.size(); i < end; ++i) {
+    experimental::ColumnMetadata* column = metadata.add_columns();
+    std::string& data = columns[i];
+    for (const std::vector<Tensor>& element : block_) {
+      const Tensor& tensor = element[i];
+      experimental::TensorMetadata* tensor_metadata =
+          column->add_tensor_metadata();
+      tensor.shape().AsProto(tensor_metadata->mutable_tensor_shape());
+      data.resize(ColumnarAlignedSize(data.size()));
+      const size_t offset = data.size();
+      if (DataTypeCanUseMemcpy(dtypes_[i])) {
+        StringPiece tensor_data = tensor.tensor_data();
+        data.append(tensor_data.data(), tensor_data.size());
+      } else {
+        TensorProto proto;
+        tensor.AsProtoTensorContent(&proto);
+        if (!proto.AppendToString(&data)) {
+          return errors::DataLoss(
+              ProtoSerializationErrorMessage(proto, filename_));
+        }
+      }
+      tensor_metadata->set_tensor_size_bytes(data.size() - offset);
+    }
+    column->set_size_bytes(data.size());
+    if (compression_type_ == io::compression::kSnappy) {
+      std::string compressed;
+      if (!tsl::port::Snappy_Compress(data.data(), data.size(), &compressed)) {
+        return errors::Internal("Failed to compress using snappy.");
+      }
+      // Columns that do not compress are stored as is, so they can be mapped.
+      if (compressed.size() < data.size()) {
+        data.swap(compressed);
+        column->set_compression(io::compression::kSnappy);
+      }
+    }
+    column->set_offset(block_size);
+    column->set_stored_size_bytes(data.size());
+    block_size += ColumnarAlignedSize(data.size());
+  }
+  metadata.set_block_size_bytes(block_size);
+
+  const std::string metadata_serialized = metadata.SerializeAsString();
+  char header[kHeaderSize];
+  core::EncodeFixed64(header, metadata_serialized.size());
+  TF_RETURN_IF_ERROR(dest_->Append(StringPiece(header, sizeof(header))));
+  position_ += sizeof(header);
+  TF_RETURN_IF_ERROR(AppendAligned(metadata_serialized));
+  for (const std::string& column : columns) {
+    TF_RETURN_IF_ERROR(AppendAligned(column));
+  }
+  block_.clear();
+  block_bytes_ = 0;
+  return OkStatus();
+}
+
+Status ColumnarWriter::AppendAligned(StringPiece data) {
+  static constexpr char kZeros[kColumnarAlignment] = {};
+  TF_RETURN_IF_ERROR(dest_->Append(data));
+  position_ += data.size();
+  const int64_t padding = ColumnarAlignedSize(position_) - position_;
+  if (padding > 0) {
+    TF_RETURN_IF_ERROR(dest_->Append(StringPiece(kZeros, padding)));
+    position_ += padding;
+  }
+  return OkStatus();
+}
+
+Status ColumnarWriter::Sync() {
+  TF_RETURN_IF_ERROR(FlushBlock());
+  return dest_->Sync();
+}
+
+Status ColumnarWriter::Close() {
+  if (dest_ != nullptr) {
+    TF_RETURN_IF_ERROR(FlushBlock());
+    TF_RETURN_IF_ERROR(dest_->Close());
+    dest_ = nullptr;
+  }
+  return OkStatus();
+}
+
+ColumnarWriter::~ColumnarWriter() {
+  Status s = Close();
+  if (!s.ok()) {
+    LOG(ERROR) << "Failed to close snapshot file " << filename_ << ": " << s;
+  }
+}
+
 Status Reader::Create(Env* env, const std::string& filename,
                       const string& compression_type, int version,
                       const DataTypeVector& dtypes,
@@ -377,6 +561,10 @@ Status Reader::Create(Env* env, const std::string& filename,
       *out_reader =
           std::make_unique<TFRecordReader>(filename, compression_type, dtypes);
       break;
+    case 3:
+      *out_reader =
+          std::make_unique<ColumnarReader>(filename, compression_type, dtypes);
+      break;
     default:
       return errors::InvalidArgument("Snapshot reader version: ", version,
                                      " is not supported.");
@@ -949,7 +1137,13 @@ Status CustomReader::SnappyUncompress(
   for (int i = 0, end = simple_tensor_mask_.size(); i < end; ++i) {
     const auto& tensor_metadata = metadata->tensor_metadata(i);
     if (simple_tensor_mask_[i]) {
-      TensorShape shape(tensor_metadata.tensor_shape());
+      TensorShape shape;
+      if (!TensorShape::BuildTensorShape(tensor_metadata.tensor_shape(), &shape)
+               .ok()) {
+        return errors::DataLoss("Invalid tensor shape ",
+                                tensor_metadata.tensor_shape().DebugString(),
+                                " in snapshot tensor metadata");
+      }
       Tensor simple_tensor(dtypes_[i], shape);
       TensorBuffer* buffer = DMAHelper::buffer(&simple_tensor);
       iov[index].iov_base = buffer->data();
@@ -1004,6 +1198,211 @@ Status CustomReader::ReadRecord(absl::Cord* record) {
 }
 #endif  // TF_CORD_SUPPORT
 
+ColumnarReader::ColumnarReader(const std::string& filename,
+                               const string& compression_type,
+                               const DataTypeVector& dtypes)
+    : filename_(filename),
+      compression_type_(compression_type),
+      dtypes_(dtypes) {}
+
+Status ColumnarReader::Initialize(Env* env) {
+  if (compression_type_ != io::compression::kNone &&
+      compression_type_ != io::compression::kSnappy) {
+    return errors::InvalidArgument("Compression ", compression_type_,
+                                   " is not supported by snapshot version 3.");
+  }
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  Status s = env->NewReadOnlyMemoryRegionFromFile(filename_, &region);
+  if (s.ok()) {
+    region_ = std::move(region);
+    file_size_ = region_->length();
+    return OkStatus();
+  }
+  VLOG(2) << "Could not map snapshot file " << filename_
+          << ", reading it instead: " << s;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename_, &file_size_));
+  return env->NewRandomAccessFile(filename_, &file_);
+}
+
+StatusOr<std::shared_ptr<const char>> ColumnarReader::ReadBytes(uint64 offset,
+                                                                uint64 n) {
+  if (offset > file_size_ || n > file_size_ - offset) {
+    return errors::DataLoss("Snapshot file ", filename_, " is truncated: ", n,
+                            " bytes at offset ", offset,
+                            " are past the end of the file of ", file_size_,
+                            " bytes.");
+  }
+  if (region_ != nullptr) {
+    // Shares the ownership of the mapping.
+    return std::shared_ptr<const char>(
+        region_, static_cast<const char*>(region_->data()) + offset);
+  }
+  std::shared_ptr<char> buffer = AllocateColumnBuffer(n);
+  StringPiece result;
+  TF_RETURN_IF_ERROR(file_->Read(offset, n, &result, buffer.get()));
+  if (result.size() != n) {
+    return errors::DataLoss("Read ", result.size(), " bytes instead of ", n,
+                            " at offset ", offset, " of snapshot file ",
+                            filename_);
+  }
+  if (result.data() != buffer.get()) {
+    memcpy(buffer.get(), result.data(), n);
+  }
+  return std::shared_ptr<const char>(std::move(buffer));
+}
+
+Status ColumnarReader::ReadBlockMetadata() {
+  if (offset_ >= file_size_) {
+    return errors::OutOfRange("End of snapshot file ", filename_);
+  }
+  TF_ASSIGN_OR_RETURN(std::shared_ptr<const char> header,
+                      ReadBytes(offset_, kHeaderSize));
+  const uint64 metadata_size = core::DecodeFixed64(header.get());
+  TF_ASSIGN_OR_RETURN(std::shared_ptr<const char> metadata,
+                      ReadBytes(offset_ + kHeaderSize, metadata_size));
+  if (!block_metadata_.ParseFromArray(metadata.get(), metadata_size)) {
+    return errors::DataLoss("Could not parse ColumnarBlockMetadata at offset ",
+                            offset_, " of snapshot file ", filename_);
+  }
+  if (block_metadata_.columns_size() != dtypes_.size()) {
+    return errors::DataLoss("Expected ", dtypes_.size(), " columns, got ",
+                            block_metadata_.columns_size(),
+                            " in snapshot file ", filename_);
+  }
+  block_data_offset_ = ColumnarAlignedSize(offset_ + kHeaderSize +
+                                           metadata_size);
+  offset_ = block_data_offset_ + block_metadata_.block_size_bytes();
+  next_index_ = 0;
+  columns_.clear();
+  tensor_offsets_.clear();
+  return OkStatus();
+}
+
+Status ColumnarReader::ReadColumns() {
+  profiler::TraceMe activity("SnapshotColumnarReader::ReadColumns",
+                             profiler::TraceMeLevel::kInfo);
+  columns_.reserve(block_metadata_.columns_size());
+  tensor_offsets_.reserve(block_metadata_.columns_size());
+  for (const experimental::ColumnMetadata& column : block_metadata_.columns()) {
+    if (column.tensor_metadata_size() != block_metadata_.num_elements()) {
+      return errors::DataLoss("Expected ", block_metadata_.num_elements(),
+                              " tensors in column, got ",
+                              column.tensor_metadata_size(),
+                              " in snapshot file ", filename_);
+    }
+    TF_ASSIGN_OR_RETURN(std::shared_ptr<const char> data,
+                        ReadBytes(block_data_offset_ + column.offset(),
+                                  column.stored_size_bytes()));
+    if (column.compression() == io::compression::kSnappy) {
+      size_t size;
+      if (!tsl::port::Snappy_GetUncompressedLength(
+              data.get(), column.stored_size_bytes(), &size) ||
+          size != column.size_bytes()) {
+        return errors::DataLoss("Uncompressed size mismatch in snapshot file ",
+                                filename_, ": expected ", column.size_bytes(),
+                                " bytes.");
+      }
+      std::shared_ptr<char> uncompressed = AllocateColumnBuffer(size);
+      if (!tsl::port::Snappy_Uncompress(data.get(), column.stored_size_bytes(),
+                                        uncompressed.get())) {
+        return errors::Internal("Failed to perform snappy decompression.");
+      }
+      data = std::move(uncompressed);
+    } else if (!column.compression().empty()) {
+      return errors::InvalidArgument("Compression ", column.compression(),
+                                     " is not supported by snapshot version 3.");
+    } else if (column.stored_size_bytes() != column.size_bytes()) {
+      return errors::DataLoss("Column size mismatch in snapshot file ",
+                              filename_);
+    }
+
+    std::vector<int64_t> offsets;
+    offsets.reserve(column.tensor_metadata_size());
+    int64_t position = 0;
+    for (const auto& tensor_metadata : column.tensor_metadata()) {
+      const int64_t size = tensor_metadata.tensor_size_bytes();
+      position = ColumnarAlignedSize(position);
+      // Checked per tensor so that corrupt sizes cannot overflow `position`.
+      if (size < 0 || size > column.size_bytes() - position) {
+        return errors::DataLoss("Tensors exceed their column in snapshot file ",
+                                filename_);
+      }
+      offsets.push_back(position);
+      position += size;
+    }
+    columns_.push_back(std::move(data));
+    tensor_offsets_.push_back(std::move(offsets));
+  }
+  return OkStatus();
+}
+
+Status ColumnarReader::ColumnTensor(int column, int64_t index, Tensor* tensor) {
+  const experimental::TensorMetadata& tensor_metadata =
+      block_metadata_.columns(column).tensor_metadata(index);
+  const char* data = columns_[column].get() + tensor_offsets_[column][index];
+  const int64_t size = tensor_metadata.tensor_size_bytes();
+  if (!DataTypeCanUseMemcpy(dtypes_[column])) {
+    TensorProto proto;
+    if (!proto.ParseFromArray(data, size)) {
+      return errors::DataLoss("Could not parse TensorProto");
+    }
+    if (!tensor->FromProto(proto)) {
+      return errors::DataLoss("Could not parse Tensor");
+    }
+    return OkStatus();
+  }
+  TensorShape shape;
+  if (!TensorShape::BuildTensorShape(tensor_metadata.tensor_shape(), &shape)
+           .ok()) {
+    return errors::DataLoss("Invalid tensor shape ",
+                            tensor_metadata.tensor_shape().DebugString(),
+                            " in snapshot file ", filename_);
+  }
+  // Divides rather than multiplies, which could overflow for a corrupt shape.
+  const int64_t dtype_size = DataTypeSize(dtypes_[column]);
+  if (size % dtype_size != 0 || shape.num_elements() != size / dtype_size) {
+    return errors::DataLoss("Tensor of shape ", shape.DebugString(), " has ",
+                            size, " bytes in snapshot file ", filename_);
+  }
+  auto* buffer = new ColumnarTensorBuffer(columns_[column], data, size);
+  *tensor = Tensor(dtypes_[column], shape, buffer);
+  buffer->Unref();
+  return OkStatus();
+}
+
+Status ColumnarReader::ReadTensors(std::vector<Tensor>* read_tensors) {
+  profiler::TraceMe activity("SnapshotColumnarReader::ReadTensors",
+                             profiler::TraceMeLevel::kInfo);
+  while (next_index_ == block_metadata_.num_elements()) {
+    TF_RETURN_IF_ERROR(ReadBlockMetadata());
+  }
+  if (columns_.size() != dtypes_.size()) {
+    TF_RETURN_IF_ERROR(ReadColumns());
+  }
+  read_tensors->reserve(dtypes_.size());
+  for (int i = 0, end = dtypes_.size(); i < end; ++i) {
+    Tensor tensor;
+    TF_RETURN_IF_ERROR(ColumnTensor(i, next_index_, &tensor));
+    read_tensors->push_back(std::move(tensor));
+  }
+  ++next_index_;
+  return OkStatus();
+}
+
+Status ColumnarReader::SkipRecords(int64_t num_records) {
+  while (num_records > 0) {
+    if (next_index_ == block_metadata_.num_elements()) {
+      TF_RETURN_IF_ERROR(ReadBlockMetadata());
+      continue;
+    }
+    const int64_t skipped =
+        std::min(num_records, block_metadata_.num_elements() - next_index_);
+    next_index_ += skipped;
+    num_records -= skipped;
+  }
+  return OkStatus();
+}
+
 Status WriteMetadataFile(Env* env, const string& dir,
                          const experimental::SnapshotMetadataRecord* metadata) {
   string metadata_filename = io::JoinPath(dir, kMetadataFilename);
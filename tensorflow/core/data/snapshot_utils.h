@@ -170,6 +170,52 @@ class CustomWriter : public Writer {
   int num_complex_ = 0;
 };
 
+// Writes snapshots with the columnar file format (version 3).
+//
+// Elements are buffered into blocks of about `kBlockSizeBytes`. A block stores
+// a `ColumnarBlockMetadata` record followed by one column per component, with
+// every tensor at a 64-byte aligned offset, so that `ColumnarReader` can hand
+// out tensors that alias a memory mapping of the file. With snappy
+// compression, each column is compressed separately and stored uncompressed if
+// compression does not make it smaller.
+class ColumnarWriter : public Writer {
+ public:
+  static constexpr const int64_t kBlockSizeBytes = 4 << 20;  // 4 MiB
+  static constexpr const int64_t kMaxBlockElements = 1024;
+  static constexpr const size_t kHeaderSize = sizeof(uint64);
+
+  ColumnarWriter(const std::string& filename,
+                 const std::string& compression_type,
+                 const DataTypeVector& dtypes);
+
+  Status WriteTensors(const std::vector<Tensor>& tensors) override;
+
+  Status Sync() override;
+
+  Status Close() override;
+
+  ~ColumnarWriter() override;
+
+ protected:
+  Status Initialize(tensorflow::Env* env) override;
+
+ private:
+  // Writes the buffered elements as a block.
+  Status FlushBlock();
+
+  // Appends `data` followed by zeros up to the next aligned file offset.
+  Status AppendAligned(StringPiece data);
+
+  const std::string filename_;
+  const std::string compression_type_;
+  const DataTypeVector dtypes_;
+  std::unique_ptr<WritableFile> dest_;
+  // Offset in the file at which the next byte is written.
+  int64_t position_ = 0;
+  std::vector<std::vector<Tensor>> block_;
+  int64_t block_bytes_ = 0;
+};
+
 // Interface class for reading snapshot files previous written with Writer.
 class Reader {
  public:
@@ -354,6 +400,64 @@ class CustomReader : public Reader {
   std::vector<bool> simple_tensor_mask_;  // true for simple, false for complex.
 };
 
+// Reads snapshots previously written with `ColumnarWriter`.
+//
+// If the file system supports it, the file is memory mapped and the tensors
+// of uncompressed columns alias the mapping, so reading them neither
+// allocates nor copies tensor data. Such tensors are never forwarded to
+// outputs by kernels. Compressed columns are decompressed once per block.
+class ColumnarReader : public Reader {
+ public:
+  static constexpr const size_t kHeaderSize = sizeof(uint64);
+
+  ColumnarReader(const std::string& filename, const string& compression_type,
+                 const DataTypeVector& dtypes);
+
+  Status ReadTensors(std::vector<Tensor>* read_tensors) override;
+
+  // Skips whole blocks without reading their columns.
+  Status SkipRecords(int64_t num_records) override;
+
+  ~ColumnarReader() override {}
+
+ protected:
+  Status Initialize(Env* env) override;
+
+ private:
+  // Reads the metadata of the block at `offset_` and moves `offset_` to the
+  // next block.
+  Status ReadBlockMetadata();
+
+  // Reads the columns of the current block.
+  Status ReadColumns();
+
+  // Reads `n` bytes at `offset` of the file into an aligned buffer, or returns
+  // a view of the mapped file.
+  StatusOr<std::shared_ptr<const char>> ReadBytes(uint64 offset, uint64 n);
+
+  // Returns the component `index` of the current block's column `column`.
+  Status ColumnTensor(int column, int64_t index, Tensor* tensor);
+
+  const std::string filename_;
+  const string compression_type_;
+  const DataTypeVector dtypes_;
+  // Set if the file is memory mapped; `file_` is used otherwise.
+  std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  std::unique_ptr<RandomAccessFile> file_;
+  uint64 file_size_ = 0;
+  // Offset of the next block in the file.
+  uint64 offset_ = 0;
+  // Offset of the column data of the current block in the file.
+  uint64 block_data_offset_ = 0;
+
+  experimental::ColumnarBlockMetadata block_metadata_;
+  // Column data of the current block and the offset of each tensor in it.
+  std::vector<std::shared_ptr<const char>> columns_;
+  std::vector<std::vector<int64_t>> tensor_offsets_;
+  // Index of the next element of the current block to read.
+  int64_t next_index_ = 0;
+};
+
 // Writes snapshot metadata to the given directory.
 Status WriteMetadataFile(Env* env, const string& dir,
                          const experimental::SnapshotMetadataRecord* metadata);
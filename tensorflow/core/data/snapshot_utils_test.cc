@@ -15,14 +15,20 @@ limitations under the License.
 
 #include "tensorflow/core/data/snapshot_utils.h"
 
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/service/test_util.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 
 namespace tensorflow {
 namespace data {
@@ -93,6 +99,202 @@ TEST(SnapshotUtilTest, CombinationRoundTripTest) {
   SnapshotRoundTrip(io::compression::kNone, 2);
   SnapshotRoundTrip(io::compression::kGzip, 2);
   SnapshotRoundTrip(io::compression::kSnappy, 2);
+
+  SnapshotRoundTrip(io::compression::kNone, 3);
+  SnapshotRoundTrip(io::compression::kSnappy, 3);
+}
+
+// Returns element `i` of a columnar test snapshot: a float vector whose size
+// depends on `i`, an int64 scalar and a string.
+std::vector<Tensor> ColumnarElement(int64_t i) {
+  Tensor values(DT_FLOAT, TensorShape({i % 7}));
+  for (int j = 0; j < i % 7; ++j) {
+    values.flat<float>()(j) = i + j;
+  }
+  return {values, test::AsScalar<int64_t>(i),
+          test::AsScalar<tstring>(absl::StrCat("element ", i))};
+}
+
+const DataTypeVector& ColumnarDtypes() {
+  static const auto* dtypes = new DataTypeVector({DT_FLOAT, DT_INT64,
+                                                  DT_STRING});
+  return *dtypes;
+}
+
+void ExpectColumnarElement(int64_t i, const std::vector<Tensor>& element) {
+  std::vector<Tensor> expected = ColumnarElement(i);
+  ASSERT_EQ(expected.size(), element.size());
+  test::ExpectTensorEqual<float>(expected[0], element[0]);
+  test::ExpectTensorEqual<int64_t>(expected[1], element[1]);
+  test::ExpectTensorEqual<tstring>(expected[2], element[2]);
+}
+
+std::string WriteColumnarSnapshot(const std::string& compression_type,
+                                  int64_t num_elements) {
+  std::string filename = LocalTempFilename();
+  std::unique_ptr<Writer> writer;
+  TF_CHECK_OK(Writer::Create(Env::Default(), filename, compression_type,
+                             /*version=*/3, ColumnarDtypes(), &writer));
+  for (int64_t i = 0; i < num_elements; ++i) {
+    TF_CHECK_OK(writer->WriteTensors(ColumnarElement(i)));
+  }
+  TF_CHECK_OK(writer->Close());
+  return filename;
+}
+
+class ColumnarSnapshotTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(ColumnarSnapshotTest, ReadsBlocks) {
+  // Spans several blocks.
+  const int64_t num_elements = 2 * ColumnarWriter::kMaxBlockElements + 10;
+  std::string filename = WriteColumnarSnapshot(GetParam(), num_elements);
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename, GetParam(),
+                              /*version=*/3, ColumnarDtypes(), &reader));
+  for (int64_t i = 0; i < num_elements; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(reader->ReadTensors(&element));
+    ExpectColumnarElement(i, element);
+    for (const Tensor& tensor : element) {
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(tensor.data()) %
+                       Allocator::kAllocatorAlignment);
+    }
+  }
+  std::vector<Tensor> element;
+  EXPECT_TRUE(errors::IsOutOfRange(reader->ReadTensors(&element)));
+}
+
+TEST_P(ColumnarSnapshotTest, SkipRecords) {
+  const int64_t num_elements = 3 * ColumnarWriter::kMaxBlockElements;
+  std::string filename = WriteColumnarSnapshot(GetParam(), num_elements);
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename, GetParam(),
+                              /*version=*/3, ColumnarDtypes(), &reader));
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(reader->SkipRecords(10));
+  TF_ASSERT_OK(reader->ReadTensors(&element));
+  ExpectColumnarElement(10, element);
+  TF_ASSERT_OK(reader->SkipRecords(ColumnarWriter::kMaxBlockElements * 2));
+  element.clear();
+  TF_ASSERT_OK(reader->ReadTensors(&element));
+  ExpectColumnarElement(ColumnarWriter::kMaxBlockElements * 2 + 11, element);
+  EXPECT_TRUE(errors::IsOutOfRange(reader->SkipRecords(num_elements)));
+}
+
+TEST_P(ColumnarSnapshotTest, TensorsOutliveReader) {
+  std::string filename = WriteColumnarSnapshot(GetParam(), 100);
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename, GetParam(),
+                              /*version=*/3, ColumnarDtypes(), &reader));
+  std::vector<std::vector<Tensor>> elements(100);
+  for (auto& element : elements) {
+    TF_ASSERT_OK(reader->ReadTensors(&element));
+  }
+  reader.reset();
+  TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
+  for (int64_t i = 0; i < elements.size(); ++i) {
+    ExpectColumnarElement(i, elements[i]);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, ColumnarSnapshotTest,
+                         ::testing::Values(io::compression::kNone,
+                                           io::compression::kSnappy));
+
+TEST(SnapshotUtilTest, ColumnarTensorsAreNotForwarded) {
+  std::string filename = WriteColumnarSnapshot(io::compression::kNone, 10);
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename,
+                              io::compression::kNone, /*version=*/3,
+                              ColumnarDtypes(), &reader));
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(reader->ReadTensors(&element));
+  // The tensor aliases the file, so kernels must not write to it.
+  EXPECT_FALSE(element[1].RefCountIsOne());
+}
+
+TEST(SnapshotUtilTest, ColumnarUnsupportedCompression) {
+  std::unique_ptr<Writer> writer;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      Writer::Create(Env::Default(), LocalTempFilename(),
+                     io::compression::kGzip, /*version=*/3, ColumnarDtypes(),
+                     &writer)));
+}
+
+TEST(SnapshotUtilTest, ColumnarWrongDtype) {
+  std::unique_ptr<Writer> writer;
+  TF_ASSERT_OK(Writer::Create(Env::Default(), LocalTempFilename(),
+                              io::compression::kNone, /*version=*/3,
+                              ColumnarDtypes(), &writer));
+  std::vector<Tensor> element = ColumnarElement(0);
+  element[1] = test::AsScalar<int32_t>(0);
+  EXPECT_TRUE(errors::IsInvalidArgument(writer->WriteTensors(element)));
+}
+
+// Writes a columnar snapshot file with one block holding one int64 scalar,
+// described by `tensor_metadata`.
+std::string WriteColumnarBlock(
+    const experimental::TensorMetadata& tensor_metadata) {
+  const int64_t alignment = Allocator::kAllocatorAlignment;
+  experimental::ColumnarBlockMetadata metadata;
+  metadata.set_num_elements(1);
+  metadata.set_block_size_bytes(alignment);
+  experimental::ColumnMetadata* column = metadata.add_columns();
+  column->set_size_bytes(sizeof(int64_t));
+  column->set_stored_size_bytes(sizeof(int64_t));
+  *column->add_tensor_metadata() = tensor_metadata;
+
+  const std::string serialized = metadata.SerializeAsString();
+  std::string contents(sizeof(uint64), '\0');
+  core::EncodeFixed64(&contents[0], serialized.size());
+  contents += serialized;
+  contents.resize((contents.size() + alignment - 1) / alignment * alignment);
+  contents.append(alignment, '\0');
+  std::string filename = LocalTempFilename();
+  TF_CHECK_OK(WriteStringToFile(Env::Default(), filename, contents));
+  return filename;
+}
+
+Status ReadColumnarBlock(const std::string& filename) {
+  std::unique_ptr<Reader> reader;
+  TF_RETURN_IF_ERROR(Reader::Create(Env::Default(), filename,
+                                    io::compression::kNone, /*version=*/3,
+                                    {DT_INT64}, &reader));
+  std::vector<Tensor> element;
+  return reader->ReadTensors(&element);
+}
+
+TEST(SnapshotUtilTest, ColumnarValidBlock) {
+  experimental::TensorMetadata tensor_metadata;
+  tensor_metadata.set_tensor_size_bytes(sizeof(int64_t));
+  TF_EXPECT_OK(ReadColumnarBlock(WriteColumnarBlock(tensor_metadata)));
+}
+
+TEST(SnapshotUtilTest, ColumnarCorruptTensorShape) {
+  experimental::TensorMetadata tensor_metadata;
+  tensor_metadata.mutable_tensor_shape()->add_dim()->set_size(-5);
+  tensor_metadata.set_tensor_size_bytes(sizeof(int64_t));
+  EXPECT_TRUE(errors::IsDataLoss(
+      ReadColumnarBlock(WriteColumnarBlock(tensor_metadata))));
+
+  tensor_metadata.mutable_tensor_shape()->clear_dim();
+  tensor_metadata.mutable_tensor_shape()->set_unknown_rank(true);
+  EXPECT_TRUE(errors::IsDataLoss(
+      ReadColumnarBlock(WriteColumnarBlock(tensor_metadata))));
+}
+
+TEST(SnapshotUtilTest, ColumnarCorruptTensorSize) {
+  experimental::TensorMetadata tensor_metadata;
+  // Eight bytes per element would wrap around to the stored size.
+  tensor_metadata.mutable_tensor_shape()->add_dim()->set_size((1LL << 61) + 1);
+  tensor_metadata.set_tensor_size_bytes(sizeof(int64_t));
+  EXPECT_TRUE(errors::IsDataLoss(
+      ReadColumnarBlock(WriteColumnarBlock(tensor_metadata))));
+
+  tensor_metadata.clear_tensor_shape();
+  tensor_metadata.set_tensor_size_bytes(-1);
+  EXPECT_TRUE(errors::IsDataLoss(
+      ReadColumnarBlock(WriteColumnarBlock(tensor_metadata))));
 }
 
 TEST(SnapshotUtilTest, MetadataFileRoundTrip) {
@@ -166,11 +368,86 @@ void SnapshotTFRecordReaderGzipBenchmark(::testing::benchmark::State& state) {
   SnapshotReaderBenchmarkLoop(state, io::compression::kGzip, 2);
 }
 
+void SnapshotColumnarReaderNoneBenchmark(::testing::benchmark::State& state) {
+  SnapshotReaderBenchmarkLoop(state, io::compression::kNone, 3);
+}
+
+void SnapshotColumnarReaderSnappyBenchmark(::testing::benchmark::State& state) {
+  SnapshotReaderBenchmarkLoop(state, io::compression::kSnappy, 3);
+}
+
+// Reads elements of ten 1KB float tensors and reports the tensor allocations
+// made per element.
+void BM_SnapshotReadNumeric(::testing::benchmark::State& state) {
+  const int version = state.range(0);
+  const std::string compression_type =
+      state.range(1) ? io::compression::kSnappy : io::compression::kNone;
+  constexpr int64_t kNumElements = 1000;
+  DataTypeVector dtypes(10, DT_FLOAT);
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < dtypes.size(); ++i) {
+    Tensor t(DT_FLOAT, TensorShape({256}));
+    for (int j = 0; j < 256; ++j) {
+      t.flat<float>()(j) = i * j;
+    }
+    tensors.push_back(t);
+  }
+
+  std::string filename = LocalTempFilename();
+  std::unique_ptr<Writer> writer;
+  TF_ASSERT_OK(Writer::Create(Env::Default(), filename, compression_type,
+                              version, dtypes, &writer));
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    TF_ASSERT_OK(writer->WriteTensors(tensors));
+  }
+  TF_ASSERT_OK(writer->Close());
+
+  EnableCPUAllocatorStats();
+  auto num_allocs = []() -> int64_t {
+    auto stats = cpu_allocator()->GetStats();
+    return stats ? stats->num_allocs : 0;
+  };
+  std::unique_ptr<Reader> reader;
+  int64_t allocs = 0;
+  int64_t start_allocs = num_allocs();
+  for (auto s : state) {
+    std::vector<Tensor> read_tensors;
+    Status status = reader == nullptr ? errors::OutOfRange("")
+                                      : reader->ReadTensors(&read_tensors);
+    if (errors::IsOutOfRange(status)) {
+      state.PauseTiming();
+      allocs += num_allocs() - start_allocs;
+      reader.reset();
+      TF_ASSERT_OK(Reader::Create(Env::Default(), filename, compression_type,
+                                  version, dtypes, &reader));
+      start_allocs = num_allocs();
+      state.ResumeTiming();
+      TF_ASSERT_OK(reader->ReadTensors(&read_tensors));
+    }
+  }
+  allocs += num_allocs() - start_allocs;
+  state.SetItemsProcessed(state.iterations());
+  state.counters["allocs_per_element"] =
+      static_cast<double>(allocs) / state.iterations();
+
+  TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
+}
+
+BENCHMARK(BM_SnapshotReadNumeric)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(2, 0)
+    ->ArgPair(2, 1)
+    ->ArgPair(3, 0)
+    ->ArgPair(3, 1);
+
 BENCHMARK(SnapshotCustomReaderNoneBenchmark);
 BENCHMARK(SnapshotCustomReaderGzipBenchmark);
 BENCHMARK(SnapshotCustomReaderSnappyBenchmark);
 BENCHMARK(SnapshotTFRecordReaderNoneBenchmark);
 BENCHMARK(SnapshotTFRecordReaderGzipBenchmark);
+BENCHMARK(SnapshotColumnarReaderNoneBenchmark);
+BENCHMARK(SnapshotColumnarReaderSnappyBenchmark);
 
 void SnapshotWriterBenchmarkLoop(::testing::benchmark::State& state,
                                  std::string compression_type, int version) {
@@ -217,12 +494,22 @@ void SnapshotTFRecordWriterSnappyBenchmark(::testing::benchmark::State& state) {
   SnapshotWriterBenchmarkLoop(state, io::compression::kSnappy, 2);
 }
 
+void SnapshotColumnarWriterNoneBenchmark(::testing::benchmark::State& state) {
+  SnapshotWriterBenchmarkLoop(state, io::compression::kNone, 3);
+}
+
+void SnapshotColumnarWriterSnappyBenchmark(::testing::benchmark::State& state) {
+  SnapshotWriterBenchmarkLoop(state, io::compression::kSnappy, 3);
+}
+
 BENCHMARK(SnapshotCustomWriterNoneBenchmark);
 BENCHMARK(SnapshotCustomWriterGzipBenchmark);
 BENCHMARK(SnapshotCustomWriterSnappyBenchmark);
 BENCHMARK(SnapshotTFRecordWriterNoneBenchmark);
 BENCHMARK(SnapshotTFRecordWriterGzipBenchmark);
 BENCHMARK(SnapshotTFRecordWriterSnappyBenchmark);
+BENCHMARK(SnapshotColumnarWriterNoneBenchmark);
+BENCHMARK(SnapshotColumnarWriterSnappyBenchmark);
 
 }  // namespace
 }  // namespace snapshot_util
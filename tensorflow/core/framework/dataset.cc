@@ -1096,6 +1096,7 @@ Status DatasetBaseIterator::GetNext(IteratorContext* ctx,
   });
   profiler::TraceMe activity([&] { return BuildTraceMeName(); },
                              profiler::TraceMeLevel::kInfo);
+  ElementTraceScope trace_scope(ctx->element_tracer().get(), prefix());
   DVLOG(3) << prefix() << " GetNext enter";
   auto model = ctx->model();
   bool output_was_recording =
@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset_metadata.pb.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/framework/dataset_stateful_op_allowlist.h"
+#include "tensorflow/core/framework/element_tracing.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/function_handle_cache.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -639,6 +640,7 @@ class IteratorContext {
         : allocator_getter(ctx->allocator_getter()),
           cancellation_manager(ctx->cancellation_manager()),
           collective_executor(ctx->collective_executor()),
+          element_tracer(ctx->element_tracer()),
           env(ctx->env()),
           flr(ctx->flr()),
           function_handle_cache(ctx->function_handle_cache()),
@@ -694,6 +696,10 @@ class IteratorContext {
     // Collective support.
     CollectiveExecutor* collective_executor = nullptr;
 
+    // If non-null, traces the latency of sampled elements through the
+    // iterators.
+    std::shared_ptr<ElementTracer> element_tracer = nullptr;
+
     // Interface to operating system functionality.
     Env* env = nullptr;
 
@@ -791,6 +797,10 @@ class IteratorContext {
     return params_.collective_executor;
   }
 
+  const std::shared_ptr<ElementTracer>& element_tracer() {
+    return params_.element_tracer;
+  }
+
   Env* env() const { return params_.env; }
 
   FunctionLibraryRuntime* flr() { return params_.flr; }
@@ -0,0 +1,239 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/element_tracing.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/env_time.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/numbers.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/profiler/lib/traceme_encode.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Number of recent self times kept per iterator.
+constexpr int64_t kMaxSamplesPerStage = 1024;
+
+// Returns the `percentile` of `sorted`, which must not be empty.
+int64_t Percentile(const std::vector<int64_t>& sorted, int percentile) {
+  const size_t index = (sorted.size() - 1) * percentile / 100;
+  return sorted[index];
+}
+
+std::string FormatNanos(int64_t nanos) {
+  return strings::HumanReadableElapsedTime(static_cast<double>(nanos) / 1e9);
+}
+
+std::string FormatStage(const ElementTracer::StageSummary& stage) {
+  return absl::StrCat(stage.prefix, " (p50 ", FormatNanos(stage.p50_nanos),
+                      ", p90 ", FormatNanos(stage.p90_nanos), ", p99 ",
+                      FormatNanos(stage.p99_nanos), " over ",
+                      stage.num_samples, " elements)");
+}
+
+}  // namespace
+
+std::string ElementTracer::Summary::Bottleneck() const {
+  if (consumer_stages.empty()) return "";
+  const StageSummary& stage = consumer_stages.front();
+  std::string bottleneck =
+      absl::StrCat("The consumer waited the longest in ", FormatStage(stage));
+  // The background stages are sorted, so the first one feeding `stage` is the
+  // slowest.
+  const std::string input_prefix = absl::StrCat(stage.prefix, "::");
+  for (const StageSummary& input : background_stages) {
+    if (absl::StartsWith(input.prefix, input_prefix)) {
+      absl::StrAppend(&bottleneck, ", whose input spends the longest in ",
+                      FormatStage(input));
+      break;
+    }
+  }
+  absl::StrAppend(&bottleneck, ".");
+  return bottleneck;
+}
+
+std::string ElementTracer::Summary::DebugString() const {
+  std::string result = Bottleneck();
+  absl::StrAppend(&result, "\nConsumer thread:");
+  for (const StageSummary& stage : consumer_stages) {
+    absl::StrAppend(&result, "\n  ", FormatStage(stage));
+  }
+  absl::StrAppend(&result, "\nBackground threads:");
+  for (const StageSummary& stage : background_stages) {
+    absl::StrAppend(&result, "\n  ", FormatStage(stage));
+  }
+  return result;
+}
+
+ElementTracer::ElementTracer(int64_t sampling_period,
+                             int64_t summary_period_nanos)
+    : sampling_period_(std::max<int64_t>(sampling_period, 1)),
+      summary_period_nanos_(summary_period_nanos),
+      last_summary_nanos_(EnvTime::NowNanos()) {}
+
+void ElementTracer::SetConsumerPrefix(const std::string& prefix) {
+  mutex_lock l(mu_);
+  consumer_prefix_ = prefix;
+}
+
+ElementTracer::ThreadState& ElementTracer::GetThreadState() {
+  static thread_local ThreadState state;
+  return state;
+}
+
+ElementTracer::Trace* ElementTracer::MaybeStartTrace() {
+  if (num_calls_.fetch_add(1, std::memory_order_relaxed) % sampling_period_ !=
+      0) {
+    return nullptr;
+  }
+  // Reuses the buffers of the previous traces of the thread.
+  static thread_local Trace trace;
+  trace.tracer = this;
+  trace.id = next_trace_id_.fetch_add(1, std::memory_order_relaxed);
+  trace.open_spans.clear();
+  trace.self_nanos.clear();
+  return &trace;
+}
+
+void ElementTracer::FinishTrace(Trace* trace) {
+  if (trace->self_nanos.empty()) return;
+  // A trace records one sample per iterator, adding up the self times of the
+  // calls it made to the iterator, e.g. to batch elements.
+  std::vector<std::pair<const std::string*, int64_t>> stages;
+  for (const auto& [prefix, self_nanos] : trace->self_nanos) {
+    auto it = std::find_if(stages.begin(), stages.end(), [&](const auto& s) {
+      return *s.first == prefix;
+    });
+    if (it == stages.end()) {
+      stages.emplace_back(&prefix, self_nanos);
+    } else {
+      it->second += self_nanos;
+    }
+  }
+  // The outermost span completes last.
+  const std::string& root_prefix = trace->self_nanos.back().first;
+
+  const int64_t now_nanos = EnvTime::NowNanos();
+  Summary summary;
+  {
+    mutex_lock l(mu_);
+    auto& stage_samples =
+        root_prefix == consumer_prefix_ ? consumer_stages_ : background_stages_;
+    for (const auto& [prefix, self_nanos] : stages) {
+      Samples& samples = stage_samples[*prefix];
+      if (samples.nanos.size() < kMaxSamplesPerStage) {
+        samples.nanos.push_back(self_nanos);
+      } else {
+        samples.nanos[samples.num_recorded % kMaxSamplesPerStage] = self_nanos;
+      }
+      ++samples.num_recorded;
+    }
+    if (summary_period_nanos_ <= 0 ||
+        now_nanos - last_summary_nanos_ < summary_period_nanos_) {
+      return;
+    }
+    last_summary_nanos_ = now_nanos;
+    summary.consumer_stages = Summarize(consumer_stages_);
+    summary.background_stages = Summarize(background_stages_);
+  }
+  LOG(INFO) << "tf.data element tracing summary: " << summary.DebugString();
+}
+
+std::vector<ElementTracer::StageSummary> ElementTracer::Summarize(
+    const absl::flat_hash_map<std::string, Samples>& stages) {
+  std::vector<StageSummary> result;
+  result.reserve(stages.size());
+  for (const auto& [prefix, samples] : stages) {
+    if (samples.nanos.empty()) continue;
+    std::vector<int64_t> sorted = samples.nanos;
+    std::sort(sorted.begin(), sorted.end());
+    StageSummary stage;
+    stage.prefix = prefix;
+    stage.num_samples = samples.num_recorded;
+    stage.p50_nanos = Percentile(sorted, 50);
+    stage.p90_nanos = Percentile(sorted, 90);
+    stage.p99_nanos = Percentile(sorted, 99);
+    result.push_back(std::move(stage));
+  }
+  std::sort(result.begin(), result.end(),
+            [](const StageSummary& a, const StageSummary& b) {
+              return a.p90_nanos > b.p90_nanos ||
+                     (a.p90_nanos == b.p90_nanos && a.prefix < b.prefix);
+            });
+  return result;
+}
+
+ElementTracer::Summary ElementTracer::GetSummary() const {
+  mutex_lock l(mu_);
+  Summary summary;
+  summary.consumer_stages = Summarize(consumer_stages_);
+  summary.background_stages = Summarize(background_stages_);
+  return summary;
+}
+
+void ElementTraceScope::Start(ElementTracer* tracer,
+                              const std::string& prefix) {
+  tracer_ = tracer;
+  ElementTracer::ThreadState& state = ElementTracer::GetThreadState();
+  if (state.depth++ == 0) {
+    state.trace = tracer->MaybeStartTrace();
+    root_ = state.trace != nullptr;
+  }
+  ElementTracer::Trace* trace = state.trace;
+  // Calls into pipelines with other tracers, e.g. in user-defined functions,
+  // count towards the span that makes them.
+  if (trace == nullptr || trace->tracer != tracer) return;
+  traced_ = true;
+  const int64_t activity_id = profiler::TraceMe::ActivityStart(
+      [&]() {
+        return profiler::TraceMeEncode(
+            "ElementTrace", {{"trace_id", trace->id}, {"iterator", prefix}});
+      },
+      profiler::TraceMeLevel::kInfo);
+  trace->open_spans.push_back(ElementTracer::OpenSpan{
+      prefix, EnvTime::NowNanos(), /*children_nanos=*/0, activity_id});
+}
+
+void ElementTraceScope::Stop() {
+  ElementTracer::ThreadState& state = ElementTracer::GetThreadState();
+  --state.depth;
+  if (traced_) {
+    ElementTracer::Trace* trace = state.trace;
+    ElementTracer::OpenSpan span = std::move(trace->open_spans.back());
+    trace->open_spans.pop_back();
+    const int64_t duration_nanos = EnvTime::NowNanos() - span.start_nanos;
+    profiler::TraceMe::ActivityEnd(span.activity_id);
+    trace->self_nanos.emplace_back(std::move(span.prefix),
+                                   duration_nanos - span.children_nanos);
+    if (!trace->open_spans.empty()) {
+      trace->open_spans.back().children_nanos += duration_nanos;
+    }
+  }
+  if (root_) {
+    tracer_->FinishTrace(state.trace);
+    state.trace = nullptr;
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,181 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_ELEMENT_TRACING_H_
+#define TENSORFLOW_CORE_FRAMEWORK_ELEMENT_TRACING_H_
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// Traces the latency of sampled elements through the iterators of an input
+// pipeline.
+//
+// Every `sampling_period`-th `GetNext` call that a thread makes outside of
+// other traced calls starts a trace of the element it returns. The trace
+// records a span for each nested `GetNext` call the thread makes into the
+// inputs of the iterator. The self time of a span, i.e. its duration minus
+// that of the spans it contains, is the time spent in that iterator: computing
+// the element, or, for asynchronous iterators, waiting for it to be produced.
+// The calls that asynchronous iterators make on their background threads are
+// traced separately.
+//
+// Spans are exported as "ElementTrace" TraceMe events. The tracer also keeps
+// the recent self times of each iterator, and periodically logs a summary of
+// the critical path: the iterators that the consumer of the pipeline waited on
+// the longest, and the slowest iterator feeding them in the background.
+//
+// The `ElementTracer` class is thread-safe.
+class ElementTracer {
+ public:
+  // Latency percentiles of the self time of an iterator.
+  struct StageSummary {
+    std::string prefix;
+    int64_t num_samples = 0;
+    int64_t p50_nanos = 0;
+    int64_t p90_nanos = 0;
+    int64_t p99_nanos = 0;
+  };
+
+  struct Summary {
+    // Iterators traced on the thread of the consumer of the pipeline, sorted
+    // by decreasing p90 latency.
+    std::vector<StageSummary> consumer_stages;
+    // Iterators traced on background threads, sorted by decreasing p90
+    // latency.
+    std::vector<StageSummary> background_stages;
+
+    // Returns a description of the bottleneck, or the empty string if no
+    // element was traced.
+    std::string Bottleneck() const;
+
+    std::string DebugString() const;
+  };
+
+  // Traces one in `sampling_period` elements and logs a summary every
+  // `summary_period_nanos`, if positive.
+  ElementTracer(int64_t sampling_period, int64_t summary_period_nanos);
+
+  // Sets the prefix of the iterator whose callers consume the elements of the
+  // pipeline. Traces rooted at other iterators run on background threads.
+  void SetConsumerPrefix(const std::string& prefix);
+
+  // Returns the latency percentiles of the traced iterators.
+  Summary GetSummary() const;
+
+ private:
+  friend class ElementTraceScope;
+
+  // A `GetNext` call being traced. Prefixes are copied, as iterators such as
+  // Repeat or FlatMap destroy their inputs while the trace is open.
+  struct OpenSpan {
+    std::string prefix;
+    int64_t start_nanos;
+    // Total duration of the spans of the nested calls.
+    int64_t children_nanos;
+    int64_t activity_id;
+  };
+
+  // The spans of an element traced on a thread.
+  struct Trace {
+    ElementTracer* tracer = nullptr;
+    int64_t id = 0;
+    std::vector<OpenSpan> open_spans;
+    // Self time of the completed spans, in order of completion.
+    std::vector<std::pair<std::string, int64_t>> self_nanos;
+  };
+
+  // The state of the thread running a traced call.
+  struct ThreadState {
+    // Number of `GetNext` calls in progress with a tracer.
+    int64_t depth = 0;
+    Trace* trace = nullptr;
+  };
+
+  // Window of the most recent self times of an iterator.
+  struct Samples {
+    std::vector<int64_t> nanos;
+    int64_t num_recorded = 0;
+  };
+
+  static ThreadState& GetThreadState();
+
+  // Returns a new trace if the next element should be traced, or nullptr.
+  Trace* MaybeStartTrace();
+
+  // Records the self times of `trace` and logs the summary when it is due.
+  void FinishTrace(Trace* trace);
+
+  static std::vector<StageSummary> Summarize(
+      const absl::flat_hash_map<std::string, Samples>& stages);
+
+  const int64_t sampling_period_;
+  const int64_t summary_period_nanos_;
+  std::atomic<int64_t> num_calls_{0};
+  std::atomic<int64_t> next_trace_id_{0};
+
+  mutable mutex mu_;
+  std::string consumer_prefix_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, Samples> consumer_stages_
+      TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, Samples> background_stages_
+      TF_GUARDED_BY(mu_);
+  int64_t last_summary_nanos_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ElementTracer);
+};
+
+// Traces the `GetNext` call of the iterator with `prefix` in which it is
+// created, if `tracer` is not null and the element is sampled. When `tracer`
+// is null, the scope costs a comparison.
+class ElementTraceScope {
+ public:
+  ElementTraceScope(ElementTracer* tracer, const std::string& prefix) {
+    if (TF_PREDICT_FALSE(tracer != nullptr)) {
+      Start(tracer, prefix);
+    }
+  }
+
+  ~ElementTraceScope() {
+    if (TF_PREDICT_FALSE(tracer_ != nullptr)) {
+      Stop();
+    }
+  }
+
+ private:
+  void Start(ElementTracer* tracer, const std::string& prefix);
+  void Stop();
+
+  ElementTracer* tracer_ = nullptr;
+  // Whether the call is a span of a trace, and whether it started the trace.
+  bool traced_ = false;
+  bool root_ = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ElementTraceScope);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_ELEMENT_TRACING_H_
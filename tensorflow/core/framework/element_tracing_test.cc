@@ -0,0 +1,235 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/element_tracing.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+constexpr char kPrefetch[] = "Iterator::Root::Prefetch";
+constexpr char kMap[] = "Iterator::Root::Prefetch::Map";
+constexpr char kRange[] = "Iterator::Root::Prefetch::Map::Range";
+
+constexpr int64_t kMillisToNanos = EnvTime::kMillisToNanos;
+
+void SleepForMillis(int64_t millis) {
+  Env::Default()->SleepForMicroseconds(millis * 1000);
+}
+
+TEST(ElementTracer, DisabledScope) {
+  ElementTraceScope scope(/*tracer=*/nullptr, kPrefetch);
+}
+
+TEST(ElementTracer, RecordsSelfTime) {
+  ElementTracer tracer(/*sampling_period=*/1, /*summary_period_nanos=*/0);
+  tracer.SetConsumerPrefix(kPrefetch);
+  for (int i = 0; i < 5; ++i) {
+    ElementTraceScope prefetch(&tracer, kPrefetch);
+    SleepForMillis(1);
+    {
+      ElementTraceScope map(&tracer, kMap);
+      SleepForMillis(10);
+    }
+  }
+  ElementTracer::Summary summary = tracer.GetSummary();
+  ASSERT_THAT(summary.consumer_stages, SizeIs(2));
+  EXPECT_THAT(summary.background_stages, IsEmpty());
+  const ElementTracer::StageSummary& map = summary.consumer_stages[0];
+  const ElementTracer::StageSummary& prefetch = summary.consumer_stages[1];
+  EXPECT_EQ(map.prefix, kMap);
+  EXPECT_EQ(map.num_samples, 5);
+  EXPECT_GE(map.p50_nanos, 10 * kMillisToNanos);
+  EXPECT_LE(map.p50_nanos, map.p90_nanos);
+  EXPECT_LE(map.p90_nanos, map.p99_nanos);
+  EXPECT_EQ(prefetch.prefix, kPrefetch);
+  EXPECT_EQ(prefetch.num_samples, 5);
+  EXPECT_GE(prefetch.p50_nanos, kMillisToNanos);
+  EXPECT_THAT(summary.Bottleneck(), HasSubstr(kMap));
+}
+
+TEST(ElementTracer, SamplesElements) {
+  ElementTracer tracer(/*sampling_period=*/10, /*summary_period_nanos=*/0);
+  tracer.SetConsumerPrefix(kPrefetch);
+  for (int i = 0; i < 100; ++i) {
+    ElementTraceScope prefetch(&tracer, kPrefetch);
+    ElementTraceScope map(&tracer, kMap);
+  }
+  ElementTracer::Summary summary = tracer.GetSummary();
+  ASSERT_THAT(summary.consumer_stages, SizeIs(2));
+  EXPECT_EQ(summary.consumer_stages[0].num_samples, 10);
+  EXPECT_EQ(summary.consumer_stages[1].num_samples, 10);
+}
+
+TEST(ElementTracer, AddsUpRepeatedCalls) {
+  ElementTracer tracer(/*sampling_period=*/1, /*summary_period_nanos=*/0);
+  tracer.SetConsumerPrefix(kMap);
+  {
+    ElementTraceScope map(&tracer, kMap);
+    for (int i = 0; i < 4; ++i) {
+      ElementTraceScope range(&tracer, kRange);
+      SleepForMillis(1);
+    }
+  }
+  ElementTracer::Summary summary = tracer.GetSummary();
+  ASSERT_THAT(summary.consumer_stages, SizeIs(2));
+  EXPECT_EQ(summary.consumer_stages[0].prefix, kRange);
+  EXPECT_EQ(summary.consumer_stages[0].num_samples, 1);
+  EXPECT_GE(summary.consumer_stages[0].p50_nanos, 4 * kMillisToNanos);
+}
+
+TEST(ElementTracer, NamesInputOfAsynchronousBottleneck) {
+  ElementTracer tracer(/*sampling_period=*/1, /*summary_period_nanos=*/0);
+  tracer.SetConsumerPrefix(kPrefetch);
+  // The consumer waits for the buffer of the prefetch iterator, which a
+  // background thread fills with elements of the map iterator.
+  std::unique_ptr<Thread> background(Env::Default()->StartThread(
+      ThreadOptions(), "background", [&tracer]() {
+        for (int i = 0; i < 5; ++i) {
+          ElementTraceScope map(&tracer, kMap);
+          SleepForMillis(1);
+          ElementTraceScope range(&tracer, kRange);
+        }
+      }));
+  for (int i = 0; i < 5; ++i) {
+    ElementTraceScope prefetch(&tracer, kPrefetch);
+    SleepForMillis(2);
+  }
+  background.reset();
+
+  ElementTracer::Summary summary = tracer.GetSummary();
+  ASSERT_THAT(summary.consumer_stages, SizeIs(1));
+  EXPECT_EQ(summary.consumer_stages[0].prefix, kPrefetch);
+  ASSERT_THAT(summary.background_stages, SizeIs(2));
+  EXPECT_EQ(summary.background_stages[0].prefix, kMap);
+  EXPECT_THAT(summary.Bottleneck(),
+              HasSubstr(absl::StrCat("waited the longest in ", kPrefetch)));
+  EXPECT_THAT(summary.Bottleneck(),
+              HasSubstr(absl::StrCat("input spends the longest in ", kMap)));
+  EXPECT_THAT(summary.DebugString(), HasSubstr(kRange));
+}
+
+TEST(ElementTracer, InputDestroyedDuringTrace) {
+  ElementTracer tracer(/*sampling_period=*/1, /*summary_period_nanos=*/0);
+  tracer.SetConsumerPrefix(kMap);
+  {
+    ElementTraceScope map(&tracer, kMap);
+    // Like Repeat, the iterator destroys its exhausted input and creates a
+    // new one within the same call.
+    for (int i = 0; i < 3; ++i) {
+      auto input_prefix = std::make_unique<std::string>(kRange);
+      { ElementTraceScope range(&tracer, *input_prefix); }
+      input_prefix.reset();
+    }
+  }
+  ElementTracer::Summary summary = tracer.GetSummary();
+  ASSERT_THAT(summary.consumer_stages, SizeIs(2));
+  EXPECT_THAT(
+      std::vector<std::string>({summary.consumer_stages[0].prefix,
+                                summary.consumer_stages[1].prefix}),
+      ::testing::UnorderedElementsAre(kMap, kRange));
+}
+
+TEST(ElementTracer, IgnoresCallsOfOtherTracers) {
+  ElementTracer tracer(/*sampling_period=*/1, /*summary_period_nanos=*/0);
+  ElementTracer other_tracer(/*sampling_period=*/1,
+                             /*summary_period_nanos=*/0);
+  tracer.SetConsumerPrefix(kPrefetch);
+  {
+    ElementTraceScope prefetch(&tracer, kPrefetch);
+    ElementTraceScope other(&other_tracer, kMap);
+  }
+  ASSERT_THAT(tracer.GetSummary().consumer_stages, SizeIs(1));
+  EXPECT_THAT(other_tracer.GetSummary().consumer_stages, IsEmpty());
+  EXPECT_THAT(other_tracer.GetSummary().background_stages, IsEmpty());
+}
+
+TEST(ElementTracer, EmptySummary) {
+  ElementTracer tracer(/*sampling_period=*/1, /*summary_period_nanos=*/0);
+  EXPECT_EQ(tracer.GetSummary().Bottleneck(), "");
+}
+
+// Calls to `depth` nested iterators, as `GetNext` makes them, without element
+// tracing (mode 0), with a null tracer as when tracing is disabled (mode 1),
+// tracing one in 100 elements (mode 2) and tracing all elements (mode 3).
+// Compare modes 0 and 1 for the cost of disabled tracing.
+template <bool kScoped>
+void NestedGetNext(ElementTracer* tracer,
+                   const std::vector<std::string>& prefixes, int depth,
+                   int64_t* num_calls) {
+  if (depth == static_cast<int>(prefixes.size())) return;
+  if (kScoped) {
+    ElementTraceScope scope(tracer, prefixes[depth]);
+    ++*num_calls;
+    testing::DoNotOptimize(*num_calls);
+    NestedGetNext<kScoped>(tracer, prefixes, depth + 1, num_calls);
+  } else {
+    ++*num_calls;
+    testing::DoNotOptimize(*num_calls);
+    NestedGetNext<kScoped>(tracer, prefixes, depth + 1, num_calls);
+  }
+}
+
+void BM_GetNext(::testing::benchmark::State& state) {
+  const int depth = state.range(0);
+  const int mode = state.range(1);
+  std::vector<std::string> prefixes;
+  std::string prefix = "Iterator::Root";
+  for (int i = 0; i < depth; ++i) {
+    prefix = absl::StrCat(prefix, "::Stage", i);
+    prefixes.push_back(prefix);
+  }
+  std::unique_ptr<ElementTracer> tracer;
+  if (mode >= 2) {
+    tracer = std::make_unique<ElementTracer>(
+        /*sampling_period=*/mode == 2 ? 100 : 1, /*summary_period_nanos=*/0);
+    tracer->SetConsumerPrefix(prefixes.front());
+  }
+  int64_t num_calls = 0;
+  for (auto s : state) {
+    if (mode == 0) {
+      NestedGetNext<false>(tracer.get(), prefixes, 0, &num_calls);
+    } else {
+      NestedGetNext<true>(tracer.get(), prefixes, 0, &num_calls);
+    }
+  }
+  state.SetItemsProcessed(num_calls);
+}
+
+BENCHMARK(BM_GetNext)
+    ->ArgPair(4, 0)
+    ->ArgPair(4, 1)
+    ->ArgPair(4, 2)
+    ->ArgPair(4, 3)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(16, 2)
+    ->ArgPair(16, 3);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
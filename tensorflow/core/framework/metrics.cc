@@ -237,6 +237,20 @@ auto* parse_ragged_feature_counter = tsl::monitoring::Counter<0>::New(
     "/tensorflow/data/ragged_feature",
     "The number of ragged features parsed by ops for parsing tf.Example.");
 
+auto* tiered_lookup_table_keys_counter = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/tiered_lookup_table/keys",
+    "The number of keys looked up in tiered lookup tables, by whether they "
+    "were found in memory (hit), on disk (miss) or not at all (absent).",
+    "result");
+
+auto* tiered_lookup_table_find_usecs_histogram =
+    tsl::monitoring::Sampler<0>::New(
+        {"/tensorflow/core/tiered_lookup_table/find_duration",
+         "Microseconds spent looking up a batch of keys in a tiered lookup "
+         "table."},
+        // Power of 2 with bucket count 24, up to ~16 seconds.
+        {tsl::monitoring::Buckets::Exponential(1, 2, 24)});
+
 auto* build_graph_calls = tsl::monitoring::Counter<0>::New(
     "/tensorflow/core/graph_build_calls",
     "The number of times TensorFlow has created a new client graph. "
@@ -503,6 +517,20 @@ void RecordParseRaggedFeature(int64_t num_features) {
   parse_ragged_feature_counter_cell->IncrementBy(num_features);
 }
 
+void RecordTieredLookupTableFind(int64_t num_hits, int64_t num_misses,
+                                 int64_t num_absent, uint64 duration_us) {
+  static auto* hit_cell = tiered_lookup_table_keys_counter->GetCell("hit");
+  static auto* miss_cell = tiered_lookup_table_keys_counter->GetCell("miss");
+  static auto* absent_cell =
+      tiered_lookup_table_keys_counter->GetCell("absent");
+  static auto* find_duration_cell =
+      tiered_lookup_table_find_usecs_histogram->GetCell();
+  hit_cell->IncrementBy(num_hits);
+  miss_cell->IncrementBy(num_misses);
+  absent_cell->IncrementBy(num_absent);
+  find_duration_cell->Add(duration_us);
+}
+
 void RecordGraphInputTensors(const size_t size) {
   static auto* graph_run_input_tensor_bytes_cell =
       graph_run_input_tensor_bytes->GetCell();
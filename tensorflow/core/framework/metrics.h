@@ -182,6 +182,12 @@ void RecordParseSparseFeature(int64_t num_features);
 // Records parsing of ragged tensor features.
 void RecordParseRaggedFeature(int64_t num_features);
 
+// Records a lookup of a batch of keys in a tiered (memory and disk) lookup
+// table: the number of keys found in memory, found on disk and not found, and
+// the duration of the lookup.
+void RecordTieredLookupTableFind(int64_t num_hits, int64_t num_misses,
+                                 int64_t num_absent, uint64 duration_us);
+
 // Records the size of input/output tensors in bytes.
 void RecordGraphInputTensors(const size_t size);
 void RecordGraphOutputTensors(const size_t size);
@@ -25,10 +25,17 @@ limitations under the License.
 #include "tensorflow/core/framework/model.pb.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numbers.h"
 #include "tensorflow/core/platform/statusor.h"
 
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif  // __linux__
+
 namespace tensorflow {
 namespace data {
 namespace model {
@@ -55,6 +62,14 @@ constexpr double kTargetTimeSigmas = 1.0;
 // downsizing a buffer.
 constexpr double kBufferUpsizeMultiplier = 2.0;
 constexpr double kBufferDownsizeMultipliter = 0.9;
+// In contention-aware optimization, running more threads than there are
+// available cores increases the output time by this fraction for every
+// available core's worth of extra threads.
+constexpr double kOversubscriptionCost = 0.1;
+// In contention-aware optimization, a drop in observed throughput larger than
+// this fraction after an increase in parallelism is considered a loss rather
+// than noise.
+constexpr double kThroughputLossTolerance = 0.05;
 
 constexpr char kFlatMap[] = "FlatMap";
 constexpr char kInterleave[] = "Interleave";
@@ -229,6 +244,74 @@ bool AreAllParametersMax(const Model::ModelParameters& parameters) {
   return true;
 }
 
+// Samples the CPU time used by this process and by all processes on the host.
+// Only supported on Linux; elsewhere the usage is reported as unknown.
+class CpuUsageSampler {
+ public:
+  // Returns the number of cores used by this process and by the host since the
+  // previous call, or zeros if unknown.
+  std::pair<double, double> Sample() {
+#if defined(__linux__)
+    const int64_t wall_us = EnvTime::NowMicros();
+    struct rusage usage;
+    int64_t process_us = 0;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+      process_us = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+                       EnvTime::kSecondsToMicros +
+                   usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    }
+    // The first line of /proc/stat holds the time all CPUs spent in user,
+    // nice, system, idle, iowait, irq, softirq and steal modes.
+    int64_t host_busy = 0;
+    int64_t host_total = 0;
+    string stat;
+    if (ReadFileToString(Env::Default(), "/proc/stat", &stat).ok()) {
+      std::vector<string> fields = str_util::Split(
+          stat.substr(0, stat.find('\n')), ' ', str_util::SkipEmpty());
+      for (int i = 1; i < fields.size() && i <= 8; ++i) {
+        int64_t ticks = 0;
+        if (!strings::safe_strto64(fields[i], &ticks)) break;
+        host_total += ticks;
+        if (i != 4 && i != 5) host_busy += ticks;
+      }
+    }
+    std::pair<double, double> result = {0.0, 0.0};
+    if (last_wall_us_ > 0 && wall_us > last_wall_us_) {
+      result.first = static_cast<double>(process_us - last_process_us_) /
+                     (wall_us - last_wall_us_);
+      if (host_total > last_host_total_) {
+        result.second = static_cast<double>(host_busy - last_host_busy_) /
+                        (host_total - last_host_total_) * port::NumTotalCPUs();
+      }
+    }
+    last_wall_us_ = wall_us;
+    last_process_us_ = process_us;
+    last_host_busy_ = host_busy;
+    last_host_total_ = host_total;
+    return result;
+#else   // __linux__
+    return {0.0, 0.0};
+#endif  // __linux__
+  }
+
+ private:
+  int64_t last_wall_us_ = 0;
+  int64_t last_process_us_ = 0;
+  int64_t last_host_busy_ = 0;
+  int64_t last_host_total_ = 0;
+};
+
+// Returns the sum of the values of the parallelism parameters.
+double TotalParallelism(const Model::ModelParameters& parameters) {
+  double total = 0.0;
+  for (const auto& pair : parameters) {
+    if (pair.second->name == kParallelism) {
+      total += pair.second->value;
+    }
+  }
+  return total;
+}
+
 // Records the ram usage of hill climbing algorithm.
 void RecordAutotuneRamUsage(int64 ram_budget, double max_buffered_bytes) {
   if (ram_budget == 0) {
@@ -2276,6 +2359,12 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64_t cpu_budget,
   optimization_params.set_cpu_budget(cpu_budget);
   optimization_params.set_ram_budget(ram_budget);
   optimization_params.set_model_input_time(model_input_time);
+  {
+    tf_shared_lock l(mu_);
+    optimization_params.set_process_cpu_usage(process_cpu_usage_);
+    optimization_params.set_host_cpu_usage(host_cpu_usage_);
+    optimization_params.set_output_throughput(output_throughput_);
+  }
   switch (algorithm) {
     case AutotuneAlgorithm::DEFAULT:
     case AutotuneAlgorithm::MAX_PARALLELISM:
@@ -2292,6 +2381,10 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64_t cpu_budget,
     case AutotuneAlgorithm::STAGE_BASED:
       OptimizeStageBased(snapshot, optimization_params, cancellation_manager);
       break;
+    case AutotuneAlgorithm::CONTENTION_AWARE:
+      OptimizeContentionAware(snapshot, optimization_params,
+                              cancellation_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -2390,6 +2483,9 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64_t cpu_budget,
 
   int64_t last_optimization_ms = 0;
   int64_t current_time_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
+  CpuUsageSampler cpu_usage_sampler;
+  int64_t last_sample_us = 0;
+  int64_t last_output_elements = 0;
   while (true) {
     {
       mutex_lock l(mu_);
@@ -2415,6 +2511,22 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64_t cpu_budget,
     if (algorithm == AutotuneAlgorithm::STAGE_BASED) {
       model_input_time = ComputeTargetTimeNsec();
     }
+    if (algorithm == AutotuneAlgorithm::CONTENTION_AWARE) {
+      const int64_t now_us = EnvTime::NowMicros();
+      const int64_t output_elements = output()->num_elements();
+      std::pair<double, double> cpu_usage = cpu_usage_sampler.Sample();
+      double output_throughput = 0.0;
+      if (last_sample_us > 0 && now_us > last_sample_us) {
+        output_throughput = static_cast<double>(output_elements -
+                                                last_output_elements) *
+                            EnvTime::kSecondsToMicros /
+                            (now_us - last_sample_us);
+      }
+      RecordResourceUsage(cpu_usage.first, cpu_usage.second,
+                          output_throughput);
+      last_sample_us = now_us;
+      last_output_elements = output_elements;
+    }
     Optimize(algorithm, cpu_budget, ram_budget, model_input_time,
              cancellation_manager);
     int64_t end_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
@@ -2913,6 +3025,131 @@ void Model::OptimizeMaxParallelism(
                           should_stop);
 }
 
+void Model::RecordResourceUsage(double process_cpu_usage,
+                                double host_cpu_usage,
+                                double output_throughput) {
+  mutex_lock l(mu_);
+  process_cpu_usage_ = process_cpu_usage;
+  host_cpu_usage_ = host_cpu_usage;
+  output_throughput_ = output_throughput;
+}
+
+void Model::OptimizeContentionAware(
+    std::shared_ptr<Node> snapshot,
+    const OptimizationParams& optimization_params,
+    CancellationManager* cancellation_manager) {
+  // Cores used by other processes on the host are not available to the
+  // pipeline, whatever the CPU budget says.
+  const double external_cpu_usage =
+      std::max(0.0, optimization_params.host_cpu_usage() -
+                        optimization_params.process_cpu_usage());
+  const double available_cores = std::max(
+      1.0, optimization_params.cpu_budget() - external_cpu_usage);
+  VLOG(2) << "Starting optimization of tunable parameters with "
+             "Contention-Aware optimization with "
+          << available_cores << " available cores.";
+
+  // If the last increase in parallelism lowered the observed throughput, the
+  // pipeline is contended: do not go beyond the parallelism used before.
+  const double throughput = optimization_params.output_throughput();
+  ContentionState& state = contention_state_;
+  if (state.parallelism_cap > 0 &&
+      available_cores >= state.cap_available_cores + 1.0) {
+    // Other processes released cores since the cap was set.
+    state.parallelism_cap = 0.0;
+  }
+  if (throughput > 0.0 && state.previous_throughput > 0.0 &&
+      state.applied_parallelism > state.previous_parallelism &&
+      throughput <
+          state.previous_throughput * (1.0 - kThroughputLossTolerance)) {
+    VLOG(2) << "Increasing parallelism from " << state.previous_parallelism
+            << " to " << state.applied_parallelism
+            << " decreased throughput from " << state.previous_throughput
+            << " to " << throughput << " elements/s. Backing off.";
+    metrics::RecordTFDataAutotuneStoppingCriteria("negative_marginal_gain");
+    state.parallelism_cap = state.previous_parallelism;
+    state.cap_available_cores = available_cores;
+  }
+
+  const double processing_time = TotalProcessingTime(snapshot);
+  auto parameters = CollectTunableParameters(snapshot);
+  if (parameters.empty()) {
+    VLOG(2) << "There are no tunable parameters.";
+    return;
+  }
+
+  // Output time of the pipeline given the CPU it can use. Threads beyond the
+  // available cores share them, which slows down every thread and adds
+  // switching overhead, and no number of threads produces elements faster
+  // than the available cores process them.
+  auto contended_output_time = [&]() {
+    const double threads = TotalParallelism(parameters);
+    const double output_time =
+        OutputTime(snapshot, optimization_params.model_input_time(),
+                   /*gradients=*/nullptr) *
+        std::max(1.0, threads / available_cores);
+    const double oversubscription =
+        std::max(0.0, threads - available_cores) / available_cores;
+    return std::max(output_time, processing_time / available_cores) *
+           (1.0 + kOversubscriptionCost * oversubscription);
+  };
+
+  // Buffer size parameter will only be incremented if the output latency
+  // improvement is greater than this constant.
+  constexpr double kBufferSizeMinDelta = 1.0L;
+  const bool skip_buffer_sizes =
+      experiments_.contains("autotune_buffer_optimization");
+  for (auto& pair : parameters) {
+    if (skip_buffer_sizes && pair.second->name == kBufferSize) {
+      continue;
+    }
+    pair.second->value = pair.second->min;
+  }
+  while (!cancellation_manager->IsCancelled()) {
+    if (AreAllParametersMax(parameters)) {
+      metrics::RecordTFDataAutotuneStoppingCriteria("all_max");
+      break;
+    }
+    if (TotalMaximumBufferedBytes(snapshot) >
+        optimization_params.ram_budget()) {
+      metrics::RecordTFDataAutotuneStoppingCriteria("max_buffered_bytes");
+      break;
+    }
+    const bool parallelism_capped =
+        state.parallelism_cap > 0.0 &&
+        TotalParallelism(parameters) >= state.parallelism_cap;
+    const double output_time = contended_output_time();
+    double best_delta = 0.0;
+    Parameter* best_parameter = nullptr;
+    for (auto& pair : parameters) {
+      if (pair.second->value >= pair.second->max ||
+          (skip_buffer_sizes && pair.second->name == kBufferSize) ||
+          (parallelism_capped && pair.second->name == kParallelism)) {
+        continue;
+      }
+      pair.second->value++;
+      const double delta = output_time - contended_output_time();
+      if (delta > best_delta &&
+          (delta > kBufferSizeMinDelta || pair.second->name != kBufferSize)) {
+        best_delta = delta;
+        best_parameter = pair.second.get();
+      }
+      pair.second->value--;
+    }
+    if (!best_parameter) {
+      // No parameter increase improves the output time given the available
+      // cores.
+      metrics::RecordTFDataAutotuneStoppingCriteria("no_marginal_gain");
+      break;
+    }
+    best_parameter->value++;
+  }
+  state.previous_parallelism = state.applied_parallelism;
+  state.previous_throughput = throughput;
+  state.applied_parallelism = TotalParallelism(parameters);
+  UpdateStateValues(&parameters);
+}
+
 double Model::OutputTime(std::shared_ptr<Node> node, double model_input_time,
                          Model::ParameterGradients* gradients) {
   // To store the input time for each node.
@@ -860,6 +860,13 @@ class Model {
   // Records gap time between consecutive `GetNext()` calls.
   void RecordIteratorGapTime(uint64_t duration_usec);
 
+  // Records the number of cores used by this process and by all processes on
+  // the host, and the number of elements per second produced by the output
+  // node, since the previous optimization. Used by the `CONTENTION_AWARE`
+  // autotune algorithm. `OptimizeLoop` records them before each optimization.
+  void RecordResourceUsage(double process_cpu_usage, double host_cpu_usage,
+                           double output_throughput) TF_LOCKS_EXCLUDED(mu_);
+
   // Computes the target time in nsecs to use for `STAGE_BASED` autotune
   // algorithm.
   double ComputeTargetTimeNsec();
@@ -943,6 +950,17 @@ class Model {
                           const OptimizationParams& optimization_params,
                           CancellationManager* cancellation_manager);
 
+  // This optimization behaves similarly to the hill climb optimization, but
+  // only counts on the cores that other processes on the host leave to the
+  // CPU budget. Threads beyond those cores share them and add overhead, so
+  // parallelism stops increasing once the marginal gain of an increase is not
+  // positive. If the last increase in parallelism lowered the observed
+  // throughput by more than 5%, parallelism is capped at its previous total
+  // until at least one more core becomes available.
+  void OptimizeContentionAware(std::shared_ptr<Node> snapshot,
+                               const OptimizationParams& optimization_params,
+                               CancellationManager* cancellation_manager);
+
   // This is the first part of the stage-based optimization that optimizes
   // tunable parallelism parameters for async interleave many nodes only. We
   // separately optimize async interleave many nodes more aggressively because
@@ -1025,6 +1043,25 @@ class Model {
   std::shared_ptr<Node> snapshot_ TF_GUARDED_BY(mu_);
   // Stores the optimization parameters used by autotune.
   OptimizationParams optimization_params_ TF_GUARDED_BY(mu_);
+  // Resource usage recorded by `RecordResourceUsage()`.
+  double process_cpu_usage_ TF_GUARDED_BY(mu_) = 0.0;
+  double host_cpu_usage_ TF_GUARDED_BY(mu_) = 0.0;
+  double output_throughput_ TF_GUARDED_BY(mu_) = 0.0;
+
+  // State kept across `CONTENTION_AWARE` optimizations. Only accessed by
+  // `Optimize()`, which is not invoked concurrently.
+  struct ContentionState {
+    // Total parallelism set by the last optimization and by the one before.
+    double applied_parallelism = 0.0;
+    double previous_parallelism = 0.0;
+    // Throughput observed while `previous_parallelism` was in effect.
+    double previous_throughput = 0.0;
+    // If positive, the total parallelism is not increased beyond this value.
+    double parallelism_cap = 0.0;
+    // Available cores when the cap was set.
+    double cap_available_cores = 0.0;
+  };
+  ContentionState contention_state_;
 };
 
 // Class to compute timing information for a model.
@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace data {
@@ -1343,7 +1344,7 @@ TEST_P(OptimizeZeroRamBudgetTest, Model) {
 }
 
 INSTANTIATE_TEST_SUITE_P(Test, OptimizeZeroRamBudgetTest,
-                         ::testing::Values(0, 1, 2, 3));
+                         ::testing::Values(0, 1, 2, 3, 5));
 
 TEST(RecordTimeTest, RecordTimeTest) {
   std::shared_ptr<Node> source = model::MakeSourceNode({});
@@ -3032,6 +3033,105 @@ TEST_F(ModelTimingTest, OptimizeStageBased_PipelineRatioLessThanOne) {
   EXPECT_EQ(14, GetNode(/*node_id=*/1)->parameter_value("parallelism"));
 }
 
+// A parallel map stage reading from a sequential source, whose parallelism is
+// tuned in the contention-aware tests.
+constexpr char kContentionAwareModel[] = R"pb(
+  nodes: {
+    key: 1
+    value: {
+      id: 1
+      name: "ParallelMapV2"
+      autotune: true
+      num_elements: 100
+      buffered_elements: 3
+      processing_time: 500000
+      bytes_produced: 10000
+      node_class: ASYNC_KNOWN_RATIO
+      ratio: 1
+      inputs: 2
+      parameters: {
+        name: "parallelism"
+        value: 1
+        min: 1
+        max: 32
+        tunable: true
+      }
+    }
+  }
+  nodes: {
+    key: 2
+    value: {
+      id: 2
+      name: "SSTable"
+      autotune: true
+      num_elements: 100
+      processing_time: 10000
+      node_class: KNOWN_RATIO
+    }
+  }
+  output: 1
+)pb";
+
+TEST_F(ModelTimingTest, OptimizeContentionAware_UsesAvailableCores) {
+  BuildModelFromProto(kContentionAwareModel);
+  CancellationManager cancellation_manager;
+  model_->Optimize(AutotuneAlgorithm::CONTENTION_AWARE, /*cpu_budget=*/16,
+                   /*ram_budget=*/1 << 30, /*model_input_time=*/0,
+                   &cancellation_manager);
+  // More threads than cores would not make the map any faster.
+  EXPECT_EQ(16, GetNode(/*node_id=*/1)->parameter_value("parallelism"));
+
+  // Other processes use 12 of the 16 cores.
+  model_->RecordResourceUsage(/*process_cpu_usage=*/2,
+                              /*host_cpu_usage=*/14,
+                              /*output_throughput=*/0);
+  model_->Optimize(AutotuneAlgorithm::CONTENTION_AWARE, /*cpu_budget=*/16,
+                   /*ram_budget=*/1 << 30, /*model_input_time=*/0,
+                   &cancellation_manager);
+  EXPECT_EQ(4, GetNode(/*node_id=*/1)->parameter_value("parallelism"));
+}
+
+TEST_F(ModelTimingTest, OptimizeContentionAware_BacksOffOnThroughputLoss) {
+  BuildModelFromProto(kContentionAwareModel);
+  CancellationManager cancellation_manager;
+  auto optimize = [&](double process_cpu_usage, double host_cpu_usage,
+                      double output_throughput) {
+    model_->RecordResourceUsage(process_cpu_usage, host_cpu_usage,
+                                output_throughput);
+    model_->Optimize(AutotuneAlgorithm::CONTENTION_AWARE, /*cpu_budget=*/16,
+                     /*ram_budget=*/1 << 30, /*model_input_time=*/0,
+                     &cancellation_manager);
+    return GetNode(/*node_id=*/1)->parameter_value("parallelism");
+  };
+  EXPECT_EQ(4, optimize(2, 14, 0));
+  // The other processes are gone, so parallelism goes up...
+  EXPECT_EQ(16, optimize(2, 2, 1000));
+  // ...but the pipeline got slower with it, so it goes back down.
+  EXPECT_EQ(4, optimize(16, 16, 500));
+  // And stays there.
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(4, optimize(4, 4, 1000));
+  }
+}
+
+TEST_F(ModelTimingTest, OptimizeContentionAware_KeepsIncreaseWithoutLoss) {
+  BuildModelFromProto(kContentionAwareModel);
+  CancellationManager cancellation_manager;
+  auto optimize = [&](double process_cpu_usage, double host_cpu_usage,
+                      double output_throughput) {
+    model_->RecordResourceUsage(process_cpu_usage, host_cpu_usage,
+                                output_throughput);
+    model_->Optimize(AutotuneAlgorithm::CONTENTION_AWARE, /*cpu_budget=*/16,
+                     /*ram_budget=*/1 << 30, /*model_input_time=*/0,
+                     &cancellation_manager);
+    return GetNode(/*node_id=*/1)->parameter_value("parallelism");
+  };
+  EXPECT_EQ(4, optimize(2, 14, 0));
+  EXPECT_EQ(16, optimize(2, 2, 1000));
+  // Throughput went up with the parallelism, so it is kept.
+  EXPECT_EQ(16, optimize(8, 8, 1900));
+}
+
 TEST_F(ModelTimingTest, ComputeTargetTime) {
   model_ = std::make_unique<Model>();
 
@@ -3144,6 +3244,59 @@ TEST_F(ModelTimingTest, SelfTime) {
   EXPECT_DOUBLE_EQ(910, node_2->ComputeSelfTime());
 }
 
+// Simulates an input pipeline on a host with 16 cores, 8 of which are used by
+// other processes, and reports the parallelism the autotuning algorithm settles
+// on, how often it changed it in the second half of the rounds, and the
+// simulated throughput. The simulated pipeline slows down by 20% for every
+// available core's worth of threads beyond the available cores.
+static void BM_AutotuneConvergence(::testing::benchmark::State& state) {
+  const auto algorithm = static_cast<AutotuneAlgorithm>(state.range(0));
+  constexpr int kRounds = 40;
+  constexpr double kHostCores = 16;
+  constexpr double kExternalCores = 8;
+  constexpr double kAvailableCores = kHostCores - kExternalCores;
+  constexpr double kElementCpuSec = 5e-3;
+  double parallelism = 0;
+  double throughput = 0;
+  int changes = 0;
+  for (auto s : state) {
+    ModelProto model_proto;
+    protobuf::TextFormat::ParseFromString(kContentionAwareModel, &model_proto);
+    std::unique_ptr<Model> model;
+    TF_CHECK_OK(Model::FromProto(model_proto, &model));
+    CancellationManager cancellation_manager;
+    changes = 0;
+    for (int round = 0; round < kRounds; ++round) {
+      const double threads = std::max(
+          1.0, model->output()->parameter_value("parallelism"));
+      const double oversubscription =
+          std::max(0.0, threads - kAvailableCores) / kAvailableCores;
+      const double process_cores = std::min(threads, kAvailableCores);
+      throughput = process_cores / kElementCpuSec /
+                   (1.0 + 0.2 * oversubscription);
+      model->RecordResourceUsage(process_cores, process_cores + kExternalCores,
+                                 round == 0 ? 0.0 : throughput);
+      model->Optimize(algorithm, static_cast<int64_t>(kHostCores),
+                      /*ram_budget=*/1 << 30, /*model_input_time=*/0,
+                      &cancellation_manager);
+      const double new_parallelism =
+          model->output()->parameter_value("parallelism");
+      if (round >= kRounds / 2 && new_parallelism != parallelism) {
+        ++changes;
+      }
+      parallelism = new_parallelism;
+    }
+  }
+  state.counters["parallelism"] = parallelism;
+  state.counters["late_changes"] = changes;
+  state.counters["elements_per_sec"] = throughput;
+}
+
+BENCHMARK(BM_AutotuneConvergence)
+    ->Arg(AutotuneAlgorithm::HILL_CLIMB)
+    ->Arg(AutotuneAlgorithm::MAX_PARALLELISM)
+    ->Arg(AutotuneAlgorithm::CONTENTION_AWARE);
+
 }  // namespace
 }  // namespace model
 }  // namespace data
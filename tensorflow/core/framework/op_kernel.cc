@@ -820,6 +820,13 @@ Status OpKernelContext::allocate_temp(
     DataType type, const TensorShape& shape, Tensor* out_temp,
     AllocatorAttributes allocator_attr,
     const AllocationAttributes& allocation_attr) {
+  // The temp allocator is bypassed when allocations are tracked, since
+  // tracking wraps the allocator returned by get_allocator(), and for
+  // ScopedAllocator requests, which keep the handling below.
+  const bool use_temp_allocator =
+      params_->temp_allocator != nullptr && allocator_attr.value == 0 &&
+      allocator_attr.scope_id == 0 && !track_allocations() &&
+      DataTypeCanUseMemcpy(type);
   if (allocator_attr.scope_id > 0) {
     // We do not allow ScopedAllocator calls from allocate_temp.
     // Here we clear the scope_id and return a temporary buffer.
@@ -838,8 +845,27 @@ Status OpKernelContext::allocate_temp(
   profiler::ScopedMemoryDebugAnnotation op_annotation(
       op_kernel().name_view().data(), step_id(), "temp", type,
       [&shape]() { return shape.DebugString(); });
-  Status s =
-      allocate_tensor(type, shape, out_temp, allocator_attr, allocation_attr);
+  Status s;
+  Tensor arena_tensor;
+  if (use_temp_allocator) {
+    // The temp allocator declines requests it cannot serve, which are then
+    // allocated from the device's allocator as usual.
+    arena_tensor = Tensor(
+        params_->temp_allocator, type, shape,
+        AllocationAttributes(
+            /*retry_on_failure=*/false,
+            /*allocation_will_be_logged=*/true, allocation_attr.freed_by_func));
+  }
+  if (arena_tensor.IsInitialized()) {
+    if (params_->log_memory) {
+      LogMemory::RecordTensorAllocation(params_->op_kernel->name(),
+                                        params_->step_id, arena_tensor);
+    }
+    *out_temp = std::move(arena_tensor);
+  } else {
+    s = allocate_tensor(type, shape, out_temp, allocator_attr,
+                        allocation_attr);
+  }
   if (track_allocations() && s.ok() && out_temp->TotalBytes() > 0) {
     Allocator* a = get_allocator(allocator_attr);
     if (a->TracksAllocationSizes()) {
@@ -617,6 +617,14 @@ class OpKernelContext {
     bool track_allocations = false;
     bool log_memory = false;
 
+    // If non-null, allocate_temp() first tries this allocator, e.g. a
+    // per-step arena, for memcpy-able requests that use default
+    // AllocatorAttributes and no ScopedAllocator. A null return falls back to
+    // the device's allocator. It must remain valid until every tensor it
+    // allocated has been freed, and callers should not set it for kernels that
+    // may retain their temporaries past the step.
+    Allocator* temp_allocator = nullptr;
+
     // Array indexed by output number for this node
     const AllocatorAttributes* output_attr_array = nullptr;
 
@@ -0,0 +1,376 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kMapDataset[] = "MapDataset";
+constexpr char kParallelMapDataset[] = "ParallelMapDataset";
+constexpr char kParallelMapDatasetV2[] = "ParallelMapDatasetV2";
+constexpr char kBatchDataset[] = "BatchDataset";
+constexpr char kBatchDatasetV2[] = "BatchDatasetV2";
+constexpr char kOutputShapes[] = "output_shapes";
+constexpr char kOutputTypes[] = "output_types";
+
+// Ops that compute each output element from the elements at the same position
+// of their (broadcast) inputs. Applied to a batch, they compute the batch of
+// their per-element results, as long as all inputs that depend on the element
+// have the same rank and all other inputs are scalars.
+const auto* kElementwiseOps = new absl::flat_hash_set<string>{
+    "Abs", "Add", "AddV2", "Cast", "Ceil", "ClipByValue", "Div", "DivNoNan",
+    "Equal", "Exp", "Floor", "FloorDiv", "FloorMod", "Greater", "GreaterEqual",
+    "Identity", "IsNan", "Less", "LessEqual", "Log", "Log1p", "LogicalAnd",
+    "LogicalNot", "LogicalOr", "Maximum", "Minimum", "Mul", "Neg", "NotEqual",
+    "Pow", "RealDiv", "Reciprocal", "Relu", "Round", "Rsqrt", "SelectV2",
+    "Sigmoid", "Sign", "Sqrt", "Square", "SquaredDifference", "StringToNumber",
+    "Sub", "Tanh",
+};
+
+// Kinds of values of a map function, besides the rank of values that depend
+// on the input element.
+constexpr int kInvariantScalar = -1;
+constexpr int kInvariant = -2;
+
+bool IsMap(const NodeDef& node) {
+  return node.op() == kMapDataset || node.op() == kParallelMapDataset ||
+         node.op() == kParallelMapDatasetV2;
+}
+
+bool IsBatch(const NodeDef& node) {
+  return node.op() == kBatchDataset || node.op() == kBatchDatasetV2;
+}
+
+// Determines whether a map function can be applied to a batch of elements as
+// is, by inferring for each of its values whether it depends on the input
+// element and, if so, its rank for a single element.
+class VectorizabilityChecker {
+ public:
+  VectorizabilityChecker(const FunctionDef& function,
+                         const std::vector<int>& arg_ranks)
+      : function_(function) {
+    for (int i = 0; i < arg_ranks.size(); ++i) {
+      args_[function.signature().input_arg(i).name()] = arg_ranks[i];
+    }
+  }
+
+  bool Check() {
+    // Function nodes are not necessarily in topological order.
+    std::vector<const NodeDef*> pending;
+    for (const NodeDef& node : function_.node_def()) {
+      nodes_[node.name()] = &node;
+      pending.push_back(&node);
+    }
+    while (!pending.empty()) {
+      std::vector<const NodeDef*> blocked;
+      for (const NodeDef* node : pending) {
+        std::vector<int> inputs;
+        if (!InputKinds(*node, &inputs)) {
+          blocked.push_back(node);
+          continue;
+        }
+        std::vector<int> outputs;
+        if (!OutputKinds(*node, inputs, &outputs)) return false;
+        values_[node->name()] = std::move(outputs);
+      }
+      if (blocked.size() == pending.size()) return false;
+      pending = std::move(blocked);
+    }
+    // Every output needs the batch dimension.
+    for (const auto& ret : function_.ret()) {
+      int kind;
+      if (!Kind(ret.second, &kind) || kind < 0) return false;
+    }
+    return true;
+  }
+
+ private:
+  // Looks up the kind of the value `ref`, which is either a function argument
+  // or a node output of the form `node:output:index`.
+  bool Kind(const string& ref, int* kind) const {
+    std::vector<string> parts = absl::StrSplit(ref, ':');
+    if (parts.size() == 1) {
+      auto it = args_.find(ref);
+      if (it == args_.end()) return false;
+      *kind = it->second;
+      return true;
+    }
+    int index;
+    if (parts.size() != 3 || !absl::SimpleAtoi(parts[2], &index)) {
+      return false;
+    }
+    auto it = values_.find(parts[0]);
+    if (it == values_.end() || index < 0 || index >= it->second.size()) {
+      return false;
+    }
+    *kind = it->second[index];
+    return true;
+  }
+
+  bool InputKinds(const NodeDef& node, std::vector<int>* kinds) const {
+    for (const string& input : node.input()) {
+      if (IsControlInput(input)) continue;
+      int kind;
+      if (!Kind(input, &kind)) return false;
+      kinds->push_back(kind);
+    }
+    return true;
+  }
+
+  bool OutputKinds(const NodeDef& node, const std::vector<int>& inputs,
+                   std::vector<int>* outputs) const {
+    if (node.op() == "Const") {
+      const auto& shape = node.attr().at("value").tensor().tensor_shape();
+      outputs->push_back(shape.dim_size() == 0 && !shape.unknown_rank()
+                             ? kInvariantScalar
+                             : kInvariant);
+      return true;
+    }
+    if (kElementwiseOps->contains(node.op())) {
+      int rank = kInvariantScalar;
+      for (int kind : inputs) {
+        if (kind == kInvariant) return false;
+        if (kind == kInvariantScalar) continue;
+        // The batch dimension only lines up if all batched inputs have the
+        // same rank.
+        if (rank != kInvariantScalar && rank != kind) return false;
+        rank = kind;
+      }
+      outputs->push_back(rank);
+      return true;
+    }
+    if (node.op() == "DecodeCSV") {
+      // The output fields have the shape of `records`.
+      if (inputs.empty() || inputs[0] < 0) return false;
+      for (int i = 1; i < inputs.size(); ++i) {
+        if (inputs[i] >= 0) return false;
+      }
+      outputs->assign(node.attr().at("OUT_TYPE").list().type_size(),
+                      inputs[0]);
+      return true;
+    }
+    if (node.op() == "ParseExampleV2") {
+      return ParseExampleOutputKinds(node, inputs, outputs);
+    }
+    return false;
+  }
+
+  // Parsing a batch of serialized examples produces the batch of the dense
+  // features of each example. Sparse and ragged features would be merged
+  // across the batch instead, and dense features with unknown dimensions
+  // would be padded.
+  bool ParseExampleOutputKinds(const NodeDef& node,
+                               const std::vector<int>& inputs,
+                               std::vector<int>* outputs) const {
+    if (inputs.size() < 2 || inputs[0] != 0) return false;
+    for (int i = 1; i < inputs.size(); ++i) {
+      if (inputs[i] >= 0) return false;
+    }
+    if (node.attr().at("num_sparse").i() != 0 ||
+        node.attr().at("ragged_value_types").list().type_size() != 0) {
+      return false;
+    }
+    // `names` must be empty, as it has to match the shape of `serialized`.
+    std::vector<string> names_ref = absl::StrSplit(node.input(1), ':');
+    auto names = nodes_.find(names_ref[0]);
+    if (names == nodes_.end() || names->second->op() != "Const") return false;
+    const auto& names_shape =
+        names->second->attr().at("value").tensor().tensor_shape();
+    if (!TensorShape::IsValid(names_shape) ||
+        TensorShape(names_shape).num_elements() != 0) {
+      return false;
+    }
+    for (const auto& shape : node.attr().at("dense_shapes").list().shape()) {
+      if (!PartialTensorShape(shape).IsFullyDefined()) return false;
+      outputs->push_back(shape.dim_size());
+    }
+    return true;
+  }
+
+  const FunctionDef& function_;
+  absl::flat_hash_map<string, int> args_;
+  absl::flat_hash_map<string, const NodeDef*> nodes_;
+  absl::flat_hash_map<string, std::vector<int>> values_;
+};
+
+// Dataset sources without `output_types` and `output_shapes` attributes that
+// produce scalar strings.
+const auto* kRecordSourceOps = new absl::flat_hash_set<string>{
+    "FixedLengthRecordDataset", "FixedLengthRecordDatasetV2",
+    "TextLineDataset", "TFRecordDataset"};
+
+// Gets the types and shapes of the components of the dataset produced by
+// `node`. Returns false if they are not known or some rank is unknown.
+bool GetComponentSpecs(const NodeDef& node, AttrValue* types,
+                       AttrValue* shapes) {
+  if (kRecordSourceOps->contains(node.op())) {
+    types->mutable_list()->add_type(DT_STRING);
+    shapes->mutable_list()->add_shape();
+    return true;
+  }
+  if (!node.attr().contains(kOutputTypes) ||
+      !node.attr().contains(kOutputShapes)) {
+    return false;
+  }
+  *types = node.attr().at(kOutputTypes);
+  *shapes = node.attr().at(kOutputShapes);
+  for (const auto& shape : shapes->list().shape()) {
+    if (shape.unknown_rank()) return false;
+  }
+  return types->list().type_size() == shapes->list().shape_size();
+}
+
+// Returns the `Batch` node that batches the input of `map_node`, whose
+// components have the given types and shapes.
+NodeDef MakeBatchNode(const NodeDef& map_node, const NodeDef& batch_node,
+                      const AttrValue& types, const AttrValue& shapes,
+                      MutableGraphView* graph) {
+  NodeDef new_node = batch_node;
+  graph_utils::SetUniqueGraphNodeName(batch_node.op(), graph->graph(),
+                                      &new_node);
+  new_node.set_input(0, map_node.input(0));
+
+  TensorShapeProto::Dim batch_dim;
+  batch_dim.set_size(-1);
+  const auto& batch_shapes = batch_node.attr().at(kOutputShapes).list();
+  if (batch_shapes.shape_size() > 0 && batch_shapes.shape(0).dim_size() > 0) {
+    batch_dim = batch_shapes.shape(0).dim(0);
+  }
+  auto* batched_shapes =
+      (*new_node.mutable_attr())[kOutputShapes].mutable_list();
+  batched_shapes->Clear();
+  for (const auto& shape : shapes.list().shape()) {
+    TensorShapeProto* batched = batched_shapes->add_shape();
+    *batched->add_dim() = batch_dim;
+    for (const auto& dim : shape.dim()) *batched->add_dim() = dim;
+  }
+  (*new_node.mutable_attr())[kOutputTypes] = types;
+  return new_node;
+}
+
+// Returns the `Map` node that applies `function_name` to the output of
+// `new_batch_node`.
+NodeDef MakeMapNode(const NodeDef& map_node, const NodeDef& batch_node,
+                    const NodeDef& new_batch_node, const string& function_name,
+                    MutableGraphView* graph) {
+  NodeDef new_node = map_node;
+  graph_utils::SetUniqueGraphNodeName(map_node.op(), graph->graph(),
+                                      &new_node);
+  new_node.set_input(0, new_batch_node.name());
+  (*new_node.mutable_attr())["f"].mutable_func()->set_name(function_name);
+  graph_utils::CopyShapesAndTypesAttrs(batch_node, &new_node);
+  return new_node;
+}
+
+}  // namespace
+
+Status MapVectorization::OptimizeAndCollectStats(Cluster* cluster,
+                                                 const GrapplerItem& item,
+                                                 GraphDef* output,
+                                                 OptimizationStats* stats) {
+  *output = item.graph;
+  MutableGraphView graph(output);
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
+  absl::flat_hash_set<string> nodes_to_delete;
+  for (const NodeDef& node : item.graph.node()) {
+    if (!IsBatch(node)) continue;
+    const NodeDef& batch_node = node;
+    NodeDef* map_node = graph_utils::GetInputNode(batch_node, graph);
+    if (map_node == nullptr || !IsMap(*map_node)) continue;
+    // Other consumers of the map still need its unbatched elements.
+    if (graph.NumFanouts(*map_node, /*include_controlled_nodes=*/true) != 1) {
+      continue;
+    }
+    if (map_node->attr().at("Targuments").list().type_size() > 0) continue;
+    NodeDef* input_node = graph_utils::GetInputNode(*map_node, graph);
+    AttrValue types, shapes;
+    if (input_node == nullptr ||
+        !GetComponentSpecs(*input_node, &types, &shapes) ||
+        !batch_node.attr().contains(kOutputShapes)) {
+      continue;
+    }
+    std::vector<int> arg_ranks;
+    for (const auto& shape : shapes.list().shape()) {
+      arg_ranks.push_back(shape.dim_size());
+    }
+
+    const FunctionDef* function =
+        function_library.Find(map_node->attr().at("f").func().name());
+    if (function == nullptr ||
+        function->signature().input_arg_size() != arg_ranks.size() ||
+        !VectorizabilityChecker(*function, arg_ranks).Check()) {
+      VLOG(2) << "Not vectorizing the function of " << map_node->name();
+      continue;
+    }
+
+    // The ops of the function already compute on a batch what they compute
+    // on each of its elements, so only shapes recorded for the arguments go
+    // stale.
+    FunctionDef* vectorized_function =
+        output->mutable_library()->add_function();
+    *vectorized_function = *function;
+    graph_utils::SetUniqueGraphFunctionName(
+        absl::StrCat("vectorized_", function->signature().name()),
+        output->mutable_library(), vectorized_function);
+    for (auto& arg_attr : *vectorized_function->mutable_arg_attr()) {
+      arg_attr.second.mutable_attr()->erase("_output_shapes");
+    }
+    TF_RETURN_IF_ERROR(function_library.AddFunctionDef(*vectorized_function));
+
+    auto* new_batch_node = graph.AddNode(
+        MakeBatchNode(*map_node, batch_node, types, shapes, &graph));
+    auto* new_map_node = graph.AddNode(
+        MakeMapNode(*map_node, batch_node, *new_batch_node,
+                    vectorized_function->signature().name(), &graph));
+    TF_RETURN_IF_ERROR(
+        graph.UpdateFanouts(batch_node.name(), new_map_node->name()));
+
+    nodes_to_delete.insert(map_node->name());
+    nodes_to_delete.insert(batch_node.name());
+    stats->num_changes++;
+  }
+
+  TF_RETURN_IF_ERROR(graph.DeleteNodes(nodes_to_delete));
+  return OkStatus();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(MapVectorization, "map_vectorization");
+
+}  // namespace grappler
+}  // namespace tensorflow
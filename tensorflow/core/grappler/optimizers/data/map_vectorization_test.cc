@@ -0,0 +1,464 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_function_library_runtime.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_test_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::GDef;
+using test::function::NDef;
+using FDH = FunctionDefHelper;
+
+// Parses a number and normalizes it.
+FunctionDef ParseAndNormalize() {
+  return FDH::Define(
+      // Name
+      "ParseAndNormalize",
+      // Args
+      {"line: string"},
+      // Return values
+      {"y: float"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"x"}, "StringToNumber", {"line"}, {{"out_type", DT_FLOAT}}},
+          {{"mean"},
+           "Const",
+           {},
+           {{"value", test::AsScalar<float>(2.0f)}, {"dtype", DT_FLOAT}}},
+          {{"scale"},
+           "Const",
+           {},
+           {{"value", test::AsScalar<float>(0.5f)}, {"dtype", DT_FLOAT}}},
+          {{"centered"}, "Sub", {"x", "mean"}, {{"T", DT_FLOAT}}},
+          {{"y"}, "Mul", {"centered", "scale"}, {{"T", DT_FLOAT}}},
+      });
+}
+
+// Decodes a CSV line with two numeric fields and normalizes the first one.
+FunctionDef DecodeCSVAndNormalize() {
+  return FDH::Define(
+      // Name
+      "DecodeCSVAndNormalize",
+      // Args
+      {"line: string"},
+      // Return values
+      {"a: float", "b: float"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"default"},
+           "Const",
+           {},
+           {{"value", test::AsTensor<float>({0.0f})}, {"dtype", DT_FLOAT}}},
+          {{"x", "b"},
+           "DecodeCSV",
+           {"line", "default", "default"},
+           {{"OUT_TYPE", DataTypeSlice{DT_FLOAT, DT_FLOAT}}}},
+          {{"min"},
+           "Const",
+           {},
+           {{"value", test::AsScalar<float>(0.0f)}, {"dtype", DT_FLOAT}}},
+          {{"max"},
+           "Const",
+           {},
+           {{"value", test::AsScalar<float>(10.0f)}, {"dtype", DT_FLOAT}}},
+          {{"a"}, "ClipByValue", {"x", "min", "max"}, {{"T", DT_FLOAT}}},
+      });
+}
+
+// Adds a vector to its input, which only broadcasts element-wise for scalar
+// inputs.
+FunctionDef AddVector() {
+  return FDH::Define(
+      // Name
+      "AddVector",
+      // Args
+      {"x: float"},
+      // Return values
+      {"y: float"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"v"},
+           "Const",
+           {},
+           {{"value", test::AsTensor<float>({1.0f, 2.0f})},
+            {"dtype", DT_FLOAT}}},
+          {{"y"}, "AddV2", {"x", "v"}, {{"T", DT_FLOAT}}},
+      });
+}
+
+// Returns the size of its input, which is not an element-wise op.
+FunctionDef InputSize() {
+  return FDH::Define(
+      // Name
+      "InputSize",
+      // Args
+      {"x: float"},
+      // Return values
+      {"y: int32"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"y"}, "Size", {"x"}, {{"T", DT_FLOAT}, {"out_type", DT_INT32}}},
+      });
+}
+
+// Returns a constant, which does not depend on the input.
+FunctionDef ReturnConstant() {
+  return FDH::Define(
+      // Name
+      "ReturnConstant",
+      // Args
+      {"x: float"},
+      // Return values
+      {"y: float"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"y"},
+           "Const",
+           {},
+           {{"value", test::AsScalar<float>(1.0f)}, {"dtype", DT_FLOAT}}},
+      });
+}
+
+NodeDef MakeSourceNode(StringPiece name, DataType dtype) {
+  return NDef(
+      name, "TensorSliceDataset", {"components"},
+      {{"Toutput_types", DataTypeSlice{dtype}},
+       {"output_shapes", gtl::ArraySlice<TensorShape>{TensorShape({})}},
+       {"output_types", DataTypeSlice{dtype}}});
+}
+
+NodeDef MakeMapNode(StringPiece name, StringPiece input_node_name,
+                    StringPiece function_name,
+                    const DataTypeSlice& output_types) {
+  NodeDef node = graph_tests_utils::MakeMapNode(name, input_node_name,
+                                                function_name);
+  SetAttrValue(output_types, &(*node.mutable_attr())["output_types"]);
+  return node;
+}
+
+NodeDef MakeBatchNode(StringPiece name, StringPiece input_node_name,
+                      const DataTypeSlice& output_types) {
+  std::vector<PartialTensorShape> shapes(output_types.size(),
+                                         PartialTensorShape({-1}));
+  return NDef(name, "BatchDatasetV2", {string(input_node_name), "batch_size",
+                                       "drop_remainder"},
+              {{"parallel_copy", false},
+               {"output_shapes", gtl::ArraySlice<PartialTensorShape>(shapes)},
+               {"output_types", output_types}});
+}
+
+// Returns the graph `source -> map(function_name) -> batch -> Sink`.
+GrapplerItem MakeMapAndBatchItem(const FunctionDef& function,
+                                 DataType input_type,
+                                 const DataTypeSlice& output_types) {
+  GrapplerItem item;
+  const string& function_name = function.signature().name();
+  item.graph = GDef(
+      {NDef("components", "Const", {},
+            {{"value", Tensor(input_type, TensorShape({8}))},
+             {"dtype", input_type}}),
+       MakeSourceNode("source", input_type),
+       MakeMapNode("map", "source", function_name, output_types),
+       NDef("batch_size", "Const", {},
+            {{"value", int64_t{4}}, {"dtype", DT_INT64}}),
+       NDef("drop_remainder", "Const", {},
+            {{"value", false}, {"dtype", DT_BOOL}}),
+       MakeBatchNode("batch", "map", output_types),
+       NDef("Sink", "Identity", {"batch"}, {})},
+      {function});
+  item.fetch.push_back("Sink");
+  return item;
+}
+
+// Returns the function applied by the map that follows the batch in `graph`,
+// or nullptr if the map still precedes the batch.
+const FunctionDef* GetVectorizedFunction(const GraphDef& graph) {
+  int batch = graph_utils::FindGraphNodeWithOp("BatchDatasetV2", graph);
+  int map = graph_utils::FindGraphNodeWithOp("MapDataset", graph);
+  if (batch == -1 || map == -1 || graph.node(map).input(0) !=
+                                      graph.node(batch).name()) {
+    return nullptr;
+  }
+  int function = graph_utils::FindGraphFunctionWithName(
+      graph.node(map).attr().at("f").func().name(), graph.library());
+  if (function == -1) return nullptr;
+  return &graph.library().function(function);
+}
+
+TEST(MapVectorizationTest, VectorizesParsingAndNormalization) {
+  GrapplerItem item =
+      MakeMapAndBatchItem(ParseAndNormalize(), DT_STRING, {DT_FLOAT});
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("batch", output));
+  const FunctionDef* function = GetVectorizedFunction(output);
+  ASSERT_NE(function, nullptr);
+  EXPECT_NE(function->signature().name(), "ParseAndNormalize");
+
+  const NodeDef& batch = output.node(
+      graph_utils::FindGraphNodeWithOp("BatchDatasetV2", output));
+  const NodeDef& map =
+      output.node(graph_utils::FindGraphNodeWithOp("MapDataset", output));
+  EXPECT_EQ(batch.input(0), "source");
+  EXPECT_EQ(batch.attr().at("output_types").list().type(0), DT_STRING);
+  EXPECT_EQ(PartialTensorShape(batch.attr().at("output_shapes").list().shape(0))
+                .DebugString(),
+            "[?]");
+  EXPECT_EQ(map.attr().at("output_types").list().type(0), DT_FLOAT);
+  const NodeDef& sink =
+      output.node(graph_utils::FindGraphNodeWithName("Sink", output));
+  EXPECT_EQ(sink.input(0), map.name());
+}
+
+TEST(MapVectorizationTest, VectorizesDecodeCSV) {
+  GrapplerItem item = MakeMapAndBatchItem(DecodeCSVAndNormalize(), DT_STRING,
+                                          {DT_FLOAT, DT_FLOAT});
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_NE(GetVectorizedFunction(output), nullptr);
+}
+
+TEST(MapVectorizationTest, KeepsParallelism) {
+  GrapplerItem item =
+      MakeMapAndBatchItem(ParseAndNormalize(), DT_STRING, {DT_FLOAT});
+  NodeDef* map = item.graph.mutable_node(
+      graph_utils::FindGraphNodeWithName("map", item.graph));
+  map->set_op("ParallelMapDatasetV2");
+  map->add_input("num_parallel_calls");
+  (*map->mutable_attr())["deterministic"].set_s("true");
+  *item.graph.add_node() = NDef("num_parallel_calls", "Const", {},
+                                {{"value", int64_t{-1}}, {"dtype", DT_INT64}});
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  int index = graph_utils::FindGraphNodeWithOp("ParallelMapDatasetV2", output);
+  ASSERT_NE(index, -1);
+  const NodeDef& parallel_map = output.node(index);
+  EXPECT_EQ(parallel_map.input(1), "num_parallel_calls");
+  EXPECT_EQ(parallel_map.attr().at("deterministic").s(), "true");
+  EXPECT_EQ(output.node(graph_utils::FindGraphNodeWithName(
+                            parallel_map.input(0), output))
+                .op(),
+            "BatchDatasetV2");
+}
+
+class NotVectorizableTest : public ::testing::TestWithParam<FunctionDef> {};
+
+TEST_P(NotVectorizableTest, LeavesPipelineUnchanged) {
+  const FunctionDef& function = GetParam();
+  DataTypeVector types;
+  for (const auto& arg : function.signature().output_arg()) {
+    types.push_back(arg.type());
+  }
+  GrapplerItem item = MakeMapAndBatchItem(function, DT_FLOAT, types);
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+INSTANTIATE_TEST_SUITE_P(Test, NotVectorizableTest,
+                         ::testing::Values(AddVector(), InputSize(),
+                                           ReturnConstant()));
+
+TEST(MapVectorizationTest, MapWithOtherConsumers) {
+  GrapplerItem item =
+      MakeMapAndBatchItem(ParseAndNormalize(), DT_STRING, {DT_FLOAT});
+  *item.graph.add_node() = NDef("Sink2", "Identity", {"map"}, {});
+  item.fetch.push_back("Sink2");
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+TEST(MapVectorizationTest, MapWithCapturedInputs) {
+  GrapplerItem item =
+      MakeMapAndBatchItem(ParseAndNormalize(), DT_STRING, {DT_FLOAT});
+  NodeDef* map = item.graph.mutable_node(
+      graph_utils::FindGraphNodeWithName("map", item.graph));
+  map->add_input("batch_size");
+  SetAttrValue(DataTypeSlice{DT_INT64},
+               &(*map->mutable_attr())["Targuments"]);
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+}
+
+// Runs map functions on the CPU the way the map dataset does.
+class FunctionRunner {
+ public:
+  explicit FunctionRunner(const FunctionDefLibrary& library) {
+    SessionOptions options;
+    std::vector<std::unique_ptr<Device>> devices;
+    TF_CHECK_OK(DeviceFactory::AddDevices(
+        options, "/job:localhost/replica:0/task:0", &devices));
+    device_mgr_ = std::make_unique<StaticDeviceMgr>(std::move(devices));
+    lib_def_ = std::make_unique<FunctionLibraryDefinition>(OpRegistry::Global(),
+                                                           library);
+    pflr_ = std::make_unique<ProcessFunctionLibraryRuntime>(
+        device_mgr_.get(), Env::Default(), &options.config,
+        TF_GRAPH_DEF_VERSION, lib_def_.get(), OptimizerOptions());
+    flr_ = pflr_->GetFLR("/job:localhost/replica:0/task:0/cpu:0");
+  }
+
+  Status Run(const string& function_name, const std::vector<Tensor>& args,
+             std::vector<Tensor>* rets) {
+    FunctionLibraryRuntime::Handle handle;
+    TF_RETURN_IF_ERROR(
+        flr_->Instantiate(function_name, AttrSlice(), &handle));
+    FunctionLibraryRuntime::Options opts;
+    opts.runner = &runner_;
+    rets->clear();
+    return flr_->RunSync(opts, handle, args, rets);
+  }
+
+ private:
+  std::function<void(std::function<void()>)> runner_ =
+      [](std::function<void()> fn) { fn(); };
+  std::unique_ptr<DeviceMgr> device_mgr_;
+  std::unique_ptr<FunctionLibraryDefinition> lib_def_;
+  std::unique_ptr<ProcessFunctionLibraryRuntime> pflr_;
+  FunctionLibraryRuntime* flr_;
+};
+
+// Returns `batch_size` lines with one number, or two if `csv` is true.
+std::vector<tstring> MakeLines(int batch_size, bool csv) {
+  std::vector<tstring> lines;
+  for (int i = 0; i < batch_size; ++i) {
+    lines.push_back(csv ? absl::StrCat(i % 13, ",", i) : absl::StrCat(i % 13));
+  }
+  return lines;
+}
+
+TEST(MapVectorizationTest, VectorizedFunctionComputesBatchOfResults) {
+  constexpr int kBatchSize = 8;
+  for (const FunctionDef& function :
+       {ParseAndNormalize(), DecodeCSVAndNormalize()}) {
+    const string& name = function.signature().name();
+    std::vector<DataType> output_types(
+        function.signature().output_arg_size(), DT_FLOAT);
+    GrapplerItem item =
+        MakeMapAndBatchItem(function, DT_STRING, output_types);
+    MapVectorization optimizer;
+    GraphDef output;
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+    const FunctionDef* vectorized = GetVectorizedFunction(output);
+    ASSERT_NE(vectorized, nullptr) << name;
+
+    FunctionRunner runner(output.library());
+    std::vector<tstring> inputs =
+        MakeLines(kBatchSize, /*csv=*/name == "DecodeCSVAndNormalize");
+    std::vector<Tensor> batched;
+    TF_ASSERT_OK(runner.Run(vectorized->signature().name(),
+                            {test::AsTensor<tstring>(inputs)}, &batched));
+    ASSERT_EQ(batched.size(), output_types.size());
+    for (int i = 0; i < kBatchSize; ++i) {
+      std::vector<Tensor> single;
+      TF_ASSERT_OK(
+          runner.Run(name, {test::AsScalar<tstring>(inputs[i])}, &single));
+      for (int j = 0; j < single.size(); ++j) {
+        EXPECT_EQ(batched[j].vec<float>()(i), single[j].scalar<float>()())
+            << name << " element " << i << " output " << j;
+      }
+    }
+  }
+}
+
+// Applies a string-parsing and feature-normalizing map function to a batch of
+// lines, either once per line as the map dataset does before the rewrite, or
+// once per batch as it does after.
+static void BM_MapFunction(::testing::benchmark::State& state) {
+  const bool vectorized = state.range(0);
+  const int batch_size = state.range(1);
+  GrapplerItem item = MakeMapAndBatchItem(DecodeCSVAndNormalize(), DT_STRING,
+                                          {DT_FLOAT, DT_FLOAT});
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+  const FunctionDef* vectorized_function = GetVectorizedFunction(output);
+  CHECK(vectorized_function != nullptr);
+  FunctionRunner runner(output.library());
+
+  std::vector<tstring> lines = MakeLines(batch_size, /*csv=*/true);
+  Tensor batch = test::AsTensor<tstring>(lines);
+  std::vector<Tensor> elements;
+  for (const tstring& line : lines) {
+    elements.push_back(test::AsScalar<tstring>(line));
+  }
+  std::vector<Tensor> rets;
+  for (auto s : state) {
+    if (vectorized) {
+      TF_CHECK_OK(
+          runner.Run(vectorized_function->signature().name(), {batch}, &rets));
+    } else {
+      for (const Tensor& element : elements) {
+        TF_CHECK_OK(runner.Run("DecodeCSVAndNormalize", {element}, &rets));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+
+BENCHMARK(BM_MapFunction)
+    ->ArgPair(0, 32)
+    ->ArgPair(1, 32)
+    ->ArgPair(0, 1024)
+    ->ArgPair(1, 1024);
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
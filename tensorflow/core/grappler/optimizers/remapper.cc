@@ -67,6 +67,10 @@ namespace grappler {
 //
 // Sigmoid + Mul -> _MklSwish  // This fusion only works on Intel CPU.
 //
+// GatherV2 + ... -> _FusedSparseSegmentReduce (CPU only):
+//   (1) GatherV2 + SegmentSum
+//   (2) GatherV2 + Mul(Reshape(weights)) + SegmentSum
+//
 //
 // In all cases, the supported activation functions are Relu, Relu6, and Elu.
 //
@@ -81,6 +85,7 @@ constexpr char kFusedDepthwiseConv2dNative[] = "_FusedDepthwiseConv2dNative";
 constexpr char kFusedBatchNormEx[] = "_FusedBatchNormEx";
 constexpr char kFusedBatchNormGradEx[] = "_FusedBatchNormGradEx";
 constexpr char kTensorToHashBucket[] = "_TensorToHashBucketFast";
+constexpr char kFusedSparseSegmentReduce[] = "_FusedSparseSegmentReduce";
 
 constexpr char kDataFormat[] = "data_format";
 constexpr char kIsTraining[] = "is_training";
@@ -2319,6 +2324,138 @@ bool FindTensorToHashBucket(const RemapperContext& ctx, int node_index,
   return true;
 }
 
+// Finds the weighted sparse embedding combiner built by
+// embedding_lookup_sparse, SegmentSum(Mul(GatherV2(params, indices, 0),
+// Reshape(weights))), or its unweighted form SegmentSum(GatherV2(params,
+// indices, 0)), which _FusedSparseSegmentReduce computes without materializing
+// the gathered rows.
+//
+// Only GatherV2 is matched. Lookups into resource variables gather with
+// ResourceGather, which reads the variable itself; _FusedSparseSegmentReduce
+// takes `params` as a tensor, so those lookups are left unfused.
+bool FindGatherSegmentSum(RemapperContext* ctx, int node_index,
+                          std::map<string, int>* matched_nodes_map,
+                          std::set<int>* remove_node_indices,
+                          bool* has_weights) {
+  using utils::MatchingDirection;
+  using utils::NodeStatus;
+  // clang-format off
+  utils::OpTypePattern gather_pattern{
+    "GatherV2", "gather", NodeStatus::kRemove,
+    {
+      { "*", "params", NodeStatus::kRemain},
+      { "*", "indices", NodeStatus::kRemain},
+      { "Const", "axis", NodeStatus::kRemain}
+    }
+  };
+  utils::OpTypePattern weighted_pattern{
+    "SegmentSum", "segment_sum", NodeStatus::kReplace,
+    {
+      { "Mul", "mul", NodeStatus::kRemove,
+        {
+          gather_pattern,
+          { "Reshape", "weights_reshape", NodeStatus::kRemain,
+            {
+              { "*", "weights", NodeStatus::kRemain},
+              { "*", "shape", NodeStatus::kRemain}
+            }
+          }
+        }
+      },
+      { "*", "segment_ids", NodeStatus::kRemain}
+    }
+  };
+  utils::OpTypePattern unweighted_pattern{
+    "SegmentSum", "segment_sum", NodeStatus::kReplace,
+    {
+      gather_pattern,
+      { "*", "segment_ids", NodeStatus::kRemain}
+    }
+  };
+  // clang-format on
+
+  // The shapes of the inputs must be known to check that the weights only
+  // scale the gathered rows.
+  if (!ctx->inferred_graph_properties) return false;
+  auto* node_view = ctx->graph_view.GetNode(node_index);
+  const auto* segment_sum = node_view->node();
+  if (segment_sum->op() != "SegmentSum") return false;
+  if (!HasDataType(segment_sum, DT_FLOAT) &&
+      !HasDataType(segment_sum, DT_BFLOAT16))
+    return false;
+  if (!NodeIsOnCpu(segment_sum)) return false;
+
+  utils::SubGraphMatcher<MatchingDirection::kFollowInputs> graph_matcher(
+      &(ctx->graph_view));
+  matched_nodes_map->clear();
+  remove_node_indices->clear();
+  *has_weights = graph_matcher.GetMatchedNodes(
+      weighted_pattern, ctx->nodes_to_preserve, node_view, matched_nodes_map,
+      remove_node_indices);
+  if (!*has_weights) {
+    matched_nodes_map->clear();
+    remove_node_indices->clear();
+    if (!graph_matcher.GetMatchedNodes(unweighted_pattern,
+                                       ctx->nodes_to_preserve, node_view,
+                                       matched_nodes_map,
+                                       remove_node_indices)) {
+      return false;
+    }
+  }
+
+  // GatherV2 must gather whole rows of `params` at a vector of indices.
+  const auto* gather =
+      ctx->graph_view.GetNode(matched_nodes_map->at("gather"))->node();
+  int batch_dims = 0;
+  if (TryGetNodeAttr(*gather, "batch_dims", &batch_dims) && batch_dims != 0) {
+    return false;
+  }
+  const auto* axis =
+      ctx->graph_view.GetNode(matched_nodes_map->at("axis"))->node();
+  Tensor axis_tensor;
+  if (!axis_tensor.FromProto(axis->attr().at("value").tensor()) ||
+      axis_tensor.NumElements() != 1) {
+    return false;
+  }
+  const int64_t axis_value = axis_tensor.dtype() == DT_INT32
+                                 ? axis_tensor.flat<int32>()(0)
+                                 : axis_tensor.flat<int64_t>()(0);
+  if (axis_value != 0) return false;
+
+  const auto& gather_props =
+      ctx->graph_properties.GetInputProperties(gather->name());
+  if (gather_props.size() < 2) return false;
+  const TensorShapeProto& params_shape = gather_props[0].shape();
+  const TensorShapeProto& indices_shape = gather_props[1].shape();
+  if (params_shape.unknown_rank() || params_shape.dim_size() < 1 ||
+      indices_shape.unknown_rank() || indices_shape.dim_size() != 1) {
+    return false;
+  }
+
+  // The weights must be a vector reshaped to [num_indices, 1, ..., 1].
+  if (*has_weights) {
+    const auto* reshape =
+        ctx->graph_view.GetNode(matched_nodes_map->at("weights_reshape"))
+            ->node();
+    const auto& input_props =
+        ctx->graph_properties.GetInputProperties(reshape->name());
+    const auto& output_props =
+        ctx->graph_properties.GetOutputProperties(reshape->name());
+    if (input_props.empty() || output_props.empty()) return false;
+    const TensorShapeProto& weights_shape = input_props[0].shape();
+    const TensorShapeProto& reshaped_shape = output_props[0].shape();
+    if (weights_shape.unknown_rank() || weights_shape.dim_size() != 1 ||
+        reshaped_shape.unknown_rank() ||
+        reshaped_shape.dim_size() != params_shape.dim_size()) {
+      return false;
+    }
+    for (int i = 1; i < reshaped_shape.dim_size(); ++i) {
+      if (reshaped_shape.dim(i).size() != 1) return false;
+    }
+  }
+  return true;
+}
+
 bool FindFusedBatchMatMul(RemapperContext* ctx, int node_index,
                           std::map<string, int>* matched_nodes_map,
                           std::set<int>* remove_node_indices) {
@@ -3543,6 +3680,53 @@ Status AddTensorToHashBucketNode(RemapperContext* ctx,
   return OkStatus();
 }
 
+Status AddFusedSparseSegmentReduceNode(
+    RemapperContext* ctx, const std::map<string, int>& matched_nodes_map,
+    const std::set<int>& remove_node_indices, bool has_weights,
+    std::vector<bool>* invalidated_nodes, std::vector<bool>* nodes_to_delete) {
+  const NodeDef* segment_sum =
+      ctx->graph_view.GetNode(matched_nodes_map.at("segment_sum"))->node();
+  const NodeDef* gather =
+      ctx->graph_view.GetNode(matched_nodes_map.at("gather"))->node();
+  VLOG(2) << "Fuse GatherV2 with SegmentSum:"
+          << " gather=" << gather->name()
+          << " segment_sum=" << segment_sum->name()
+          << " has_weights=" << has_weights;
+
+  NodeDef fused_op;
+  fused_op.set_name(segment_sum->name());
+  fused_op.set_op(kFusedSparseSegmentReduce);
+  fused_op.set_device(segment_sum->device());
+  fused_op.add_input(gather->input(0));       // 0: data
+  fused_op.add_input(gather->input(1));       // 1: indices
+  fused_op.add_input(segment_sum->input(1));  // 2: segment_ids
+  if (has_weights) {
+    const NodeDef* reshape =
+        ctx->graph_view.GetNode(matched_nodes_map.at("weights_reshape"))
+            ->node();
+    fused_op.add_input(reshape->input(0));  // 3: weights
+  }
+
+  auto* attr = fused_op.mutable_attr();
+  (*attr)["T"] = segment_sum->attr().at("T");
+  (*attr)["Tidx"] = gather->attr().at("Tindices");
+  (*attr)["Tsegmentids"] = segment_sum->attr().at("Tindices");
+  SetAttrValue(has_weights ? 1 : 0, &(*attr)["num_weights"]);
+  SetAttrValue("sum", &(*attr)["combiner"]);
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched_nodes_map.at("segment_sum")] = true;
+  for (const auto& node_index : remove_node_indices) {
+    (*nodes_to_delete)[node_index] = true;
+  }
+  return OkStatus();
+}
+
 Status AddFusedBatchMatMul(RemapperContext* ctx,
                            const std::map<string, int>& matched_nodes_map,
                            const std::set<int>& remove_node_indices,
@@ -3885,16 +4069,27 @@ bool RequiresInferredShapes(const RemapperContext& ctx, int node_index,
     return true;
   };
 
+  // Candidate for a GatherV2+[Mul]+SegmentSum fusion.
+  const auto is_gather_segment_sum_candidate = [&]() -> bool {
+    if (node_def->op() != "SegmentSum" || !NodeIsOnCpu(node_def)) return false;
+    if (node_view->NumRegularFanins() < 1) return false;
+    const auto& data_fanin = node_view->GetRegularFanin(0);
+    const auto* data_node_def = data_fanin.node_view()->node();
+    return data_node_def->op() == "GatherV2" || IsMul(*data_node_def);
+  };
+
   if (IsMKLEnabled())
     return is_batch_norm_candidate() || is_batch_norm_fusion_candidate() ||
            IsContractionWithAdd(ctx, node_index) ||
-           is_act_biasadd_conv_candidate();
+           is_act_biasadd_conv_candidate() ||
+           is_gather_segment_sum_candidate();
 
   return is_act_biasadd_conv_candidate() || is_batch_norm_candidate() ||
          is_batch_norm_fusion_candidate() ||
          is_batch_norm_grad_fusion_candidate() ||
          is_matmul_gelu_exact_fusion_candidate() ||
-         is_act_biasadd_matmul_candidate();
+         is_act_biasadd_matmul_candidate() ||
+         is_gather_segment_sum_candidate();
 }
 }  // namespace
 
@@ -4140,6 +4335,19 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       continue;
     }
 
+    // Remap GatherV2+[Mul]+SegmentSum into the _FusedSparseSegmentReduce.
+    matched_nodes_map.clear();
+    remove_node_indices.clear();
+    bool has_weights = false;
+    if (allow_non_differentiable_rewrites &&
+        FindGatherSegmentSum(&ctx, i, &matched_nodes_map, &remove_node_indices,
+                             &has_weights)) {
+      TF_RETURN_IF_ERROR(AddFusedSparseSegmentReduceNode(
+          &ctx, matched_nodes_map, remove_node_indices, has_weights,
+          &invalidated_nodes, &nodes_to_delete));
+      continue;
+    }
+
     // During inference, most of the inputs to FusedBatchNorm are constant, and
     // we can therefore replace the op with a much cheaper set of primitives.
     FusedBatchNorm fused_batch_norm;
@@ -1414,6 +1414,89 @@ TEST_F(RemapperTensorToHashBucketTest, I32) { RunTest<DT_INT32>(); }
 
 TEST_F(RemapperTensorToHashBucketTest, I64) { RunTest<DT_INT64>(); }
 
+class RemapperFuseGatherSegmentSumTest : public RemapperTest {
+ public:
+  void RunTest(bool weighted) {
+    using ::tensorflow::ops::Placeholder;
+
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+    auto params_shape = ops::Placeholder::Shape({10, 4});
+    auto ids_shape = ops::Placeholder::Shape({6});
+    auto params = Placeholder(s.WithOpName("params"), DT_FLOAT, params_shape);
+    auto indices = Placeholder(s.WithOpName("indices"), DT_INT32, ids_shape);
+    auto segment_ids =
+        Placeholder(s.WithOpName("segment_ids"), DT_INT32, ids_shape);
+    auto weights = Placeholder(s.WithOpName("weights"), DT_FLOAT, ids_shape);
+
+    auto axis = ops::Const(s.WithOpName("axis"), 0);
+    Output rows = ops::GatherV2(s.WithOpName("gather"), params, indices, axis);
+    if (weighted) {
+      auto reshaped_weights = ops::Reshape(s.WithOpName("reshaped_weights"),
+                                           weights, {-1, 1});
+      rows = ops::Mul(s.WithOpName("mul"), rows, reshaped_weights);
+    }
+    auto segment_sum =
+        ops::SegmentSum(s.WithOpName("segment_sum"), rows, segment_ids);
+    auto fetch = ops::Identity(s.WithOpName("fetch"), segment_sum);
+
+    auto params_t = GenerateRandomTensor<DT_FLOAT>({10, 4});
+    auto weights_t = GenerateRandomTensor<DT_FLOAT>({6});
+    Tensor indices_t(DT_INT32, TensorShape({6}));
+    test::FillValues<int32>(&indices_t, {3, 9, 0, 3, 7, 1});
+    Tensor segment_ids_t(DT_INT32, TensorShape({6}));
+    test::FillValues<int32>(&segment_ids_t, {0, 0, 1, 3, 3, 4});
+
+    GrapplerItem item;
+    item.fetch = {"fetch"};
+    item.feed = {{"params", params_t},
+                 {"indices", indices_t},
+                 {"segment_ids", segment_ids_t}};
+    if (weighted) item.feed.push_back({"weights", weights_t});
+    TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+    for (int i = 0; i < item.graph.node_size(); ++i) {
+      item.graph.mutable_node(i)->set_device("/device:CPU:0");
+    }
+
+    Remapper optimizer(RewriterConfig::ON);
+    GraphDef output;
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+    int found = 0;
+    for (const NodeDef& node : output.node()) {
+      EXPECT_NE(node.name(), "gather");
+      EXPECT_NE(node.name(), "mul");
+      if (node.name() == "segment_sum") {
+        EXPECT_EQ(node.op(), "_FusedSparseSegmentReduce");
+        ASSERT_EQ(node.input_size(), weighted ? 4 : 3);
+        EXPECT_EQ(node.input(0), "params");
+        EXPECT_EQ(node.input(1), "indices");
+        EXPECT_EQ(node.input(2), "segment_ids");
+        if (weighted) EXPECT_EQ(node.input(3), "weights");
+        EXPECT_EQ(node.attr().at("num_weights").i(), weighted ? 1 : 0);
+        EXPECT_EQ(node.attr().at("combiner").s(), "sum");
+        found++;
+      }
+    }
+    EXPECT_EQ(found, 1);
+
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+    ASSERT_EQ(tensors_expected.size(), 1);
+    auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+    ASSERT_EQ(tensors.size(), 1);
+    test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-6);
+  }
+};
+
+TEST_F(RemapperFuseGatherSegmentSumTest, Unweighted) {
+  RunTest(/*weighted=*/false);
+}
+
+TEST_F(RemapperFuseGatherSegmentSumTest, Weighted) {
+  RunTest(/*weighted=*/true);
+}
+
 class RemapperFuseMatMulWithBiasTest : public RemapperTest {
  public:
   template <DataType DTYPE>
@@ -0,0 +1,407 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/global_shuffle_dataset_op.h"
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/random_seed_ops.h"
+#include "tensorflow/core/kernels/random_index_shuffle.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr char GlobalShuffleDatasetOp::kDatasetType[];
+/* static */ constexpr char GlobalShuffleDatasetOp::kInputDataset[];
+/* static */ constexpr char GlobalShuffleDatasetOp::kNumParallelCalls[];
+/* static */ constexpr char GlobalShuffleDatasetOp::kSeed[];
+/* static */ constexpr char GlobalShuffleDatasetOp::kSeed2[];
+/* static */ constexpr char GlobalShuffleDatasetOp::kReshuffleEachIteration[];
+/* static */ constexpr char GlobalShuffleDatasetOp::kOutputTypes[];
+/* static */ constexpr char GlobalShuffleDatasetOp::kOutputShapes[];
+
+namespace {
+
+constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
+constexpr char kNextIndex[] = "next_index";
+
+// Number of Feistel rounds of `random::index_shuffle`, as recommended there.
+constexpr int32_t kNumShuffleRounds = 8;
+
+// Elements read ahead of the consumer, per parallel call. Reads complete out of
+// order, so a window larger than the number of calls in flight keeps them busy
+// while the consumer waits for a slow read.
+constexpr int64_t kReadAheadPerCall = 2;
+
+// Derives the key of the permutation from a pair of seeds.
+std::array<uint32_t, 3> ShuffleKey(int64_t seed, int64_t seed2) {
+  random::PhiloxRandom generator(seed, seed2);
+  random::PhiloxRandom::ResultType bits = generator();
+  return {bits[0], bits[1], bits[2]};
+}
+
+}  // namespace
+
+class GlobalShuffleDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input,
+          int64_t num_parallel_calls, int64_t cardinality, RandomSeeds&& seeds,
+          bool reshuffle_each_iteration, const DataTypeVector& output_types,
+          const std::vector<PartialTensorShape>& output_shapes)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        num_parallel_calls_(num_parallel_calls),
+        cardinality_(cardinality),
+        key_(ShuffleKey(seeds.seed(), seeds.seed2())),
+        reshuffle_each_iteration_(reshuffle_each_iteration),
+        output_types_(output_types),
+        output_shapes_(output_shapes) {
+    if (reshuffle_each_iteration_) {
+      seed_generator_ = std::make_shared<RandomSeedGenerator>(std::move(seeds));
+    } else {
+      seed_generator_ = std::make_shared<FixedSeedGenerator>(std::move(seeds));
+    }
+    input_->Ref();
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override { return output_types_; }
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.set_args(seed_generator_->seed(), seed_generator_->seed2());
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return cardinality_;
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+  // Random access follows the permutation of the dataset seeds, which does not
+  // change across calls even with `reshuffle_each_iteration`.
+  Status Get(OpKernelContext* ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    return input_->Get(ctx, ShuffledIndex(index, key_), out_tensors);
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* num_parallel_calls_node = nullptr;
+    TF_RETURN_IF_ERROR(
+        b->AddScalar(num_parallel_calls_, &num_parallel_calls_node));
+    Node* seed_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(seed_generator_->seed(), &seed_node));
+    Node* seed2_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(seed_generator_->seed2(), &seed2_node));
+    AttrValue reshuffle_each_iteration;
+    b->BuildAttrValue(reshuffle_each_iteration_, &reshuffle_each_iteration);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, num_parallel_calls_node, seed_node, seed2_node},
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration)},
+        output));
+    return OkStatus();
+  }
+
+ private:
+  int64_t ShuffledIndex(int64_t index,
+                        const std::array<uint32_t, 3>& key) const {
+    return static_cast<int64_t>(random::index_shuffle(
+        static_cast<uint64_t>(index), key,
+        static_cast<uint64_t>(cardinality_ - 1), kNumShuffleRounds));
+  }
+
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params),
+          mu_(std::make_shared<mutex>()),
+          cond_var_(std::make_shared<condition_variable>()),
+          num_parallel_calls_(std::make_shared<model::SharedState>(
+              params.dataset->num_parallel_calls_, mu_, cond_var_)) {}
+
+    ~Iterator() override {
+      CancelCalls(/*wait=*/true);
+      if (deregister_fn_) deregister_fn_();
+    }
+
+    bool SymbolicCheckpointCompatible() const override { return true; }
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(*mu_);
+      if (num_parallel_calls_->value == model::kAutotune) {
+        num_parallel_calls_->value = GetAutotuneDefaultParallelism(ctx);
+      }
+      TF_RETURN_IF_ERROR(RegisterCancellationCallback(
+          ctx->cancellation_manager(),
+          [this]() { CancelCalls(/*wait=*/false); }, &deregister_fn_));
+      // Reads run on the runner of the iterator, outside of any GetNext call,
+      // so they get their own kernel contexts on the iterator's device.
+      flr_ = ctx->flr();
+      runner_ = *ctx->runner();
+      dataset()->seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      key_ = ShuffleKey(seed_, seed2_);
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      std::shared_ptr<Read> read;
+      {
+        mutex_lock l(*mu_);
+        ScheduleReads();
+        if (reads_.empty()) {
+          *end_of_sequence = true;
+          return OkStatus();
+        }
+        read = reads_.front();
+        while (!cancelled_ && !read->done) {
+          RecordStop(ctx);
+          cond_var_->wait(l);
+          RecordStart(ctx);
+        }
+        if (cancelled_) {
+          return errors::Cancelled("Iterator was cancelled");
+        }
+        reads_.pop_front();
+        ScheduleReads();
+      }
+      TF_RETURN_IF_ERROR(read->status);
+      *out_tensors = std::move(read->element);
+      *end_of_sequence = false;
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeAsyncKnownRatioNode(
+          std::move(args),
+          /*ratio=*/1,
+          {model::MakeParameter("parallelism", num_parallel_calls_, /*min=*/1,
+                                /*max=*/ctx->runner_threadpool_size())});
+    }
+
+    // The state of the iterator is the permutation and the position in it, so
+    // the elements read ahead are not saved.
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(*mu_);
+      const int64_t next_index =
+          reads_.empty() ? next_index_ : reads_.front()->index;
+      // Save the state needed to restore the seeds of later iterators.
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kEpochNumRandomSamples),
+                              dataset()->seed_generator_->num_random_samples()));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed), seed_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed2), seed2_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kNextIndex), next_index));
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(*mu_);
+      while (num_calls_ > 0) {
+        cond_var_->wait(l);
+      }
+      reads_.clear();
+      int64_t num_random_samples;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpochNumRandomSamples),
+                                            &num_random_samples));
+      dataset()->seed_generator_->set_num_random_samples(num_random_samples);
+      dataset()->seed_generator_->Reset();
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed), &seed_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed2), &seed2_));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kNextIndex), &next_index_));
+      key_ = ShuffleKey(seed_, seed2_);
+      return OkStatus();
+    }
+
+   private:
+    // The element at an output position, read in the background.
+    struct Read {
+      explicit Read(int64_t index) : index(index) {}
+
+      const int64_t index;
+      std::vector<Tensor> element;
+      Status status;
+      bool done = false;
+    };
+
+    // Issues reads of the next positions until the read-ahead window is full or
+    // `num_parallel_calls_` reads are in flight.
+    void ScheduleReads() TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      const int64_t parallelism = num_parallel_calls_->value;
+      while (!cancelled_ && next_index_ < dataset()->cardinality_ &&
+             num_calls_ < parallelism &&
+             static_cast<int64_t>(reads_.size()) <
+                 kReadAheadPerCall * parallelism) {
+        auto read = std::make_shared<Read>(next_index_++);
+        reads_.push_back(read);
+        ++num_calls_;
+        runner_([this, read]() { CallGet(read); });
+      }
+    }
+
+    void CallGet(const std::shared_ptr<Read>& read) {
+      OpKernelContext::Params params;
+      params.device = flr_->device();
+      params.function_library = flr_;
+      params.runner = &runner_;
+      OpKernelContext op_ctx(&params, /*num_outputs=*/0);
+      std::vector<Tensor> element;
+      Status status = dataset()->input_->Get(
+          &op_ctx, dataset()->ShuffledIndex(read->index, key_), &element);
+      mutex_lock l(*mu_);
+      read->element = std::move(element);
+      read->status = std::move(status);
+      read->done = true;
+      --num_calls_;
+      ScheduleReads();
+      cond_var_->notify_all();
+    }
+
+    void CancelCalls(bool wait) TF_LOCKS_EXCLUDED(mu_) {
+      mutex_lock l(*mu_);
+      cancelled_ = true;
+      cond_var_->notify_all();
+      while (wait && num_calls_ > 0) {
+        cond_var_->wait(l);
+      }
+    }
+
+    const std::shared_ptr<mutex> mu_;
+    const std::shared_ptr<condition_variable> cond_var_;
+    const std::shared_ptr<model::SharedState> num_parallel_calls_;
+
+    FunctionLibraryRuntime* flr_ = nullptr;  // not owned.
+    std::function<void(std::function<void()>)> runner_;
+    std::function<void()> deregister_fn_;
+
+    // Seeds of the permutation of this iterator, and its key. The key only
+    // changes when restoring, with no reads in flight.
+    int64_t seed_ TF_GUARDED_BY(*mu_) = 0;
+    int64_t seed2_ TF_GUARDED_BY(*mu_) = 0;
+    std::array<uint32_t, 3> key_;
+    // Output position of the next read to issue.
+    int64_t next_index_ TF_GUARDED_BY(*mu_) = 0;
+    // Reads of consecutive output positions, in flight or not yet consumed.
+    std::deque<std::shared_ptr<Read>> reads_ TF_GUARDED_BY(*mu_);
+    int64_t num_calls_ TF_GUARDED_BY(*mu_) = 0;
+    bool cancelled_ TF_GUARDED_BY(*mu_) = false;
+  };
+
+  const DatasetBase* const input_;
+  const int64_t num_parallel_calls_;
+  const int64_t cardinality_;
+  // Key of the permutation used for random access.
+  const std::array<uint32_t, 3> key_;
+  const bool reshuffle_each_iteration_;
+  std::shared_ptr<SeedGenerator> seed_generator_;
+  const DataTypeVector output_types_;
+  const std::vector<PartialTensorShape> output_shapes_;
+};
+
+GlobalShuffleDatasetOp::GlobalShuffleDatasetOp(OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kReshuffleEachIteration,
+                                   &reshuffle_each_iteration_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
+}
+
+void GlobalShuffleDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                         DatasetBase* input,
+                                         DatasetBase** output) {
+  int64_t num_parallel_calls = 0;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kNumParallelCalls,
+                                                   &num_parallel_calls));
+  OP_REQUIRES(
+      ctx, num_parallel_calls > 0 || num_parallel_calls == model::kAutotune,
+      errors::InvalidArgument("num_parallel_calls must be greater than zero."));
+  int64_t seed = 0;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed, &seed));
+  int64_t seed2 = 0;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed2, &seed2));
+
+  CardinalityOptions options;
+  options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+  const int64_t cardinality = input->Cardinality(options);
+  OP_REQUIRES(
+      ctx, cardinality >= 0,
+      errors::InvalidArgument(
+          "A global shuffle requires an input dataset of known, finite "
+          "cardinality, but ",
+          input->DebugString(), " has ",
+          cardinality == kInfiniteCardinality ? "infinite" : "unknown",
+          " cardinality."));
+
+  *output = new Dataset(ctx, input, num_parallel_calls, cardinality,
+                        RandomSeeds(seed, seed2), reshuffle_each_iteration_,
+                        output_types_, output_shapes_);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(Name("GlobalShuffleDataset").Device(DEVICE_CPU),
+                        GlobalShuffleDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,59 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_GLOBAL_SHUFFLE_DATASET_OP_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_GLOBAL_SHUFFLE_DATASET_OP_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Shuffles all the elements of a dataset with random access. The `i`-th output
+// is the element at position `p(i)` of the input, where `p` is a pseudorandom
+// permutation computed one index at a time by `random::index_shuffle`, so the
+// shuffle does not buffer elements. Elements are read with `DatasetBase::Get`
+// in parallel, ahead of the consumer.
+class GlobalShuffleDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  static constexpr char kDatasetType[] = "GlobalShuffle";
+  static constexpr char kInputDataset[] = "input_dataset";
+  static constexpr char kNumParallelCalls[] = "num_parallel_calls";
+  static constexpr char kSeed[] = "seed";
+  static constexpr char kSeed2[] = "seed2";
+  static constexpr char kReshuffleEachIteration[] = "reshuffle_each_iteration";
+  static constexpr char kOutputTypes[] = "output_types";
+  static constexpr char kOutputShapes[] = "output_shapes";
+
+  explicit GlobalShuffleDatasetOp(OpKernelConstruction* ctx);
+
+ protected:
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override;
+
+ private:
+  class Dataset;
+  bool reshuffle_each_iteration_ = true;
+  DataTypeVector output_types_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_GLOBAL_SHUFFLE_DATASET_OP_H_
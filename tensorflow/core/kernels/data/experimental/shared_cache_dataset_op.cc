@@ -0,0 +1,331 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/shared_cache_dataset_op.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/hash_utils.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/shared_element_cache.h"
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/function_handle_cache.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr char SharedCacheDatasetOp::kDatasetType[];
+/* static */ constexpr char SharedCacheDatasetOp::kInputDataset[];
+/* static */ constexpr char SharedCacheDatasetOp::kMaxCacheSizeBytes[];
+/* static */ constexpr char SharedCacheDatasetOp::kOutputTypes[];
+/* static */ constexpr char SharedCacheDatasetOp::kOutputShapes[];
+
+namespace {
+
+using Element = SharedElementCacheRegistry::Element;
+
+// Produces the elements of a shared cache from an iterator of the input
+// dataset. The cache owns the sequence, and every reader of the cache shares
+// the ownership of the cache, so the input iterator lives until the last
+// reader is destroyed, whichever reader created it. Whichever reader extends
+// the cache drives the input iterator.
+//
+// The input iterator must not depend on the pipeline of the reader that
+// created it, so the sequence runs it on its own function library runtime,
+// resource manager and thread pool, and with its own cancellation manager.
+class InputSequence : public SharedElementCacheRegistry::Sequence {
+ public:
+  // Creates an iterator of `input` from the context of a reader.
+  static StatusOr<std::unique_ptr<InputSequence>> Create(
+      IteratorContext* ctx, const DatasetBase* input,
+      const std::string& prefix) {
+    auto sequence = std::make_unique<InputSequence>();
+    IteratorContext::Params params(ctx);
+    if (ctx->flr() != nullptr) {
+      TF_RETURN_IF_ERROR(ctx->flr()->Clone(&sequence->flib_def_,
+                                           &sequence->pflr_, &sequence->flr_,
+                                           /*skip_flib_def=*/true));
+      sequence->function_handle_cache_ =
+          std::make_unique<FunctionHandleCache>(sequence->flr_);
+      params.flr = sequence->flr_;
+      params.function_handle_cache = sequence->function_handle_cache_.get();
+    }
+    params.resource_mgr = &sequence->resource_mgr_;
+    const int num_threads = port::MaxParallelism();
+    sequence->thread_pool_ = std::make_unique<thread::ThreadPool>(
+        Env::Default(), ThreadOptions{}, "data_shared_cache", num_threads);
+    params.runner = [pool = sequence->thread_pool_.get()](
+                        std::function<void()> c) {
+      pool->Schedule(std::move(c));
+    };
+    params.runner_threadpool_size = num_threads;
+    params.thread_pool = nullptr;
+    params.cancellation_manager = &sequence->cancellation_manager_;
+    params.collective_executor = nullptr;
+    // Readers of the cache run the input iterator from their own threads,
+    // which the autotuning model can not attribute to its nodes.
+    params.model = nullptr;
+    sequence->ctx_ = std::make_unique<IteratorContext>(std::move(params));
+    mutex_lock l(sequence->mu_);
+    TF_RETURN_IF_ERROR(input->MakeIterator(sequence->ctx_.get(),
+                                           /*parent=*/nullptr, prefix,
+                                           &sequence->input_impl_));
+    return sequence;
+  }
+
+  // Cancels the input iterator and destroys it, once the last reader is gone.
+  ~InputSequence() override {
+    cancellation_manager_.StartCancel();
+    mutex_lock l(mu_);
+    input_impl_.reset();
+  }
+
+  StatusOr<Element> GetNext() override {
+    mutex_lock l(mu_);
+    Element element;
+    if (!end_of_sequence_) {
+      TF_RETURN_IF_ERROR(
+          input_impl_->GetNext(ctx_.get(), &element, &end_of_sequence_));
+    }
+    if (end_of_sequence_) {
+      return errors::OutOfRange("End of sequence");
+    }
+    return element;
+  }
+
+  size_t GetElementSizeBytes(const Element& element) const override {
+    return SharedElementCacheRegistry::GetElementSizeBytes(element);
+  }
+
+ private:
+  // Resources of the input iterator, which must outlive it.
+  std::unique_ptr<FunctionLibraryDefinition> flib_def_;
+  std::unique_ptr<ProcessFunctionLibraryRuntime> pflr_;
+  FunctionLibraryRuntime* flr_ = nullptr;  // Owned by `pflr_`.
+  std::unique_ptr<FunctionHandleCache> function_handle_cache_;
+  ResourceMgr resource_mgr_;
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+  CancellationManager cancellation_manager_;
+  std::unique_ptr<IteratorContext> ctx_;
+
+  mutex mu_;
+  std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+  bool end_of_sequence_ TF_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace
+
+class SharedCacheDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input,
+          int64_t max_cache_size_bytes, uint64 fingerprint,
+          const DataTypeVector& output_types,
+          const std::vector<PartialTensorShape>& output_shapes)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        max_cache_size_bytes_(max_cache_size_bytes),
+        fingerprint_(fingerprint),
+        output_types_(output_types),
+        output_shapes_(output_shapes) {
+    input_->Ref();
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override { return output_types_; }
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    return name_utils::DatasetDebugString(kDatasetType);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    // Readers that fall behind the window of the cache skip elements.
+    int64_t n = input_->Cardinality(options);
+    return n == kInfiniteCardinality ? n : kUnknownCardinality;
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* max_cache_size_bytes_node = nullptr;
+    TF_RETURN_IF_ERROR(
+        b->AddScalar(max_cache_size_bytes_, &max_cache_size_bytes_node));
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {input_graph_node, max_cache_size_bytes_node}, output));
+    return OkStatus();
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params),
+          trainer_id_(absl::StrCat("iterator_", next_trainer_id_++)) {}
+
+    ~Iterator() override {
+      if (cache_ != nullptr) cache_->RemoveTrainer(trainer_id_);
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      bool created = false;
+      TF_ASSIGN_OR_RETURN(
+          cache_,
+          SharedElementCacheRegistry::Global()->GetOrCreate(
+              dataset()->fingerprint_, dataset()->max_cache_size_bytes_,
+              [&]() -> StatusOr<
+                        std::unique_ptr<SharedElementCacheRegistry::Sequence>> {
+                TF_ASSIGN_OR_RETURN(
+                    std::unique_ptr<InputSequence> result,
+                    InputSequence::Create(ctx, dataset()->input_, prefix()));
+                return std::unique_ptr<SharedElementCacheRegistry::Sequence>(
+                    std::move(result));
+              },
+              &created));
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      StatusOr<std::shared_ptr<const Element>> element =
+          cache_->Get(trainer_id_);
+      if (errors::IsOutOfRange(element.status())) {
+        *end_of_sequence = true;
+        return OkStatus();
+      }
+      TF_RETURN_IF_ERROR(element.status());
+      *out_tensors = **element;
+      *end_of_sequence = false;
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      return errors::Unimplemented(
+          "Checkpointing an iterator of a shared cache is not supported, as "
+          "its position depends on the other readers of the cache.");
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      return errors::Unimplemented(
+          "Checkpointing an iterator of a shared cache is not supported, as "
+          "its position depends on the other readers of the cache.");
+    }
+
+   private:
+    static std::atomic<int64_t> next_trainer_id_;
+
+    // Identifies the iterator among the readers of the cache.
+    const std::string trainer_id_;
+    // Shared with the other readers; the last one destroys the input iterator.
+    std::shared_ptr<SharedElementCacheRegistry::Cache> cache_;
+  };
+
+  const DatasetBase* const input_;
+  const int64_t max_cache_size_bytes_;
+  const uint64 fingerprint_;
+  const DataTypeVector output_types_;
+  const std::vector<PartialTensorShape> output_shapes_;
+};
+
+std::atomic<int64_t> SharedCacheDatasetOp::Dataset::Iterator::next_trainer_id_{
+    0};
+
+SharedCacheDatasetOp::SharedCacheDatasetOp(OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
+}
+
+void SharedCacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                                       DatasetBase** output) {
+  int64_t max_cache_size_bytes = 0;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kMaxCacheSizeBytes,
+                                                   &max_cache_size_bytes));
+  OP_REQUIRES(ctx, max_cache_size_bytes > 0,
+              errors::InvalidArgument(kMaxCacheSizeBytes,
+                                      " must be positive, but got ",
+                                      max_cache_size_bytes, "."));
+
+  // Iterators share the cache of datasets with the same graph. The tensors
+  // the graph captures are hashed by value, so that e.g. datasets of different
+  // in-memory data do not share a cache.
+  GraphDef graph_def;
+  SerializationContext::Params params(ctx);
+  params.external_state_policy = ExternalStatePolicy::POLICY_IGNORE;
+  OP_REQUIRES_OK(ctx,
+                 AsGraphDef(input, SerializationContext(params), &graph_def));
+  uint64 fingerprint;
+  OP_REQUIRES_OK(ctx, HashGraph(graph_def, &fingerprint));
+
+  *output = new Dataset(ctx, input, max_cache_size_bytes, fingerprint,
+                        output_types_, output_shapes_);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(Name("SharedCacheDataset").Device(DEVICE_CPU),
+                        SharedCacheDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
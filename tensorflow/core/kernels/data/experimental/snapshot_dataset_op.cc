@@ -23,6 +23,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/time/clock.h"
+#include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/hash_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/data/snapshot_utils.h"
@@ -65,7 +66,11 @@ namespace experimental {
     SnapshotDatasetV2Op::kReaderFuncTarguments;
 /* static */ constexpr const char* const
     SnapshotDatasetV2Op::kShardFuncTarguments;
+/* static */ constexpr const char* const
+    SnapshotDatasetV2Op::kFileFormatVersionAttr;
 /* static */ constexpr const int SnapshotDatasetV2Op::kFileFormatVersion;
+/* static */ constexpr const int
+    SnapshotDatasetV2Op::kColumnarFileFormatVersion;
 
 // ==== Snapshot Implementation ====
 
@@ -102,6 +107,7 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
   Dataset(OpKernelContext* ctx, const DatasetBase* input, uint64 hash,
           const std::string& path, const std::string& compression,
           const std::string& reader_prefix, const std::string& writer_prefix,
+          int64_t file_format_version,
           std::unique_ptr<CapturedFunction> reader_func,
           std::unique_ptr<CapturedFunction> shard_func)
       : DatasetBase(DatasetContext(ctx)),
@@ -111,6 +117,7 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
         compression_(compression),
         reader_prefix_(reader_prefix),
         writer_prefix_(writer_prefix),
+        file_format_version_(file_format_version),
         reader_func_(std::move(reader_func)),
         shard_func_(std::move(shard_func)) {
     input_->Ref();
@@ -190,6 +197,9 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
     AttrValue hash_attr;
     b->BuildAttrValue(static_cast<int64_t>(hash_), &hash_attr);
 
+    AttrValue file_format_version_attr;
+    b->BuildAttrValue(file_format_version_, &file_format_version_attr);
+
     AttrValue reader_func_attr;
     b->BuildAttrValue(reader_func_->func(), &reader_func_attr);
 
@@ -217,6 +227,7 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
          {kWriterPrefix, writer_prefix_attr},
          {kHashValid, hash_valid_attr},
          {kHash, hash_attr},
+         {kFileFormatVersionAttr, file_format_version_attr},
          {kReaderFunc, reader_func_attr},
          {kShardFunc, shard_func_attr},
          {kReaderFuncTarguments, reader_func_arguments_types_attr},
@@ -231,6 +242,9 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
   const std::string compression_;
   const std::string reader_prefix_;
   const std::string writer_prefix_;
+  // The version of the files this dataset writes. Snapshots are read with the
+  // version recorded in their metadata.
+  const int64_t file_format_version_;
 
   std::unique_ptr<CapturedFunction> reader_func_;
   std::unique_ptr<CapturedFunction> shard_func_;
@@ -416,7 +430,8 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
           auto writer = std::make_unique<snapshot_util::AsyncWriter>(
               ctx->env(), shard_index, snapshot_shard_directory,
               current_checkpoint_id_, dataset()->compression_,
-              kFileFormatVersion, dataset()->output_dtypes(), [this](Status s) {
+              dataset()->file_format_version_, dataset()->output_dtypes(),
+              [this](Status s) {
                 if (!s.ok()) {
                   LOG(ERROR) << "AsyncWriter in snapshot writer failed: " << s;
                   mutex_lock l(writer_status_mu_);
@@ -499,7 +514,7 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
       metadata.set_creation_timestamp(EnvTime::NowMicros());
       metadata.set_graph_hash(strings::StrCat(dataset()->hash_));
       metadata.set_run_id(strings::StrCat(run_id_));
-      metadata.set_version(kFileFormatVersion);
+      metadata.set_version(dataset()->file_format_version_);
       for (const auto& output_dtype : dataset()->output_dtypes()) {
         metadata.add_dtype(output_dtype);
       }
@@ -732,6 +747,19 @@ SnapshotDatasetV2Op::SnapshotDatasetV2Op(OpKernelConstruction* ctx)
   int64_t hash;
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kHash, &hash));
   hash_ = static_cast<uint64>(hash);
+  file_format_version_ = 0;
+  if (ctx->HasAttr(kFileFormatVersionAttr)) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr(kFileFormatVersionAttr, &file_format_version_));
+  }
+  OP_REQUIRES(ctx,
+              file_format_version_ == 0 ||
+                  file_format_version_ == kFileFormatVersion ||
+                  file_format_version_ == kColumnarFileFormatVersion,
+              errors::InvalidArgument(
+                  "Snapshots can only be written with file format version ",
+                  kFileFormatVersion, " or ", kColumnarFileFormatVersion,
+                  ", got ", file_format_version_, "."));
 
   OP_REQUIRES_OK(ctx, FunctionMetadata::Create(ctx, kReaderFunc, reader_params,
                                                &reader_func_metadata_));
@@ -747,6 +775,21 @@ void SnapshotDatasetV2Op::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   std::string compression = compression_ == kCompressionAuto
                                 ? io::compression::kSnappy
                                 : compression_;
+  int64_t file_format_version = file_format_version_;
+  if (file_format_version == 0) {
+    // The columnar format does not support gzip.
+    file_format_version =
+        GetExperiments().contains("snapshot_columnar_format") &&
+                compression != io::compression::kGzip
+            ? kColumnarFileFormatVersion
+            : kFileFormatVersion;
+  }
+  OP_REQUIRES(ctx,
+              file_format_version != kColumnarFileFormatVersion ||
+                  compression != io::compression::kGzip,
+              errors::InvalidArgument("Snapshot file format version ",
+                                      kColumnarFileFormatVersion,
+                                      " does not support GZIP compression."));
   uint64 hash;
   if (hash_valid_) {
     hash = hash_;
@@ -775,7 +818,7 @@ void SnapshotDatasetV2Op::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
 
   *output = new SnapshotDatasetV2Op::Dataset(
       ctx, input, hash, path, compression, reader_prefix_, writer_prefix_,
-      std::move(reader_func), std::move(shard_func));
+      file_format_version, std::move(reader_func), std::move(shard_func));
 }
 
 namespace {
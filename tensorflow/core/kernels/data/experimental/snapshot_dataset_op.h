@@ -60,6 +60,8 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
   static constexpr const char* const kReaderFuncTarguments =
       "Treader_func_args";
   static constexpr const char* const kShardFuncTarguments = "Tshard_func_args";
+  static constexpr const char* const kFileFormatVersionAttr =
+      "file_format_version";
   // Note: If a new constant is declared here, it *must* be defined in
   // snapshot_dataset_op.cc, otherwise it will not compile in debug mode.
 
@@ -70,7 +72,10 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
                    DatasetBase** output) override;
 
  private:
+  // The file format of new snapshots, unless the `file_format_version` attr or
+  // the "snapshot_columnar_format" experiment selects the columnar format.
   static constexpr const int kFileFormatVersion = 2;
+  static constexpr const int kColumnarFileFormatVersion = 3;
 
   class Dataset;
 
@@ -83,6 +88,8 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
   std::string writer_prefix_;
   bool hash_valid_;
   uint64 hash_;
+  // 0 if the default version should be used.
+  int64_t file_format_version_;
 
   std::shared_ptr<FunctionMetadata> reader_func_metadata_;
   std::shared_ptr<FunctionMetadata> shard_func_metadata_;
@@ -11,7 +11,13 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/flat_map_dataset_op.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/framework/element_tracing.h"
 
 namespace tensorflow {
 namespace data {
@@ -212,6 +218,41 @@ IteratorSaveAndRestoreTestCases() {
 ITERATOR_SAVE_AND_RESTORE_TEST_P(FlatMapDatasetOpTest, FlatMapDatasetParams,
                                  IteratorSaveAndRestoreTestCases())
 
+TEST_F(FlatMapDatasetOpTest, ElementTracing) {
+  auto dataset_params = FlatMapDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  auto tracer = std::make_shared<ElementTracer>(/*sampling_period=*/1,
+                                                /*summary_period_nanos=*/0);
+  IteratorContext::Params params(iterator_ctx_.get());
+  params.element_tracer = tracer;
+  IteratorContext ctx(std::move(params));
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(
+      &ctx, /*parent=*/nullptr, dataset_params.iterator_prefix(), &iterator));
+  tracer->SetConsumerPrefix(iterator->prefix());
+
+  // The calls that exhaust an element's iterator destroy it after its span
+  // was traced.
+  int num_elements = 0;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(iterator->GetNext(&ctx, &out_tensors, &end_of_sequence));
+    if (!end_of_sequence) ++num_elements;
+  }
+  EXPECT_EQ(num_elements, 9);
+  std::vector<std::string> prefixes;
+  for (const auto& stage : tracer->GetSummary().consumer_stages) {
+    prefixes.push_back(stage.prefix);
+  }
+  const std::string& prefix = iterator->prefix();
+  EXPECT_THAT(prefixes, ::testing::UnorderedElementsAre(
+                            prefix, absl::StrCat(prefix, "::TensorSlice"),
+                            absl::StrCat(prefix, "[0]::TensorSlice"),
+                            absl::StrCat(prefix, "[1]::TensorSlice"),
+                            absl::StrCat(prefix, "[2]::TensorSlice")));
+}
+
 TEST_F(FlatMapDatasetOpTest, InvalidMapFunc) {
   auto dataset_params = InvalidFlatMapDatasetParams();
   TF_ASSERT_OK(Initialize(dataset_params));
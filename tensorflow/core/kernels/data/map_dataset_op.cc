@@ -96,12 +96,19 @@ class MapDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
     std::vector<Tensor> args;
     TF_RETURN_IF_ERROR(input_->Get(ctx, index, &args));
-    if (!instantiated_captured_func_) {
-      TF_RETURN_IF_ERROR(
-          captured_func_->Instantiate(InstantiateCapturedFunctionParams(ctx),
-                                      &instantiated_captured_func_));
+    InstantiatedCapturedFunction* instantiated_captured_func;
+    {
+      // Get() may be called concurrently, so the function is instantiated
+      // by the first call only, and never replaced afterwards.
+      mutex_lock l(instantiated_captured_func_mu_);
+      if (!instantiated_captured_func_) {
+        TF_RETURN_IF_ERROR(
+            captured_func_->Instantiate(InstantiateCapturedFunctionParams(ctx),
+                                        &instantiated_captured_func_));
+      }
+      instantiated_captured_func = instantiated_captured_func_.get();
     }
-    return instantiated_captured_func_->RunInstantiated(args, out_tensors);
+    return instantiated_captured_func->RunInstantiated(args, out_tensors);
   }
 
  protected:
@@ -224,8 +231,10 @@ class MapDatasetOp::Dataset : public DatasetBase {
   const DataTypeVector output_types_;
   const std::vector<PartialTensorShape> output_shapes_;
   // This is used for random access provided by Get().
+  mutable mutex instantiated_captured_func_mu_;
   mutable std::unique_ptr<InstantiatedCapturedFunction>
-      instantiated_captured_func_;
+      instantiated_captured_func_
+          TF_GUARDED_BY(instantiated_captured_func_mu_);
 };
 
 MapDatasetOp::MapDatasetOp(OpKernelConstruction* ctx)
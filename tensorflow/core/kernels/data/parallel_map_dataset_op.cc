@@ -142,12 +142,19 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
     std::vector<Tensor> args;
     TF_RETURN_IF_ERROR(input_->Get(ctx, index, &args));
-    if (!instantiated_captured_func_) {
-      TF_RETURN_IF_ERROR(
-          captured_func_->Instantiate(InstantiateCapturedFunctionParams(ctx),
-                                      &instantiated_captured_func_));
+    InstantiatedCapturedFunction* instantiated_captured_func;
+    {
+      // Get() may be called concurrently, so the function is instantiated
+      // by the first call only, and never replaced afterwards.
+      mutex_lock l(instantiated_captured_func_mu_);
+      if (!instantiated_captured_func_) {
+        TF_RETURN_IF_ERROR(
+            captured_func_->Instantiate(InstantiateCapturedFunctionParams(ctx),
+                                        &instantiated_captured_func_));
+      }
+      instantiated_captured_func = instantiated_captured_func_.get();
     }
-    return instantiated_captured_func_->RunInstantiated(args, out_tensors);
+    return instantiated_captured_func->RunInstantiated(args, out_tensors);
   }
 
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
@@ -738,8 +745,10 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
   const std::unique_ptr<CapturedFunction> captured_func_;
   const int op_version_;
   // This is used for random access provided by Get().
+  mutable mutex instantiated_captured_func_mu_;
   mutable std::unique_ptr<InstantiatedCapturedFunction>
-      instantiated_captured_func_;
+      instantiated_captured_func_
+          TF_GUARDED_BY(instantiated_captured_func_mu_);
 };
 
 ParallelMapDatasetOp::ParallelMapDatasetOp(OpKernelConstruction* ctx)
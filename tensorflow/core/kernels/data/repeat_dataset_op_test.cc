@@ -14,12 +14,18 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/repeat_dataset_op.h"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/element_tracing.h"
 
 namespace tensorflow {
 namespace data {
@@ -279,6 +285,38 @@ IteratorPrefixTestCases() {
 ITERATOR_PREFIX_TEST_P(RepeatDatasetOpTest, RepeatDatasetParams,
                        IteratorPrefixTestCases())
 
+TEST_F(RepeatDatasetOpTest, ElementTracing) {
+  auto dataset_params = FiniteRepeatDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  auto tracer = std::make_shared<ElementTracer>(/*sampling_period=*/1,
+                                                /*summary_period_nanos=*/0);
+  IteratorContext::Params params(iterator_ctx_.get());
+  params.element_tracer = tracer;
+  IteratorContext ctx(std::move(params));
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(
+      &ctx, /*parent=*/nullptr, dataset_params.iterator_prefix(), &iterator));
+  tracer->SetConsumerPrefix(iterator->prefix());
+
+  // The call that exhausts the first repetition destroys the input iterator
+  // whose span it traced.
+  int num_elements = 0;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(iterator->GetNext(&ctx, &out_tensors, &end_of_sequence));
+    if (!end_of_sequence) ++num_elements;
+  }
+  EXPECT_EQ(num_elements, 4);
+  ElementTracer::Summary summary = tracer->GetSummary();
+  ASSERT_EQ(summary.consumer_stages.size(), 2);
+  std::vector<std::string> prefixes = {summary.consumer_stages[0].prefix,
+                                       summary.consumer_stages[1].prefix};
+  std::sort(prefixes.begin(), prefixes.end());
+  EXPECT_EQ(prefixes[0], iterator->prefix());
+  EXPECT_EQ(prefixes[1], absl::StrCat(iterator->prefix(), "::TensorSlice"));
+}
+
 std::vector<IteratorSaveAndRestoreTestCase<RepeatDatasetParams>>
 IteratorSaveAndRestoreTestCases() {
   return {{/*dataset_params=*/FiniteRepeatDatasetParams(),
@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <algorithm>
+
+#include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -43,6 +46,15 @@ constexpr char kGcsFsPrefix[] = "gs://";
 constexpr char kS3FsPrefix[] = "s3://";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
+// With the `tfrecord_read_ahead` experiment, files are read in blocks of
+// `buffer_size` bytes (or the default block size if it is 0), reading ahead
+// between `kMinReadAheadBlocks` and `kMaxReadAheadBlocks` blocks.  Blocks are
+// capped at `kReadAheadBytes / kMinReadAheadBlocks`, so that at most
+// `kReadAheadBytes` are buffered per file.
+constexpr int64_t kDefaultReadAheadBlockSize = 1LL << 20;  // 1MB.
+constexpr int64_t kReadAheadBytes = 64LL << 20;            // 64MB.
+constexpr int64_t kMinReadAheadBlocks = 2;
+constexpr int64_t kMaxReadAheadBlocks = 8;
 
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
@@ -64,6 +76,14 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    if (GetExperiments().contains("tfrecord_read_ahead")) {
+      options_.read_ahead_block_size = std::min(
+          buffer_size > 0 ? buffer_size : kDefaultReadAheadBlockSize,
+          kReadAheadBytes / kMinReadAheadBlocks);
+      options_.read_ahead_num_blocks = std::clamp(
+          kReadAheadBytes / options_.read_ahead_block_size,
+          kMinReadAheadBlocks, kMaxReadAheadBlocks);
+    }
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -0,0 +1,205 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/op_requires.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+// Computes, for each segment `s`,
+//
+//   output[s] = sum(weights[i] * data[indices[i]]) / norm(s)
+//
+// over the `i` such that `segment_ids[i] == s`, where `norm(s)` is 1 for the
+// "sum" combiner, the sum of the weights for "mean" and the square root of the
+// sum of their squares for "sqrtn". Without weights, they are all 1, which
+// makes this op equivalent to SparseSegment{Sum,Mean,SqrtN}.
+//
+// Each row of `data` is read once per index and accumulated in float into the
+// output segment, so unlike GatherV2 followed by SegmentSum, the op does not
+// materialize a [num_indices, ...] tensor. Segments are reduced in parallel.
+template <typename T, typename Index, typename SegmentId>
+class FusedSparseSegmentReduceOp : public OpKernel {
+ public:
+  explicit FusedSparseSegmentReduceOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    int num_weights;
+    OP_REQUIRES_OK(context, context->GetAttr("num_weights", &num_weights));
+    OP_REQUIRES(context, num_weights <= 1,
+                errors::InvalidArgument(
+                    "_FusedSparseSegmentReduce takes at most one weights "
+                    "tensor, got ",
+                    num_weights));
+    has_weights_ = num_weights == 1;
+    std::string combiner;
+    OP_REQUIRES_OK(context, context->GetAttr("combiner", &combiner));
+    is_mean_ = combiner == "mean";
+    is_sqrtn_ = combiner == "sqrtn";
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& data = context->input(0);
+    const Tensor& indices = context->input(1);
+    const Tensor& segment_ids = context->input(2);
+
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(data.shape()),
+                errors::InvalidArgument("data must be at least rank 1, got ",
+                                        data.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(indices.shape()),
+                errors::InvalidArgument("indices should be a vector, got ",
+                                        indices.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(segment_ids.shape()),
+                errors::InvalidArgument("segment_ids should be a vector, got ",
+                                        segment_ids.shape().DebugString()));
+    const int64_t num_indices = indices.NumElements();
+    OP_REQUIRES(context, num_indices == segment_ids.NumElements(),
+                errors::InvalidArgument(
+                    "segment_ids and indices should have same size, got ",
+                    segment_ids.NumElements(), " and ", num_indices));
+    const T* weights = nullptr;
+    if (has_weights_) {
+      const Tensor& weights_tensor = context->input(3);
+      OP_REQUIRES(
+          context,
+          TensorShapeUtils::IsVector(weights_tensor.shape()) &&
+              weights_tensor.NumElements() == num_indices,
+          errors::InvalidArgument("weights should be a vector of size ",
+                                  num_indices, ", got shape ",
+                                  weights_tensor.shape().DebugString()));
+      weights = weights_tensor.flat<T>().data();
+    }
+
+    const auto data_flat = data.flat_outer_dims<T>();
+    const int64_t num_rows = data_flat.dimension(0);
+    const int64_t num_col = data_flat.dimension(1);
+    const auto indices_vec = indices.vec<Index>();
+    const auto segment_vec = segment_ids.vec<SegmentId>();
+
+    // Validates copies of the inputs up front, so that segments can be
+    // reduced in parallel without error handling, and without rereading
+    // inputs that may change concurrently.
+    std::vector<Index> row_indices(num_indices);
+    std::vector<SegmentId> segment_ids_copy(num_indices);
+    SegmentId previous_segment_id = 0;
+    for (int64_t i = 0; i < num_indices; ++i) {
+      const SegmentId segment_id = internal::SubtleMustCopy(segment_vec(i));
+      OP_REQUIRES(context, segment_id >= previous_segment_id,
+                  errors::InvalidArgument(
+                      segment_id < 0 ? "segment ids must be >= 0"
+                                     : "segment ids are not increasing"));
+      previous_segment_id = segment_id;
+      segment_ids_copy[i] = segment_id;
+      const Index index = internal::SubtleMustCopy(indices_vec(i));
+      OP_REQUIRES(context, FastBoundsCheck(index, num_rows),
+                  errors::InvalidArgument("Bad: indices[", i, "] == ", index,
+                                          " out of range [0, ", num_rows,
+                                          ")"));
+      row_indices[i] = index;
+    }
+    const int64_t output_rows =
+        num_indices > 0 ? static_cast<int64_t>(previous_segment_id) + 1 : 0;
+
+    TensorShape output_shape = data.shape();
+    OP_REQUIRES_OK(context, output_shape.SetDimWithStatus(0, output_rows));
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+    if (output_rows == 0 || num_col == 0) return;
+    auto output_flat = output->flat_outer_dims<T>();
+
+    using Row = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>;
+    using OutputRow = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>;
+    auto reduce_segments = [&](int64_t begin, int64_t end) {
+      Eigen::ArrayXf sum(num_col);
+      int64_t i = std::lower_bound(segment_ids_copy.begin(),
+                                   segment_ids_copy.end(),
+                                   static_cast<SegmentId>(begin)) -
+                  segment_ids_copy.begin();
+      for (int64_t segment = begin; segment < end; ++segment) {
+        sum.setZero();
+        float weight_sum = 0;
+        for (; i < num_indices && segment_ids_copy[i] == segment; ++i) {
+          const Row row(&data_flat(row_indices[i], 0), num_col);
+          if (weights != nullptr) {
+            const float weight = static_cast<float>(weights[i]);
+            sum += weight * row.template cast<float>();
+            weight_sum += is_sqrtn_ ? weight * weight : weight;
+          } else {
+            sum += row.template cast<float>();
+            weight_sum += 1;
+          }
+        }
+        if (is_mean_ || is_sqrtn_) {
+          // Segments whose weights sum to 0 are 0, as with div_no_nan.
+          const float norm = is_sqrtn_ ? std::sqrt(weight_sum) : weight_sum;
+          if (norm != 0) {
+            sum /= norm;
+          } else {
+            sum.setZero();
+          }
+        }
+        OutputRow(&output_flat(segment, 0), num_col) =
+            sum.template cast<T>();
+      }
+    };
+    const int64_t cost_per_segment =
+        (num_indices / output_rows + 1) * num_col * 2;
+    const auto& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers, output_rows,
+          cost_per_segment, reduce_segments);
+  }
+
+ private:
+  bool has_weights_;
+  bool is_mean_;
+  bool is_sqrtn_;
+};
+
+#define REGISTER_KERNEL(type, index_type, segment_ids_type)            \
+  REGISTER_KERNEL_BUILDER(                                             \
+      Name("_FusedSparseSegmentReduce")                                \
+          .Device(DEVICE_CPU)                                          \
+          .TypeConstraint<type>("T")                                   \
+          .TypeConstraint<index_type>("Tidx")                          \
+          .TypeConstraint<segment_ids_type>("Tsegmentids"),            \
+      FusedSparseSegmentReduceOp<type, index_type, segment_ids_type>);
+
+#define REGISTER_KERNELS_FOR_EACH_INDEX_TYPE(type) \
+  REGISTER_KERNEL(type, int32, int32)              \
+  REGISTER_KERNEL(type, int32, int64_t)            \
+  REGISTER_KERNEL(type, int64_t, int32)            \
+  REGISTER_KERNEL(type, int64_t, int64_t)
+
+TF_CALL_float(REGISTER_KERNELS_FOR_EACH_INDEX_TYPE);
+TF_CALL_bfloat16(REGISTER_KERNELS_FOR_EACH_INDEX_TYPE);
+
+#undef REGISTER_KERNELS_FOR_EACH_INDEX_TYPE
+#undef REGISTER_KERNEL
+
+}  // namespace tensorflow
@@ -0,0 +1,237 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedSparseSegmentReduceOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType data_type, int num_weights, const string& combiner) {
+    TF_ASSERT_OK(NodeDefBuilder("myop", "_FusedSparseSegmentReduce")
+                     .Input(FakeInput(data_type))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_INT64))
+                     .Input(FakeInput(num_weights, data_type))
+                     .Attr("combiner", combiner)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Adds a [4, 2] table, 5 indices into 4 segments, the third of them empty,
+  // and their weights if `weighted`.
+  void AddInputs(bool weighted) {
+    AddInputFromArray<float>(TensorShape({4, 2}), {0, 1, 2, 3, 4, 5, 6, 7});
+    AddInputFromArray<int32>(TensorShape({5}), {3, 1, 3, 0, 2});
+    AddInputFromArray<int64_t>(TensorShape({5}), {0, 0, 1, 3, 3});
+    if (weighted) {
+      AddInputFromArray<float>(TensorShape({5}), {1, 2, 0.5, 3, -3});
+    }
+  }
+};
+
+TEST_F(FusedSparseSegmentReduceOpTest, Sum) {
+  MakeOp(DT_FLOAT, /*num_weights=*/0, "sum");
+  AddInputs(/*weighted=*/false);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({4, 2}));
+  test::FillValues<float>(&expected, {8, 10, 6, 7, 0, 0, 4, 6});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, WeightedSum) {
+  MakeOp(DT_FLOAT, /*num_weights=*/1, "sum");
+  AddInputs(/*weighted=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({4, 2}));
+  test::FillValues<float>(&expected, {10, 13, 3, 3.5, 0, 0, -12, -12});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, WeightedMean) {
+  MakeOp(DT_FLOAT, /*num_weights=*/1, "mean");
+  AddInputs(/*weighted=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+
+  // The weights of the last segment sum to 0.
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({4, 2}));
+  test::FillValues<float>(&expected, {10.0 / 3, 13.0 / 3, 6, 7, 0, 0, 0, 0});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, WeightedSqrtN) {
+  MakeOp(DT_FLOAT, /*num_weights=*/1, "sqrtn");
+  AddInputs(/*weighted=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+
+  const float norm0 = std::sqrt(5.0f);
+  const float norm3 = std::sqrt(18.0f);
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({4, 2}));
+  test::FillValues<float>(&expected, {10 / norm0, 13 / norm0, 6, 7, 0, 0,
+                                      -12 / norm3, -12 / norm3});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, Mean) {
+  MakeOp(DT_FLOAT, /*num_weights=*/0, "mean");
+  AddInputs(/*weighted=*/false);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({4, 2}));
+  test::FillValues<float>(&expected, {4, 5, 6, 7, 0, 0, 2, 3});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, Bfloat16) {
+  MakeOp(DT_BFLOAT16, /*num_weights=*/1, "sum");
+  AddInputFromArray<bfloat16>(TensorShape({2, 2}),
+                              {bfloat16(1), bfloat16(2), bfloat16(3),
+                               bfloat16(4)});
+  AddInputFromArray<int32>(TensorShape({3}), {0, 1, 1});
+  AddInputFromArray<int64_t>(TensorShape({3}), {0, 0, 1});
+  AddInputFromArray<bfloat16>(TensorShape({3}),
+                              {bfloat16(2), bfloat16(0.5), bfloat16(1)});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_BFLOAT16, TensorShape({2, 2}));
+  test::FillValues<bfloat16>(
+      &expected, {bfloat16(3.5), bfloat16(6), bfloat16(3), bfloat16(4)});
+  test::ExpectTensorEqual<bfloat16>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, Empty) {
+  MakeOp(DT_FLOAT, /*num_weights=*/0, "sum");
+  AddInputFromArray<float>(TensorShape({2, 3}), {0, 1, 2, 3, 4, 5});
+  AddInputFromArray<int32>(TensorShape({0}), {});
+  AddInputFromArray<int64_t>(TensorShape({0}), {});
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_EQ(GetOutput(0)->shape(), TensorShape({0, 3}));
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, IndexOutOfRange) {
+  MakeOp(DT_FLOAT, /*num_weights=*/0, "sum");
+  AddInputFromArray<float>(TensorShape({2, 1}), {0, 1});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 2});
+  AddInputFromArray<int64_t>(TensorShape({2}), {0, 0});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "out of range"));
+}
+
+TEST_F(FusedSparseSegmentReduceOpTest, UnsortedSegments) {
+  MakeOp(DT_FLOAT, /*num_weights=*/0, "sum");
+  AddInputFromArray<float>(TensorShape({2, 1}), {0, 1});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 1});
+  AddInputFromArray<int64_t>(TensorShape({2}), {1, 0});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "not increasing"));
+}
+
+// A weighted sparse embedding lookup as in recommendation models: a batch of
+// `batch_size` examples with `ids_per_example` ids each, looked up in a table
+// of 100k rows of `dim` floats. Compares the fused kernel with the GatherV2,
+// Mul and SegmentSum it replaces. "temp_bytes" reports the size of the
+// [num_ids, dim] intermediate tensors of the unfused graph, which the fused
+// kernel does not allocate.
+void BM_EmbeddingLookupSparse(::testing::benchmark::State& state) {
+  const bool fused = state.range(0);
+  const int batch_size = state.range(1);
+  const int dim = state.range(2);
+  constexpr int kVocabularySize = 100000;
+  constexpr int kIdsPerExample = 20;
+  const int num_ids = batch_size * kIdsPerExample;
+
+  Tensor params(DT_FLOAT, TensorShape({kVocabularySize, dim}));
+  params.flat<float>().setRandom();
+  Tensor indices(DT_INT32, TensorShape({num_ids}));
+  Tensor segment_ids(DT_INT32, TensorShape({num_ids}));
+  for (int i = 0; i < num_ids; ++i) {
+    indices.flat<int32>()(i) = (i * 7919) % kVocabularySize;
+    segment_ids.flat<int32>()(i) = i / kIdsPerExample;
+  }
+  Tensor weights(DT_FLOAT, TensorShape({num_ids}));
+  weights.flat<float>().setRandom();
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* params_node = test::graph::Constant(g, params);
+  Node* indices_node = test::graph::Constant(g, indices);
+  Node* segment_ids_node = test::graph::Constant(g, segment_ids);
+  Node* node;
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_FusedSparseSegmentReduce")
+                    .Input(params_node)
+                    .Input(indices_node)
+                    .Input(segment_ids_node)
+                    .Input({NodeBuilder::NodeOut(
+                        test::graph::Constant(g, weights))})
+                    .Attr("combiner", "sum")
+                    .Finalize(g, &node));
+  } else {
+    Tensor axis(DT_INT32, TensorShape({}));
+    axis.scalar<int32>()() = 0;
+    Tensor column_weights(DT_FLOAT, TensorShape({num_ids, 1}));
+    column_weights.flat<float>() = weights.flat<float>();
+    Node* gather;
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "GatherV2")
+                    .Input(params_node)
+                    .Input(indices_node)
+                    .Input(test::graph::Constant(g, axis))
+                    .Finalize(g, &gather));
+    Node* mul = test::graph::Multi(
+        g, "Mul", {gather, test::graph::Constant(g, column_weights)});
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "SegmentSum")
+                    .Input(mul)
+                    .Input(segment_ids_node)
+                    .Finalize(g, &node));
+  }
+
+  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * num_ids);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * num_ids *
+                          dim * sizeof(float));
+  state.counters["temp_bytes"] =
+      fused ? 0 : 2.0 * num_ids * dim * sizeof(float);
+}
+
+BENCHMARK(BM_EmbeddingLookupSparse)
+    ->UseRealTime()
+    ->Args({0, 256, 64})
+    ->Args({1, 256, 64})
+    ->Args({0, 4096, 64})
+    ->Args({1, 4096, 64})
+    ->Args({0, 4096, 256})
+    ->Args({1, 4096, 256});
+
+}  // namespace
+}  // namespace tensorflow
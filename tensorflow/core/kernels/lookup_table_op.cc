@@ -16,14 +16,19 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
+#include "tensorflow/core/kernels/striped_hash_map.h"
+#include "tensorflow/core/kernels/tiered_row_store.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/random.h"
@@ -408,6 +413,469 @@ class MutableHashTableOfTensors final : public LookupInterface {
   std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
 };
 
+// Lookup table of scalar values that behaves like MutableHashTableOfScalars,
+// but is partitioned into `num_shards` independently locked shards by
+// StripedHashMap. Inserting keys only blocks lookups of keys in the same
+// shard, and only for the insert of a single key, so that lookups from serving
+// threads do not wait for whole batches of inserts from training threads.
+//
+// Export and import lock all the shards, and so see a consistent table.
+// MutableStripedHashTableOfTensors below is the variant for vector values.
+template <class K, class V>
+class MutableStripedHashTable final : public LookupInterface {
+ public:
+  MutableStripedHashTable(OpKernelContext* ctx, OpKernel* kernel) {
+    int64_t num_shards;
+    OP_REQUIRES_OK(ctx, GetNodeAttr(kernel->def(), "num_shards", &num_shards));
+    table_ = std::make_unique<StripedHashMap<K, V>>(num_shards);
+  }
+
+  size_t size() const override { return table_->size(); }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+    const auto default_flat = default_value.flat<V>();
+
+    int64_t total = value_values.size();
+    int64_t default_total = default_flat.size();
+    bool is_full_size_default = (total == default_total);
+
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      if (!table_->Find(SubtleMustCopyIfIntegral(key_values(i)),
+                        &value_values(i))) {
+        value_values(i) =
+            is_full_size_default ? default_flat(i) : default_flat(0);
+      }
+    }
+    return OkStatus();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      table_->InsertOrUpdate(SubtleMustCopyIfIntegral(key_values(i)),
+                             SubtleMustCopyIfIntegral(value_values(i)));
+    }
+    return OkStatus();
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      table_->Erase(SubtleMustCopyIfIntegral(key_values(i)));
+    }
+    return OkStatus();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+    table_->Assign(absl::MakeConstSpan(key_values.data(), key_values.size()),
+                   absl::MakeConstSpan(value_values.data(),
+                                       value_values.size()));
+    return OkStatus();
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    auto snapshot = table_->GetSnapshot();
+    int64_t size = snapshot.size();
+
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("values", TensorShape({size}), &values));
+    ExportKeysAndValues(snapshot, keys, values);
+    return OkStatus();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  int64_t MemoryUsed() const override {
+    return sizeof(MutableStripedHashTable) + table_->MemoryUsed();
+  }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    auto snapshot = table_->GetSnapshot();
+    int64_t size = snapshot.size();
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), TensorShape({size}));
+    ExportKeysAndValues(snapshot, &keys, &values);
+
+    // We set use_node_name_sharing with a unique node name so that the resource
+    // can outlive the MutableStripedHashTable kernel. This means that the
+    // lifetime of the resource will be tied to the lifetime of the resource
+    // manager it is created in.
+    Node* table = ops::SourceOp(
+        "MutableStripedHashTable",
+        builder->opts()
+            .WithName(UniqueNodeName("MutableStripedHashTableFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("num_shards",
+                      static_cast<int64_t>(table_->num_shards())));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return OkStatus();
+  }
+
+ private:
+  // Writes all keys and values of `snapshot` into `keys` and `values`, which
+  // must point to tensors of size `snapshot.size()`.
+  static void ExportKeysAndValues(
+      const typename StripedHashMap<K, V>::Snapshot& snapshot, Tensor* keys,
+      Tensor* values) {
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->flat<V>();
+    int64_t i = 0;
+    snapshot.ForEach([&](const K& key, const V& value) {
+      keys_data(i) = key;
+      values_data(i) = value;
+      ++i;
+    });
+  }
+
+  std::unique_ptr<StripedHashMap<K, V>> table_;
+};
+
+// Lookup table that behaves like MutableStripedHashTable, except that each
+// value must be a vector, as in MutableHashTableOfTensors.
+template <class K, class V>
+class MutableStripedHashTableOfTensors final : public LookupInterface {
+ public:
+  MutableStripedHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel) {
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(value_shape_),
+        errors::InvalidArgument("Default value must be a vector, got shape ",
+                                value_shape_.DebugString()));
+    int64_t num_shards;
+    OP_REQUIRES_OK(ctx, GetNodeAttr(kernel->def(), "num_shards", &num_shards));
+    table_ = std::make_unique<StripedHashMap<K, ValueArray>>(num_shards);
+  }
+
+  size_t size() const override { return table_->size(); }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto default_flat = default_value.flat_inner_dims<V, 2>();
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat_inner_dims<V, 2>();
+    const int64_t value_dim = value_shape_.dim_size(0);
+
+    int64_t total = value_values.size();
+    int64_t default_total = default_flat.size();
+    bool is_full_size_default = (total == default_total);
+
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      const bool found = table_->FindWith(
+          SubtleMustCopyIfIntegral(key_values(i)),
+          [&](const ValueArray& value_vec) {
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(i, j) = value_vec[j];
+            }
+          });
+      if (!found) {
+        for (int64_t j = 0; j < value_dim; j++) {
+          value_values(i, j) =
+              is_full_size_default ? default_flat(i, j) : default_flat(0, j);
+        }
+      }
+    }
+    return OkStatus();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat_inner_dims<V, 2>();
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      table_->InsertOrUpdate(SubtleMustCopyIfIntegral(key_values(i)),
+                             ToValueArray(value_values, i));
+    }
+    return OkStatus();
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      table_->Erase(SubtleMustCopyIfIntegral(key_values(i)));
+    }
+    return OkStatus();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat_inner_dims<V, 2>();
+    std::vector<ValueArray> value_vecs;
+    value_vecs.reserve(key_values.size());
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      value_vecs.push_back(ToValueArray(value_values, i));
+    }
+    table_->Assign(absl::MakeConstSpan(key_values.data(), key_values.size()),
+                   value_vecs);
+    return OkStatus();
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    auto snapshot = table_->GetSnapshot();
+    int64_t size = snapshot.size();
+    int64_t value_dim = value_shape_.dim_size(0);
+
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(ctx->allocate_output(
+        "values", TensorShape({size, value_dim}), &values));
+    ExportKeysAndValues(snapshot, keys, values);
+    return OkStatus();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return value_shape_; }
+
+  int64_t MemoryUsed() const override {
+    return sizeof(MutableStripedHashTableOfTensors) + table_->MemoryUsed();
+  }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    auto snapshot = table_->GetSnapshot();
+    int64_t size = snapshot.size();
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
+    ExportKeysAndValues(snapshot, &keys, &values);
+
+    // We set use_node_name_sharing with a unique node name so that the resource
+    // can outlive the MutableStripedHashTableOfTensors kernel. This means that
+    // the lifetime of the resource will be tied to the lifetime of the
+    // resource manager it is created in.
+    Node* table = ops::SourceOp(
+        "MutableStripedHashTableOfTensors",
+        builder->opts()
+            .WithName(
+                UniqueNodeName("MutableStripedHashTableOfTensorsFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("value_shape", value_shape_)
+            .WithAttr("num_shards",
+                      static_cast<int64_t>(table_->num_shards())));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return OkStatus();
+  }
+
+ private:
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+
+  static ValueArray ToValueArray(
+      const typename TTypes<V, 2>::ConstTensor& values, int64_t row) {
+    ValueArray value_vec;
+    value_vec.reserve(values.dimension(1));
+    for (int64_t j = 0; j < values.dimension(1); j++) {
+      value_vec.push_back(SubtleMustCopyIfIntegral(values(row, j)));
+    }
+    return value_vec;
+  }
+
+  // Writes all keys and values of `snapshot` into `keys` and `values`, which
+  // must point to tensors of `snapshot.size()` rows.
+  static void ExportKeysAndValues(
+      const typename StripedHashMap<K, ValueArray>::Snapshot& snapshot,
+      Tensor* keys, Tensor* values) {
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->matrix<V>();
+    int64_t i = 0;
+    snapshot.ForEach([&](const K& key, const ValueArray& value) {
+      keys_data(i) = key;
+      for (int64_t j = 0; j < values_data.dimension(1); j++) {
+        values_data(i, j) = value[j];
+      }
+      ++i;
+    });
+  }
+
+  TensorShape value_shape_;
+  std::unique_ptr<StripedHashMap<K, ValueArray>> table_;
+};
+
+// Lookup table of vector values, e.g. embeddings, too large to fit in memory.
+// TieredRowStore keeps the rows of the most used keys in memory, up to
+// `cache_capacity` of them, and the others in a file at `storage_path`, which
+// must be on a local disk and must not be shared with other tables.
+//
+// The rows missing from memory in a lookup are read in parallel on the CPU
+// worker threads of the device. The hit rate and the duration of the lookups
+// are exported to /tensorflow/core/tiered_lookup_table/.
+template <class K, class V>
+class TieredHashTableOfTensors final : public LookupInterface {
+ public:
+  TieredHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel)
+      : env_(ctx->env()) {
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(value_shape_),
+        errors::InvalidArgument("Default value must be a vector, got shape ",
+                                value_shape_.DebugString()));
+    TieredRowStore::Options options;
+    OP_REQUIRES_OK(
+        ctx, GetNodeAttr(kernel->def(), "storage_path", &options.path));
+    if (options.path.empty()) {
+      OP_REQUIRES(ctx, env_->LocalTempFilename(&options.path),
+                  errors::Internal("Failed to create a temporary file name "
+                                   "for the storage of the table."));
+    }
+    OP_REQUIRES_OK(ctx, GetNodeAttr(kernel->def(), "cache_capacity",
+                                    &options.cache_capacity));
+    options.row_bytes = value_shape_.dim_size(0) * sizeof(V);
+    OP_REQUIRES(ctx, options.row_bytes > 0,
+                errors::InvalidArgument("Values must not be empty."));
+    OP_REQUIRES_OK(ctx, TieredRowStore::Create(env_, options, &store_));
+  }
+
+  size_t size() const override { return store_->size(); }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const uint64 start_us = env_->NowMicros();
+    const auto default_flat = default_value.flat_inner_dims<V, 2>();
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat_inner_dims<V, 2>();
+    const int64_t value_dim = value_shape_.dim_size(0);
+    const bool is_full_size_default =
+        (value_values.size() == default_flat.size());
+
+    std::vector<bool> found;
+    TieredRowStore::Stats stats;
+    TF_RETURN_IF_ERROR(store_->Find(
+        absl::MakeConstSpan(key_values.data(), key_values.size()),
+        reinterpret_cast<char*>(value_values.data()), &found,
+        ctx->device()->tensorflow_cpu_worker_threads()->workers, &stats));
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      if (found[i]) continue;
+      for (int64_t j = 0; j < value_dim; j++) {
+        value_values(i, j) =
+            is_full_size_default ? default_flat(i, j) : default_flat(0, j);
+      }
+    }
+    metrics::RecordTieredLookupTableFind(stats.hits, stats.misses,
+                                         stats.absent,
+                                         env_->NowMicros() - start_us);
+    return OkStatus();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    return store_->Insert(
+        absl::MakeConstSpan(key_values.data(), key_values.size()),
+        reinterpret_cast<const char*>(values.flat<V>().data()));
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+    store_->Remove(absl::MakeConstSpan(key_values.data(), key_values.size()));
+    return OkStatus();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    TF_RETURN_IF_ERROR(store_->Clear());
+    return Insert(ctx, keys, values);
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    const int64_t value_dim = value_shape_.dim_size(0);
+    std::vector<K> exported_keys;
+    std::vector<V> exported_values;
+    TF_RETURN_IF_ERROR(store_->ForEach([&](int64_t key, const char* row) {
+      exported_keys.push_back(key);
+      const V* values = reinterpret_cast<const V*>(row);
+      exported_values.insert(exported_values.end(), values,
+                             values + value_dim);
+    }));
+    const int64_t size = exported_keys.size();
+
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(ctx->allocate_output(
+        "values", TensorShape({size, value_dim}), &values));
+    std::copy(exported_keys.begin(), exported_keys.end(),
+              keys->flat<K>().data());
+    std::copy(exported_values.begin(), exported_values.end(),
+              values->flat<V>().data());
+    return OkStatus();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return value_shape_; }
+
+  int64_t MemoryUsed() const override {
+    return sizeof(TieredHashTableOfTensors) + store_->MemoryUsed();
+  }
+
+ private:
+  static_assert(std::is_same<K, int64_t>::value,
+                "TieredRowStore only supports int64 keys.");
+
+  Env* const env_;
+  TensorShape value_shape_;
+  std::unique_ptr<TieredRowStore> store_;
+};
+
 namespace {
 
 template <typename T>
@@ -1160,6 +1628,76 @@ REGISTER_KERNEL(tstring, int64_t);
 
 #undef REGISTER_KERNEL
 
+// Register the MutableStripedHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                                \
+  REGISTER_KERNEL_BUILDER(                                                     \
+      Name("MutableStripedHashTable")                                          \
+          .Device(DEVICE_CPU)                                                  \
+          .TypeConstraint<key_dtype>("key_dtype")                              \
+          .TypeConstraint<value_dtype>("value_dtype"),                         \
+      LookupTableOp<lookup::MutableStripedHashTable<key_dtype, value_dtype>,   \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int32, double);
+REGISTER_KERNEL(int32, float);
+REGISTER_KERNEL(int32, int32);
+REGISTER_KERNEL(int64_t, double);
+REGISTER_KERNEL(int64_t, float);
+REGISTER_KERNEL(int64_t, int32);
+REGISTER_KERNEL(int64_t, int64_t);
+REGISTER_KERNEL(int64_t, tstring);
+REGISTER_KERNEL(int64_t, Variant);
+REGISTER_KERNEL(tstring, bool);
+REGISTER_KERNEL(tstring, double);
+REGISTER_KERNEL(tstring, float);
+REGISTER_KERNEL(tstring, int32);
+REGISTER_KERNEL(tstring, int64_t);
+
+#undef REGISTER_KERNEL
+
+// Register the TieredHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                                \
+  REGISTER_KERNEL_BUILDER(                                                     \
+      Name("TieredHashTable")                                                  \
+          .Device(DEVICE_CPU)                                                  \
+          .TypeConstraint<key_dtype>("key_dtype")                              \
+          .TypeConstraint<value_dtype>("value_dtype"),                         \
+      LookupTableOp<lookup::TieredHashTableOfTensors<key_dtype, value_dtype>,  \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int64_t, double);
+REGISTER_KERNEL(int64_t, float);
+
+#undef REGISTER_KERNEL
+
+// Register the MutableStripedHashTableOfTensors op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                      \
+  REGISTER_KERNEL_BUILDER(                                           \
+      Name("MutableStripedHashTableOfTensors")                       \
+          .Device(DEVICE_CPU)                                        \
+          .TypeConstraint<key_dtype>("key_dtype")                    \
+          .TypeConstraint<value_dtype>("value_dtype"),               \
+      LookupTableOp<                                                 \
+          lookup::MutableStripedHashTableOfTensors<key_dtype,        \
+                                                   value_dtype>,     \
+          key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int32, double);
+REGISTER_KERNEL(int32, float);
+REGISTER_KERNEL(int32, int32);
+REGISTER_KERNEL(int64_t, double);
+REGISTER_KERNEL(int64_t, float);
+REGISTER_KERNEL(int64_t, int32);
+REGISTER_KERNEL(int64_t, int64_t);
+REGISTER_KERNEL(int64_t, tstring);
+REGISTER_KERNEL(tstring, bool);
+REGISTER_KERNEL(tstring, double);
+REGISTER_KERNEL(tstring, float);
+REGISTER_KERNEL(tstring, int32);
+REGISTER_KERNEL(tstring, int64_t);
+
+#undef REGISTER_KERNEL
+
 // Register the MutableHashTableOfTensors op.
 #define REGISTER_KERNEL(key_dtype, value_dtype)                                \
   REGISTER_KERNEL_BUILDER(                                                     \
@@ -18,6 +18,7 @@ limitations under the License.
 #include "re2/re2.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/simd_text_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -26,6 +27,36 @@ limitations under the License.
 namespace tensorflow {
 namespace {
 
+// Returns true if `regex` matches exactly its own pattern string and `rewrite`
+// has no backslash substitutions, so that a replace can be done as a plain
+// string search.
+bool IsLiteralReplace(const RE2& regex, const string& rewrite) {
+  const string& pattern = regex.pattern();
+  return !pattern.empty() &&
+         pattern.find_first_of("\\^$.|?*+()[]{}") == string::npos &&
+         rewrite.find('\\') == string::npos;
+}
+
+// Replaces the first, or with `replace_global` every, occurrence of `literal`
+// in `*text` by `rewrite`. `*text` is only rebuilt if there is an occurrence.
+void LiteralReplace(StringPiece literal, StringPiece rewrite,
+                    const bool replace_global, tstring* text) {
+  StringPiece input(*text);
+  size_t pos = simd_text::Find(input, literal);
+  if (pos == StringPiece::npos) return;
+  tstring result;
+  result.reserve(input.size());
+  do {
+    result.append(input.data(), pos);
+    result.append(rewrite.data(), rewrite.size());
+    input.remove_prefix(pos + literal.size());
+    if (!replace_global) break;
+    pos = simd_text::Find(input, literal);
+  } while (pos != StringPiece::npos);
+  result.append(input.data(), input.size());
+  *text = std::move(result);
+}
+
 // Execute the specified regex using the given context.
 // Context requirements:
 //  - "input" string Tensor at input_index=0
@@ -48,7 +79,14 @@ Status InternalCompute(const RE2& regex, const string& rewrite,
     output_tensor->flat<tstring>() = input_tensor->flat<tstring>();
   }
   auto output_flat = output_tensor->flat<tstring>();
+  const bool literal = IsLiteralReplace(regex, rewrite);
   for (size_t i = 0; i < output_flat.size(); ++i) {
+    // On well-formed UTF-8, a literal pattern matches exactly where its bytes
+    // occur.
+    if (literal && simd_text::IsValidUTF8(output_flat(i))) {
+      LiteralReplace(regex.pattern(), rewrite, replace_global, &output_flat(i));
+      continue;
+    }
     // TODO(dero): Mitigate copy; Global and GlobalReplace below currently only
     // accept std::string.
     string buf = output_flat(i);
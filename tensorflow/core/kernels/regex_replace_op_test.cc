@@ -57,6 +57,16 @@ const char* lines[] = {
 const char kRegExPattern[] = "\\p{P}";
 const char kRewrite[] = " ";
 
+// URL-encoded search queries as they appear in a query log.
+const char* query_lines[] = {"how%20to%20train%20a%20neural%20network",
+                             "tensorflow%20string%20split%20example",
+                             "best%20pizza%20near%20me",
+                             "weather%20tomorrow%20san%20francisco",
+                             "python%20list%20comprehension%20vs%20map",
+                             "caf\xc3\xa9%20open%20now",
+                             "gpu%20out%20of%20memory%20error%20tf.data",
+                             "2024%20election%20results%20by%20county"};
+
 Tensor GetTestTensor(int batch) {
   const int sz = TF_ARRAYSIZE(lines);
   Tensor t(DT_STRING, {batch});
@@ -67,6 +77,18 @@ Tensor GetTestTensor(int batch) {
   return t;
 }
 
+Tensor GetQueryLogTensor(int batch, int64_t* num_bytes) {
+  const int sz = TF_ARRAYSIZE(query_lines);
+  Tensor t(DT_STRING, {batch});
+  auto s = t.flat<tstring>();
+  *num_bytes = 0;
+  for (int i = 0; i < batch; ++i) {
+    s(i) = query_lines[i % sz];
+    *num_bytes += s(i).size();
+  }
+  return t;
+}
+
 Graph* SetupRegexReplaceGraph(const Tensor& input, const string& input_pattern,
                               const string& input_rewrite) {
   Graph* g = new Graph(OpRegistry::Global());
@@ -103,6 +125,21 @@ BENCHMARK(BM_RegexReplace)
     ->Arg(128)
     ->Arg(256);
 
+// Decodes the spaces of URL-encoded query log lines. The pattern has no
+// metacharacters, so it is replaced as a literal.
+static void BM_RegexReplaceLiteral(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+
+  int64_t num_bytes;
+  Tensor input = GetQueryLogTensor(batch_size, &num_bytes);
+  Graph* g = SetupRegexReplaceGraph(input, "%20", " ");
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK(BM_RegexReplaceLiteral)->UseRealTime()->Arg(256)->Arg(4096);
+
 Graph* SetupStaticGraph(const Tensor& input, const string& input_pattern,
                         const string& rewrite) {
   Graph* g = new Graph(OpRegistry::Global());
@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <stdlib.h>
+
 #include <complex>
 #include <functional>
 #include <memory>
@@ -356,5 +358,11 @@ TEST_F(RestoreV2OpTest, RestoreAfterSaveV2) { RunTest("SaveV2"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveSlicesV1) { RunTest("SaveSlices"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveV1) { RunTest("Save"); }
 
+TEST_F(RestoreV2OpTest, RestoreAfterSaveV2ShardParallel) {
+  setenv("TF_RESTORE_V2_SHARD_THREADS", "4", /*overwrite=*/1);
+  RunTest("SaveV2");
+  unsetenv("TF_RESTORE_V2_SHARD_THREADS");
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -250,6 +251,10 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
 
+// If set to a positive value, full tensors are restored by
+// BundleReader::LookupMany() with that many shard reader threads.
+const char kRestoreShardThreadsEnvVar[] = "TF_RESTORE_V2_SHARD_THREADS";
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -402,10 +407,27 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
+  int64_t num_shard_threads = 0;
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar(kRestoreShardThreadsEnvVar, 0,
+                                         &num_shard_threads));
+
   std::vector<RestoreOp*> pool_restore_ops;
   std::vector<RestoreOp*> direct_restore_ops;
+  // Full tensors handed to BundleReader::LookupMany() when the shard-parallel
+  // restore is enabled.
+  std::vector<StringPiece> batched_keys;
+  std::vector<Tensor*> batched_tensors;
   for (RestoreOp& restore_op : restore_ops) {
-    if (restore_op.should_run_in_pool(&default_reader)) {
+    if (num_shard_threads > 0 && restore_op.shape_and_slice.empty()) {
+      TensorShape restored_full_shape;
+      TF_RETURN_IF_ERROR(default_reader.LookupTensorShape(
+          restore_op.tensor_name, &restored_full_shape));
+      Tensor* restored_tensor;
+      TF_RETURN_IF_ERROR(context->allocate_output(
+          restore_op.idx, restored_full_shape, &restored_tensor));
+      batched_keys.push_back(restore_op.tensor_name);
+      batched_tensors.push_back(restored_tensor);
+    } else if (restore_op.should_run_in_pool(&default_reader)) {
       pool_restore_ops.push_back(&restore_op);
     } else {
       direct_restore_ops.push_back(&restore_op);
@@ -428,6 +450,11 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     for (auto* op : direct_restore_ops) {
       TF_RETURN_IF_ERROR(op->run(&default_reader));
     }
+
+    if (!batched_keys.empty()) {
+      TF_RETURN_IF_ERROR(default_reader.LookupMany(
+          batched_keys, batched_tensors, static_cast<int>(num_shard_threads)));
+    }
   }
 
   // Check status of pool ops; this must come after the pool shuts down.
@@ -63,6 +63,10 @@ void RestoreTensor(OpKernelContext* context,
 //   * "prefix" has 1 element, DT_STRING.
 //   * "tensor_names" and "shape_and_slices" shaped {N}, both DT_STRING.
 //   * "dtypes" has N elements, the datatypes of the to-restore tensors.
+//
+// If the environment variable TF_RESTORE_V2_SHARD_THREADS is set to a positive
+// value, all full (non-sliced) tensors are read shard-parallel on that many
+// threads with coalesced reads; see BundleReader::LookupMany().
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                         const Tensor& tensor_names,
                         const Tensor& shape_and_slices,
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include <complex>
+#include <cstdlib>
 #include <string>
 
 #include "tensorflow/core/framework/fake_input.h"
@@ -340,5 +341,41 @@ TEST_F(SaveV2OpTest, Simple) {
   }
 }
 
+TEST_F(SaveV2OpTest, AsyncWrite) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "tensor_async");
+  setenv("TF_SAVE_V2_ASYNC_WRITE", "true", /*overwrite=*/1);
+  TF_ASSERT_OK(NodeDefBuilder("myop", "SaveV2")
+                   .Input(FakeInput())  // prefix
+                   .Input(FakeInput())  // tensor_names
+                   .Input(FakeInput())  // shape_and_slices
+                   .Input(FakeInput({DT_FLOAT, DT_INT64}))  // tensors
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  unsetenv("TF_SAVE_V2_ASYNC_WRITE");
+
+  AddInput<tstring>(TensorShape({}),
+                    [&prefix](int x) -> tstring { return prefix; });
+  AddInputFromArray<tstring>(TensorShape({2}), {"tensor_float", "slice"});
+  AddInputFromArray<tstring>(TensorShape({2}), {"", "4 0,2"});
+  AddInput<float>(TensorShape({1000}),
+                  [](int x) -> float { return static_cast<float>(x) / 10; });
+  AddInput<int64_t>(TensorShape({2}), [](int x) -> int64 { return x + 1; });
+  TF_ASSERT_OK(RunOpKernel());
+
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  TF_ASSERT_OK(reader.Lookup("tensor_float", &val));
+  ASSERT_EQ(1000, val.NumElements());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(static_cast<float>(i) / 10, val.flat<float>()(i));
+  }
+  Tensor slice(DT_INT64, TensorShape({2}));
+  TF_ASSERT_OK(reader.LookupSlice("slice", TensorSlice::ParseOrDie("0,2"),
+                                  &slice));
+  EXPECT_EQ(1, slice.flat<int64_t>()(0));
+  EXPECT_EQ(2, slice.flat<int64_t>()(1));
+}
+
 }  // namespace
 }  // namespace tensorflow
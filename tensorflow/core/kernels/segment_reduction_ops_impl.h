@@ -38,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/segment_reduction_ops.h"
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/util/determinism.h"
@@ -344,6 +345,12 @@ namespace functor {
 template <typename T, typename Index, typename InitialValueF,
           typename ReductionF>
 struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
+  // Inputs with at least this many elements are reduced by the bucketed path.
+  static constexpr int64_t kMinBucketedElements = 1 << 15;
+  // Target size in bytes of the output rows owned by one bucket, so that the
+  // rows a worker accumulates into stay resident in its L2 cache.
+  static constexpr int64_t kBucketBytes = 256 << 10;
+
   void operator()(OpKernelContext* ctx, const TensorShape& segment_ids_shape,
                   typename TTypes<Index>::ConstFlat segment_ids,
                   typename TTypes<T, 2>::ConstTensor data,
@@ -372,6 +379,28 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     // Length of non-zero elements is `num_reductions`.
     std::vector<Index> row_counter(num_segments, 0);
 
+    // Large inputs are partitioned by a radix pass into buckets of
+    // `1 << bucket_shift` consecutive segments, each sized to fit in cache and
+    // reduced by a single worker. `bucket_offsets[b + 1]` first counts the
+    // input rows that fall in bucket `b`.
+    const bool use_buckets =
+        num_segments > 1 && N * inner_dim >= kMinBucketedElements;
+    int bucket_shift = 0;
+    int64_t num_buckets = 0;
+    std::vector<int64_t> bucket_offsets;
+    if (use_buckets) {
+      const int64_t cache_segments = std::max<int64_t>(
+          1, kBucketBytes / (inner_dim * static_cast<int64_t>(sizeof(T))));
+      // Keep at least a few buckets per thread for load balancing.
+      const int64_t num_threads =
+          std::max<int64_t>(1, cpu_device.numThreads());
+      const int64_t balanced_segments =
+          std::max<int64_t>(1, Eigen::divup(num_segments, 4 * num_threads));
+      bucket_shift = Log2Floor64(std::min(cache_segments, balanced_segments));
+      num_buckets = ((num_segments - 1) >> bucket_shift) + 1;
+      bucket_offsets.resize(num_buckets + 1, 0);
+    }
+
     for (int64_t i = 0; i < N; ++i) {
       Index j = internal::SubtleMustCopy(segment_ids(i));
       if (j < 0) {
@@ -384,11 +413,18 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
                       " = ", j, " is out of range [0, ", num_segments, ")"));
       if (row_counter[j] == 0) num_reductions++;
       row_counter[j]++;
+      if (use_buckets) ++bucket_offsets[(j >> bucket_shift) + 1];
     }
 
     // Nothing to reduce. All output values equal to `InitialValueF()`.
     if (num_reductions == 0) return;
 
+    if (use_buckets) {
+      ReduceBucketed(cpu_device, segment_ids, data, num_segments, bucket_shift,
+                     num_real_segment, &bucket_offsets, output);
+      return;
+    }
+
     // Parallelize by `num_segments`. It's simple, efficient and safe
     // (no data dependency):
     //
@@ -420,6 +456,69 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     const Eigen::TensorOpCost cost(input_bytes, output_bytes, compute_cycles);
     cpu_device.parallelFor(num_segments, cost, reductionWorker);
   }
+
+ private:
+  // Scatters the indices of the input rows into bucket order and reduces
+  // every bucket on one worker. Since buckets own disjoint output rows, no
+  // synchronization is needed between workers, and each input row is read
+  // by exactly one of them.
+  //
+  //   input   segment_ids    order (shift 1)     worker  output rows
+  //   | a0 |  | 0 |          | 0 |  bucket 0   1       |0|1|
+  //   | b0 |  | 1 |          | 1 |
+  //   | c0 |  | 2 |   -->    | 3 |
+  //   | b1 |  | 1 |          | 4 |
+  //   | a1 |  | 0 |          | 2 |  bucket 1   2       |2|
+  void ReduceBucketed(const CPUDevice& cpu_device,
+                      typename TTypes<Index>::ConstFlat segment_ids,
+                      typename TTypes<T, 2>::ConstTensor data,
+                      int64_t num_segments, int bucket_shift,
+                      int64_t num_real_segment,
+                      std::vector<int64_t>* bucket_offsets,
+                      typename TTypes<T, 2>::Tensor output) {
+    const int64_t N = segment_ids.dimension(0);
+    const int64_t inner_dim = data.dimension(1);
+    const int64_t num_buckets = bucket_offsets->size() - 1;
+    std::vector<int64_t>& offsets = *bucket_offsets;
+    for (int64_t b = 0; b < num_buckets; ++b) {
+      offsets[b + 1] += offsets[b];
+    }
+
+    // The scatter is O(N) and cheap next to the O(N * inner_dim) reduction.
+    // Segment ids are re-read from a buffer other threads may write to, so
+    // ids that have changed since validation are skipped rather than trusted.
+    std::vector<int64_t> order(offsets[num_buckets], 0);
+    std::vector<int64_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (int64_t i = 0; i < N; ++i) {
+      Index j = internal::SubtleMustCopy(segment_ids(i));
+      if (!FastBoundsCheck(j, num_segments)) continue;
+      const int64_t b = j >> bucket_shift;
+      if (cursor[b] < offsets[b + 1]) order[cursor[b]++] = i;
+    }
+
+    ReductionF reduction;
+    auto bucketWorker = [&](int64_t begin, int64_t end) -> void {
+      const int64_t first_segment = begin << bucket_shift;
+      const int64_t last_segment =
+          std::min(end << bucket_shift, num_segments);
+      for (int64_t k = offsets[begin]; k < offsets[end]; ++k) {
+        const int64_t i = order[k];
+        Index j = internal::SubtleMustCopy(segment_ids(i));
+        if (j >= first_segment && j < last_segment) {
+          reduction(data.template chip<0>(i), output.template chip<0>(j));
+        }
+      }
+    };
+
+    const int64_t rows_per_bucket =
+        Eigen::divup<int64_t>(num_real_segment, num_buckets);
+    const int64_t compute_cycles = 5 * inner_dim * rows_per_bucket;
+    const int64_t input_bytes = sizeof(T) * inner_dim * rows_per_bucket;
+    const int64_t output_bytes =
+        sizeof(T) * inner_dim * (int64_t{1} << bucket_shift);
+    const Eigen::TensorOpCost cost(input_bytes, output_bytes, compute_cycles);
+    cpu_device.parallelFor(num_buckets, cost, bucketWorker);
+  }
 };
 
 template <typename T>
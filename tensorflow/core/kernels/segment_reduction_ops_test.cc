@@ -106,6 +106,48 @@ static void BM_UnsortedSegmentReduction(::testing::benchmark::State& state,
 BM_UnsortedReduce_Arg(4096, 1024, 1);
 BM_UnsortedReduce_Arg(4096, 1024, 128);
 
+// UnsortedSegmentSum of 65536 rows with scattered segment ids, over
+// `num_segments` x `num_cols` x `num_threads`.
+static void BM_UnsortedSegmentSumThreads(::testing::benchmark::State& state) {
+  const int num_segments = state.range(0);
+  const int num_cols = state.range(1);
+  const int num_threads = state.range(2);
+  constexpr int kNumRows = 65536;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, TensorShape({kNumRows, num_cols}));
+  input.flat<float>().setRandom();
+  Tensor segment_ids(DT_INT32, TensorShape({kNumRows}));
+  test::FillFn<int32>(&segment_ids, [num_segments](int i) -> int32 {
+    return (static_cast<uint32>(i) * 2654435761u) % num_segments;
+  });
+  Tensor num_segments_t(DT_INT32, TensorShape({}));
+  num_segments_t.scalar<int32>()() = num_segments;
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "UnsortedSegmentSum")
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, segment_ids))
+                  .Input(test::graph::Constant(g, num_segments_t))
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+
+  SessionOptions opts;
+  opts.config.set_intra_op_parallelism_threads(num_threads);
+  opts.config.set_inter_op_parallelism_threads(1);
+  opts.config.set_use_per_session_threads(true);
+  test::Benchmark("cpu", g, &opts, nullptr, nullptr, "",
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kNumRows);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * kNumRows *
+                          num_cols * sizeof(float));
+}
+
+BENCHMARK(BM_UnsortedSegmentSumThreads)
+    ->UseRealTime()
+    ->ArgsProduct({{1024, 16384, 262144}, {16, 128}, {1, 4, 16}});
+
 template <typename Index>
 static void BM_SegmentReduction(::testing::benchmark::State& state,
                                 const string& reduction, Index num_rows,
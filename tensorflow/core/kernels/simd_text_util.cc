@@ -0,0 +1,265 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/simd_text_util.h"
+
+#include <cstring>
+
+#include "absl/numeric/bits.h"
+
+#ifdef __SSE2__
+#define USE_SSE2_TEXT 1
+#include <emmintrin.h>
+#endif
+
+namespace tensorflow {
+namespace simd_text {
+namespace {
+
+constexpr uint64_t kOnes = ~uint64_t{0} / 255;  // 0x0101010101010101
+constexpr uint64_t kHighBits = kOnes * 0x80;
+
+inline uint64_t LoadWord(const char* p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+inline void StoreWord(uint64_t word, char* p) {
+  memcpy(p, &word, sizeof(word));
+}
+
+// Maps the ASCII bytes of `word` in [lo, hi] by xor with 0x20, which swaps
+// their case when the range is 'A'-'Z' or 'a'-'z'.
+inline uint64_t FlipCaseInRange(uint64_t word, char lo, char hi) {
+  // Adding to the low 7 bits of each byte cannot carry into the next byte,
+  // and sets the byte's high bit exactly when it is >= lo (resp. > hi).
+  const uint64_t low_bits = word & ~kHighBits;
+  const uint64_t ge_lo = low_bits + kOnes * (0x80 - lo);
+  const uint64_t gt_hi = low_bits + kOnes * (0x7F - hi);
+  const uint64_t in_range = (ge_lo ^ gt_hi) & ~word & kHighBits;
+  return word ^ (in_range >> 2);
+}
+
+inline char FlipCaseInRange(char c, char lo, char hi) {
+  return (c >= lo && c <= hi) ? static_cast<char>(c ^ 0x20) : c;
+}
+
+void MapCaseInRange(StringPiece src, char* dst, char lo, char hi) {
+  const char* p = src.data();
+  const size_t size = src.size();
+  size_t i = 0;
+#ifdef USE_SSE2_TEXT
+  // Bytes >= 0x80 are negative as signed chars, so fall outside [lo, hi].
+  const __m128i lo_minus_one = _mm_set1_epi8(lo - 1);
+  const __m128i hi_plus_one = _mm_set1_epi8(hi + 1);
+  const __m128i flip = _mm_set1_epi8(0x20);
+  for (; i + 16 <= size; i += 16) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    const __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(v, lo_minus_one),
+                                           _mm_cmplt_epi8(v, hi_plus_one));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_xor_si128(v, _mm_and_si128(in_range, flip)));
+  }
+#endif
+  for (; i + 8 <= size; i += 8) {
+    StoreWord(FlipCaseInRange(LoadWord(p + i), lo, hi), dst + i);
+  }
+  for (; i < size; ++i) {
+    dst[i] = FlipCaseInRange(p[i], lo, hi);
+  }
+}
+
+inline bool IsContinuation(uint8_t b) { return (b & 0xC0) == 0x80; }
+
+// Returns the length of the well-formed multi-byte sequence at the start of
+// `p`, or 0 if it is ill-formed. See table 3-7 of the Unicode standard.
+size_t MultiByteSequenceLength(const uint8_t* p, size_t size) {
+  const uint8_t lead = p[0];
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    return (size >= 2 && IsContinuation(p[1])) ? 2 : 0;
+  }
+  if (lead >= 0xE0 && lead <= 0xEF) {
+    if (size < 3 || !IsContinuation(p[1]) || !IsContinuation(p[2])) return 0;
+    if (lead == 0xE0 && p[1] < 0xA0) return 0;  // Overlong.
+    if (lead == 0xED && p[1] > 0x9F) return 0;  // Surrogate.
+    return 3;
+  }
+  if (lead >= 0xF0 && lead <= 0xF4) {
+    if (size < 4 || !IsContinuation(p[1]) || !IsContinuation(p[2]) ||
+        !IsContinuation(p[3])) {
+      return 0;
+    }
+    if (lead == 0xF0 && p[1] < 0x90) return 0;  // Overlong.
+    if (lead == 0xF4 && p[1] > 0x8F) return 0;  // Above U+10FFFF.
+    return 4;
+  }
+  return 0;
+}
+
+}  // namespace
+
+size_t AsciiPrefixLength(StringPiece text) {
+  const char* p = text.data();
+  const size_t size = text.size();
+  size_t i = 0;
+#ifdef USE_SSE2_TEXT
+  for (; i + 16 <= size; i += 16) {
+    const int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+    if (mask != 0) return i + absl::countr_zero(static_cast<uint32_t>(mask));
+  }
+#endif
+  for (; i + 8 <= size; i += 8) {
+    if ((LoadWord(p + i) & kHighBits) != 0) break;
+  }
+  while (i < size && static_cast<uint8_t>(p[i]) < 0x80) ++i;
+  return i;
+}
+
+size_t AsciiSuffixLength(StringPiece text) {
+  const char* p = text.data();
+  size_t end = text.size();
+#ifdef USE_SSE2_TEXT
+  for (; end >= 16; end -= 16) {
+    const int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + end - 16)));
+    if (mask != 0) {
+      return text.size() - end +
+             absl::countl_zero(static_cast<uint16_t>(mask));
+    }
+  }
+#endif
+  for (; end >= 8; end -= 8) {
+    if ((LoadWord(p + end - 8) & kHighBits) != 0) break;
+  }
+  while (end > 0 && static_cast<uint8_t>(p[end - 1]) < 0x80) --end;
+  return text.size() - end;
+}
+
+bool IsValidUTF8(StringPiece text) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(text.data());
+  size_t size = text.size();
+  while (size > 0) {
+    // Most text is mostly ASCII, so skip runs of it in bulk.
+    const size_t ascii =
+        AsciiPrefixLength(StringPiece(reinterpret_cast<const char*>(p), size));
+    p += ascii;
+    size -= ascii;
+    if (size == 0) break;
+    const size_t length = MultiByteSequenceLength(p, size);
+    if (length == 0) return false;
+    p += length;
+    size -= length;
+  }
+  return true;
+}
+
+void AsciiToLower(StringPiece src, char* dst) {
+  MapCaseInRange(src, dst, 'A', 'Z');
+}
+
+void AsciiToUpper(StringPiece src, char* dst) {
+  MapCaseInRange(src, dst, 'a', 'z');
+}
+
+ByteSet::ByteSet(StringPiece bytes) {
+  for (char c : bytes) {
+    if (Contains(c)) continue;
+    const uint8_t b = static_cast<uint8_t>(c);
+    bits_[b >> 6] |= uint64_t{1} << (b & 63);
+    if (num_bytes_ < kMaxVectorBytes) bytes_[num_bytes_] = c;
+    ++num_bytes_;
+  }
+}
+
+size_t ByteSet::FindFirstIn(StringPiece text) const {
+  const char* p = text.data();
+  const size_t size = text.size();
+  if (num_bytes_ == 0) return size;
+  if (num_bytes_ == 1) {
+    // libc's memchr is already vectorized.
+    const void* found = memchr(p, bytes_[0], size);
+    return found == nullptr ? size : static_cast<const char*>(found) - p;
+  }
+  size_t i = 0;
+#ifdef USE_SSE2_TEXT
+  if (num_bytes_ <= kMaxVectorBytes) {
+    __m128i needles[kMaxVectorBytes];
+    for (int k = 0; k < num_bytes_; ++k) needles[k] = _mm_set1_epi8(bytes_[k]);
+    for (; i + 16 <= size; i += 16) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+      __m128i match = _mm_cmpeq_epi8(v, needles[0]);
+      for (int k = 1; k < num_bytes_; ++k) {
+        match = _mm_or_si128(match, _mm_cmpeq_epi8(v, needles[k]));
+      }
+      const int mask = _mm_movemask_epi8(match);
+      if (mask != 0) return i + absl::countr_zero(static_cast<uint32_t>(mask));
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    if (Contains(p[i])) return i;
+  }
+  return size;
+}
+
+size_t ByteSet::FindFirstNotIn(StringPiece text) const {
+  const char* p = text.data();
+  const size_t size = text.size();
+  size_t i = 0;
+#ifdef USE_SSE2_TEXT
+  if (num_bytes_ > 0 && num_bytes_ <= kMaxVectorBytes) {
+    __m128i needles[kMaxVectorBytes];
+    for (int k = 0; k < num_bytes_; ++k) needles[k] = _mm_set1_epi8(bytes_[k]);
+    for (; i + 16 <= size; i += 16) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+      __m128i match = _mm_cmpeq_epi8(v, needles[0]);
+      for (int k = 1; k < num_bytes_; ++k) {
+        match = _mm_or_si128(match, _mm_cmpeq_epi8(v, needles[k]));
+      }
+      const int mask = ~_mm_movemask_epi8(match) & 0xFFFF;
+      if (mask != 0) return i + absl::countr_zero(static_cast<uint32_t>(mask));
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    if (!Contains(p[i])) return i;
+  }
+  return size;
+}
+
+size_t Find(StringPiece text, StringPiece needle) {
+  if (needle.empty()) return 0;
+  const char* p = text.data();
+  const char* const end = p + text.size();
+  const char first = needle[0];
+  const size_t rest = needle.size() - 1;
+  while (static_cast<size_t>(end - p) > rest) {
+    const char* candidate =
+        static_cast<const char*>(memchr(p, first, end - p - rest));
+    if (candidate == nullptr) break;
+    if (memcmp(candidate + 1, needle.data() + 1, rest) == 0) {
+      return candidate - text.data();
+    }
+    p = candidate + 1;
+  }
+  return StringPiece::npos;
+}
+
+}  // namespace simd_text
+}  // namespace tensorflow
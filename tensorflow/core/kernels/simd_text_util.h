@@ -0,0 +1,102 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_SIMD_TEXT_UTIL_H_
+#define TENSORFLOW_CORE_KERNELS_SIMD_TEXT_UTIL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/tstring.h"
+
+namespace tensorflow {
+namespace simd_text {
+
+// Byte-level text primitives shared by the string kernels. They process 16
+// bytes per step with SSE2 when it is available, and 8 bytes per step with
+// word-wide bit tricks otherwise.
+
+// Returns the number of leading bytes of `text` that are ASCII (< 0x80).
+size_t AsciiPrefixLength(StringPiece text);
+
+// Returns the number of trailing bytes of `text` that are ASCII (< 0x80).
+size_t AsciiSuffixLength(StringPiece text);
+
+inline bool IsAscii(StringPiece text) {
+  return AsciiPrefixLength(text) == text.size();
+}
+
+// Returns true if `text` is well-formed UTF-8, i.e. it has no truncated or
+// overlong sequences, surrogates, or code points above U+10FFFF.
+bool IsValidUTF8(StringPiece text);
+
+// Writes `src` to `dst` with 'A'-'Z' mapped to 'a'-'z'. All other bytes are
+// copied unchanged. `dst` must have room for `src.size()` bytes, and may be
+// `src.data()` itself.
+void AsciiToLower(StringPiece src, char* dst);
+
+// As AsciiToLower, mapping 'a'-'z' to 'A'-'Z'.
+void AsciiToUpper(StringPiece src, char* dst);
+
+// Sets `*out` to `src` mapped by AsciiToLower. The result is written straight
+// into the buffer of `out`, which holds short strings inline, so no temporary
+// string is built.
+inline void AssignAsciiLower(StringPiece src, tstring* out) {
+  out->resize_uninitialized(src.size());
+  AsciiToLower(src, out->mdata());
+}
+
+// As AssignAsciiLower, by AsciiToUpper.
+inline void AssignAsciiUpper(StringPiece src, tstring* out) {
+  out->resize_uninitialized(src.size());
+  AsciiToUpper(src, out->mdata());
+}
+
+// A set of byte values, e.g. the delimiters of a split, to scan text for.
+class ByteSet {
+ public:
+  explicit ByteSet(StringPiece bytes);
+
+  bool Contains(char c) const {
+    const uint8_t b = static_cast<uint8_t>(c);
+    return (bits_[b >> 6] >> (b & 63)) & 1;
+  }
+
+  // Returns the offset of the first byte of `text` in the set, or
+  // `text.size()` if there is none.
+  size_t FindFirstIn(StringPiece text) const;
+
+  // Returns the offset of the first byte of `text` not in the set, or
+  // `text.size()` if there is none.
+  size_t FindFirstNotIn(StringPiece text) const;
+
+ private:
+  // Sets of at most this many distinct bytes are matched with one vector
+  // compare per byte; larger sets are matched through `bits_`.
+  static constexpr int kMaxVectorBytes = 8;
+
+  uint64_t bits_[4] = {0, 0, 0, 0};
+  char bytes_[kMaxVectorBytes];
+  int num_bytes_ = 0;
+};
+
+// Returns the offset of the first occurrence of `needle` in `text`, or
+// StringPiece::npos if there is none. An empty `needle` is found at 0.
+size_t Find(StringPiece text, StringPiece needle);
+
+}  // namespace simd_text
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_SIMD_TEXT_UTIL_H_
@@ -0,0 +1,189 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/simd_text_util.h"
+
+#include <algorithm>
+#include <string>
+
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace simd_text {
+namespace {
+
+// Lengths around the 8 and 16 byte steps, so that every scan ends in a tail.
+constexpr int kLengths[] = {0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 64};
+
+std::string AsciiText(int length) {
+  std::string text;
+  for (int i = 0; i < length; ++i) text.push_back('a' + i % 26);
+  return text;
+}
+
+TEST(SimdTextUtil, AsciiPrefixAndSuffixLength) {
+  for (int length : kLengths) {
+    std::string text = AsciiText(length);
+    EXPECT_EQ(AsciiPrefixLength(text), length);
+    EXPECT_EQ(AsciiSuffixLength(text), length);
+    EXPECT_TRUE(IsAscii(text));
+    for (int i = 0; i < length; ++i) {
+      std::string with_high_byte = text;
+      with_high_byte[i] = '\x80';
+      EXPECT_EQ(AsciiPrefixLength(with_high_byte), i);
+      EXPECT_EQ(AsciiSuffixLength(with_high_byte), length - i - 1);
+      EXPECT_FALSE(IsAscii(with_high_byte));
+    }
+  }
+}
+
+TEST(SimdTextUtil, IsValidUTF8) {
+  EXPECT_TRUE(IsValidUTF8(""));
+  EXPECT_TRUE(IsValidUTF8(AsciiText(40)));
+  EXPECT_TRUE(IsValidUTF8("caf\xc3\xa9 \xe2\x82\xac \xf0\x9d\x84\x9e"));
+  EXPECT_TRUE(IsValidUTF8("\xed\x9f\xbf\xf4\x8f\xbf\xbf"));
+  // Stray continuation byte.
+  EXPECT_FALSE(IsValidUTF8(AsciiText(20) + "\x80"));
+  // Truncated sequence.
+  EXPECT_FALSE(IsValidUTF8("abc\xe2\x82"));
+  // Overlong encodings.
+  EXPECT_FALSE(IsValidUTF8("\xc0\xaf"));
+  EXPECT_FALSE(IsValidUTF8("\xe0\x80\xaf"));
+  EXPECT_FALSE(IsValidUTF8("\xf0\x80\x80\xaf"));
+  // Surrogate.
+  EXPECT_FALSE(IsValidUTF8("\xed\xa0\x80"));
+  // Above U+10FFFF.
+  EXPECT_FALSE(IsValidUTF8("\xf4\x90\x80\x80"));
+  EXPECT_FALSE(IsValidUTF8("\xff"));
+}
+
+TEST(SimdTextUtil, AsciiCaseMapping) {
+  std::string text;
+  for (int c = 0; c < 256; ++c) text.push_back(static_cast<char>(c));
+  std::string lower(text.size(), 0);
+  std::string upper(text.size(), 0);
+  AsciiToLower(text, &lower[0]);
+  AsciiToUpper(text, &upper[0]);
+  for (int c = 0; c < 256; ++c) {
+    const char expected_lower = (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    const char expected_upper = (c >= 'a' && c <= 'z') ? c - 32 : c;
+    EXPECT_EQ(lower[c], expected_lower) << c;
+    EXPECT_EQ(upper[c], expected_upper) << c;
+  }
+
+  std::string in_place = "Hello, WORLD! \xc3\x89t\xc3\xa9";
+  AsciiToLower(in_place, &in_place[0]);
+  EXPECT_EQ(in_place, "hello, world! \xc3\x89t\xc3\xa9");
+
+  tstring out;
+  AssignAsciiUpper("Query Log", &out);
+  EXPECT_EQ(out, "QUERY LOG");
+}
+
+TEST(SimdTextUtil, ByteSet) {
+  for (StringPiece bytes : {"", ",", " \t", " \t\n\v\f\r", "0123456789"}) {
+    const ByteSet set(bytes);
+    const std::string chars(bytes);
+    for (int length : kLengths) {
+      for (int i = 0; i <= length; ++i) {
+        std::string text = AsciiText(length);
+        if (!chars.empty() && i < length) text[i] = chars.back();
+        size_t expected = text.find_first_of(chars);
+        if (expected == std::string::npos) expected = text.size();
+        EXPECT_EQ(set.FindFirstIn(text), expected) << bytes << " " << text;
+
+        std::string run(length, chars.empty() ? 'x' : chars[0]);
+        if (i < length) run[i] = 'x';
+        expected = run.find_first_not_of(chars);
+        if (expected == std::string::npos) expected = run.size();
+        EXPECT_EQ(set.FindFirstNotIn(run), expected) << bytes << " " << run;
+      }
+    }
+  }
+  const ByteSet high_bytes("\x80\xff");
+  EXPECT_TRUE(high_bytes.Contains('\xff'));
+  EXPECT_FALSE(high_bytes.Contains('\x7f'));
+  EXPECT_EQ(high_bytes.FindFirstIn(AsciiText(20) + "\xff"), 20);
+}
+
+TEST(SimdTextUtil, Find) {
+  EXPECT_EQ(Find("abc", ""), 0);
+  EXPECT_EQ(Find("", "a"), StringPiece::npos);
+  EXPECT_EQ(Find("a%2", "%20"), StringPiece::npos);
+  EXPECT_EQ(Find("tensor%2%20flow", "%20"), 8);
+  EXPECT_EQ(Find("aaab", "aab"), 1);
+  EXPECT_EQ(Find("caf\xc3\xa9", "\xc3\xa9"), 3);
+}
+
+// Search queries as they appear in a query log, URL-encoded or not.
+const char* const kQueryLog[] = {
+    "how to train a neural network",
+    "tensorflow+string_split+example",
+    "Best Pizza Near Me",
+    "weather%20tomorrow%20san%20francisco",
+    "python list comprehension vs map",
+    "caf\xc3\xa9 open now",
+    "GPU out of memory error tf.data",
+    "2024 election results by county",
+};
+
+std::string QueryLogText(size_t size) {
+  std::string text;
+  for (int i = 0; text.size() < size; ++i) {
+    text.append(kQueryLog[i % TF_ARRAYSIZE(kQueryLog)]);
+    text.push_back('\n');
+  }
+  text.resize(size);
+  return text;
+}
+
+void BM_AsciiToLower(::testing::benchmark::State& state) {
+  const std::string text = QueryLogText(state.range(0));
+  std::string out(text.size(), 0);
+  for (auto s : state) {
+    AsciiToLower(text, &out[0]);
+    tensorflow::testing::DoNotOptimize(out);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_AsciiToLower)->Arg(32)->Arg(4096);
+
+void BM_IsValidUTF8(::testing::benchmark::State& state) {
+  const std::string text = QueryLogText(state.range(0));
+  for (auto s : state) {
+    tensorflow::testing::DoNotOptimize(IsValidUTF8(text));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_IsValidUTF8)->Arg(32)->Arg(4096);
+
+void BM_FindWhitespace(::testing::benchmark::State& state) {
+  const std::string text = QueryLogText(state.range(0));
+  const ByteSet whitespace(" \t\n\v\f\r");
+  for (auto s : state) {
+    StringPiece rest(text);
+    while (!rest.empty()) {
+      const size_t token_size = whitespace.FindFirstIn(rest);
+      rest.remove_prefix(std::min(rest.size(), token_size + 1));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FindWhitespace)->Arg(32)->Arg(4096);
+
+}  // namespace
+}  // namespace simd_text
+}  // namespace tensorflow
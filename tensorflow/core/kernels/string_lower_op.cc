@@ -17,11 +17,11 @@ limitations under the License.
 
 #include <string>
 
-#include "absl/strings/ascii.h"
 #include "unicode/unistr.h"  // from @icu
 #include "tensorflow/core/framework/kernel_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/simd_text_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -50,12 +50,16 @@ class StringLowerOp : public OpKernel {
 
     if (encoding_.empty()) {
       for (int64_t i = 0; i < input.size(); ++i) {
-        StringPiece entry(input(i));
-        output(i) = absl::AsciiStrToLower(entry);
+        simd_text::AssignAsciiLower(input(i), &output(i));
       }
     } else {
       // The validation of utf-8 has already been done in GetAttr above.
       for (int64_t i = 0; i < input.size(); ++i) {
+        // Unicode case mapping agrees with ASCII case mapping on ASCII text.
+        if (simd_text::IsAscii(input(i))) {
+          simd_text::AssignAsciiLower(input(i), &output(i));
+          continue;
+        }
         icu::UnicodeString us(input(i).c_str(), "UTF-8");
         us.toLower();
         us.toUTF8String(output(i));
@@ -0,0 +1,106 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+
+class StringLowerOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(const string& encoding) {
+    TF_ASSERT_OK(NodeDefBuilder("string_lower_op", "StringLower")
+                     .Input(FakeInput(DT_STRING))
+                     .Attr("encoding", encoding)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_F(StringLowerOpTest, NoEncoding) {
+  MakeOp("");
+  AddInputFromArray<tstring>(
+      TensorShape({3}),
+      {"Hello, World!", "A STRING TOO LONG FOR INLINE", "\xc3\x89T\xc3\x89"});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_STRING, TensorShape({3}));
+  // Only ASCII is mapped without an encoding.
+  test::FillValues<tstring>(
+      &expected,
+      {"hello, world!", "a string too long for inline", "\xc3\x89t\xc3\x89"});
+  test::ExpectTensorEqual<tstring>(expected, *GetOutput(0));
+}
+
+TEST_F(StringLowerOpTest, UTF8) {
+  MakeOp("utf-8");
+  AddInputFromArray<tstring>(TensorShape({2}),
+                             {"Hello, World!", "\xc3\x89T\xc3\x89"});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_STRING, TensorShape({2}));
+  test::FillValues<tstring>(&expected,
+                            {"hello, world!", "\xc3\xa9t\xc3\xa9"});
+  test::ExpectTensorEqual<tstring>(expected, *GetOutput(0));
+}
+
+// Search queries as they appear in a query log.
+const char* query_lines[] = {
+    "How To Train A Neural Network",
+    "TensorFlow string split example",
+    "Best Pizza Near Me",
+    "weather tomorrow San Francisco",
+    "Python list comprehension vs map",
+    "Caf\xc3\xa9 open now",
+    "GPU out of memory error tf.data",
+    "2024 Election Results by County"};
+
+static void BM_StringLower(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+  const bool utf8 = state.range(1);
+
+  const int sz = TF_ARRAYSIZE(query_lines);
+  Tensor input(DT_STRING, {batch_size});
+  auto input_flat = input.flat<tstring>();
+  int64_t num_bytes = 0;
+  for (int i = 0; i < batch_size; ++i) {
+    input_flat(i) = query_lines[i % sz];
+    num_bytes += input_flat(i).size();
+  }
+
+  Graph* g = new Graph(OpRegistry::Global());
+  TF_CHECK_OK(NodeBuilder("string_lower_op", "StringLower")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("encoding", utf8 ? "utf-8" : "")
+                  .Finalize(g, nullptr /* node */));
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK(BM_StringLower)
+    ->UseRealTime()
+    ->ArgPair(256, false)
+    ->ArgPair(4096, false)
+    ->ArgPair(256, true)
+    ->ArgPair(4096, true);
+
+}  // end namespace tensorflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/framework/kernel_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/simd_text_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
@@ -59,28 +60,29 @@ std::vector<StringPiece> SplitOnChar(const tstring& str, const char delim,
 // Based on str_util::Split.
 template <typename Predicate>
 std::vector<StringPiece> SplitOnCharSet(const tstring& str,
-                                        const tstring& delim_set, Predicate p) {
+                                        const simd_text::ByteSet& delim_set,
+                                        Predicate p) {
   std::vector<StringPiece> result;
   StringPiece text(str);
-  StringPiece delims(delim_set);
-  size_t token_start = 0;
-  for (size_t i = 0; i < text.size() + 1; i++) {
-    if ((i == text.size()) || (delims.find(text[i]) != StringPiece::npos)) {
-      StringPiece token(text.data() + token_start, i - token_start);
-      if (p(token)) {
-        result.emplace_back(token);
-      }
-      token_start = i + 1;
+  while (true) {
+    const size_t f = delim_set.FindFirstIn(text);
+    StringPiece token = text.substr(0, f);
+    if (p(token)) {
+      result.emplace_back(token);
     }
+    if (f == text.size()) break;
+    text.remove_prefix(f + 1);
   }
   return result;
 }
 
-// Split input string `str` based on given delimiter.
+// Split input string `str` based on given delimiter, whose characters are
+// also in `delim_set`.
 // Returns a vector of StringPieces which are valid as long as input `str`
 // is valid.
 template <typename Predicate>
 std::vector<StringPiece> Split(const tstring& str, const tstring& delimiter,
+                               const simd_text::ByteSet& delim_set,
                                Predicate predicate) {
   if (str.empty()) {
     return std::vector<StringPiece>();
@@ -96,7 +98,7 @@ std::vector<StringPiece> Split(const tstring& str, const tstring& delimiter,
   if (delimiter.size() == 1) {
     return SplitOnChar(str, delimiter[0], predicate);
   }
-  return SplitOnCharSet(str, delimiter, predicate);
+  return SplitOnCharSet(str, delim_set, predicate);
 }
 
 std::vector<StringPiece> SplitV2(const tstring& str, StringPiece sep,
@@ -124,13 +126,16 @@ std::vector<StringPiece> SplitV2(const tstring& str, StringPiece sep,
   }
 
   if (sep.empty()) {
-    StringPiece token;
+    static const simd_text::ByteSet* const kWhitespace =
+        new simd_text::ByteSet(" \t\n\v\f\r");
     // Remove leading whitespaces.
-    str_util::RemoveLeadingWhitespace(&text);
+    text.remove_prefix(kWhitespace->FindFirstNotIn(text));
     int split = 0;
-    while (str_util::ConsumeNonWhitespace(&text, &token)) {
-      result.push_back(token);
-      str_util::RemoveLeadingWhitespace(&text);
+    while (!text.empty()) {
+      const size_t token_size = kWhitespace->FindFirstIn(text);
+      result.push_back(text.substr(0, token_size));
+      text.remove_prefix(token_size);
+      text.remove_prefix(kWhitespace->FindFirstNotIn(text));
       ++split;
       if (maxsplit > 0 && split == maxsplit) {
         result.push_back(text);
@@ -139,10 +144,10 @@ std::vector<StringPiece> SplitV2(const tstring& str, StringPiece sep,
     }
     return result;
   }
-  auto p = std::search(text.begin(), text.end(), sep.begin(), sep.end());
+  size_t p = simd_text::Find(text, sep);
   int split = 0;
-  while (p != text.end()) {
-    StringPiece token = text.substr(0, p - text.begin());
+  while (p != StringPiece::npos) {
+    StringPiece token = text.substr(0, p);
     result.push_back(token);
     text.remove_prefix(token.size());
     text.remove_prefix(sep.size());
@@ -151,7 +156,7 @@ std::vector<StringPiece> SplitV2(const tstring& str, StringPiece sep,
       result.push_back(StringPiece(text));
       return result;
     }
-    p = std::search(text.begin(), text.end(), sep.begin(), sep.end());
+    p = simd_text::Find(text, sep);
   }
   result.push_back(text);
   return result;
@@ -189,6 +194,7 @@ class StringSplitOp : public OpKernel {
                                 delimiter_tensor->shape().DebugString()));
     const auto delimiter_vec = delimiter_tensor->flat<tstring>();
     const tstring& delimiter = delimiter_vec(0);
+    const simd_text::ByteSet delim_set(delimiter);
     // Empty delimiter means split the input character by character.
     std::vector<StringPiece> tokens;
     // Guess that we'll be unpacking a handful of tokens per example.
@@ -200,8 +206,10 @@ class StringSplitOp : public OpKernel {
     std::vector<int64_t> num_indices(batch_size);
     for (int64_t i = 0; i < batch_size; ++i) {
       std::vector<StringPiece> parts =
-          skip_empty_ ? Split(input_vec(i), delimiter, str_util::SkipEmpty())
-                      : Split(input_vec(i), delimiter, str_util::AllowEmpty());
+          skip_empty_ ? Split(input_vec(i), delimiter, delim_set,
+                              str_util::SkipEmpty())
+                      : Split(input_vec(i), delimiter, delim_set,
+                              str_util::AllowEmpty());
       int64_t n_entries = parts.size();
       num_indices[i] = n_entries;
       output_size += n_entries;
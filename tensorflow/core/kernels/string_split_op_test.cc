@@ -54,6 +54,17 @@ const char* lines[] = {
     "backwards compatibility guarantee like C++, Go, Java, JavaScript and "
     "Swift."};
 
+// Search queries as they appear in a query log.
+const char* query_lines[] = {
+    "how to train a neural network",
+    "tensorflow string split example",
+    "Best Pizza Near Me",
+    "weather tomorrow\tsan francisco",
+    "python list comprehension vs map",
+    "caf\xc3\xa9 open now",
+    "GPU out of memory error tf.data",
+    "2024 election results by county"};
+
 Tensor GetTestTensor(int batch) {
   const int sz = TF_ARRAYSIZE(lines);
   Tensor t(DT_STRING, {batch});
@@ -64,10 +75,22 @@ Tensor GetTestTensor(int batch) {
   return t;
 }
 
-Graph* SetupStringSplitGraph(const Tensor& input) {
+Tensor GetQueryLogTensor(int batch, int64_t* num_bytes) {
+  const int sz = TF_ARRAYSIZE(query_lines);
+  Tensor t(DT_STRING, {batch});
+  auto s = t.flat<tstring>();
+  *num_bytes = 0;
+  for (int i = 0; i < batch; ++i) {
+    s(i) = query_lines[i % sz];
+    *num_bytes += s(i).size();
+  }
+  return t;
+}
+
+Graph* SetupStringSplitGraph(const Tensor& input, const string& delimiter) {
   Graph* g = new Graph(OpRegistry::Global());
   Tensor delim(DT_STRING, TensorShape({}));
-  delim.flat<tstring>().setConstant(" ");
+  delim.flat<tstring>().setConstant(delimiter);
 
   TF_CHECK_OK(NodeBuilder("string_split_op", "StringSplit")
                   .Input(test::graph::Constant(g, input))
@@ -80,7 +103,7 @@ static void BM_StringSplit(::testing::benchmark::State& state) {
   const int batch_size = state.range(0);
 
   Tensor input = GetTestTensor(batch_size);
-  Graph* g = SetupStringSplitGraph(input);
+  Graph* g = SetupStringSplitGraph(input, " ");
   test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
 }
@@ -95,10 +118,24 @@ BENCHMARK(BM_StringSplit)
     ->Arg(128)
     ->Arg(256);
 
-Graph* SetupStringSplitV2Graph(const Tensor& input) {
+// Splits query log lines on a set of delimiters.
+static void BM_StringSplitQueryLog(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+
+  int64_t num_bytes;
+  Tensor input = GetQueryLogTensor(batch_size, &num_bytes);
+  Graph* g = SetupStringSplitGraph(input, " \t");
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK(BM_StringSplitQueryLog)->UseRealTime()->Arg(256)->Arg(4096);
+
+Graph* SetupStringSplitV2Graph(const Tensor& input, const string& separator) {
   Graph* g = new Graph(OpRegistry::Global());
   Tensor sep(DT_STRING, TensorShape({}));
-  sep.flat<tstring>().setConstant(" ");
+  sep.flat<tstring>().setConstant(separator);
 
   TF_CHECK_OK(NodeBuilder("string_split_op", "StringSplitV2")
                   .Input(test::graph::Constant(g, input))
@@ -111,7 +148,7 @@ static void BM_StringSplitV2(::testing::benchmark::State& state) {
   const int batch_size = state.range(0);
 
   Tensor input = GetTestTensor(batch_size);
-  Graph* g = SetupStringSplitV2Graph(input);
+  Graph* g = SetupStringSplitV2Graph(input, " ");
   test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
 }
@@ -126,4 +163,18 @@ BENCHMARK(BM_StringSplitV2)
     ->Arg(128)
     ->Arg(256);
 
+// Splits query log lines on runs of whitespace, as str.split() does.
+static void BM_StringSplitV2QueryLog(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+
+  int64_t num_bytes;
+  Tensor input = GetQueryLogTensor(batch_size, &num_bytes);
+  Graph* g = SetupStringSplitV2Graph(input, "");
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK(BM_StringSplitV2QueryLog)->UseRealTime()->Arg(256)->Arg(4096);
+
 }  // end namespace tensorflow
@@ -0,0 +1,92 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+
+class StringToHashBucketFastOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(int64_t num_buckets) {
+    TF_ASSERT_OK(NodeDefBuilder("hash_op", "StringToHashBucketFast")
+                     .Input(FakeInput(DT_STRING))
+                     .Attr("num_buckets", num_buckets)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_F(StringToHashBucketFastOpTest, ManyStrings) {
+  // Enough strings for the work to be sharded.
+  constexpr int kNumStrings = 10000;
+  constexpr int64_t kNumBuckets = 1000;
+  MakeOp(kNumBuckets);
+  AddInput<tstring>(TensorShape({kNumStrings}),
+                    [](int i) -> tstring { return strings::StrCat("q", i); });
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_INT64, TensorShape({kNumStrings}));
+  test::FillFn<int64_t>(&expected, [](int i) -> int64_t {
+    return Fingerprint64(strings::StrCat("q", i)) % kNumBuckets;
+  });
+  test::ExpectTensorEqual<int64_t>(expected, *GetOutput(0));
+}
+
+// Search queries as they appear in a query log.
+const char* query_lines[] = {
+    "how to train a neural network",
+    "tensorflow string split example",
+    "best pizza near me",
+    "weather tomorrow san francisco",
+    "python list comprehension vs map",
+    "caf\xc3\xa9 open now",
+    "gpu out of memory error tf.data",
+    "2024 election results by county"};
+
+static void BM_StringToHashBucketFast(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+
+  const int sz = TF_ARRAYSIZE(query_lines);
+  Tensor input(DT_STRING, {batch_size});
+  auto input_flat = input.flat<tstring>();
+  int64_t num_bytes = 0;
+  for (int i = 0; i < batch_size; ++i) {
+    input_flat(i) = query_lines[i % sz];
+    num_bytes += input_flat(i).size();
+  }
+
+  Graph* g = new Graph(OpRegistry::Global());
+  TF_CHECK_OK(NodeBuilder("hash_op", "StringToHashBucketFast")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("num_buckets", 1 << 20)
+                  .Finalize(g, nullptr /* node */));
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK(BM_StringToHashBucketFast)->UseRealTime()->Arg(256)->Arg(65536);
+
+}  // end namespace tensorflow
@@ -15,6 +15,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_STRING_UTIL_H_
 #define TENSORFLOW_CORE_KERNELS_STRING_UTIL_H_
 
+#include <algorithm>
+
+#include "tensorflow/core/kernels/simd_text_util.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 
@@ -53,6 +56,18 @@ bool ForwardNUTF8CharPositions(const StringPiece in,
   const size_t size = in.size();
   T utf8_chars_counted = 0;
   while (utf8_chars_counted < num_utf8_chars_to_shift && *pos < size) {
+    // Each byte of a run of ASCII is a character of its own.
+    const size_t max_run = std::min<size_t>(
+        num_utf8_chars_to_shift - utf8_chars_counted, size - *pos);
+    const T ascii_run =
+        simd_text::AsciiPrefixLength(StringPiece(in.data() + *pos, max_run));
+    if (ascii_run > 0) {
+      *pos += ascii_run;
+      utf8_chars_counted += ascii_run;
+      // Stray trail bytes belong to the last character, as below.
+      while (*pos < size && IsTrailByte(in[*pos])) ++*pos;
+      continue;
+    }
     // move forward one utf-8 character
     do {
       ++*pos;
@@ -74,6 +89,16 @@ bool BackNUTF8CharPositions(const StringPiece in,
   const size_t start = 0;
   T utf8_chars_counted = 0;
   while (utf8_chars_counted < num_utf8_chars_to_shift && (*pos > start)) {
+    // Each byte of a run of ASCII is a character of its own.
+    const size_t max_run = std::min<size_t>(
+        num_utf8_chars_to_shift - utf8_chars_counted, *pos - start);
+    const T ascii_run = simd_text::AsciiSuffixLength(
+        StringPiece(in.data() + *pos - max_run, max_run));
+    if (ascii_run > 0) {
+      *pos -= ascii_run;
+      utf8_chars_counted += ascii_run;
+      continue;
+    }
     // move back one utf-8 character
     do {
       --*pos;
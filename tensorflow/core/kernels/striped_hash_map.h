@@ -0,0 +1,195 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_STRIPED_HASH_MAP_H_
+#define TENSORFLOW_CORE_KERNELS_STRIPED_HASH_MAP_H_
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/core/platform/hash.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace lookup {
+
+// A hash map partitioned into shards by the hash of the keys, each guarded by
+// its own reader-writer lock. Single-key operations only lock the shard of the
+// key, for the duration of that operation, so lookups run concurrently with
+// each other and only wait for writes of keys in the same shard, rather than
+// for a whole batch of writes to the map.
+//
+// Operations on the whole map (`Assign` and `Snapshot`) lock all the shards,
+// in order, and so see or produce a consistent state of the map.
+//
+// This class is thread-safe.
+template <class K, class V>
+class StripedHashMap {
+ public:
+  explicit StripedHashMap(int num_shards)
+      : num_shards_(num_shards), shards_(new Shard[num_shards]) {
+    DCHECK_GT(num_shards_, 0);
+  }
+
+  int num_shards() const { return num_shards_; }
+
+  size_t size() const {
+    size_t result = 0;
+    for (int i = 0; i < num_shards_; ++i) {
+      tf_shared_lock l(shards_[i].mu);
+      result += shards_[i].map.size();
+    }
+    return result;
+  }
+
+  // Copies the value of `key` to `*value` and returns true if the map contains
+  // `key`. Returns false otherwise.
+  bool Find(const K& key, V* value) const {
+    return FindWith(key, [value](const V& found) { *value = found; });
+  }
+
+  // Calls `fn(value)` with the value of `key`, while holding the lock of its
+  // shard, and returns true if the map contains `key`. Returns false
+  // otherwise. Avoids copying values that are only read in part.
+  template <typename Fn>
+  bool FindWith(const K& key, Fn&& fn) const {
+    const Shard& shard = GetShard(key);
+    tf_shared_lock l(shard.mu);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) return false;
+    fn(it->second);
+    return true;
+  }
+
+  void InsertOrUpdate(const K& key, const V& value) {
+    Shard& shard = GetShard(key);
+    mutex_lock l(shard.mu);
+    shard.map[key] = value;
+  }
+
+  // Returns true if the map contained `key`.
+  bool Erase(const K& key) {
+    Shard& shard = GetShard(key);
+    mutex_lock l(shard.mu);
+    return shard.map.erase(key) > 0;
+  }
+
+  // Replaces the contents of the map with the pairs of `keys` and `values`,
+  // which must have the same size. Later pairs win over earlier ones with the
+  // same key.
+  void Assign(absl::Span<const K> keys, absl::Span<const V> values) {
+    DCHECK_EQ(keys.size(), values.size());
+    std::vector<mutex_lock> locks;
+    locks.reserve(num_shards_);
+    for (int i = 0; i < num_shards_; ++i) {
+      locks.emplace_back(shards_[i].mu);
+    }
+    AssignLocked(keys, values);
+  }
+
+  // Bytes used by the buckets and entries of the map, approximately.
+  int64_t MemoryUsed() const {
+    int64_t result = 0;
+    for (int i = 0; i < num_shards_; ++i) {
+      tf_shared_lock l(shards_[i].mu);
+      result += shards_[i].map.bucket_count() * sizeof(void*) +
+                shards_[i].map.size() * sizeof(std::pair<const K, V>);
+    }
+    return sizeof(StripedHashMap) + num_shards_ * sizeof(Shard) + result;
+  }
+
+  // A consistent view of the whole map. Writers of the map are blocked for as
+  // long as the snapshot exists.
+  class Snapshot {
+   public:
+    size_t size() const { return size_; }
+
+    // Calls `fn(key, value)` for each entry of the map.
+    void ForEach(const std::function<void(const K&, const V&)>& fn) const
+        TF_NO_THREAD_SAFETY_ANALYSIS {
+      for (int i = 0; i < map_->num_shards_; ++i) {
+        for (const auto& entry : map_->shards_[i].map) {
+          fn(entry.first, entry.second);
+        }
+      }
+    }
+
+   private:
+    friend class StripedHashMap;
+
+    explicit Snapshot(const StripedHashMap* map) TF_NO_THREAD_SAFETY_ANALYSIS
+        : map_(map) {
+      locks_.reserve(map_->num_shards_);
+      for (int i = 0; i < map_->num_shards_; ++i) {
+        locks_.emplace_back(map_->shards_[i].mu);
+        size_ += map_->shards_[i].map.size();
+      }
+    }
+
+    const StripedHashMap* const map_;
+    std::vector<tf_shared_lock> locks_;
+    size_t size_ = 0;
+  };
+
+  Snapshot GetSnapshot() const { return Snapshot(this); }
+
+ private:
+  // Padded to a cache line, so that threads locking adjacent shards do not
+  // contend for the cache line of the locks.
+  struct alignas(64) Shard {
+    mutable mutex mu;
+    std::unordered_map<K, V> map TF_GUARDED_BY(mu);
+  };
+
+  size_t ShardIndex(const K& key) const {
+    // The maps of the shards bucket keys by the low bits of their hash, so the
+    // shard is chosen from the high bits of the mixed hash.
+    const uint64 hash = static_cast<uint64>(std::hash<K>()(key));
+    return ((hash * 0x9E3779B97F4A7C15ULL) >> 32) % num_shards_;
+  }
+
+  Shard& GetShard(const K& key) { return shards_[ShardIndex(key)]; }
+  const Shard& GetShard(const K& key) const {
+    return shards_[ShardIndex(key)];
+  }
+
+  void AssignLocked(absl::Span<const K> keys, absl::Span<const V> values)
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int i = 0; i < num_shards_; ++i) {
+      shards_[i].map.clear();
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+      GetShard(keys[i]).map[keys[i]] = values[i];
+    }
+  }
+
+  const int num_shards_;
+  const std::unique_ptr<Shard[]> shards_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StripedHashMap);
+};
+
+}  // namespace lookup
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_STRIPED_HASH_MAP_H_
@@ -0,0 +1,176 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/striped_hash_map.h"
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+TEST(StripedHashMap, InsertFindErase) {
+  StripedHashMap<int64_t, float> map(/*num_shards=*/4);
+  float value = 0;
+  EXPECT_FALSE(map.Find(1, &value));
+  for (int64_t i = 0; i < 100; ++i) {
+    map.InsertOrUpdate(i, i * 0.5f);
+  }
+  EXPECT_EQ(map.size(), 100);
+  ASSERT_TRUE(map.Find(7, &value));
+  EXPECT_EQ(value, 3.5f);
+  map.InsertOrUpdate(7, -1.0f);
+  ASSERT_TRUE(map.Find(7, &value));
+  EXPECT_EQ(value, -1.0f);
+  EXPECT_EQ(map.size(), 100);
+  EXPECT_TRUE(map.Erase(7));
+  EXPECT_FALSE(map.Erase(7));
+  EXPECT_FALSE(map.Find(7, &value));
+  EXPECT_EQ(map.size(), 99);
+}
+
+TEST(StripedHashMap, StringKeys) {
+  StripedHashMap<tstring, int64_t> map(/*num_shards=*/3);
+  map.InsertOrUpdate("a", 1);
+  map.InsertOrUpdate("b", 2);
+  int64_t value = 0;
+  ASSERT_TRUE(map.Find("b", &value));
+  EXPECT_EQ(value, 2);
+  EXPECT_FALSE(map.Find("c", &value));
+}
+
+TEST(StripedHashMap, FindWithVectorValues) {
+  StripedHashMap<int64_t, std::vector<float>> map(/*num_shards=*/2);
+  map.InsertOrUpdate(1, {1.0f, 2.0f, 3.0f});
+  float sum = 0;
+  ASSERT_TRUE(map.FindWith(1, [&sum](const std::vector<float>& value) {
+    for (float x : value) sum += x;
+  }));
+  EXPECT_EQ(sum, 6.0f);
+  EXPECT_FALSE(map.FindWith(2, [](const std::vector<float>&) {
+    ADD_FAILURE() << "Called for a missing key.";
+  }));
+}
+
+TEST(StripedHashMap, AssignAndSnapshot) {
+  StripedHashMap<int64_t, int64_t> map(/*num_shards=*/8);
+  map.InsertOrUpdate(-1, -1);
+  std::vector<int64_t> keys = {1, 2, 3, 2};
+  std::vector<int64_t> values = {10, 20, 30, 40};
+  map.Assign(keys, values);
+  EXPECT_EQ(map.size(), 3);
+
+  std::map<int64_t, int64_t> entries;
+  {
+    auto snapshot = map.GetSnapshot();
+    EXPECT_EQ(snapshot.size(), 3);
+    snapshot.ForEach(
+        [&](const int64_t& key, const int64_t& value) { entries[key] = value; });
+  }
+  EXPECT_EQ(entries, (std::map<int64_t, int64_t>{{1, 10}, {2, 40}, {3, 30}}));
+}
+
+TEST(StripedHashMap, ConcurrentReadersAndWriters) {
+  constexpr int kNumKeys = 1000;
+  constexpr int kNumThreads = 8;
+  StripedHashMap<int64_t, int64_t> map(/*num_shards=*/16);
+  thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+  std::atomic<int> num_inconsistent(0);
+  BlockingCounter counter(kNumThreads);
+  for (int t = 0; t < kNumThreads; ++t) {
+    pool.Schedule([&, t]() {
+      for (int64_t i = 0; i < 10 * kNumKeys; ++i) {
+        const int64_t key = (i * 7 + t) % kNumKeys;
+        if (t % 2 == 0) {
+          // Values are always a function of the key.
+          map.InsertOrUpdate(key, key * 3);
+        } else {
+          int64_t value;
+          if (map.Find(key, &value) && value != key * 3) ++num_inconsistent;
+        }
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  EXPECT_EQ(num_inconsistent, 0);
+  EXPECT_EQ(map.size(), kNumKeys);
+}
+
+// Lookups and inserts of random keys from `num_threads` threads, 1 in 10 of
+// them an insert, as when serving threads read an embedding table that a
+// trainer updates. With a single shard, the map is guarded by one lock as
+// MutableHashTableOfScalars is.
+void BM_MixedReadWrite(::testing::benchmark::State& state) {
+  const int num_shards = state.range(0);
+  const int num_threads = state.range(1);
+  constexpr int64_t kNumKeys = 1 << 16;
+  constexpr int kOpsPerThread = 10000;
+  constexpr int kWritePeriod = 10;
+
+  StripedHashMap<int64_t, float> map(num_shards);
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    map.InsertOrUpdate(i, 1.0f);
+  }
+  thread::ThreadPool pool(Env::Default(), "bm", num_threads);
+  std::atomic<int64_t> num_found(0);
+  int64_t round = 0;
+  for (auto s : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&, t, round]() {
+        random::PhiloxRandom philox(t, round);
+        random::SimplePhilox rnd(&philox);
+        int64_t found = 0;
+        for (int i = 0; i < kOpsPerThread; ++i) {
+          const int64_t key = rnd.Uniform64(kNumKeys);
+          if (i % kWritePeriod == 0) {
+            map.InsertOrUpdate(key, static_cast<float>(i));
+          } else {
+            float value;
+            found += map.Find(key, &value);
+          }
+        }
+        num_found += found;
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    ++round;
+  }
+  CHECK_GT(num_found, 0);
+  state.SetItemsProcessed(state.iterations() * num_threads * kOpsPerThread);
+}
+
+BENCHMARK(BM_MixedReadWrite)
+    ->ArgPair(1, 1)
+    ->ArgPair(64, 1)
+    ->ArgPair(1, 4)
+    ->ArgPair(64, 4)
+    ->ArgPair(1, 16)
+    ->ArgPair(64, 16);
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
@@ -109,6 +109,17 @@ const char* unicode_lines[] = {
     "Go\xef\xbc\x8cJava\xef\xbc\x8cJavaScript\xe5\x92\x8cSwift\xe3\x80\x82",
 };
 
+// Search queries as they appear in a query log.
+const char* query_lines[] = {
+    "how to train a neural network",
+    "tensorflow string split example",
+    "Best Pizza Near Me",
+    "weather tomorrow san francisco",
+    "python list comprehension vs map",
+    "caf\xc3\xa9 open now",
+    "GPU out of memory error tf.data",
+    "2024 election results by county"};
+
 const char* const kByteUnit = "BYTE";
 const char* const kUTF8Unit = "UTF8_CHAR";
 
@@ -132,6 +143,18 @@ Tensor GetTestUTF8Tensor(int batch) {
   return t;
 }
 
+Tensor GetQueryLogTensor(int batch, int64_t* num_bytes) {
+  const int sz = TF_ARRAYSIZE(query_lines);
+  Tensor t(DT_STRING, {batch});
+  auto s = t.flat<tstring>();
+  *num_bytes = 0;
+  for (int i = 0; i < batch; ++i) {
+    s(i) = query_lines[i % sz];
+    *num_bytes += s(i).size();
+  }
+  return t;
+}
+
 Graph* SetupSubstrGraph(const Tensor& input, const int32_t pos,
                         const int32_t len, const char* const unit) {
   Graph* g = new Graph(OpRegistry::Global());
@@ -186,4 +209,18 @@ BENCHMARK(BM_SubstrUTF8)
     ->Arg(128)
     ->Arg(256);
 
+// Takes character-based prefixes of mostly ASCII query log lines.
+static void BM_SubstrUTF8QueryLog(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+
+  int64_t num_bytes;
+  Tensor input = GetQueryLogTensor(batch_size, &num_bytes);
+  Graph* g = SetupSubstrGraph(input, 0, 16, kUTF8Unit);
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK(BM_SubstrUTF8QueryLog)->UseRealTime()->Arg(256)->Arg(4096);
+
 }  // end namespace tensorflow
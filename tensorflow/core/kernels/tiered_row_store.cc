@@ -0,0 +1,454 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/tiered_row_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+// Saturating value of the counters of the frequency sketch.
+constexpr uint8 kMaxFrequency = 15;
+
+// Number of counters of the sketch per cached row.
+constexpr int64_t kCountersPerRow = 4;
+
+uint64 Mix(uint64 x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+}  // namespace
+
+// Estimates how often keys were used recently, as the minimum of 4 saturating
+// counters indexed by independent hashes of the key. All the counters are
+// halved periodically, so that keys that stop being used are forgotten.
+class TieredRowStore::FrequencySketch {
+ public:
+  explicit FrequencySketch(int64_t capacity) {
+    int64_t width = kMinWidth;
+    while (width < capacity * kCountersPerRow) width *= 2;
+    mask_ = width - 1;
+    counters_.resize(kDepth * width);
+    reset_period_ = 10 * width;
+  }
+
+  void Increment(int64_t key) {
+    const uint64 hash = Mix(static_cast<uint64>(key));
+    for (int i = 0; i < kDepth; ++i) {
+      uint8& counter = counters_[Index(hash, i)];
+      if (counter < kMaxFrequency) ++counter;
+    }
+    if (++num_increments_ == reset_period_) {
+      for (uint8& counter : counters_) counter >>= 1;
+      num_increments_ = 0;
+    }
+  }
+
+  uint8 Frequency(int64_t key) const {
+    const uint64 hash = Mix(static_cast<uint64>(key));
+    uint8 frequency = kMaxFrequency;
+    for (int i = 0; i < kDepth; ++i) {
+      frequency = std::min(frequency, counters_[Index(hash, i)]);
+    }
+    return frequency;
+  }
+
+  int64_t MemoryUsed() const { return counters_.size(); }
+
+ private:
+  static constexpr int kDepth = 4;
+  // Keeps collisions rare in the sketches of small caches.
+  static constexpr int64_t kMinWidth = 1024;
+
+  int64_t Index(uint64 hash, int row) const {
+    const uint64 row_hash = Mix(hash + row * 0x9e3779b97f4a7c15ULL);
+    return row * (mask_ + 1) + static_cast<int64_t>(row_hash & mask_);
+  }
+
+  uint64 mask_;
+  std::vector<uint8> counters_;
+  int64_t reset_period_;
+  int64_t num_increments_ = 0;
+};
+
+TieredRowStore::Segment::~Segment() {
+  writer.reset();
+  reader.reset();
+  Status s = env->DeleteFile(path);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to delete " << path << ": " << s;
+  }
+}
+
+Status TieredRowStore::Create(Env* env, const Options& options,
+                              std::unique_ptr<TieredRowStore>* store) {
+  if (options.path.empty()) {
+    return errors::InvalidArgument("The path of the row store is empty.");
+  }
+  if (options.row_bytes <= 0) {
+    return errors::InvalidArgument("Rows must have a positive size, got ",
+                                   options.row_bytes, " bytes.");
+  }
+  if (options.cache_capacity < 0) {
+    return errors::InvalidArgument("The cache capacity must be >= 0, got ",
+                                   options.cache_capacity, ".");
+  }
+  if (options.min_garbage_bytes < 0) {
+    return errors::InvalidArgument(
+        "The minimum garbage size must be >= 0, got ",
+        options.min_garbage_bytes, " bytes.");
+  }
+  if (!(options.max_garbage_fraction >= 0.0 &&
+        options.max_garbage_fraction <= 1.0)) {
+    return errors::InvalidArgument(
+        "The maximum garbage fraction must be in [0, 1], got ",
+        options.max_garbage_fraction, ".");
+  }
+  std::unique_ptr<TieredRowStore> result(new TieredRowStore(env, options));
+  {
+    mutex_lock l(result->mu_);
+    TF_RETURN_IF_ERROR(result->NewSegment(&result->segment_));
+  }
+  *store = std::move(result);
+  return OkStatus();
+}
+
+TieredRowStore::TieredRowStore(Env* env, const Options& options)
+    : env_(env),
+      path_(options.path),
+      row_bytes_(options.row_bytes),
+      cache_capacity_(options.cache_capacity),
+      min_garbage_bytes_(options.min_garbage_bytes),
+      max_garbage_fraction_(options.max_garbage_fraction),
+      cache_rows_(options.cache_capacity * options.row_bytes),
+      sketch_(std::make_unique<FrequencySketch>(options.cache_capacity)) {
+  free_slots_.reserve(cache_capacity_);
+  for (int64_t slot = cache_capacity_ - 1; slot >= 0; --slot) {
+    free_slots_.push_back(slot);
+  }
+}
+
+TieredRowStore::~TieredRowStore() = default;
+
+Status TieredRowStore::NewSegment(std::shared_ptr<Segment>* segment) {
+  auto result = std::make_shared<Segment>();
+  result->env = env_;
+  result->path = absl::StrCat(path_, ".", num_segments_++);
+  TF_RETURN_IF_ERROR(env_->NewWritableFile(result->path, &result->writer));
+  TF_RETURN_IF_ERROR(
+      env_->NewRandomAccessFile(result->path, &result->reader));
+  *segment = std::move(result);
+  return OkStatus();
+}
+
+void TieredRowStore::Touch(CacheEntry& entry) {
+  lru_.splice(lru_.begin(), lru_, entry.lru_position);
+}
+
+StatusOr<int64_t> TieredRowStore::Admit(int64_t key) {
+  if (!free_slots_.empty()) {
+    const int64_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+  }
+  if (lru_.empty()) return -1;
+  const int64_t victim = lru_.back();
+  if (sketch_->Frequency(key) <= sketch_->Frequency(victim)) return -1;
+  auto it = cache_.find(victim);
+  const int64_t slot = it->second.slot;
+  if (it->second.dirty) {
+    TF_RETURN_IF_ERROR(WriteRow(victim, CacheRow(slot)));
+  }
+  lru_.pop_back();
+  cache_.erase(it);
+  return slot;
+}
+
+Status TieredRowStore::WriteRow(int64_t key, const char* row) {
+  TF_RETURN_IF_ERROR(segment_->writer->Append(StringPiece(row, row_bytes_)));
+  file_index_[key] = segment_->size;
+  segment_->size += row_bytes_;
+  return OkStatus();
+}
+
+Status TieredRowStore::FinishWrites() {
+  const int64_t garbage_bytes =
+      segment_->size - static_cast<int64_t>(file_index_.size()) * row_bytes_;
+  if (garbage_bytes > min_garbage_bytes_ &&
+      garbage_bytes > max_garbage_fraction_ * segment_->size) {
+    return Compact();
+  }
+  return segment_->writer->Flush();
+}
+
+Status TieredRowStore::Compact() {
+  TF_RETURN_IF_ERROR(segment_->writer->Flush());
+  std::shared_ptr<Segment> segment;
+  TF_RETURN_IF_ERROR(NewSegment(&segment));
+  // The index is only updated once the new file is complete, so that a failed
+  // compaction leaves the store unchanged.
+  std::vector<int64_t> offsets;
+  offsets.reserve(file_index_.size());
+  std::vector<char> row(row_bytes_);
+  for (const auto& [key, offset] : file_index_) {
+    TF_RETURN_IF_ERROR(ReadRow(*segment_, offset, row.data()));
+    TF_RETURN_IF_ERROR(
+        segment->writer->Append(StringPiece(row.data(), row_bytes_)));
+    offsets.push_back(segment->size);
+    segment->size += row_bytes_;
+  }
+  TF_RETURN_IF_ERROR(segment->writer->Flush());
+  auto offset = offsets.begin();
+  for (auto& entry : file_index_) entry.second = *offset++;
+  // Lookups in flight keep reading the previous file, which is deleted once
+  // they complete.
+  segment_ = std::move(segment);
+  ++stats_.compactions;
+  return OkStatus();
+}
+
+Status TieredRowStore::ReadRow(const Segment& segment, int64_t offset,
+                               char* row) const {
+  StringPiece result;
+  Status s = segment.reader->Read(offset, row_bytes_, &result, row);
+  if (result.size() != row_bytes_) {
+    return errors::DataLoss("Failed to read the row at offset ", offset,
+                            " of ", segment.path, ": ", s);
+  }
+  if (result.data() != row) memmove(row, result.data(), row_bytes_);
+  return OkStatus();
+}
+
+Status TieredRowStore::Find(absl::Span<const int64_t> keys, char* rows,
+                            std::vector<bool>* found,
+                            thread::ThreadPool* thread_pool, Stats* stats) {
+  struct Miss {
+    int64_t index;
+    int64_t offset;
+    Status status;
+  };
+  std::vector<Miss> misses;
+  std::shared_ptr<Segment> segment;
+  Stats batch_stats;
+  found->assign(keys.size(), false);
+  {
+    mutex_lock l(mu_);
+    for (int64_t i = 0; i < keys.size(); ++i) {
+      const int64_t key = keys[i];
+      sketch_->Increment(key);
+      auto cached = cache_.find(key);
+      if (cached != cache_.end()) {
+        memcpy(rows + i * row_bytes_, CacheRow(cached->second.slot),
+               row_bytes_);
+        Touch(cached->second);
+        (*found)[i] = true;
+        ++batch_stats.hits;
+        continue;
+      }
+      auto indexed = file_index_.find(key);
+      if (indexed != file_index_.end()) {
+        misses.push_back({i, indexed->second, OkStatus()});
+        ++batch_stats.misses;
+      } else {
+        ++batch_stats.absent;
+      }
+    }
+    segment = segment_;
+    stats_.hits += batch_stats.hits;
+    stats_.misses += batch_stats.misses;
+    stats_.absent += batch_stats.absent;
+  }
+  if (stats != nullptr) *stats = batch_stats;
+  if (misses.empty()) return OkStatus();
+
+  // Reads mostly wait on the disk, so each thread reads a contiguous share of
+  // the misses rather than splitting them by cost.
+  const int64_t num_blocks =
+      thread_pool == nullptr
+          ? 1
+          : std::min<int64_t>(misses.size(), thread_pool->NumThreads() + 1);
+  const int64_t block_size = (misses.size() + num_blocks - 1) / num_blocks;
+  auto read_block = [&](int64_t block) {
+    const int64_t end =
+        std::min<int64_t>((block + 1) * block_size, misses.size());
+    for (int64_t j = block * block_size; j < end; ++j) {
+      Miss& miss = misses[j];
+      miss.status =
+          ReadRow(*segment, miss.offset, rows + miss.index * row_bytes_);
+    }
+  };
+  // The calling thread and the threads of `thread_pool` claim blocks until
+  // none is left, and the calling thread then only waits for the blocks
+  // claimed by others, which are being read. Lookups thus complete even when
+  // they run on a thread of `thread_pool` while the others are busy. Closures
+  // that run after the lookup completes find no block to claim, and do not
+  // touch its state other than `progress`.
+  struct Progress {
+    explicit Progress(int64_t num_blocks) : done(num_blocks) {}
+    std::atomic<int64_t> next_block{0};
+    BlockingCounter done;
+  };
+  auto progress = std::make_shared<Progress>(num_blocks);
+  auto claim_blocks = [progress, num_blocks, &read_block]() {
+    for (int64_t block = progress->next_block.fetch_add(1);
+         block < num_blocks; block = progress->next_block.fetch_add(1)) {
+      read_block(block);
+      progress->done.DecrementCount();
+    }
+  };
+  for (int64_t i = 1; i < num_blocks; ++i) thread_pool->Schedule(claim_blocks);
+  claim_blocks();
+  progress->done.Wait();
+
+  mutex_lock l(mu_);
+  for (const Miss& miss : misses) {
+    TF_RETURN_IF_ERROR(miss.status);
+    (*found)[miss.index] = true;
+    // Only rows that were not overwritten since they were read are cached.
+    const int64_t key = keys[miss.index];
+    if (segment != segment_ || cache_.count(key) > 0) continue;
+    auto indexed = file_index_.find(key);
+    if (indexed == file_index_.end() || indexed->second != miss.offset) {
+      continue;
+    }
+    TF_ASSIGN_OR_RETURN(const int64_t slot, Admit(key));
+    if (slot < 0) continue;
+    memcpy(CacheRow(slot), rows + miss.index * row_bytes_, row_bytes_);
+    lru_.push_front(key);
+    cache_[key] = {slot, lru_.begin(), /*dirty=*/false};
+  }
+  // Makes the rows of dirty evicted entries readable.
+  return FinishWrites();
+}
+
+Status TieredRowStore::Insert(absl::Span<const int64_t> keys,
+                              const char* rows) {
+  mutex_lock l(mu_);
+  for (int64_t i = 0; i < keys.size(); ++i) {
+    const int64_t key = keys[i];
+    const char* row = rows + i * row_bytes_;
+    sketch_->Increment(key);
+    auto cached = cache_.find(key);
+    if (cached != cache_.end()) {
+      memcpy(CacheRow(cached->second.slot), row, row_bytes_);
+      cached->second.dirty = true;
+      Touch(cached->second);
+      continue;
+    }
+    if (file_index_.count(key) == 0) ++num_keys_;
+    TF_ASSIGN_OR_RETURN(const int64_t slot, Admit(key));
+    if (slot < 0) {
+      TF_RETURN_IF_ERROR(WriteRow(key, row));
+      continue;
+    }
+    memcpy(CacheRow(slot), row, row_bytes_);
+    lru_.push_front(key);
+    cache_[key] = {slot, lru_.begin(), /*dirty=*/true};
+  }
+  return FinishWrites();
+}
+
+void TieredRowStore::Remove(absl::Span<const int64_t> keys) {
+  mutex_lock l(mu_);
+  for (const int64_t key : keys) {
+    bool removed = file_index_.erase(key) > 0;
+    auto cached = cache_.find(key);
+    if (cached != cache_.end()) {
+      free_slots_.push_back(cached->second.slot);
+      lru_.erase(cached->second.lru_position);
+      cache_.erase(cached);
+      removed = true;
+    }
+    if (removed) --num_keys_;
+  }
+}
+
+Status TieredRowStore::Clear() {
+  mutex_lock l(mu_);
+  // Lookups in flight keep reading the previous file, which is deleted once
+  // they complete.
+  TF_RETURN_IF_ERROR(NewSegment(&segment_));
+  file_index_.clear();
+  cache_.clear();
+  lru_.clear();
+  free_slots_.clear();
+  for (int64_t slot = cache_capacity_ - 1; slot >= 0; --slot) {
+    free_slots_.push_back(slot);
+  }
+  num_keys_ = 0;
+  return OkStatus();
+}
+
+Status TieredRowStore::ForEach(
+    const std::function<void(int64_t, const char*)>& fn) {
+  mutex_lock l(mu_);
+  for (const auto& [key, entry] : cache_) {
+    fn(key, CacheRow(entry.slot));
+  }
+  std::vector<char> row(row_bytes_);
+  for (const auto& [key, offset] : file_index_) {
+    if (cache_.count(key) > 0) continue;
+    TF_RETURN_IF_ERROR(ReadRow(*segment_, offset, row.data()));
+    fn(key, row.data());
+  }
+  return OkStatus();
+}
+
+int64_t TieredRowStore::size() const {
+  mutex_lock l(mu_);
+  return num_keys_;
+}
+
+int64_t TieredRowStore::FileBytes() const {
+  mutex_lock l(mu_);
+  return segment_->size;
+}
+
+int64_t TieredRowStore::MemoryUsed() const {
+  mutex_lock l(mu_);
+  // Approximates the nodes of the hash maps and of the list by their
+  // contents and two pointers.
+  constexpr int64_t kNodeOverhead = 2 * sizeof(void*);
+  return sizeof(TieredRowStore) + cache_rows_.size() +
+         free_slots_.capacity() * sizeof(int64_t) +
+         cache_.size() * (sizeof(int64_t) + sizeof(CacheEntry) +
+                          kNodeOverhead) +
+         lru_.size() * (sizeof(int64_t) + kNodeOverhead) +
+         file_index_.size() * (2 * sizeof(int64_t) + kNodeOverhead) +
+         sketch_->MemoryUsed();
+}
+
+TieredRowStore::Stats TieredRowStore::GetStats() const {
+  mutex_lock l(mu_);
+  return stats_;
+}
+
+}  // namespace lookup
+}  // namespace tensorflow
@@ -0,0 +1,223 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_TIERED_ROW_STORE_H_
+#define TENSORFLOW_CORE_KERNELS_TIERED_ROW_STORE_H_
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace lookup {
+
+// Stores fixed-size rows of bytes by int64 key, e.g. the rows of an embedding
+// table, in two tiers: a bounded in-memory cache of the most frequently used
+// rows, and a file that holds the others.
+//
+// The file is a log of rows: rows written to it are appended, and an in-memory
+// index maps each key to the offset of its latest row. Only the index, of a few
+// bytes per key, has to fit in memory. Overwritten and removed rows are
+// garbage: once they make up more than `max_garbage_fraction` of the file, and
+// more than `min_garbage_bytes`, the store rewrites the file with only the
+// latest rows. The rewrite holds the lock of the store, so lookups and inserts
+// wait for it, but with the default `max_garbage_fraction` of 0.5 it copies
+// fewer rows than were overwritten or removed since the previous rewrite.
+//
+// Rows enter the cache when they are inserted or read from the file, subject
+// to admission: when the cache is full, a row replaces the least recently used
+// one only if its key was used more often, as estimated by a count-min sketch
+// of recent accesses. Rows of keys used once, e.g. in a scan, thus do not evict
+// the hot rows. Evicted rows are written to the file if they changed.
+//
+// Lookups read the rows missing from the cache in parallel, outside of the lock
+// of the store. They keep reading the file they started with if the store
+// rewrites it in the meantime.
+//
+// This class is thread-safe.
+class TieredRowStore {
+ public:
+  struct Options {
+    // Prefix of the path of the file holding the rows that are not cached.
+    // The store creates the file, replaces it when cleared and deletes it when
+    // destroyed.
+    std::string path;
+    // Size of the rows, in bytes.
+    int64_t row_bytes = 0;
+    // Maximum number of rows held in memory.
+    int64_t cache_capacity = 0;
+    // The file is rewritten once it holds more than `min_garbage_bytes` of
+    // overwritten or removed rows, and these are more than
+    // `max_garbage_fraction` of its size.
+    int64_t min_garbage_bytes = 64 << 20;
+    double max_garbage_fraction = 0.5;
+  };
+
+  // Activity of the store since it was created.
+  struct Stats {
+    // Keys looked up whose rows were in the cache.
+    int64_t hits = 0;
+    // Keys looked up whose rows were read from the file.
+    int64_t misses = 0;
+    // Keys looked up that are not in the store.
+    int64_t absent = 0;
+    // Rewrites of the file that dropped its garbage.
+    int64_t compactions = 0;
+  };
+
+  static Status Create(Env* env, const Options& options,
+                       std::unique_ptr<TieredRowStore>* store);
+
+  ~TieredRowStore();
+
+  // Copies the row of `keys[i]` to `rows + i * row_bytes` and sets `found[i]`
+  // if the store contains `keys[i]`, for each `i`. Rows missing from the cache
+  // are read in parallel by the calling thread and the threads of
+  // `thread_pool`, if not null, or else sequentially by the calling thread.
+  // Find may be called from a thread of `thread_pool`. If `stats` is not null,
+  // its key counts are set to those of this lookup.
+  Status Find(absl::Span<const int64_t> keys, char* rows,
+              std::vector<bool>* found, thread::ThreadPool* thread_pool,
+              Stats* stats = nullptr);
+
+  // Inserts or overwrites the row of `keys[i]` with the one at
+  // `rows + i * row_bytes`, for each `i`.
+  Status Insert(absl::Span<const int64_t> keys, const char* rows);
+
+  void Remove(absl::Span<const int64_t> keys);
+
+  // Removes all the rows and truncates the file.
+  Status Clear();
+
+  // Calls `fn(key, row)` for each row of the store. The store is locked for
+  // the duration of the call.
+  Status ForEach(const std::function<void(int64_t, const char*)>& fn);
+
+  // Number of keys in the store.
+  int64_t size() const;
+
+  int64_t row_bytes() const { return row_bytes_; }
+
+  int64_t cache_capacity() const { return cache_capacity_; }
+
+  // Bytes of memory used by the cache and the index.
+  int64_t MemoryUsed() const;
+
+  // Size of the file, including its garbage.
+  int64_t FileBytes() const;
+
+  Stats GetStats() const;
+
+ private:
+  class FrequencySketch;
+
+  // A file of rows. Lookups hold a reference to the file they read, which
+  // `Clear` may replace in the meantime.
+  struct Segment {
+    ~Segment();
+
+    Env* env;
+    std::string path;
+    // Only used while holding `mu_`.
+    std::unique_ptr<WritableFile> writer;
+    std::unique_ptr<RandomAccessFile> reader;
+    int64_t size = 0;
+  };
+
+  // A row held in the cache.
+  struct CacheEntry {
+    // Index of the row in `cache_rows_`.
+    int64_t slot;
+    // Position of the key in `lru_`.
+    std::list<int64_t>::iterator lru_position;
+    // Whether the row differs from the one in the file, if any.
+    bool dirty;
+  };
+
+  TieredRowStore(Env* env, const Options& options);
+
+  // Creates the file of the next generation.
+  Status NewSegment(std::shared_ptr<Segment>* segment)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  char* CacheRow(int64_t slot) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return cache_rows_.data() + slot * row_bytes_;
+  }
+
+  // Moves the entry of `key` to the front of the LRU list.
+  void Touch(CacheEntry& entry) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns a cache slot for `key`, which must not be cached, evicting the
+  // least recently used row if the cache is full and `key` is used more often.
+  // Returns -1 if `key` is not admitted.
+  StatusOr<int64_t> Admit(int64_t key) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Appends `row` to the file and points the index of `key` at it. The row
+  // can only be read once the file is flushed.
+  Status WriteRow(int64_t key, const char* row)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Makes the rows written since the last call readable, after rewriting the
+  // file if it holds too much garbage.
+  Status FinishWrites() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Replaces the file with one holding only the rows of `file_index_`.
+  Status Compact() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Status ReadRow(const Segment& segment, int64_t offset, char* row) const;
+
+  Env* const env_;
+  const std::string path_;
+  const int64_t row_bytes_;
+  const int64_t cache_capacity_;
+  const int64_t min_garbage_bytes_;
+  const double max_garbage_fraction_;
+
+  mutable mutex mu_;
+  int64_t num_segments_ TF_GUARDED_BY(mu_) = 0;
+  std::shared_ptr<Segment> segment_ TF_GUARDED_BY(mu_);
+  // Offsets in the file of the latest written row of each key.
+  std::unordered_map<int64_t, int64_t> file_index_ TF_GUARDED_BY(mu_);
+  std::unordered_map<int64_t, CacheEntry> cache_ TF_GUARDED_BY(mu_);
+  // Keys of `cache_`, the most recently used first.
+  std::list<int64_t> lru_ TF_GUARDED_BY(mu_);
+  std::vector<char> cache_rows_ TF_GUARDED_BY(mu_);
+  std::vector<int64_t> free_slots_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<FrequencySketch> sketch_ TF_GUARDED_BY(mu_);
+  // Number of keys in the cache or the file, or both.
+  int64_t num_keys_ TF_GUARDED_BY(mu_) = 0;
+  Stats stats_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(TieredRowStore);
+};
+
+}  // namespace lookup
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_TIERED_ROW_STORE_H_
@@ -0,0 +1,294 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/tiered_row_store.h"
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+constexpr int64_t kRowSize = 4;
+
+std::unique_ptr<TieredRowStore> CreateStore(int64_t cache_capacity,
+                                            int64_t min_garbage_bytes = 0) {
+  TieredRowStore::Options options;
+  CHECK(Env::Default()->LocalTempFilename(&options.path));
+  options.row_bytes = kRowSize * sizeof(float);
+  options.cache_capacity = cache_capacity;
+  options.min_garbage_bytes = min_garbage_bytes;
+  std::unique_ptr<TieredRowStore> store;
+  TF_CHECK_OK(TieredRowStore::Create(Env::Default(), options, &store));
+  return store;
+}
+
+std::vector<float> Row(int64_t key) {
+  std::vector<float> row(kRowSize);
+  for (int64_t i = 0; i < kRowSize; ++i) row[i] = key * 10 + i;
+  return row;
+}
+
+Status Insert(TieredRowStore* store, int64_t key, std::vector<float> row) {
+  return store->Insert({key}, reinterpret_cast<const char*>(row.data()));
+}
+
+// Looks up `keys` and checks that each row equals Row(key) if `present`.
+void ExpectRows(TieredRowStore* store, const std::vector<int64_t>& keys,
+                bool present, thread::ThreadPool* thread_pool = nullptr) {
+  std::vector<float> rows(keys.size() * kRowSize);
+  std::vector<bool> found;
+  TF_ASSERT_OK(store->Find(keys, reinterpret_cast<char*>(rows.data()), &found,
+                           thread_pool));
+  for (int64_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(found[i], present) << keys[i];
+    if (!present) continue;
+    std::vector<float> row(rows.begin() + i * kRowSize,
+                           rows.begin() + (i + 1) * kRowSize);
+    EXPECT_EQ(row, Row(keys[i])) << keys[i];
+  }
+}
+
+TEST(TieredRowStore, InvalidOptions) {
+  TieredRowStore::Options options;
+  std::unique_ptr<TieredRowStore> store;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      TieredRowStore::Create(Env::Default(), options, &store)));
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&options.path));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      TieredRowStore::Create(Env::Default(), options, &store)));
+  options.row_bytes = 8;
+  options.cache_capacity = -1;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      TieredRowStore::Create(Env::Default(), options, &store)));
+  options.cache_capacity = 0;
+  options.max_garbage_fraction = 1.5;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      TieredRowStore::Create(Env::Default(), options, &store)));
+}
+
+TEST(TieredRowStore, SpillsToFile) {
+  auto store = CreateStore(/*cache_capacity=*/8);
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 100; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+    keys.push_back(key);
+  }
+  EXPECT_EQ(store->size(), 100);
+  ExpectRows(store.get(), keys, /*present=*/true);
+  ExpectRows(store.get(), {100, -1}, /*present=*/false);
+
+  TieredRowStore::Stats stats = store->GetStats();
+  EXPECT_EQ(stats.hits + stats.misses, 100);
+  EXPECT_GE(stats.misses, 100 - 8);
+  EXPECT_EQ(stats.absent, 2);
+}
+
+TEST(TieredRowStore, ParallelMisses) {
+  auto store = CreateStore(/*cache_capacity=*/4);
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 1000; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+    keys.push_back(key);
+  }
+  thread::ThreadPool pool(Env::Default(), "test", /*num_threads=*/4);
+  ExpectRows(store.get(), keys, /*present=*/true, &pool);
+}
+
+TEST(TieredRowStore, FindFromThreadPool) {
+  auto store = CreateStore(/*cache_capacity=*/0);
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 100; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+    keys.push_back(key);
+  }
+  // Every thread of the pool looks up rows with the pool at the same time.
+  constexpr int kNumThreads = 4;
+  thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+  BlockingCounter counter(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    pool.Schedule([&]() {
+      ExpectRows(store.get(), keys, /*present=*/true, &pool);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
+TEST(TieredRowStore, Overwrite) {
+  auto store = CreateStore(/*cache_capacity=*/2);
+  for (int64_t key = 0; key < 10; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(-key)));
+  }
+  for (int64_t key = 0; key < 10; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+  }
+  EXPECT_EQ(store->size(), 10);
+  ExpectRows(store.get(), {0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, /*present=*/true);
+}
+
+TEST(TieredRowStore, CompactsGarbage) {
+  auto store = CreateStore(/*cache_capacity=*/0);
+  constexpr int64_t kNumKeys = 10;
+  const int64_t row_bytes = store->row_bytes();
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < kNumKeys; ++key) keys.push_back(key);
+  for (int i = 0; i < 20; ++i) {
+    for (int64_t key : keys) {
+      TF_ASSERT_OK(Insert(store.get(), key, Row(i % 2 == 0 ? -key : key)));
+      // At most half of the file is garbage, plus the last row written.
+      EXPECT_LE(store->FileBytes(), (2 * kNumKeys + 1) * row_bytes);
+    }
+  }
+  EXPECT_GT(store->GetStats().compactions, 0);
+  ExpectRows(store.get(), keys, /*present=*/true);
+
+  // Removed rows are garbage too.
+  store->Remove({0, 1, 2, 3, 4, 5, 6, 7});
+  TF_ASSERT_OK(Insert(store.get(), 9, Row(9)));
+  EXPECT_LE(store->FileBytes(), 2 * row_bytes);
+  ExpectRows(store.get(), {8, 9}, /*present=*/true);
+  ExpectRows(store.get(), {0, 7}, /*present=*/false);
+}
+
+TEST(TieredRowStore, KeepsGarbageBelowMinimum) {
+  auto store = CreateStore(/*cache_capacity=*/0,
+                           /*min_garbage_bytes=*/int64_t{1} << 20);
+  for (int i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(Insert(store.get(), 1, Row(1)));
+  }
+  EXPECT_EQ(store->FileBytes(), 10 * store->row_bytes());
+  EXPECT_EQ(store->GetStats().compactions, 0);
+}
+
+TEST(TieredRowStore, HotKeysStayCached) {
+  auto store = CreateStore(/*cache_capacity=*/4);
+  const std::vector<int64_t> hot_keys = {1, 2, 3, 4};
+  for (int64_t key : hot_keys) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+  }
+  for (int i = 0; i < 5; ++i) {
+    ExpectRows(store.get(), hot_keys, /*present=*/true);
+  }
+  // A scan of keys used once does not evict the hot keys.
+  for (int64_t key = 100; key < 200; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+    ExpectRows(store.get(), {key}, /*present=*/true);
+  }
+  TieredRowStore::Stats before = store->GetStats();
+  ExpectRows(store.get(), hot_keys, /*present=*/true);
+  TieredRowStore::Stats after = store->GetStats();
+  EXPECT_EQ(after.hits - before.hits, hot_keys.size());
+}
+
+TEST(TieredRowStore, RemoveAndClear) {
+  auto store = CreateStore(/*cache_capacity=*/2);
+  for (int64_t key = 0; key < 6; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+  }
+  store->Remove({0, 5, 42});
+  EXPECT_EQ(store->size(), 4);
+  ExpectRows(store.get(), {0, 5}, /*present=*/false);
+  ExpectRows(store.get(), {1, 2, 3, 4}, /*present=*/true);
+
+  TF_ASSERT_OK(store->Clear());
+  EXPECT_EQ(store->size(), 0);
+  ExpectRows(store.get(), {1, 2, 3, 4}, /*present=*/false);
+  TF_ASSERT_OK(Insert(store.get(), 3, Row(3)));
+  ExpectRows(store.get(), {3}, /*present=*/true);
+}
+
+TEST(TieredRowStore, ForEach) {
+  auto store = CreateStore(/*cache_capacity=*/3);
+  for (int64_t key = 0; key < 20; ++key) {
+    TF_ASSERT_OK(Insert(store.get(), key, Row(key)));
+  }
+  std::map<int64_t, std::vector<float>> rows;
+  TF_ASSERT_OK(store->ForEach([&](int64_t key, const char* row) {
+    const float* values = reinterpret_cast<const float*>(row);
+    rows[key] = std::vector<float>(values, values + kRowSize);
+  }));
+  ASSERT_EQ(rows.size(), 20);
+  for (const auto& [key, row] : rows) {
+    EXPECT_EQ(row, Row(key));
+  }
+}
+
+// Looks up batches of keys drawn from a Zipf-like distribution, as in the
+// embeddings of a recommendation model, with a cache of 1% of the rows.
+// Reports the hit rate of the cache.
+void BM_ZipfLookup(::testing::benchmark::State& state) {
+  const int64_t num_keys = state.range(0);
+  const int num_threads = state.range(1);
+  constexpr int64_t kBatchSize = 1024;
+  TieredRowStore::Options options;
+  CHECK(Env::Default()->LocalTempFilename(&options.path));
+  options.row_bytes = 64 * sizeof(float);
+  options.cache_capacity = num_keys / 100;
+  std::unique_ptr<TieredRowStore> store;
+  TF_CHECK_OK(TieredRowStore::Create(Env::Default(), options, &store));
+  std::vector<char> rows(kBatchSize * options.row_bytes, 1);
+  std::vector<int64_t> keys(kBatchSize);
+  for (int64_t key = 0; key < num_keys; key += kBatchSize) {
+    for (int64_t i = 0; i < kBatchSize; ++i) keys[i] = key + i;
+    TF_CHECK_OK(store->Insert(keys, rows.data()));
+  }
+  std::unique_ptr<thread::ThreadPool> pool;
+  if (num_threads > 1) {
+    pool = std::make_unique<thread::ThreadPool>(Env::Default(), "bm",
+                                                num_threads);
+  }
+
+  random::PhiloxRandom philox(42);
+  random::SimplePhilox rnd(&philox);
+  const TieredRowStore::Stats before = store->GetStats();
+  std::vector<bool> found;
+  for (auto s : state) {
+    for (int64_t i = 0; i < kBatchSize; ++i) {
+      // Approximates a Zipf distribution of exponent 1 by a log-uniform one.
+      keys[i] = static_cast<int64_t>(
+                    std::exp(rnd.RandDouble() * std::log(num_keys))) -
+                1;
+    }
+    TF_CHECK_OK(store->Find(keys, rows.data(), &found, pool.get()));
+  }
+  const TieredRowStore::Stats after = store->GetStats();
+  const int64_t hits = after.hits - before.hits;
+  const int64_t lookups = hits + after.misses - before.misses;
+  state.counters["hit_rate"] =
+      lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+
+BENCHMARK(BM_ZipfLookup)
+    ->ArgPair(1 << 16, 1)
+    ->ArgPair(1 << 16, 8)
+    ->ArgPair(1 << 20, 1)
+    ->ArgPair(1 << 20, 8);
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
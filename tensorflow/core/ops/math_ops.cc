@@ -1491,6 +1491,44 @@ REGISTER_OP("SparseSegmentSqrtNGrad")
     .Attr("Tsegmentids: {int32, int64} = DT_INT32")
     .SetShapeFn(SparseSegmentReductionGradShapeFn);
 
+REGISTER_OP("_FusedSparseSegmentReduce")
+    .Input("data: T")
+    .Input("indices: Tidx")
+    .Input("segment_ids: Tsegmentids")
+    .Input("weights: num_weights * T")
+    .Output("output: T")
+    .Attr("T: {float, bfloat16}")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .Attr("num_weights: int >= 0 = 0")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'sum'")
+    .SetShapeFn([](InferenceContext* c) {
+      TF_RETURN_IF_ERROR(SparseSegmentReductionShapeFn(c));
+      for (int i = 3; i < c->num_inputs(); ++i) {
+        ShapeHandle weights_shape;
+        TF_RETURN_IF_ERROR(c->WithRank(c->input(i), 1, &weights_shape));
+        // weights and indices should merge cleanly.
+        ShapeHandle unused;
+        TF_RETURN_IF_ERROR(c->Merge(weights_shape, c->input(1), &unused));
+      }
+      return OkStatus();
+    })
+    .Doc(R"doc(
+Computes the weighted sums of the rows of `data` gathered at `indices` along
+segments, as `embedding_lookup_sparse` does.
+
+For each segment `s`, computes `sum(weights[i] * data[indices[i]]) / norm(s)`
+over the `i` such that `segment_ids[i] == s`, where `norm(s)` is 1 for the
+"sum" combiner, the sum of the weights for "mean" and the square root of the
+sum of their squares for "sqrtn". Segments whose norm is 0 are 0. Without
+weights (`num_weights` = 0) all the weights are 1, which makes this op
+equivalent to SparseSegmentSum, SparseSegmentMean or SparseSegmentSqrtN.
+
+The rows are accumulated in float, without materializing the gathered rows.
+`segment_ids` must be sorted. Created by the remapper from GatherV2 followed by
+an optional multiplication by weights and SegmentSum; not differentiable.
+)doc");
+
 REGISTER_OP("All")
     .Input("input: bool")
     .Input("reduction_indices: Tidx")
@@ -14,8 +14,15 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <algorithm>
+#include <cstring>
+#include <optional>
 #include <vector>
 
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
 #include "absl/base/casts.h"
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/example/example.pb.h"
@@ -1125,6 +1132,232 @@ void CopySparseBufferToTensor(DataType dtype, size_t offset, SparseBuffer* src,
   }
 }
 
+// Reads a varint of at most 32 bits from [*p, end) and advances *p past it.
+inline bool ReadVarint32(const uint8** p, const uint8* end, uint32* value) {
+  uint32 result = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (*p == end) return false;
+    const uint8 byte = *(*p)++;
+    result |= static_cast<uint32>(byte & 0x7F) << shift;
+    if (byte < 0x80) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads a length-delimited field with the given tag from [*p, end) into
+// [*field_begin, *field_end) and advances *p past it.
+inline bool ReadDelimited(const uint8** p, const uint8* end, uint8 tag,
+                          const uint8** field_begin, const uint8** field_end) {
+  if (*p == end || **p != tag) return false;
+  ++*p;
+  uint32 length;
+  if (!ReadVarint32(p, end, &length)) return false;
+  if (static_cast<size_t>(end - *p) < length) return false;
+  *field_begin = *p;
+  *field_end = *p + length;
+  *p += length;
+  return true;
+}
+
+// Decodes exactly `n` packed varints from [p, end) into `out`.
+bool DecodePackedVarints(const uint8* p, const uint8* end, size_t n,
+                         int64_t* out) {
+  size_t i = 0;
+  while (i < n && p != end) {
+    // Small values are encoded in a single byte each, so runs of eight of them
+    // are widened at once.
+    if (n - i >= 8 && end - p >= 8) {
+#ifdef __SSE4_1__
+      const __m128i bytes =
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+      if ((_mm_movemask_epi8(bytes) & 0xFF) == 0) {
+        __m128i* dst = reinterpret_cast<__m128i*>(out + i);
+        _mm_storeu_si128(dst, _mm_cvtepu8_epi64(bytes));
+        _mm_storeu_si128(dst + 1, _mm_cvtepu8_epi64(_mm_srli_si128(bytes, 2)));
+        _mm_storeu_si128(dst + 2, _mm_cvtepu8_epi64(_mm_srli_si128(bytes, 4)));
+        _mm_storeu_si128(dst + 3, _mm_cvtepu8_epi64(_mm_srli_si128(bytes, 6)));
+        i += 8;
+        p += 8;
+        continue;
+      }
+#else
+      constexpr uint64 kContinuationBits = 0x8080808080808080ULL;
+      uint64 word;
+      std::memcpy(&word, p, sizeof(word));
+      if ((word & kContinuationBits) == 0) {
+        for (int k = 0; k < 8; ++k) out[i + k] = p[k];
+        i += 8;
+        p += 8;
+        continue;
+      }
+#endif  // __SSE4_1__
+    }
+    uint64 value = 0;
+    for (int shift = 0;; shift += 7) {
+      if (p == end || shift > 63) return false;
+      const uint8 byte = *p++;
+      value |= static_cast<uint64>(byte & 0x7F) << shift;
+      if (byte < 0x80) break;
+    }
+    out[i++] = static_cast<int64_t>(value);
+  }
+  return i == n && p == end;
+}
+
+// Maps the names of the features to parse to their index in `config.dense`.
+using DenseKeyTable = absl::flat_hash_map<StringPiece, size_t>;
+
+// Parses examples whose requested features are all fixed-length float or
+// int64 dense features, as is common for numeric data with a fixed schema.
+// Keys are looked up in a table built once per batch, and the keys of the
+// previous example are used to predict those of the next one, so that
+// examples sharing a schema are matched without hashing. Packed values are
+// decoded straight into the output tensors.
+//
+// Examples with another layout, e.g. with a missing, duplicated or unpacked
+// feature, or one with another type or size, are left to
+// `FastParseSerializedExample`, which also reports their errors.
+class DenseExampleParser {
+ public:
+  // Returns whether all features of `config` can be parsed by this class.
+  static bool Supports(const Config& config) {
+    if (!port::kLittleEndian || config.collect_feature_stats ||
+        !config.sparse.empty() || !config.ragged.empty() ||
+        config.dense.empty()) {
+      return false;
+    }
+    for (const Config::Dense& dense : config.dense) {
+      if (dense.variable_length ||
+          (dense.dtype != DT_FLOAT && dense.dtype != DT_INT64)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  DenseExampleParser(const Config& config, const DenseKeyTable& key_table)
+      : config_(config), key_table_(key_table), seen_(config.dense.size()) {}
+
+  // Parses `serialized` into row `example_index` of `output_dense`. Returns
+  // false if the example has to be parsed by `FastParseSerializedExample`.
+  bool Parse(StringPiece serialized, size_t example_index,
+             std::vector<Tensor>* output_dense) {
+    const uint8* p = reinterpret_cast<const uint8*>(serialized.data());
+    const uint8* const end = p + serialized.size();
+    std::fill(seen_.begin(), seen_.end(), false);
+    if (p != end) {
+      const uint8* features;
+      const uint8* features_end;
+      if (!ReadDelimited(&p, end, kDelimitedTag(1), &features, &features_end) ||
+          p != end) {
+        return false;
+      }
+      size_t position = 0;
+      while (features != features_end) {
+        const uint8* entry;
+        const uint8* entry_end;
+        const uint8* key;
+        const uint8* key_end;
+        const uint8* feature;
+        const uint8* feature_end;
+        if (!ReadDelimited(&features, features_end, kDelimitedTag(1), &entry,
+                           &entry_end) ||
+            !ReadDelimited(&entry, entry_end, kDelimitedTag(1), &key,
+                           &key_end) ||
+            !ReadDelimited(&entry, entry_end, kDelimitedTag(2), &feature,
+                           &feature_end) ||
+            entry != entry_end) {
+          return false;
+        }
+        const int64_t d = Lookup(
+            position++, StringPiece(reinterpret_cast<const char*>(key),
+                                    key_end - key));
+        if (d < 0) continue;
+        if (seen_[d]) return false;
+        seen_[d] = true;
+        if (!ParseFeature(d, feature, feature_end, example_index,
+                          output_dense)) {
+          return false;
+        }
+      }
+      previous_keys_.resize(position);
+    }
+    for (size_t d = 0; d < config_.dense.size(); ++d) {
+      if (seen_[d]) continue;
+      const Tensor& in = config_.dense[d].default_value;
+      if (in.NumElements() == 0) return false;
+      const size_t num_elements = in.NumElements();
+      Tensor& out = (*output_dense)[d];
+      if (config_.dense[d].dtype == DT_FLOAT) {
+        std::copy_n(in.flat<float>().data(), num_elements,
+                    out.flat<float>().data() + example_index * num_elements);
+      } else {
+        std::copy_n(in.flat<int64_t>().data(), num_elements,
+                    out.flat<int64_t>().data() + example_index * num_elements);
+      }
+    }
+    return true;
+  }
+
+ private:
+  // Returns the index in `config_.dense` of the feature with `key` at
+  // `position` of the feature map, or -1 if the feature is not requested.
+  int64_t Lookup(size_t position, StringPiece key) {
+    if (position < previous_keys_.size() &&
+        previous_keys_[position].first == key) {
+      return previous_keys_[position].second;
+    }
+    auto it = key_table_.find(key);
+    const int64_t d = it == key_table_.end() ? -1 : it->second;
+    if (position >= previous_keys_.size()) {
+      previous_keys_.resize(position + 1);
+    }
+    previous_keys_[position] = {key, d};
+    return d;
+  }
+
+  bool ParseFeature(size_t d, const uint8* p, const uint8* end,
+                    size_t example_index, std::vector<Tensor>* output_dense) {
+    const Config::Dense& dense = config_.dense[d];
+    const uint8 list_tag =
+        dense.dtype == DT_FLOAT ? kDelimitedTag(2) : kDelimitedTag(3);
+    const uint8* list;
+    const uint8* list_end;
+    const uint8* values;
+    const uint8* values_end;
+    if (!ReadDelimited(&p, end, list_tag, &list, &list_end) || p != end ||
+        !ReadDelimited(&list, list_end, kDelimitedTag(1), &values,
+                       &values_end) ||
+        list != list_end) {
+      return false;
+    }
+    const size_t num_elements = dense.elements_per_stride;
+    Tensor& out = (*output_dense)[d];
+    if (dense.dtype == DT_FLOAT) {
+      if (static_cast<size_t>(values_end - values) !=
+          num_elements * sizeof(float)) {
+        return false;
+      }
+      std::memcpy(out.flat<float>().data() + example_index * num_elements,
+                  values, num_elements * sizeof(float));
+      return true;
+    }
+    return DecodePackedVarints(
+        values, values_end, num_elements,
+        out.flat<int64_t>().data() + example_index * num_elements);
+  }
+
+  const Config& config_;
+  const DenseKeyTable& key_table_;
+  // The keys of the previous example and the index of their feature in
+  // `config_.dense`, or -1.
+  std::vector<std::pair<StringPiece, int64_t>> previous_keys_;
+  std::vector<bool> seen_;
+};
+
 }  // namespace
 
 Status FastParseExample(const Config& config,
@@ -1183,6 +1416,16 @@ Status FastParseExample(const Config& config,
     fixed_dense_values[d] = Tensor(config.dense[d].dtype, out_shape);
   }
 
+  // Examples with only fixed-length numeric dense features are parsed with a
+  // specialized parser first.
+  DenseKeyTable dense_key_table;
+  const bool use_dense_parser = DenseExampleParser::Supports(config);
+  if (use_dense_parser) {
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      dense_key_table[config.dense[d].feature_name] = d;
+    }
+  }
+
   // This parameter affects performance in a big and data-dependent way.
   const size_t kMiniBatchSizeBytes = 50000;
 
@@ -1231,7 +1474,13 @@ Status FastParseExample(const Config& config,
     ragged_buffers[minibatch].resize(config.ragged.size());
     size_t start = first_example_of_minibatch(minibatch);
     size_t end = first_example_of_minibatch(minibatch + 1);
+    std::optional<DenseExampleParser> dense_parser;
+    if (use_dense_parser) dense_parser.emplace(config, dense_key_table);
     for (size_t e = start; e < end; ++e) {
+      if (dense_parser.has_value() &&
+          dense_parser->Parse(serialized[e], e, &fixed_dense_values)) {
+        continue;
+      }
       PerExampleFeatureStats* stats = nullptr;
       if (config.collect_feature_stats) {
         stats = &result->feature_stats[e];
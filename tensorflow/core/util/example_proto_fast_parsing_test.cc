@@ -14,13 +14,19 @@ limitations under the License.
 ==============================================================================*/
 
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include "absl/strings/match.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -427,6 +433,133 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+// Returns a config with the given dense features. If `add_unused_sparse` is
+// set, it also requests a sparse feature that no example has, which makes
+// `FastParseExample` parse the examples with its general parser.
+FastParseExampleConfig DenseConfig(
+    const std::vector<std::pair<const char*, DataType>>& features,
+    int64_t num_values, bool add_unused_sparse) {
+  FastParseExampleConfig config;
+  for (const auto& [name, dtype] : features) {
+    AddDenseFeature(name, dtype, {num_values}, false, num_values, &config);
+    config.dense.back().default_value = Tensor();
+  }
+  if (add_unused_sparse) {
+    AddSparseFeature("unused", DT_INT64, &config);
+  }
+  return config;
+}
+
+string DenseExample(int64_t example_index, int64_t num_values, bool reverse) {
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  FloatList* float_list = features[kDenseFloatKey].mutable_float_list();
+  Int64List* int64_list = features[kDenseInt64Key].mutable_int64_list();
+  for (int64_t i = 0; i < num_values; ++i) {
+    float_list->add_value(example_index + i / 4.0f);
+    // Mixes single-byte, multi-byte and negative varints.
+    int64_list->add_value(i % 3 == 0   ? i
+                          : i % 3 == 1 ? example_index << (i % 50)
+                                       : -i);
+  }
+  features["unrequested"].mutable_bytes_list()->add_value("x");
+  string serialized = Serialize(example);
+  if (reverse) {
+    // Serializes the same features in another order.
+    Example reversed;
+    auto& reversed_features = *reversed.mutable_features()->mutable_feature();
+    reversed_features["unrequested"] = features["unrequested"];
+    reversed_features[kDenseInt64Key] = features[kDenseInt64Key];
+    reversed_features[kDenseFloatKey] = features[kDenseFloatKey];
+    serialized = Serialize(reversed);
+  }
+  return serialized;
+}
+
+TEST(FastParse, DenseOnlyMatchesGeneralParser) {
+  constexpr int64_t kNumValues = 20;
+  std::vector<tstring> serialized;
+  for (int64_t i = 0; i < 100; ++i) {
+    serialized.push_back(DenseExample(i, kNumValues, /*reverse=*/i % 7 == 0));
+  }
+  // A missing feature takes its default value.
+  serialized.push_back("");
+  const std::vector<std::pair<const char*, DataType>> features = {
+      {kDenseInt64Key, DT_INT64}, {kDenseFloatKey, DT_FLOAT}};
+  FastParseExampleConfig dense_config =
+      DenseConfig(features, kNumValues, /*add_unused_sparse=*/false);
+  FastParseExampleConfig general_config =
+      DenseConfig(features, kNumValues, /*add_unused_sparse=*/true);
+  for (FastParseExampleConfig* config : {&dense_config, &general_config}) {
+    config->dense[0].default_value =
+        test::AsTensor<int64_t>(std::vector<int64_t>(kNumValues, -1));
+    config->dense[1].default_value =
+        test::AsTensor<float>(std::vector<float>(kNumValues, 0.5f));
+  }
+
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  Result dense_result;
+  TF_ASSERT_OK(FastParseExample(dense_config, serialized, {}, &thread_pool,
+                                &dense_result));
+  Result general_result;
+  TF_ASSERT_OK(FastParseExample(general_config, serialized, {}, &thread_pool,
+                                &general_result));
+  ASSERT_EQ(dense_result.dense_values.size(), 2);
+  test::ExpectTensorEqual<int64_t>(dense_result.dense_values[0],
+                                   general_result.dense_values[0]);
+  test::ExpectTensorEqual<float>(dense_result.dense_values[1],
+                                 general_result.dense_values[1]);
+  EXPECT_EQ(dense_result.dense_values[0].matrix<int64_t>()(100, 0), -1);
+}
+
+TEST(FastParse, DenseOnlyReportsErrors) {
+  const std::vector<std::pair<const char*, DataType>> features = {
+      {kDenseInt64Key, DT_INT64}, {kDenseFloatKey, DT_FLOAT}};
+  FastParseExampleConfig config =
+      DenseConfig(features, /*num_values=*/4, /*add_unused_sparse=*/false);
+  Result result;
+
+  std::vector<tstring> wrong_size = {DenseExample(0, 4, false),
+                                     DenseExample(1, 3, false)};
+  Status status = FastParseExample(config, wrong_size, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(status));
+  EXPECT_TRUE(absl::StrContains(status.error_message(), "values != expected"));
+
+  std::vector<tstring> missing = {DenseExample(0, 4, false), ""};
+  status = FastParseExample(config, missing, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(status));
+  EXPECT_TRUE(absl::StrContains(status.error_message(),
+                                "is required but could not be found"));
+}
+
+void BM_ParseDenseExamples(::testing::benchmark::State& state) {
+  const int num_values = state.range(0);
+  const bool general_parser = state.range(1);
+  constexpr int kBatchSize = 512;
+  std::vector<tstring> serialized;
+  for (int i = 0; i < kBatchSize; ++i) {
+    serialized.push_back(DenseExample(i, num_values, /*reverse=*/false));
+  }
+  FastParseExampleConfig config =
+      DenseConfig({{kDenseInt64Key, DT_INT64}, {kDenseFloatKey, DT_FLOAT}},
+                  num_values, general_parser);
+  for (auto s : state) {
+    Result result;
+    TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+
+// Compares the specialized dense parser with the general one that
+// ParseExampleV2 used for all configs.
+BENCHMARK(BM_ParseDenseExamples)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 1);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
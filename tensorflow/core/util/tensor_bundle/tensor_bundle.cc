@@ -21,6 +21,7 @@ limitations under the License.
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -45,6 +46,8 @@ limitations under the License.
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
@@ -420,6 +423,67 @@ Status PadAlignment(tsl::BufferedWritableFile* out, int alignment,
   return status;
 }
 
+// Buffers appends to "file" and writes each full buffer from a background
+// thread, so that the caller can fill the next buffer while the previous one is
+// being written.  The full buffer is swapped with the one that was last
+// written rather than copied, so the output is double buffered with no extra
+// copy.  At most one append is in flight at a time.
+class BackgroundBufferedWritableFile : public tsl::BufferedWritableFile {
+ public:
+  BackgroundBufferedWritableFile(Env* env, std::unique_ptr<WritableFile> file,
+                                 int64_t buffer_size)
+      : tsl::BufferedWritableFile(std::move(file), buffer_size),
+        io_thread_(std::make_unique<thread::ThreadPool>(
+            env, "bundle_writer_io", 1)) {}
+
+  ~BackgroundBufferedWritableFile() override {
+    WaitForPendingAppend().IgnoreError();
+  }
+
+  Status Close() override {
+    TF_RETURN_IF_ERROR(WaitForPendingAppend());
+    return tsl::BufferedWritableFile::Close();
+  }
+
+  Status Flush() override {
+    TF_RETURN_IF_ERROR(WaitForPendingAppend());
+    return tsl::BufferedWritableFile::Flush();
+  }
+
+  Status Sync() override {
+    TF_RETURN_IF_ERROR(WaitForPendingAppend());
+    return tsl::BufferedWritableFile::Sync();
+  }
+
+ protected:
+  Status AppendFullBuffer(std::string* buffer) override {
+    TF_RETURN_IF_ERROR(WaitForPendingAppend());
+    std::swap(*buffer, pending_);
+    // Only the first swap hands back a buffer that has not been allocated.
+    if (buffer->size() != pending_.size()) buffer->resize(pending_.size());
+    append_done_ = std::make_unique<Notification>();
+    io_thread_->Schedule([this]() {
+      append_status_ = file()->Append(pending_);
+      append_done_->Notify();
+    });
+    return OkStatus();
+  }
+
+ private:
+  Status WaitForPendingAppend() {
+    if (append_done_ != nullptr) {
+      append_done_->WaitForNotification();
+      append_done_.reset();
+    }
+    return append_status_;
+  }
+
+  string pending_;
+  std::unique_ptr<Notification> append_done_;
+  Status append_status_;
+  std::unique_ptr<thread::ThreadPool> io_thread_;
+};
+
 }  // namespace
 
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
@@ -443,13 +507,38 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
   std::unique_ptr<WritableFile> wrapper;
   status_ = env_->NewWritableFile(data_path_, &wrapper);
   if (!status_.ok()) return;
-  out_ = std::make_unique<tsl::BufferedWritableFile>(
-      std::move(wrapper), 8 << 20 /* 8MB write buffer */);
+  if (options_.async_write) {
+    out_ = std::make_unique<BackgroundBufferedWritableFile>(
+        env_, std::move(wrapper), 8 << 20 /* 8MB write buffer */);
+    serializer_ = std::make_unique<thread::ThreadPool>(
+        env_, "bundle_writer_serializer", 1);
+  } else {
+    out_ = std::make_unique<tsl::BufferedWritableFile>(
+        std::move(wrapper), 8 << 20 /* 8MB write buffer */);
+  }
 
   VLOG(1) << "Writing to file " << data_path_;
 }
 
+BundleWriter::~BundleWriter() {
+  if (serializer_ != nullptr) WaitForPendingWrites();
+}
+
+Status BundleWriter::status() const {
+  if (serializer_ != nullptr) {
+    mutex_lock l(mu_);
+    Status s = status_;
+    s.Update(async_status_);
+    return s;
+  }
+  return status_;
+}
+
 Status BundleWriter::Add(StringPiece key, const Tensor& val) {
+  if (serializer_ != nullptr) {
+    mutex_lock l(mu_);
+    status_.Update(async_status_);
+  }
   if (!status_.ok()) return status_;
   CHECK_NE(key, kHeaderEntryKey);
   const string key_string(key);
@@ -458,32 +547,83 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
     return status_;
   }
 
+  // Pointers to map elements are stable, so the background thread may fill in
+  // the rest of "entry" while more entries are added.
   BundleEntryProto* entry = &entries_[key_string];
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
   entry->set_shard_id(0);
+
+  if (serializer_ != nullptr) {
+    // "val" is captured by value, which only takes a reference on its buffer.
+    Enqueue([this, entry, val]() {
+      {
+        mutex_lock l(mu_);
+        if (!async_status_.ok()) return;
+      }
+      Status s = WriteEntry(entry, val);
+      if (!s.ok()) {
+        mutex_lock l(mu_);
+        async_status_.Update(s);
+      }
+    });
+    return OkStatus();
+  }
+  status_ = WriteEntry(entry, val);
+  return status_;
+}
+
+Status BundleWriter::WriteEntry(BundleEntryProto* entry, const Tensor& val) {
   entry->set_offset(size_);
 
   // Updates the data file.
   size_t data_bytes_written = 0;
   uint32 crc32c = 0;
   out_->reset_crc32();
+  Status status;
   if (val.dtype() == DT_STRING) {
-    status_ = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
+    status = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
   } else if (val.dtype() == DT_VARIANT) {
-    status_ = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
+    status = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
   } else {
-    status_ = WriteTensor(val, out_.get(), &data_bytes_written);
+    status = WriteTensor(val, out_.get(), &data_bytes_written);
     crc32c = out_->crc32();
   }
 
-  if (status_.ok()) {
+  if (status.ok()) {
     entry->set_size(data_bytes_written);
     entry->set_crc32c(crc32c::Mask(crc32c));
     size_ += data_bytes_written;
-    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
+    status = PadAlignment(out_.get(), options_.data_alignment, &size_);
   }
-  return status_;
+  return status;
+}
+
+void BundleWriter::Enqueue(std::function<void()> fn) {
+  {
+    mutex_lock l(mu_);
+    pending_writes_.push_back(std::move(fn));
+    ++num_pending_writes_;
+  }
+  // The serializer has a single thread, and each closure runs the oldest
+  // pending function, so functions run in the order they were enqueued.
+  serializer_->Schedule([this]() {
+    std::function<void()> next;
+    {
+      mutex_lock l(mu_);
+      next = std::move(pending_writes_.front());
+      pending_writes_.pop_front();
+    }
+    next();
+    mutex_lock l(mu_);
+    if (--num_pending_writes_ == 0) writes_done_.notify_all();
+  });
+}
+
+void BundleWriter::WaitForPendingWrites() {
+  mutex_lock l(mu_);
+  while (num_pending_writes_ > 0) writes_done_.wait(l);
+  status_.Update(async_status_);
 }
 
 Status BundleWriter::AddSlice(StringPiece full_tensor_key,
@@ -527,9 +667,26 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
   return status_;
 }
 
+Status BundleWriter::Finish() {
+  if (serializer_ != nullptr) WaitForPendingWrites();
+  return FinishMetadata();
+}
+
+void BundleWriter::FinishAsync(std::function<void(const Status&)> done) {
+  CHECK(serializer_ != nullptr)
+      << "FinishAsync() requires BundleWriter::Options::async_write";
+  Enqueue([this, done = std::move(done)]() {
+    {
+      mutex_lock l(mu_);
+      status_.Update(async_status_);
+    }
+    done(FinishMetadata());
+  });
+}
+
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
-Status BundleWriter::Finish() {
+Status BundleWriter::FinishMetadata() {
   if (out_) {
     status_.Update(out_->Close());
     out_ = nullptr;
@@ -765,9 +922,186 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 
 // Interface for reading a tensor bundle.
 
+namespace {
+
+// Entries of at least this size are read directly into their tensor by
+// BundleReader::LookupMany(); smaller neighboring entries of the same shard are
+// coalesced into a single read of at most this size.
+const int64_t kMaxCoalescedReadBytes = 8 << 20;
+// Largest gap between two entries, e.g. alignment padding, that is read and
+// discarded in order to coalesce them.
+const int64_t kMaxCoalesceGapBytes = 64 << 10;
+
+// A full tensor restored by BundleReader::LookupMany().
+struct PendingRead {
+  int64_t offset;
+  int64_t size;
+  uint32 masked_crc32c;
+  Tensor* val;
+};
+
+// A sequential read of file[offset, offset + size) covering one or more
+// PendingReads of the same shard.
+struct CoalescedRead {
+  int64_t offset = 0;
+  int64_t size = 0;
+  std::vector<const PendingRead*> reads;
+};
+
+// Groups "reads", sorted by offset, into as few sequential reads as possible.
+std::vector<CoalescedRead> CoalesceReads(const std::vector<PendingRead>& reads) {
+  std::vector<CoalescedRead> runs;
+  for (const PendingRead& read : reads) {
+    if (!runs.empty()) {
+      CoalescedRead& last = runs.back();
+      const int64_t gap = read.offset - (last.offset + last.size);
+      if (gap >= 0 && gap <= kMaxCoalesceGapBytes &&
+          last.size + gap + read.size <= kMaxCoalescedReadBytes) {
+        last.size += gap + read.size;
+        last.reads.push_back(&read);
+        continue;
+      }
+    }
+    CoalescedRead run;
+    run.offset = read.offset;
+    run.size = read.size;
+    run.reads.push_back(&read);
+    runs.push_back(std::move(run));
+  }
+  return runs;
+}
+
+// Moves the bytes of every tensor covered by "run" out of "data", the contents
+// of file[run.offset, run.offset + run.size), and verifies their checksums.
+Status FinishCoalescedRead(const string& filename, const CoalescedRead& run,
+                           const char* data, bool need_to_swap_bytes) {
+  for (const PendingRead* read : run.reads) {
+    const char* src = data + (read->offset - run.offset);
+    const uint32 actual_crc32c = crc32c::Value(src, read->size);
+    if (crc32c::Unmask(read->masked_crc32c) != actual_crc32c) {
+      return errors::DataLoss(
+          "TensorBundle data file ", filename, " (", read->size,
+          " bytes at offset ", read->offset,
+          "): Checksum does not match: stored ",
+          strings::Printf("%08u", crc32c::Unmask(read->masked_crc32c)),
+          " vs. calculated on the restored bytes ", actual_crc32c);
+    }
+    char* dst = GetBackingBuffer(*read->val);
+    if (dst != src) memcpy(dst, src, read->size);
+    if (need_to_swap_bytes) {
+      TF_RETURN_IF_ERROR(ByteSwapTensor(read->val));
+    }
+  }
+  return OkStatus();
+}
+
+// Issues the sequential reads "runs" against "filename" in order.  Reads of a
+// single tensor land directly in its buffer; coalesced reads go through one of
+// two scratch buffers, so that one can be read into while the previous one is
+// being checksummed and scattered on "verify_pool".
+Status RestoreShard(Env* env, const string& filename,
+                    const std::vector<CoalescedRead>& runs,
+                    bool need_to_swap_bytes, thread::ThreadPool* verify_pool) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+
+  std::unique_ptr<char[]> scratch[2];
+  std::unique_ptr<Notification> verified[2];
+  Status verify_status[2];
+  Status status;
+  auto wait_for_slot = [&](int slot) {
+    if (verified[slot] == nullptr) return;
+    verified[slot]->WaitForNotification();
+    verified[slot].reset();
+    status.Update(verify_status[slot]);
+  };
+
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const int slot = i % 2;
+    wait_for_slot(slot);
+    if (!status.ok()) break;
+
+    const CoalescedRead& run = runs[i];
+    const bool in_place = run.reads.size() == 1;
+    char* buffer;
+    if (in_place) {
+      buffer = GetBackingBuffer(*run.reads[0]->val);
+    } else {
+      if (scratch[slot] == nullptr) {
+        scratch[slot].reset(new char[kMaxCoalescedReadBytes]);
+      }
+      buffer = scratch[slot].get();
+    }
+    StringPiece result;
+    status = file->Read(run.offset, run.size, &result, buffer);
+    if (status.ok() && result.size() != run.size) {
+      status = errors::DataLoss("Requested ", run.size, " bytes at offset ",
+                                run.offset, " of ", filename, " but read ",
+                                result.size());
+    }
+    if (!status.ok()) break;
+    if (in_place && result.data() != buffer) {
+      memmove(buffer, result.data(), run.size);
+      result = StringPiece(buffer, run.size);
+    }
+
+    verified[slot] = std::make_unique<Notification>();
+    Notification* done = verified[slot].get();
+    Status* run_status = &verify_status[slot];
+    const char* data = result.data();
+    verify_pool->Schedule([&filename, &run, data, need_to_swap_bytes,
+                           run_status, done]() {
+      *run_status =
+          FinishCoalescedRead(filename, run, data, need_to_swap_bytes);
+      done->Notify();
+    });
+  }
+  wait_for_slot(0);
+  wait_for_slot(1);
+  return status;
+}
+
+BundleReader::Options LegacyReaderOptions(
+    bool enable_multi_threading_for_testing) {
+  BundleReader::Options options;
+  options.enable_multi_threading_for_testing =
+      enable_multi_threading_for_testing;
+  return options;
+}
+
+// A TensorBuffer aliasing a range of a memory-mapped bundle data file.  Holds a
+// reference to the mapping, so that the restored tensor may outlive the
+// BundleReader that produced it.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("bundle_reader_mmap");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
+}  // namespace
+
 BundleReader::BundleReader(
     Env* env, StringPiece prefix,
     bool enable_multi_threading_for_testing /* = false */)
+    : BundleReader(env, prefix,
+                   LegacyReaderOptions(enable_multi_threading_for_testing)) {}
+
+BundleReader::BundleReader(Env* env, StringPiece prefix, const Options& options)
     : env_(env),
       prefix_(prefix),
       metadata_(nullptr),
@@ -775,7 +1109,9 @@ BundleReader::BundleReader(
       index_cache_(nullptr),
       iter_(nullptr),
       need_to_swap_bytes_(false),
-      enable_multi_threading_for_testing_(enable_multi_threading_for_testing) {
+      options_(options),
+      enable_multi_threading_for_testing_(
+          options.enable_multi_threading_for_testing) {
   const string filename = MetaFilename(prefix_);
   uint64 file_size;
   status_ = env_->GetFileSize(filename, &file_size);
@@ -844,6 +1180,8 @@ BundleReader::~BundleReader() {
   }
   data_.clear();
   tensor_slices_.clear();
+  // Tensors restored from a mapping hold their own reference to it.
+  mapped_data_.clear();
 }
 
 Status BundleReader::GetBundleEntryProto(StringPiece key,
@@ -868,6 +1206,12 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
 }
 
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
+  if (options_.use_mmap) {
+    bool aliased = false;
+    TF_RETURN_IF_ERROR(GetMappedValue(entry, val, &aliased));
+    if (aliased) return OkStatus();
+  }
+
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
   if (val->NumElements() == 0) {
@@ -1008,6 +1352,88 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   return OkStatus();
 }
 
+Status BundleReader::GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                                    bool* aliased) {
+  *aliased = false;
+  if (!DataTypeCanUseMemcpy(entry.dtype()) || need_to_swap_bytes_ ||
+      entry.size() == 0) {
+    return OkStatus();
+  }
+
+  // Maps the data file if it has not been mapped.
+  auto it = mapped_data_.find(entry.shard_id());
+  if (it == mapped_data_.end()) {
+    const string filename =
+        DataFilename(prefix_, entry.shard_id(), num_shards_);
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &region);
+    if (!s.ok()) {
+      // Not all file systems support memory-mapping; copy instead.
+      VLOG(1) << "Unable to memory-map " << filename
+              << ", falling back to copying restore: " << s;
+      region.reset();
+    }
+    it = mapped_data_.emplace(entry.shard_id(), std::move(region)).first;
+  }
+  const std::shared_ptr<ReadOnlyMemoryRegion>& region = it->second;
+  if (region == nullptr) return OkStatus();
+
+  const TensorShape stored_shape(entry.shape());
+  const uint64 expected_size =
+      stored_shape.num_elements() * DataTypeSize(entry.dtype());
+  if (entry.size() != expected_size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+                            "; stored size ", entry.size(),
+                            "; expected size ", expected_size);
+  }
+  // Applies the same validation as the copying path to a tensor the caller
+  // has already allocated.
+  if (val->NumElements() != 0) {
+    if (entry.size() != val->TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+                              "; stored size ", entry.size(),
+                              "; expected size ", val->TotalBytes());
+    }
+    // Leaves a differing dtype or shape to the copying path, which keeps the
+    // caller's.
+    if (val->dtype() != entry.dtype() || val->shape() != stored_shape) {
+      return OkStatus();
+    }
+  }
+  const uint64 file_size = region->length();
+  const uint64 size = entry.size();
+  if (entry.offset() < 0 || size > file_size ||
+      static_cast<uint64>(entry.offset()) > file_size - size) {
+    return errors::DataLoss("TensorBundle at ", prefix_, " shard ",
+                            entry.shard_id(), ": entry at offset ",
+                            entry.offset(), " of ", entry.size(),
+                            " bytes exceeds the file length ", file_size);
+  }
+  const char* data = static_cast<const char*>(region->data()) + entry.offset();
+
+  auto* buffer = new MappedTensorBuffer(region, data, entry.size());
+  Tensor mapped(entry.dtype(), stored_shape, buffer);
+  buffer->Unref();
+  if (!mapped.IsAligned()) {
+    // Eigen requires aligned buffers; the bundle has to be written with a
+    // sufficient "data_alignment" for aliasing to apply.
+    return OkStatus();
+  }
+
+  const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
+        entry.size(), " bytes): Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the mapped bytes ", actual_crc32c);
+  }
+
+  *val = std::move(mapped);
+  *aliased = true;
+  return OkStatus();
+}
+
 Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1022,6 +1448,76 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMany(gtl::ArraySlice<StringPiece> keys,
+                                gtl::ArraySlice<Tensor*> vals,
+                                int num_threads) {
+  CHECK_EQ(keys.size(), vals.size());
+  CHECK_GE(num_threads, 1);
+
+  // Shard id -> full tensors to restore from that shard.
+  std::map<int32, std::vector<PendingRead>> shards;
+  std::vector<size_t> sequential;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    BundleEntryProto entry;
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &entry));
+    Tensor* val = vals[i];
+    CHECK(val != nullptr);
+    if (options_.use_mmap || !entry.slices().empty() ||
+        !DataTypeCanUseMemcpy(entry.dtype()) || entry.size() == 0 ||
+        val->NumElements() == 0) {
+      sequential.push_back(i);
+      continue;
+    }
+    if (entry.size() != val->TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", keys[i],
+                              "; stored size ", entry.size(),
+                              "; expected size ", val->TotalBytes());
+    }
+    shards[entry.shard_id()].push_back(
+        {entry.offset(), static_cast<int64_t>(entry.size()), entry.crc32c(),
+         val});
+  }
+
+  std::vector<std::pair<int32, std::vector<CoalescedRead>>> shard_runs;
+  shard_runs.reserve(shards.size());
+  for (auto& shard : shards) {
+    std::vector<PendingRead>& reads = shard.second;
+    std::sort(reads.begin(), reads.end(),
+              [](const PendingRead& a, const PendingRead& b) {
+                return a.offset < b.offset;
+              });
+    shard_runs.emplace_back(shard.first, CoalesceReads(reads));
+  }
+
+  if (!shard_runs.empty()) {
+    const int num_readers =
+        std::min<int>(num_threads, static_cast<int>(shard_runs.size()));
+    // Must outlive "read_pool", whose closures schedule onto it.
+    thread::ThreadPool verify_pool(env_, "restore_verify", num_readers);
+    mutex mu;
+    Status status;
+    {
+      thread::ThreadPool read_pool(env_, "restore_shards", num_readers);
+      for (const auto& shard : shard_runs) {
+        const string filename = DataFilename(prefix_, shard.first, num_shards_);
+        read_pool.Schedule([this, filename, &shard, &verify_pool, &mu,
+                            &status]() {
+          Status s = RestoreShard(env_, filename, shard.second,
+                                  need_to_swap_bytes_, &verify_pool);
+          mutex_lock l(mu);
+          status.Update(s);
+        });
+      }
+    }
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  for (const size_t i : sequential) {
+    TF_RETURN_IF_ERROR(Lookup(keys[i], vals[i]));
+  }
+  return OkStatus();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -61,6 +61,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 #define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -73,6 +75,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/cache.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
@@ -81,6 +84,8 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
@@ -116,9 +121,21 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // If true, Add() only records the tensor's metadata and a reference to its
+    // buffer and returns immediately.  Serialization and checksumming happen
+    // in order on a background thread, and the data file is written by a
+    // second background thread while the next buffer is being filled.
+    //
+    // The buffers of added tensors are not copied: callers must not modify
+    // them in place until Finish() returns or FinishAsync() calls back.
+    // Errors of background writes are reported by a later Add(), by status()
+    // or by the Finish call.
+    bool async_write{false};
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
+  // Waits for any pending background writes.
+  ~BundleWriter();
 
   // Adds the tensor "val" under key "key".
   // Across calls "key" must be unique but can be added in any order.
@@ -144,12 +161,36 @@ class BundleWriter {
                   const TensorShape& full_tensor_shape,
                   const TensorSlice& slice_spec, const Tensor& slice_tensor);
 
-  // Finishes the writer and flushes.
+  // Finishes the writer and flushes.  With "Options::async_write", first waits
+  // for all pending background writes.
   Status Finish() TF_MUST_USE_RESULT;
 
-  Status status() const { return status_; }
+  // Like Finish(), but returns immediately and calls "done" with the result
+  // from a background thread once all pending writes are done and the bundle
+  // is finished.  The writer must not be used after this call, except for
+  // destruction, which waits for "done" to return; in particular it must not be
+  // destroyed from within "done".
+  // REQUIRES: Options::async_write
+  void FinishAsync(std::function<void(const Status&)> done);
+
+  Status status() const;
 
  private:
+  // Serializes "val" at the end of the data file and fills in the offset, size
+  // and checksum of "entry".
+  Status WriteEntry(BundleEntryProto* entry, const Tensor& val);
+
+  // Writes the metadata file.  Called once all tensors have been written.
+  Status FinishMetadata();
+
+  // Runs "fn" on the background serialization thread, after all previously
+  // enqueued functions.
+  void Enqueue(std::function<void()> fn);
+
+  // Blocks until all enqueued functions have run, then folds their errors into
+  // "status_".
+  void WaitForPendingWrites();
+
   Env* const env_;  // Not owned.
   const Options options_;
   const string prefix_;
@@ -161,6 +202,15 @@ class BundleWriter {
   std::map<string, BundleEntryProto> entries_;
   Status status_;
 
+  // State of "Options::async_write".
+  mutable mutex mu_;
+  condition_variable writes_done_;
+  std::deque<std::function<void()>> pending_writes_ TF_GUARDED_BY(mu_);
+  int64_t num_pending_writes_ TF_GUARDED_BY(mu_) = 0;
+  Status async_status_ TF_GUARDED_BY(mu_);
+  // Declared last so that it is joined before the state above is destroyed.
+  std::unique_ptr<thread::ThreadPool> serializer_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(BundleWriter);
 };
 
@@ -196,8 +246,26 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
+  struct Options {
+    Options() {}
+    // If true, tensors of memcpy-able dtypes are restored by aliasing a
+    // read-only memory mapping of their data file instead of being copied into
+    // a freshly allocated buffer.  This only applies to entries whose mapped
+    // address satisfies the Tensor alignment requirement (see
+    // BundleWriter::Options::data_alignment) and whose bytes do not need to be
+    // swapped; all other entries, and file systems that do not support
+    // memory-mapping, fall back to the copying path.
+    //
+    // Restored tensors keep the mapping alive and may outlive the reader.  They
+    // are backed by read-only memory and must not be mutated in place.
+    bool use_mmap{false};
+    // Forwarded from the legacy constructor; see below.
+    bool enable_multi_threading_for_testing{false};
+  };
+
   BundleReader(Env* const env, StringPiece prefix,
                bool enable_multi_threading_for_testing = false);
+  BundleReader(Env* const env, StringPiece prefix, const Options& options);
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -243,9 +311,28 @@ class BundleReader {
   // tensor keyed by "key" does not exist in this bundle.
   //
   // Validates the stored crc32c checksum against the restored bytes.
+  //
+  // If "Options::use_mmap" is set and the entry is eligible, "val" is replaced
+  // by a tensor aliasing the mapped data file rather than filled in place.
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensors keyed by "keys" into the corresponding "vals", with
+  // the same contract as "Lookup()" for each pair.
+  //
+  // Full (non-partitioned) tensors of memcpy-able dtypes are grouped by data
+  // file shard and read concurrently on up to "num_threads" threads, one shard
+  // per thread.  Within a shard, entries are visited in file order and small
+  // neighboring entries are coalesced into large sequential reads; checksum
+  // verification of one read overlaps with issuing the next one.  All other
+  // entries are restored one by one on the calling thread.
+  //
+  // Returns the first error encountered; "vals" may then hold nonsense data.
+  // REQUIRES: status().ok(), keys.size() == vals.size(), num_threads >= 1
+  Status LookupMany(gtl::ArraySlice<StringPiece> keys,
+                    gtl::ArraySlice<Tensor*> vals,
+                    int num_threads) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -302,6 +389,13 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Attempts to restore the tensor described by "entry" by aliasing a memory
+  // mapping of its data file.  Sets "*aliased" to true and "*val" to the
+  // aliasing tensor on success; leaves "*val" untouched and "*aliased" false if
+  // the entry is not eligible, in which case the caller should copy instead.
+  Status GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                        bool* aliased) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -320,6 +414,11 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // Memory mappings of the data files, populated on demand when
+  // "options_.use_mmap" is set.  A null value records that the shard could not
+  // be mapped, so that it is not retried.  Shared with the restored tensors.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -335,6 +434,7 @@ class BundleReader {
 
   friend class TensorBundleAlignmentTest;  // For testing data alignment.
 
+  const Options options_;
   bool enable_multi_threading_for_testing_ = false;
 
   TF_DISALLOW_COPY_AND_ASSIGN(BundleReader);
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
+#include <algorithm>
 #include <random>
 #include <string>
 #include <vector>
@@ -23,6 +24,12 @@ limitations under the License.
 #include <windows.h>
 #endif  // _WIN32
 
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -30,10 +37,12 @@ limitations under the License.
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
@@ -1201,6 +1210,406 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+// Writes "num_shards" bundles of "tensors_per_shard" tensors each and merges
+// them, along with the bundles at "extra_prefixes", into a single bundle at
+// "prefix".  Tensor "t<i>" is filled with i.
+void WriteShardedBundle(const string& prefix, int num_shards,
+                        int tensors_per_shard, const TensorShape& shape,
+                        const std::vector<string>& extra_prefixes = {}) {
+  std::vector<tstring> shard_prefixes;
+  for (int shard = 0; shard < num_shards; ++shard) {
+    shard_prefixes.push_back(strings::StrCat(prefix, "_part", shard));
+    BundleWriter writer(Env::Default(), shard_prefixes.back());
+    for (int i = 0; i < tensors_per_shard; ++i) {
+      const int id = shard * tensors_per_shard + i;
+      TF_CHECK_OK(writer.Add(strings::StrCat("t", id),
+                             Constant(static_cast<float>(id), shape)));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  shard_prefixes.insert(shard_prefixes.end(), extra_prefixes.begin(),
+                        extra_prefixes.end());
+  TF_CHECK_OK(MergeBundles(Env::Default(), shard_prefixes, prefix));
+}
+
+TEST(TensorBundleTest, LookupMany) {
+  const string prefix = Prefix("lookup_many");
+  {
+    // A string tensor and a partitioned tensor, which are restored
+    // sequentially.
+    BundleWriter writer(Env::Default(), Prefix("lookup_many_other"));
+    TF_EXPECT_OK(writer.Add("str", Constant_2x3<tstring>("abc")));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("0,2:-"),
+                                 Constant_2x3<float>(1)));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("2,2:-"),
+                                 Constant_2x3<float>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  WriteShardedBundle(prefix, /*num_shards=*/3, /*tensors_per_shard=*/50,
+                     TensorShape({7, 3}), {Prefix("lookup_many_other")});
+
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+  std::vector<string> names = {"str", "part"};
+  for (int i = 149; i >= 0; --i) names.push_back(strings::StrCat("t", i));
+  std::vector<Tensor> tensors;
+  tensors.emplace_back(DT_STRING, TensorShape({2, 3}));
+  tensors.emplace_back(DT_FLOAT, TensorShape({4, 3}));
+  for (int i = 2; i < names.size(); ++i) {
+    tensors.emplace_back(DT_FLOAT, TensorShape({7, 3}));
+  }
+  std::vector<StringPiece> keys(names.begin(), names.end());
+  std::vector<Tensor*> vals;
+  for (Tensor& t : tensors) vals.push_back(&t);
+  TF_ASSERT_OK(reader.LookupMany(keys, vals, /*num_threads=*/4));
+
+  test::ExpectTensorEqual<tstring>(tensors[0], Constant_2x3<tstring>("abc"));
+  test::ExpectTensorEqual<float>(
+      tensors[1], test::AsTensor<float>({1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2},
+                                        TensorShape({4, 3})));
+  for (int i = 2; i < names.size(); ++i) {
+    test::ExpectTensorEqual<float>(
+        tensors[i],
+        Constant(static_cast<float>(151 - i), TensorShape({7, 3})));
+  }
+
+  Tensor missing(DT_FLOAT, TensorShape({1}));
+  EXPECT_TRUE(errors::IsNotFound(
+      reader.LookupMany({"t0", "missing"}, {&tensors[2], &missing}, 2)));
+}
+
+TEST(TensorBundleTest, LookupManyChecksum) {
+  const string prefix = Prefix("lookup_many_checksum");
+  WriteShardedBundle(prefix, /*num_shards=*/1, /*tensors_per_shard=*/4,
+                     TensorShape({10}));
+  // Flips a byte of "t2", which is coalesced with its neighbors.
+  const string data_path = DataFilename(prefix, 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), data_path, &data));
+  data[2 * 10 * sizeof(float) + 1] ^= 0xff;
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), data_path, data));
+
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < 4; ++i) tensors.emplace_back(DT_FLOAT, TensorShape({10}));
+  Status s = reader.LookupMany({"t0", "t1", "t2", "t3"},
+                               {&tensors[0], &tensors[1], &tensors[2],
+                                &tensors[3]},
+                               /*num_threads=*/1);
+  EXPECT_TRUE(errors::IsDataLoss(s));
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "Checksum does not match"));
+}
+
+// Restores "num_vars" small variables spread over 16 data shards, either one by
+// one with Lookup() (num_threads == 0) or with LookupMany().
+static void BM_BundleLookupMany(::testing::benchmark::State& state) {
+  const int num_vars = state.range(0);
+  const int num_threads = state.range(1);
+  const int kNumShards = 16;
+  const TensorShape shape({64});
+  const string prefix = Prefix(strings::StrCat("lookup_many_bm", num_vars));
+  WriteShardedBundle(prefix, kNumShards, num_vars / kNumShards, shape);
+
+  std::vector<string> names;
+  for (int i = 0; i < num_vars / kNumShards * kNumShards; ++i) {
+    names.push_back(strings::StrCat("t", i));
+  }
+  std::vector<StringPiece> keys(names.begin(), names.end());
+  std::vector<Tensor> tensors(names.size());
+  for (auto s : state) {
+    BundleReader reader(Env::Default(), prefix);
+    TF_CHECK_OK(reader.status());
+    for (Tensor& t : tensors) t = Tensor(DT_FLOAT, shape);
+    if (num_threads == 0) {
+      for (int i = 0; i < keys.size(); ++i) {
+        TF_CHECK_OK(reader.Lookup(keys[i], &tensors[i]));
+      }
+    } else {
+      std::vector<Tensor*> vals;
+      for (Tensor& t : tensors) vals.push_back(&t);
+      TF_CHECK_OK(reader.LookupMany(keys, vals, num_threads));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  state.SetBytesProcessed(state.iterations() * keys.size() *
+                          shape.num_elements() * sizeof(float));
+}
+
+BENCHMARK(BM_BundleLookupMany)
+    ->ArgsProduct({{1000, 10000, 100000}, {0, 1, 4, 16}});
+
+string AllocatorName(const Tensor& t) {
+  TensorDescription description;
+  t.FillDescription(&description);
+  return description.allocation_description().allocator_name();
+}
+
+TEST(TensorBundleTest, MmapRestore) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("mmap"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_100x100<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<int64_t>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<tstring>("hello")));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  Tensor restored;
+  {
+    BundleReader::Options options;
+    options.use_mmap = true;
+    BundleReader reader(Env::Default(), Prefix("mmap"), options);
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_100x100<float>(0));
+    Expect<int64_t>(&reader, "foo_001", Constant_2x3<int64_t>(1));
+    Expect<tstring>(&reader, "foo_002", Constant_2x3<tstring>("hello"));
+
+    TF_ASSERT_OK(reader.Lookup("foo_000", &restored));
+    EXPECT_EQ("bundle_reader_mmap", AllocatorName(restored));
+    // String tensors are never aliased.
+    Tensor strings;
+    TF_ASSERT_OK(reader.Lookup("foo_002", &strings));
+    EXPECT_NE("bundle_reader_mmap", AllocatorName(strings));
+  }
+  // The aliasing tensor keeps the mapping alive after the reader is gone.
+  test::ExpectTensorEqual<float>(restored, Constant_100x100<float>(0));
+}
+
+TEST(TensorBundleTest, MmapRestoreFallsBackForUnalignedData) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("mmap_unaligned"));
+    TF_EXPECT_OK(writer.Add("a", Constant(true, TensorShape({1}))));
+    TF_EXPECT_OK(writer.Add("b", Constant_100x100<float>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_unaligned"), options);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  TF_ASSERT_OK(reader.Lookup("b", &val));
+  EXPECT_NE("bundle_reader_mmap", AllocatorName(val));
+  test::ExpectTensorEqual<float>(val, Constant_100x100<float>(2));
+}
+
+TEST(TensorBundleTest, MmapRestoreChecksum) {
+  BundleWriter::Options opts;
+  opts.data_alignment = 64;
+  {
+    BundleWriter writer(Env::Default(), Prefix("mmap_checksum"), opts);
+    TF_EXPECT_OK(writer.Add("foo", Constant_100x100<float>(5)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  // Flips a byte in the data file.
+  const string data_path = DataFilename(Prefix("mmap_checksum"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), data_path, &data));
+  data[100] ^= 0xff;
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), data_path, data));
+
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_checksum"), options);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  Status s = reader.Lookup("foo", &val);
+  EXPECT_TRUE(errors::IsDataLoss(s));
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "Checksum does not match"));
+}
+
+TEST(TensorBundleTest, MmapRestoreIntoAllocatedTensor) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("mmap_allocated"), opts);
+    TF_EXPECT_OK(writer.Add("foo", Constant_100x100<float>(3)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_allocated"), options);
+  TF_ASSERT_OK(reader.status());
+
+  // A tensor of the wrong size is rejected, as when copying.
+  Tensor too_small(DT_FLOAT, TensorShape({10, 10}));
+  Status s = reader.Lookup("foo", &too_small);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "Invalid size"));
+
+  // A tensor of the same size but another shape keeps its shape.
+  Tensor flat(DT_FLOAT, TensorShape({10000}));
+  TF_ASSERT_OK(reader.Lookup("foo", &flat));
+  EXPECT_EQ(TensorShape({10000}), flat.shape());
+  EXPECT_NE("bundle_reader_mmap", AllocatorName(flat));
+  test::ExpectTensorEqual<float>(flat, Constant(3.0f, TensorShape({10000})));
+
+  Tensor matching(DT_FLOAT, TensorShape({100, 100}));
+  TF_ASSERT_OK(reader.Lookup("foo", &matching));
+  EXPECT_EQ("bundle_reader_mmap", AllocatorName(matching));
+  test::ExpectTensorEqual<float>(matching, Constant_100x100<float>(3));
+}
+
+// Returns the resident set size of this process in bytes, or 0 if unknown.
+int64_t ResidentSetBytes() {
+  string status;
+  if (!ReadFileToString(Env::Default(), "/proc/self/status", &status).ok()) {
+    return 0;
+  }
+  for (absl::string_view line : str_util::Split(status, '\n')) {
+    int64_t kb = 0;
+    if (absl::ConsumePrefix(&line, "VmRSS:")) {
+      line = absl::StripAsciiWhitespace(line);
+      if (absl::ConsumeSuffix(&line, " kB") && absl::SimpleAtoi(line, &kb)) {
+        return kb << 10;
+      }
+    }
+  }
+  return 0;
+}
+
+// Restores "num_tensors" tensors of "tensor_mb" megabytes each, either by
+// copying (mmap == 0) or by aliasing the mapped data file (mmap == 1).
+// Reports restore time per iteration and the RSS growth of the last restore.
+static void BM_BundleRestore(::testing::benchmark::State& state) {
+  const bool use_mmap = state.range(0);
+  const int num_tensors = state.range(1);
+  const int64_t tensor_bytes = static_cast<int64_t>(state.range(2)) << 20;
+  const string prefix = Prefix(strings::StrCat("restore", num_tensors));
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), prefix, opts);
+    for (int i = 0; i < num_tensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("t", i),
+                             Constant(static_cast<int8>(i),
+                                      TensorShape({tensor_bytes}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = use_mmap;
+  int64_t rss_delta = 0;
+  for (auto s : state) {
+    const int64_t rss_before = ResidentSetBytes();
+    BundleReader reader(Env::Default(), prefix, options);
+    TF_CHECK_OK(reader.status());
+    std::vector<Tensor> restored(num_tensors);
+    for (int i = 0; i < num_tensors; ++i) {
+      TF_CHECK_OK(reader.Lookup(strings::StrCat("t", i), &restored[i]));
+    }
+    rss_delta = ResidentSetBytes() - rss_before;
+  }
+  state.SetLabel(use_mmap ? "mmap" : "copy");
+  state.SetBytesProcessed(state.iterations() * num_tensors * tensor_bytes);
+  state.counters["rss_delta_mb"] = static_cast<double>(rss_delta) / (1 << 20);
+}
+
+BENCHMARK(BM_BundleRestore)
+    ->ArgsProduct({{0, 1}, {1, 16}, {64}})
+    ->ArgsProduct({{0, 1}, {256}, {1}});
+
+TEST(TensorBundleTest, AsyncWrite) {
+  BundleWriter::Options opts;
+  opts.async_write = true;
+  opts.data_alignment = 64;
+  {
+    BundleWriter writer(Env::Default(), Prefix("async"), opts);
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_100x100<float>(3)));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<tstring>("zero")));
+    TF_EXPECT_OK(writer.AddSlice("foo_002", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("0,2:-"),
+                                 Constant_2x3<int32>(2)));
+    TF_EXPECT_OK(writer.AddSlice("foo_002", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("2,2:-"),
+                                 Constant_2x3<int32>(5)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_100x100<double>(1)));
+    // Duplicate keys are still rejected synchronously.
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        writer.Add("foo_001", Constant_100x100<double>(1))));
+  }
+  {
+    BundleWriter writer(Env::Default(), Prefix("async"), opts);
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_100x100<float>(3)));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<tstring>("zero")));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_100x100<double>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("async"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ(AllTensorKeys(&reader),
+            std::vector<string>({"foo_000", "foo_001", "foo_003"}));
+  Expect<tstring>(&reader, "foo_000", Constant_2x3<tstring>("zero"));
+  Expect<double>(&reader, "foo_001", Constant_100x100<double>(1));
+  Expect<float>(&reader, "foo_003", Constant_100x100<float>(3));
+}
+
+TEST(TensorBundleTest, AsyncWriteFinishAsync) {
+  BundleWriter::Options opts;
+  opts.async_write = true;
+  {
+    BundleWriter writer(Env::Default(), Prefix("async_finish"), opts);
+    for (int i = 0; i < 10; ++i) {
+      TF_EXPECT_OK(writer.Add(strings::StrCat("t", i),
+                              Constant(i, TensorShape({1000}))));
+    }
+    Notification done;
+    Status finish_status;
+    writer.FinishAsync([&](const Status& s) {
+      finish_status = s;
+      done.Notify();
+    });
+    done.WaitForNotification();
+    TF_ASSERT_OK(finish_status);
+  }
+  BundleReader reader(Env::Default(), Prefix("async_finish"));
+  TF_ASSERT_OK(reader.status());
+  for (int i = 0; i < 10; ++i) {
+    Expect<int>(&reader, strings::StrCat("t", i),
+                Constant(i, TensorShape({1000})));
+  }
+}
+
+// Simulates training steps that each do some compute and then save one tensor
+// of "tensor_kb" kilobytes, with a synchronous or an asynchronous writer.
+// Reports the median and tail step times; the final Finish() is excluded.
+static void BM_BundleWriterStepJitter(::testing::benchmark::State& state) {
+  const bool async_write = state.range(0);
+  const int64_t tensor_bytes = static_cast<int64_t>(state.range(1)) << 10;
+  const int kStepsPerSave = 100;
+  const Tensor t =
+      Constant(static_cast<int8>('a'), TensorShape{tensor_bytes});
+  std::vector<double> step_micros;
+  BundleWriter::Options opts;
+  opts.async_write = async_write;
+  for (auto s : state) {
+    BundleWriter writer(Env::Default(), Prefix("jitter"), opts);
+    for (int step = 0; step < kStepsPerSave; ++step) {
+      const uint64 start = Env::Default()->NowMicros();
+      // Stand-in for the compute of a training step.
+      uint32 crc = 0;
+      for (int i = 0; i < 16; ++i) {
+        crc = crc32c::Extend(crc, t.tensor_data().data(), 64 << 10);
+      }
+      ::benchmark::DoNotOptimize(crc);
+      TF_CHECK_OK(writer.Add(strings::StrCat("t", step), t));
+      step_micros.push_back(Env::Default()->NowMicros() - start);
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  std::sort(step_micros.begin(), step_micros.end());
+  state.SetLabel(async_write ? "async" : "sync");
+  state.counters["step_p50_us"] = step_micros[step_micros.size() / 2];
+  state.counters["step_p99_us"] = step_micros[step_micros.size() * 99 / 100];
+  state.counters["step_max_us"] = step_micros.back();
+}
+
+BENCHMARK(BM_BundleWriterStepJitter)
+    ->ArgsProduct({{0, 1}, {64, 1024, 16 << 10}})
+    ->Unit(::benchmark::kMillisecond);
+
 static void BM_BundleAlignment(::testing::benchmark::State& state) {
   {
     const int alignment = state.range(0);
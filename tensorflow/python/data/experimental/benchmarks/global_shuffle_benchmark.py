@@ -0,0 +1,67 @@
+# Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks for `global_shuffle()` against `tf.data.Dataset.shuffle()`."""
+from tensorflow.python.data.benchmarks import benchmark_base
+from tensorflow.python.data.experimental.ops import shuffle_ops
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.ops import array_ops
+from tensorflow.python.ops import math_ops
+
+# Number of records of the index the benchmarks shuffle.
+_NUM_RECORDS = 10 * 1000 * 1000
+# Number of records read in each run, which includes filling the buffer of
+# `Dataset.shuffle()`.
+_NUM_ELEMENTS = 100 * 1000
+
+
+class GlobalShuffleBenchmark(benchmark_base.DatasetBenchmarkBase):
+  """Benchmarks for `global_shuffle()` against `tf.data.Dataset.shuffle()`."""
+
+  def _records(self):
+    # Stands in for reading a record of 256 bytes through an index of record
+    # offsets; `Dataset.range()` and `map()` support random access.
+    def read_record(index):
+      return array_ops.fill([64], math_ops.cast(index, dtypes.float32))
+
+    return dataset_ops.Dataset.range(_NUM_RECORDS).map(read_record)
+
+  def _run(self, dataset, name, parameters):
+    self.run_and_report_benchmark(
+        dataset=dataset,
+        num_elements=_NUM_ELEMENTS,
+        iters=3,
+        extras={
+            "model_name": "global_shuffle.benchmark.%s" % name,
+            "parameters": parameters,
+        },
+        name=name)
+
+  def benchmark_buffer_shuffle(self):
+    for buffer_size in [10 * 1000, 1000 * 1000]:
+      dataset = self._records().shuffle(buffer_size, seed=42)
+      self._run(dataset, "buffer_shuffle_%d" % buffer_size, "%d" % buffer_size)
+
+  def benchmark_global_shuffle(self):
+    for num_parallel_calls in [1, 4, dataset_ops.AUTOTUNE]:
+      dataset = self._records().apply(
+          shuffle_ops.global_shuffle(
+              seed=42, num_parallel_calls=num_parallel_calls))
+      label = "autotune" if num_parallel_calls < 0 else num_parallel_calls
+      self._run(dataset, "global_shuffle_%s" % label, "%s" % label)
+
+
+if __name__ == "__main__":
+  benchmark_base.test.main()
@@ -0,0 +1,156 @@
+# Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for `global_shuffle()`."""
+from absl.testing import parameterized
+import numpy as np
+
+from tensorflow.python.data.experimental.ops import random_access
+from tensorflow.python.data.experimental.ops import shuffle_ops
+from tensorflow.python.data.kernel_tests import checkpoint_test_base
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.data.ops import options as options_lib
+from tensorflow.python.framework import combinations
+from tensorflow.python.framework import errors
+from tensorflow.python.platform import test
+
+
+class GlobalShuffleTest(test_base.DatasetTestBase, parameterized.TestCase):
+
+  def _build_dataset(self,
+                     num_elements=100,
+                     seed=None,
+                     reshuffle_each_iteration=True,
+                     num_parallel_calls=dataset_ops.AUTOTUNE):
+    dataset = dataset_ops.Dataset.range(num_elements).map(lambda x: x * 2)
+    return dataset.apply(
+        shuffle_ops.global_shuffle(
+            seed=seed,
+            reshuffle_each_iteration=reshuffle_each_iteration,
+            num_parallel_calls=num_parallel_calls))
+
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(num_parallel_calls=[1, 4, -1])))
+  def testProducesAllElements(self, num_parallel_calls):
+    dataset = self._build_dataset(
+        seed=42, num_parallel_calls=num_parallel_calls)
+    output = self.getDatasetOutput(dataset)
+    self.assertAllEqual(sorted(output), np.arange(100) * 2)
+    self.assertNotEqual(output, list(np.arange(100) * 2))
+    self.assertEqual(self.evaluate(dataset.cardinality()), 100)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testSameSeed(self):
+    # The order only depends on the seed, not on the order of the reads.
+    output_1 = self.getDatasetOutput(
+        self._build_dataset(seed=42, num_parallel_calls=1))
+    output_2 = self.getDatasetOutput(
+        self._build_dataset(seed=42, num_parallel_calls=8))
+    self.assertEqual(output_1, output_2)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testDifferentSeed(self):
+    output_1 = self.getDatasetOutput(self._build_dataset(seed=42))
+    output_2 = self.getDatasetOutput(self._build_dataset(seed=24))
+    self.assertNotEqual(output_1, output_2)
+    self.assertAllEqual(sorted(output_1), sorted(output_2))
+
+  @combinations.generate(
+      combinations.times(
+          test_base.v2_eager_only_combinations(),
+          combinations.combine(reshuffle_each_iteration=[True, False])))
+  def testReshuffleEachIteration(self, reshuffle_each_iteration):
+    dataset = self._build_dataset(
+        seed=42, reshuffle_each_iteration=reshuffle_each_iteration)
+    output_1 = self.getDatasetOutput(dataset)
+    output_2 = self.getDatasetOutput(dataset)
+    if reshuffle_each_iteration:
+      self.assertNotEqual(output_1, output_2)
+      self.assertAllEqual(sorted(output_1), sorted(output_2))
+    else:
+      self.assertAllEqual(output_1, output_2)
+
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(map_parallel_calls=[None, 4])))
+  def testConcurrentFirstReadsOfMappedInput(self, map_parallel_calls):
+    # The first reads of each new dataset run concurrently and all need the
+    # map function, which is instantiated on the first `Get` of the input.
+    for seed in range(10):
+      dataset = dataset_ops.Dataset.range(1000).map(
+          lambda x: x * 2, num_parallel_calls=map_parallel_calls)
+      dataset = dataset.apply(
+          shuffle_ops.global_shuffle(seed=seed, num_parallel_calls=16))
+      self.assertAllEqual(
+          sorted(self.getDatasetOutput(dataset)), np.arange(1000) * 2)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testEmptyDataset(self):
+    self.assertDatasetProduces(self._build_dataset(num_elements=0), [])
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testUnknownCardinality(self):
+    dataset = dataset_ops.Dataset.range(10).filter(lambda x: x > 5)
+    with self.assertRaisesRegex(errors.InvalidArgumentError,
+                                "known, finite cardinality"):
+      dataset = dataset.apply(shuffle_ops.global_shuffle())
+      self.evaluate(dataset._variant_tensor)  # pylint: disable=protected-access
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testRandomAccess(self):
+    dataset = self._build_dataset(seed=42, reshuffle_each_iteration=False)
+    output = self.getDatasetOutput(dataset)
+    for i in range(100):
+      self.assertEqual(
+          self.evaluate(random_access.at(dataset, i)), output[i])
+
+
+class GlobalShuffleCheckpointTest(checkpoint_test_base.CheckpointTestBase,
+                                  parameterized.TestCase):
+
+  def _build_dataset(self, num_elements, num_epochs, reshuffle_each_iteration,
+                     symbolic_checkpoint):
+    dataset = dataset_ops.Dataset.range(num_elements).apply(
+        shuffle_ops.global_shuffle(
+            seed=42, reshuffle_each_iteration=reshuffle_each_iteration))
+    dataset = dataset.repeat(num_epochs)
+    options = options_lib.Options()
+    options.experimental_symbolic_checkpoint = symbolic_checkpoint
+    return dataset.with_options(options)
+
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          checkpoint_test_base.default_test_combinations(),
+          combinations.combine(
+              symbolic_checkpoint=[False, True],
+              reshuffle_each_iteration=[False, True])))
+  def test(self, verify_fn, symbolic_checkpoint, reshuffle_each_iteration):
+    num_elements = 20
+    num_epochs = 2
+    # pylint: disable=g-long-lambda
+    verify_fn(
+        self, lambda: self._build_dataset(
+            num_elements=num_elements,
+            num_epochs=num_epochs,
+            reshuffle_each_iteration=reshuffle_each_iteration,
+            symbolic_checkpoint=symbolic_checkpoint), num_elements * num_epochs)
+
+
+if __name__ == "__main__":
+  test.main()
@@ -0,0 +1,138 @@
+# Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for `tf.data.experimental.shared_cache()`."""
+from absl.testing import parameterized
+
+from tensorflow.python.data.experimental.ops import shared_cache
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import combinations
+from tensorflow.python.framework import errors
+from tensorflow.python.platform import test
+
+# The size of the `tf.int64` scalar elements of `Dataset.range`.
+_ELEMENT_SIZE_BYTES = 8
+
+# The caches are shared by the whole process, so each test caches a dataset of
+# its own, e.g. `Dataset.range` of a different size.
+
+
+class SharedCacheTest(test_base.DatasetTestBase, parameterized.TestCase):
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testSingleIterator(self):
+    dataset = dataset_ops.Dataset.range(10).apply(
+        shared_cache.shared_cache(max_cache_size_bytes=1 << 20))
+    self.assertDatasetProduces(dataset, list(range(10)))
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testConcurrentIteratorsReadSameElements(self):
+    dataset = dataset_ops.Dataset.range(5).map(lambda x: x * x).apply(
+        shared_cache.shared_cache(max_cache_size_bytes=1 << 20))
+    it1 = iter(dataset)
+    it2 = iter(dataset)
+    self.assertEqual([next(it1).numpy() for _ in range(5)], [0, 1, 4, 9, 16])
+    self.assertEqual([next(it2).numpy() for _ in range(5)], [0, 1, 4, 9, 16])
+    with self.assertRaises(StopIteration):
+      next(it1)
+    with self.assertRaises(StopIteration):
+      next(it2)
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testLaggingIteratorSkipsEvictedElements(self):
+    dataset = dataset_ops.Dataset.range(11).apply(
+        shared_cache.shared_cache(max_cache_size_bytes=2 *
+                                  _ELEMENT_SIZE_BYTES))
+    it1 = iter(dataset)
+    it2 = iter(dataset)
+    self.assertEqual([next(it1).numpy() for _ in range(6)], list(range(6)))
+    # Only the last two elements remain in the cache.
+    self.assertEqual([next(it2).numpy() for _ in range(3)], [4, 5, 6])
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testReaderOutlivesCreator(self):
+    dataset = dataset_ops.Dataset.range(16).map(lambda x: x + 1)
+    dataset = dataset.apply(
+        shared_cache.shared_cache(max_cache_size_bytes=1 << 20))
+    it1 = iter(dataset)
+    it2 = iter(dataset)
+    self.assertEqual([next(it1).numpy() for _ in range(4)], [1, 2, 3, 4])
+    # `it1` created the input iterator, which `it2` keeps running.
+    del it1
+    self.assertEqual([next(it2).numpy() for _ in range(16)],
+                     list(range(1, 17)))
+    with self.assertRaises(StopIteration):
+      next(it2)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testTwoEpochs(self):
+    dataset = dataset_ops.Dataset.range(17).apply(
+        shared_cache.shared_cache(max_cache_size_bytes=2 *
+                                  _ELEMENT_SIZE_BYTES))
+    self.assertDatasetProduces(dataset.repeat(2), list(range(17)) * 2)
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testIteratorAfterEndReadsFromStart(self):
+    dataset = dataset_ops.Dataset.range(18).apply(
+        shared_cache.shared_cache(max_cache_size_bytes=2 *
+                                  _ELEMENT_SIZE_BYTES))
+    it1 = iter(dataset)
+    self.assertEqual([x.numpy() for x in it1], list(range(18)))
+    # `it1` still holds the cache of the first epoch, which has ended.
+    it2 = iter(dataset)
+    self.assertEqual([x.numpy() for x in it2], list(range(18)))
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testSeparateDatasetsWithSameGraphShareCache(self):
+
+    def make_dataset():
+      return dataset_ops.Dataset.range(12).apply(
+          shared_cache.shared_cache(max_cache_size_bytes=_ELEMENT_SIZE_BYTES))
+
+    it1 = iter(make_dataset())
+    it2 = iter(make_dataset())
+    self.assertEqual([next(it1).numpy() for _ in range(4)], list(range(4)))
+    self.assertEqual(next(it2).numpy(), 3)
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testDifferentDatasetsDoNotShareCache(self):
+    it1 = iter(
+        dataset_ops.Dataset.range(13).apply(
+            shared_cache.shared_cache(max_cache_size_bytes=_ELEMENT_SIZE_BYTES)))
+    it2 = iter(
+        dataset_ops.Dataset.range(14).apply(
+            shared_cache.shared_cache(max_cache_size_bytes=_ELEMENT_SIZE_BYTES)))
+    self.assertEqual([next(it1).numpy() for _ in range(4)], list(range(4)))
+    self.assertEqual(next(it2).numpy(), 0)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testInvalidCacheSize(self):
+    with self.assertRaisesRegex(errors.InvalidArgumentError,
+                                "must be positive"):
+      dataset = dataset_ops.Dataset.range(10).apply(
+          shared_cache.shared_cache(max_cache_size_bytes=0))
+      self.evaluate(self.getNext(dataset)())
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testElementLargerThanCache(self):
+    dataset = dataset_ops.Dataset.range(15).apply(
+        shared_cache.shared_cache(max_cache_size_bytes=_ELEMENT_SIZE_BYTES - 1))
+    with self.assertRaisesRegex(errors.InvalidArgumentError,
+                                "larger than cache size"):
+      self.evaluate(self.getNext(dataset)())
+
+
+if __name__ == "__main__":
+  test.main()
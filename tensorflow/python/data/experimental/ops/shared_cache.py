@@ -0,0 +1,77 @@
+# Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Experimental API for sharing cached elements across iterators."""
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import gen_experimental_dataset_ops as ged_ops
+from tensorflow.python.util.tf_export import tf_export
+
+
+@tf_export("data.experimental.shared_cache")
+def shared_cache(max_cache_size_bytes):
+  """Shares the elements of the input dataset across its concurrent iterators.
+
+  Iterators of the same input pipeline that run concurrently in a process, for
+  example the trials of a hyperparameter search on one host, read its elements
+  from a single cache instead of each computing them. Pipelines are identified
+  by the fingerprint of their graph, so the cache is shared even by datasets
+  built separately, as long as they are built the same way.
+
+  The first iterator to reach an element computes it, and the others read it
+  from the cache while it stays within `max_cache_size_bytes`. The cache is a
+  sliding window: an iterator that falls further behind the fastest one skips
+  the elements evicted from it. Hence, this transformation suits infinite,
+  e.g. repeated, datasets read at similar rates.
+
+  >>> dataset = tf.data.Dataset.range(10).apply(
+  ...     tf.data.experimental.shared_cache(max_cache_size_bytes=1 << 20))
+  >>> it1 = iter(dataset)
+  >>> it2 = iter(dataset)
+  >>> [next(it1).numpy() for _ in range(3)]
+  [0, 1, 2]
+  >>> [next(it2).numpy() for _ in range(3)]
+  [0, 1, 2]
+
+  The input pipeline runs on resources of its own, on behalf of all the
+  iterators reading the cache, and is destroyed with the last of them.
+  Iterators of a shared cache can not be checkpointed.
+
+  Args:
+    max_cache_size_bytes: A `tf.int64` scalar, the memory budget of the cache
+      in bytes. It must be large enough to hold the largest element.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+  def _apply_fn(dataset):
+    return _SharedCacheDataset(dataset, max_cache_size_bytes)
+
+  return _apply_fn
+
+
+class _SharedCacheDataset(dataset_ops.UnaryUnchangedStructureDataset):
+  """A `Dataset` whose elements are cached across its iterators."""
+
+  def __init__(self, input_dataset, max_cache_size_bytes):
+    self._input_dataset = input_dataset
+    self._max_cache_size_bytes = ops.convert_to_tensor(
+        max_cache_size_bytes, dtype=dtypes.int64, name="max_cache_size_bytes")
+    variant_tensor = ged_ops.shared_cache_dataset(
+        self._input_dataset._variant_tensor,  # pylint: disable=protected-access
+        self._max_cache_size_bytes,
+        **self._flat_structure)
+    super(_SharedCacheDataset, self).__init__(input_dataset, variant_tensor)
@@ -25,6 +25,7 @@ from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import gen_dataset_ops
+from tensorflow.python.ops import gen_experimental_dataset_ops
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import stateless_random_ops
 from tensorflow.python.util import deprecation
@@ -270,3 +271,75 @@ def index_shuffle(file_infos,
       rerandomize_each_iteration=reshuffle_each_iteration)
   rng_ds = rng_ds.take(2).batch(2, drop_remainder=True)
   return rng_ds.flat_map(sequential_index_shuffle)
+
+
+class _GlobalShuffleDataset(dataset_ops.UnaryUnchangedStructureDataset):
+  """A `Dataset` that reads the elements of its input in a random order."""
+
+  def __init__(self,
+               input_dataset,
+               seed=None,
+               reshuffle_each_iteration=True,
+               num_parallel_calls=dataset_ops.AUTOTUNE):
+    self._input_dataset = input_dataset
+    self._num_parallel_calls = ops.convert_to_tensor(
+        num_parallel_calls, dtype=dtypes.int64, name="num_parallel_calls")
+    self._seed, self._seed2 = random_seed.get_seed(seed)
+    variant_tensor = gen_experimental_dataset_ops.global_shuffle_dataset(
+        self._input_dataset._variant_tensor,  # pylint: disable=protected-access
+        num_parallel_calls=self._num_parallel_calls,
+        seed=self._seed,
+        seed2=self._seed2,
+        reshuffle_each_iteration=reshuffle_each_iteration,
+        **self._flat_structure)
+    super(_GlobalShuffleDataset, self).__init__(input_dataset, variant_tensor)
+
+
+# Like `index_shuffle`, this method is not yet exposed in the public API.
+def global_shuffle(seed=None,
+                   reshuffle_each_iteration=True,
+                   num_parallel_calls=dataset_ops.AUTOTUNE):
+  """Shuffles all the elements of a dataset that supports random access.
+
+  Unlike `tf.data.Dataset.shuffle()`, which samples elements from a buffer of
+  the next `buffer_size` elements, `global_shuffle()` reads the elements of the
+  input dataset in the order of a pseudorandom permutation of all of its
+  indices, using random access (see `tf.data.experimental.at`). The permutation
+  is computed one index at a time, so the shuffle is uniform over the whole
+  dataset without buffering any elements, and it is deterministic for a given
+  `seed`. Elements are read in parallel, ahead of the consumer, to hide the
+  latency of random reads.
+
+  The input dataset must have a known, finite cardinality, and all of its
+  transformations must support random access.
+
+  ```python
+  dataset = tf.data.Dataset.range(10_000_000).map(read_record)
+  dataset = dataset.apply(global_shuffle(seed=42))
+  ```
+
+  Args:
+    seed: (Optional.) A `tf.int64` scalar `tf.Tensor`, representing the random
+      seed that will be used to create the permutation. See
+      `tf.random.set_seed` for behavior.
+    reshuffle_each_iteration: (Optional.) A boolean, which if true indicates
+      that the permutation should be different for each iteration over the
+      dataset. Defaults to `True`.
+    num_parallel_calls: (Optional.) A `tf.int64` scalar `tf.Tensor`,
+      representing the maximum number of elements to read in parallel. By
+      default, the tf.data runtime uses autotuning to determine the value
+      dynamically.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+
+  def _apply_fn(dataset):
+    return _GlobalShuffleDataset(
+        dataset,
+        seed=seed,
+        reshuffle_each_iteration=reshuffle_each_iteration,
+        num_parallel_calls=num_parallel_calls)
+
+  return _apply_fn
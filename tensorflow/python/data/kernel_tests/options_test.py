@@ -152,6 +152,7 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.experimental_optimization.warm_start = True
     options.experimental_slack = True
     options.threading.max_intra_op_parallelism = 30
+    options.threading.numa_aware = True
     options.threading.private_threadpool_size = 40
     pb = options._to_proto()
     result = options_lib.Options()
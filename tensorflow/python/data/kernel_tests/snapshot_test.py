@@ -28,6 +28,7 @@ from tensorflow.python.data.kernel_tests import tf_record_test_base
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.ops import options as options_lib
 from tensorflow.python.data.ops import readers as core_readers
+from tensorflow.python.data.ops import snapshot_op
 from tensorflow.python.framework import combinations
 from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
@@ -160,6 +161,51 @@ class SnapshotTest(tf_record_test_base.TFRecordTestBase,
     dataset2 = dataset2.snapshot(path=self._snapshot_dir, compression="SNAPPY")
     self.assertDatasetProduces(dataset2, expected)
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(compression=[
+              snapshot.COMPRESSION_NONE, snapshot.COMPRESSION_SNAPPY
+          ])))
+  def testReadSnapshotDatasetColumnarFormat(self, compression):
+
+    def snapshot_dataset(input_dataset):
+      return snapshot_op._SnapshotDataset(
+          input_dataset,
+          path=self._snapshot_dir,
+          shard_func=lambda index, _: index % 3,
+          compression=compression,
+          file_format_version=3).map(lambda _, elem: elem)
+
+    def make_input_dataset():
+      dataset = dataset_ops.Dataset.range(1000)
+      dataset = dataset.map(lambda x: (x, -x, string_ops.as_string(x)))
+      return dataset.enumerate()
+
+    expected = [(x, -x, b"%d" % x) for x in range(1000)]
+    self.assertDatasetProducesSet(
+        snapshot_dataset(make_input_dataset()), expected)
+    # The second pass reads the finished snapshot, so it adds no run.
+    self.assertDatasetProducesSet(
+        snapshot_dataset(make_input_dataset()), expected)
+    self.assertSnapshotDirectoryContains(
+        self._snapshot_dir,
+        num_fingerprints=1,
+        num_runs_per_fingerprint=1,
+        num_snapshot_shards_per_run=3)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testSnapshotDatasetColumnarFormatRejectsGzip(self):
+    dataset = dataset_ops.Dataset.range(10).enumerate()
+    with self.assertRaises(errors.InvalidArgumentError):
+      dataset = snapshot_op._SnapshotDataset(
+          dataset,
+          path=self._snapshot_dir,
+          shard_func=lambda index, _: index,
+          compression="GZIP",
+          file_format_version=3)
+      self.evaluate(self.getNext(dataset)())
+
   @combinations.generate(test_base.default_test_combinations())
   def testReadSnapshotDatasetCustomShardFn(self):
     self.createTFRecords()
@@ -44,12 +44,18 @@ class AutotuneAlgorithm(enum.Enum):
 
   STAGE_BASED: In each optimization step, this algorithm chooses the worst
   bottleneck parameter and increases its value by 1.
+
+  CONTENTION_AWARE: Similar to HILL_CLIMB but only uses the CPU left over by
+  other processes on the host. If increasing parallelism lowered the observed
+  throughput by more than 5%, parallelism is capped at its previous value
+  until at least one more core becomes available.
   """
   DEFAULT = 0
   HILL_CLIMB = 1
   GRADIENT_DESCENT = 2
   MAX_PARALLELISM = 3
   STAGE_BASED = 4
+  CONTENTION_AWARE = 5
 
   @classmethod
   def _to_proto(cls, obj):
@@ -63,9 +69,12 @@ class AutotuneAlgorithm(enum.Enum):
       return model_pb2.AutotuneAlgorithm.MAX_PARALLELISM
     if obj == cls.STAGE_BASED:
       return model_pb2.AutotuneAlgorithm.STAGE_BASED
+    if obj == cls.CONTENTION_AWARE:
+      return model_pb2.AutotuneAlgorithm.CONTENTION_AWARE
     raise ValueError(
         f"Invalid `obj.` Supported values include `DEFAULT`, `HILL_CLIMB` "
-        f"`GRADIENT_DESCENT`, and `STAGE_BASED`. Got {obj.name}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED`, and `CONTENTION_AWARE`. Got "
+        f"{obj.name}.")
 
   @classmethod
   def _from_proto(cls, pb):
@@ -79,9 +88,11 @@ class AutotuneAlgorithm(enum.Enum):
       return cls.MAX_PARALLELISM
     if pb == model_pb2.AutotuneAlgorithm.STAGE_BASED:
       return cls.STAGE_BASED
+    if pb == model_pb2.AutotuneAlgorithm.CONTENTION_AWARE:
+      return cls.CONTENTION_AWARE
     raise ValueError(
         f"Invalid `pb.` Supported values include `DEFAULT`, `HILL_CLIMB`, "
-        f"`GRADIENT_DESCENT` and `STAGE_BASED`. Got {pb}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED` and `CONTENTION_AWARE`. Got {pb}.")
 
 
 @tf_export("data.experimental.AutoShardPolicy")
@@ -484,6 +495,15 @@ class ThreadingOptions(options_lib.OptionsBase):
       docstring=
       "If set, it overrides the maximum degree of intra-op parallelism.")
 
+  numa_aware = options_lib.create_option(
+      name="numa_aware",
+      ty=bool,
+      docstring=
+      "If true, the input pipeline threads are partitioned per NUMA node, so "
+      "that elements are produced on the NUMA node of the thread consuming "
+      "them, from memory local to that node. Has no effect on hosts with a "
+      "single NUMA node. If None, defaults to False.")
+
   private_threadpool_size = options_lib.create_option(
       name="private_threadpool_size",
       ty=int,
@@ -496,6 +516,8 @@ class ThreadingOptions(options_lib.OptionsBase):
     pb = dataset_options_pb2.ThreadingOptions()
     if self.max_intra_op_parallelism is not None:
       pb.max_intra_op_parallelism = self.max_intra_op_parallelism
+    if self.numa_aware is not None:
+      pb.numa_aware = self.numa_aware
     if self.private_threadpool_size is not None:
       pb.private_threadpool_size = self.private_threadpool_size
     return pb
@@ -503,6 +525,8 @@ class ThreadingOptions(options_lib.OptionsBase):
   def _from_proto(self, pb):
     if pb.WhichOneof("optional_max_intra_op_parallelism") is not None:
       self.max_intra_op_parallelism = pb.max_intra_op_parallelism
+    if pb.WhichOneof("optional_numa_aware") is not None:
+      self.numa_aware = pb.numa_aware
     if pb.WhichOneof("optional_private_threadpool_size") is not None:
       self.private_threadpool_size = pb.private_threadpool_size
 
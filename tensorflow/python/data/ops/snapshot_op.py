@@ -67,6 +67,7 @@ class _SnapshotDataset(dataset_ops.UnaryUnchangedStructureDataset):
                reader_func=None,
                pending_snapshot_expiry_seconds=None,
                use_legacy_function=False,
+               file_format_version=0,
                name=None):
 
     if reader_func is None:
@@ -109,6 +110,7 @@ class _SnapshotDataset(dataset_ops.UnaryUnchangedStructureDataset):
         compression=compression,
         reader_func=self._reader_func.function,
         shard_func=self._shard_func.function,
+        file_format_version=file_format_version,
         **self._common_args)
     super().__init__(input_dataset, variant_tensor)
 
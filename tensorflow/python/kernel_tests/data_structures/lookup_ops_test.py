@@ -4226,6 +4226,134 @@ class MutableHashTableOpTest(test.TestCase):
     self.assertTrue(inferred_shapes[1].is_compatible_with(actual_shapes[1]))
 
 
+class MutableStripedHashTableOpTest(test.TestCase):
+
+  @test_util.run_v2_only
+  def testInsertFindRemoveExport(self):
+    table = gen_lookup_ops.mutable_striped_hash_table(
+        key_dtype=dtypes.string, value_dtype=dtypes.int64, num_shards=4)
+    keys = constant_op.constant(["brain", "salad", "surgery", "tarkus"])
+    values = constant_op.constant([0, 1, 2, 3], dtypes.int64)
+    gen_lookup_ops.lookup_table_insert_v2(table, keys, values)
+    self.assertAllEqual(4, gen_lookup_ops.lookup_table_size_v2(table))
+
+    gen_lookup_ops.lookup_table_remove_v2(
+        table, constant_op.constant(["tarkus", "tank"]))
+    self.assertAllEqual(3, gen_lookup_ops.lookup_table_size_v2(table))
+
+    output = gen_lookup_ops.lookup_table_find_v2(
+        table, constant_op.constant(["brain", "salad", "tank"]),
+        constant_op.constant(-1, dtypes.int64))
+    self.assertAllEqual([0, 1, -1], output)
+
+    exported_keys, exported_values = gen_lookup_ops.lookup_table_export_v2(
+        table, Tkeys=dtypes.string, Tvalues=dtypes.int64)
+    self.assertAllEqual([b"brain", b"salad", b"surgery"],
+                        np.sort(exported_keys))
+    self.assertAllEqual([0, 1, 2], np.sort(exported_values))
+
+  @test_util.run_v2_only
+  def testImportReplacesContents(self):
+    table = gen_lookup_ops.mutable_striped_hash_table(
+        key_dtype=dtypes.int64, value_dtype=dtypes.float32)
+    gen_lookup_ops.lookup_table_insert_v2(
+        table, constant_op.constant([1, 2], dtypes.int64),
+        constant_op.constant([1.0, 2.0]))
+    gen_lookup_ops.lookup_table_import_v2(
+        table, constant_op.constant([2, 3, 4], dtypes.int64),
+        constant_op.constant([20.0, 30.0, 40.0]))
+    self.assertAllEqual(3, gen_lookup_ops.lookup_table_size_v2(table))
+    output = gen_lookup_ops.lookup_table_find_v2(
+        table, constant_op.constant([1, 2, 4], dtypes.int64),
+        constant_op.constant(0.0))
+    self.assertAllEqual([0.0, 20.0, 40.0], output)
+
+  @test_util.run_v2_only
+  def testInvalidNumShards(self):
+    with self.assertRaises(
+        (errors_impl.InvalidArgumentError, ValueError)):
+      gen_lookup_ops.mutable_striped_hash_table(
+          key_dtype=dtypes.int64, value_dtype=dtypes.float32, num_shards=0)
+
+  @test_util.run_v2_only
+  def testVectorValues(self):
+    table = gen_lookup_ops.mutable_striped_hash_table_of_tensors(
+        key_dtype=dtypes.int64,
+        value_dtype=dtypes.float32,
+        value_shape=[2],
+        num_shards=4)
+    gen_lookup_ops.lookup_table_insert_v2(
+        table, constant_op.constant([1, 2, 3], dtypes.int64),
+        constant_op.constant([[1.0, 1.5], [2.0, 2.5], [3.0, 3.5]]))
+    gen_lookup_ops.lookup_table_remove_v2(
+        table, constant_op.constant([3], dtypes.int64))
+    self.assertAllEqual(2, gen_lookup_ops.lookup_table_size_v2(table))
+
+    output = gen_lookup_ops.lookup_table_find_v2(
+        table, constant_op.constant([1, 2, 3], dtypes.int64),
+        constant_op.constant([-1.0, -1.0]))
+    self.assertAllEqual([[1.0, 1.5], [2.0, 2.5], [-1.0, -1.0]], output)
+
+    gen_lookup_ops.lookup_table_import_v2(
+        table, constant_op.constant([4], dtypes.int64),
+        constant_op.constant([[4.0, 4.5]]))
+    exported_keys, exported_values = gen_lookup_ops.lookup_table_export_v2(
+        table, Tkeys=dtypes.int64, Tvalues=dtypes.float32)
+    self.assertAllEqual([4], exported_keys)
+    self.assertAllEqual([[4.0, 4.5]], exported_values)
+
+
+class TieredHashTableOpTest(test.TestCase):
+
+  def _create_table(self, cache_capacity):
+    return gen_lookup_ops.tiered_hash_table(
+        key_dtype=dtypes.int64,
+        value_dtype=dtypes.float32,
+        value_shape=[2],
+        storage_path=os.path.join(self.get_temp_dir(), "tiered_hash_table"),
+        cache_capacity=cache_capacity)
+
+  @test_util.run_v2_only
+  def testInsertFindRemoveExport(self):
+    table = self._create_table(cache_capacity=2)
+    keys = constant_op.constant(np.arange(10), dtypes.int64)
+    values = constant_op.constant(
+        [[i, -i] for i in range(10)], dtypes.float32)
+    gen_lookup_ops.lookup_table_insert_v2(table, keys, values)
+    self.assertAllEqual(10, gen_lookup_ops.lookup_table_size_v2(table))
+
+    gen_lookup_ops.lookup_table_remove_v2(
+        table, constant_op.constant([9, 42], dtypes.int64))
+    self.assertAllEqual(9, gen_lookup_ops.lookup_table_size_v2(table))
+
+    output = gen_lookup_ops.lookup_table_find_v2(
+        table, constant_op.constant([0, 5, 9, 8], dtypes.int64),
+        constant_op.constant([-1.0, -1.0]))
+    self.assertAllEqual([[0, 0], [5, -5], [-1, -1], [8, -8]], output)
+
+    exported_keys, exported_values = gen_lookup_ops.lookup_table_export_v2(
+        table, Tkeys=dtypes.int64, Tvalues=dtypes.float32)
+    order = np.argsort(exported_keys)
+    self.assertAllEqual(np.arange(9), np.take(exported_keys, order))
+    self.assertAllEqual([[i, -i] for i in range(9)],
+                        np.take(exported_values, order, axis=0))
+
+  @test_util.run_v2_only
+  def testImportReplacesContents(self):
+    table = self._create_table(cache_capacity=1)
+    gen_lookup_ops.lookup_table_insert_v2(
+        table, constant_op.constant([1, 2], dtypes.int64),
+        constant_op.constant([[1.0, 1.0], [2.0, 2.0]]))
+    gen_lookup_ops.lookup_table_import_v2(
+        table, constant_op.constant([2, 3, 4], dtypes.int64),
+        constant_op.constant([[20.0, 2.0], [30.0, 3.0], [40.0, 4.0]]))
+    self.assertAllEqual(3, gen_lookup_ops.lookup_table_size_v2(table))
+    output = gen_lookup_ops.lookup_table_find_v2(
+        table, constant_op.constant([1, 2, 4], dtypes.int64),
+        constant_op.constant([0.0, 0.0]))
+    self.assertAllEqual([[0.0, 0.0], [20.0, 2.0], [40.0, 4.0]], output)
+
+
 class MutableHashTableBenchmark(test.Benchmark):
 
   def _create_table(self):
@@ -420,6 +420,29 @@ class UnsortedSegmentTest(SegmentReductionHelper, parameterized.TestCase):
         self.assertAllClose(np_ans, tf_ans)
         self.assertShapeEqual(np_ans, s)
 
+  def testLargeNumSegments(self):
+    # Large enough inputs take the bucketed CPU path.
+    np.random.seed(0)
+    num_segments = 5000
+    indices = np.random.randint(0, num_segments, size=4096)
+    np_x = np.random.rand(4096, 16).astype(np.float32)
+    for np_op, tf_op, init_value in [
+        (np.add, math_ops.unsorted_segment_sum, 0),
+        (np.minimum, math_ops.unsorted_segment_min, np.finfo(np.float32).max),
+        (np.maximum, math_ops.unsorted_segment_max, np.finfo(np.float32).min),
+    ]:
+      with self.cached_session(use_gpu=False):
+        np_ans = self._segmentReduce(
+            indices,
+            np_x,
+            np_op,
+            num_segments=num_segments,
+            initial_value=init_value,
+            empty_value=init_value,
+        )
+        s = tf_op(np_x, segment_ids=indices, num_segments=num_segments)
+        self.assertAllClose(np_ans, self.evaluate(s))
+
   @test_util.run_deprecated_v1
   def testGradientsTFGradients(self):
     num_cols = 2
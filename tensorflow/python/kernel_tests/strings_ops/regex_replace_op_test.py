@@ -68,6 +68,23 @@ class RegexReplaceOpVariantsTest(test.TestCase, parameterized.TestCase):
       stripped = op(input_vector, "", "x")
       self.assertAllEqual([b"xaxbxcx", b"x1x"], stripped)
 
+  @test_util.run_deprecated_v1
+  def testLiteralReplace(self, op):
+    values = ["a%20b%20c", "aaaa", "café %20", "none", ""]
+    with self.cached_session():
+      input_vector = constant_op.constant(values, dtypes.string)
+      replaced = op(input_vector, "%20", " ")
+      self.assertAllEqual(
+          [b"a b c", b"aaaa", "café  ".encode("utf-8"), b"none", b""],
+          replaced)
+      replaced = op(input_vector, "aa", "b", replace_global=False)
+      self.assertAllEqual(
+          [b"a%20b%20c", b"baa", "café %20".encode("utf-8"), b"none",
+           b""], replaced)
+      replaced = op(input_vector, "é", "e")
+      self.assertAllEqual(
+          [b"a%20b%20c", b"aaaa", b"cafe %20", b"none", b""], replaced)
+
   @test_util.run_deprecated_v1
   def testInvalidPattern(self, op):
     values = ["abc", "1"]
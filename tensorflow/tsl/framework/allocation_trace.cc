@@ -0,0 +1,97 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/tsl/framework/allocation_trace.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/tsl/platform/errors.h"
+
+namespace tsl {
+
+std::string SerializeAllocationTrace(const AllocationTrace& trace) {
+  std::string text;
+  for (const AllocationTraceEvent& event : trace) {
+    if (event.is_allocation) {
+      absl::StrAppend(&text, "a ", event.id, " ", event.num_bytes, "\n");
+    } else {
+      absl::StrAppend(&text, "f ", event.id, "\n");
+    }
+  }
+  return text;
+}
+
+Status ParseAllocationTrace(absl::string_view text, AllocationTrace* trace) {
+  trace->clear();
+  int line_number = 0;
+  for (absl::string_view line : absl::StrSplit(text, '\n', absl::SkipEmpty())) {
+    ++line_number;
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    AllocationTraceEvent event;
+    bool ok = false;
+    if (fields.size() == 3 && fields[0] == "a") {
+      uint64 num_bytes;
+      ok = absl::SimpleAtoi(fields[1], &event.id) &&
+           absl::SimpleAtoi(fields[2], &num_bytes);
+      event.num_bytes = num_bytes;
+    } else if (fields.size() == 2 && fields[0] == "f") {
+      event.is_allocation = false;
+      ok = absl::SimpleAtoi(fields[1], &event.id);
+    }
+    if (!ok) {
+      return errors::InvalidArgument(
+          "Malformed allocation trace event on line ", line_number, ": ", line);
+    }
+    trace->push_back(event);
+  }
+  return OkStatus();
+}
+
+Status ReplayAllocationTrace(const AllocationTrace& trace,
+                             Allocator* allocator) {
+  absl::flat_hash_map<int64_t, void*> live;
+  Status status;
+  for (const AllocationTraceEvent& event : trace) {
+    if (event.is_allocation) {
+      void* ptr = allocator->AllocateRaw(Allocator::kAllocatorAlignment,
+                                         event.num_bytes);
+      if (ptr == nullptr) {
+        status = errors::ResourceExhausted(
+            "Allocator ", allocator->Name(), " failed to allocate ",
+            event.num_bytes, " bytes while replaying allocation ", event.id);
+        break;
+      }
+      void*& slot = live[event.id];
+      if (slot != nullptr) allocator->DeallocateRaw(slot);
+      slot = ptr;
+    } else {
+      auto it = live.find(event.id);
+      if (it == live.end()) continue;
+      allocator->DeallocateRaw(it->second);
+      live.erase(it);
+    }
+  }
+  for (const auto& id_and_ptr : live) {
+    allocator->DeallocateRaw(id_and_ptr.second);
+  }
+  return status;
+}
+
+}  // namespace tsl
@@ -0,0 +1,57 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_TSL_FRAMEWORK_ALLOCATION_TRACE_H_
+#define TENSORFLOW_TSL_FRAMEWORK_ALLOCATION_TRACE_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/tsl/framework/allocator.h"
+#include "tensorflow/tsl/platform/status.h"
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+
+// One allocation or deallocation seen by an allocator.  The allocation and
+// the deallocation of the same buffer share an `id`.
+struct AllocationTraceEvent {
+  bool is_allocation = true;
+  int64_t id = 0;
+  // The requested size, for allocations.
+  size_t num_bytes = 0;
+};
+
+// A sequence of allocation events in the order in which they happened, e.g.
+// as recorded by BFCAllocator::StartAllocationTrace().
+using AllocationTrace = std::vector<AllocationTraceEvent>;
+
+// Converts `trace` to a text form with one event per line: "a <id> <bytes>"
+// for an allocation and "f <id>" for a deallocation.
+std::string SerializeAllocationTrace(const AllocationTrace& trace);
+
+// Parses the output of SerializeAllocationTrace() into `trace`.
+Status ParseAllocationTrace(absl::string_view text, AllocationTrace* trace);
+
+// Issues the allocations and deallocations of `trace` against `allocator`.
+// Deallocations of buffers allocated before the trace started are ignored, and
+// buffers still live at the end of the trace are deallocated.  Returns an
+// error if an allocation fails.
+Status ReplayAllocationTrace(const AllocationTrace& trace,
+                             Allocator* allocator);
+
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_FRAMEWORK_ALLOCATION_TRACE_H_
@@ -19,9 +19,11 @@ limitations under the License.
 #include <atomic>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "tensorflow/tsl/framework/allocator_retry.h"
+#include "tensorflow/tsl/framework/metrics.h"
 #include "tensorflow/tsl/lib/core/bits.h"
 #include "tensorflow/tsl/platform/file_system.h"
 #include "tensorflow/tsl/platform/logging.h"
@@ -210,6 +212,7 @@ bool BFCAllocator::Extend(size_t alignment, size_t rounded_bytes) {
   // Maybe merge adjacent chunks and insert the chunk into the right bin.
   InsertFreeChunkIntoBin(TryToCoalesce(h, /*ignore_freed_at=*/false));
 
+  MaybePublishFragmentationMetrics(/*force=*/true);
   return true;
 }
 
@@ -515,6 +518,51 @@ double BFCAllocator::GetFragmentation() {
          bytes_available;
 }
 
+void BFCAllocator::MaybePublishFragmentationMetrics(bool force) {
+  if (!force && num_allocs_since_publish_ + num_deallocs_since_publish_ <
+                    kFragmentationMetricsInterval) {
+    return;
+  }
+  std::vector<int64_t> bin_sizes(kNumBins);
+  std::vector<int64_t> bin_free_chunks(kNumBins);
+  std::vector<int64_t> bin_free_bytes(kNumBins);
+  for (BinNum b = 0; b < kNumBins; b++) {
+    const Bin* bin = BinFromIndex(b);
+    bin_sizes[b] = bin->bin_size;
+    bin_free_chunks[b] = bin->free_chunks.size();
+    bin_free_bytes[b] = bin->free_bytes;
+  }
+  const bool any_free = *stats_.pool_bytes > stats_.bytes_in_use;
+  metrics::UpdateBfcAllocatorFragmentation(
+      name_, LargestFreeChunk(), any_free ? GetFragmentation() : 0.0, bin_sizes,
+      bin_free_chunks, bin_free_bytes, num_allocs_since_publish_,
+      num_deallocs_since_publish_);
+  num_allocs_since_publish_ = 0;
+  num_deallocs_since_publish_ = 0;
+}
+
+void BFCAllocator::RecordTraceEvent(bool is_allocation, int64_t id,
+                                    size_t num_bytes) {
+  if (trace_.size() < max_trace_events_) {
+    trace_.push_back({is_allocation, id, num_bytes});
+  }
+}
+
+void BFCAllocator::StartAllocationTrace(size_t max_events) {
+  mutex_lock l(lock_);
+  max_trace_events_ = max_events;
+  trace_.clear();
+  trace_.reserve(std::min<size_t>(max_events, 1 << 20));
+}
+
+AllocationTrace BFCAllocator::StopAllocationTrace() {
+  mutex_lock l(lock_);
+  max_trace_events_ = 0;
+  AllocationTrace trace;
+  trace.swap(trace_);
+  return trace;
+}
+
 void BFCAllocator::AddTraceMe(absl::string_view traceme_name, const void* ptr) {
   BFCAllocator::Chunk* chunk = ChunkFromHandle(region_manager_.get_handle(ptr));
   AddTraceMe(traceme_name, chunk->ptr, chunk->requested_size, chunk->size);
@@ -555,15 +603,36 @@ void BFCAllocator::AddTraceMe(absl::string_view traceme_name,
       /*level=*/tsl::profiler::TraceMeLevel::kInfo);
 }
 
+BFCAllocator::Bin::FreeChunkSet::iterator BFCAllocator::LowestAddressFit(
+    Bin* b, size_t rounded_bytes, uint64 freed_before) {
+  auto lowest = b->free_chunks.end();
+  for (auto citer = b->free_chunks.begin(); citer != b->free_chunks.end();
+       ++citer) {
+    const Chunk* chunk = ChunkFromHandle(*citer);
+    if (chunk->size < rounded_bytes ||
+        (freed_before > 0 && freed_before < chunk->freed_at_count)) {
+      continue;
+    }
+    if (lowest == b->free_chunks.end() ||
+        chunk->ptr < ChunkFromHandle(*lowest)->ptr) {
+      lowest = citer;
+    }
+  }
+  return lowest;
+}
+
 void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
                                  size_t num_bytes, uint64 freed_before) {
   // First identify the first bin that could satisfy rounded_bytes.
   for (; bin_num < kNumBins; bin_num++) {
     // Start searching from the first bin for the smallest chunk that fits
-    // rounded_bytes.
+    // rounded_bytes, or from the lowest-addressed one if the allocator is
+    // address ordered.
     Bin* b = BinFromIndex(bin_num);
-    for (auto citer = b->free_chunks.begin(); citer != b->free_chunks.end();
-         ++citer) {
+    for (auto citer = opts_.best_fit_address_ordered
+                          ? LowestAddressFit(b, rounded_bytes, freed_before)
+                          : b->free_chunks.begin();
+         citer != b->free_chunks.end(); ++citer) {
       const BFCAllocator::ChunkHandle h = (*citer);
       BFCAllocator::Chunk* chunk = ChunkFromHandle(h);
       DCHECK(!chunk->in_use());
@@ -635,6 +704,10 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
         if (VLOG_IS_ON(4)) {
           LOG(INFO) << "A: " << RenderOccupancy();
         }
+        RecordTraceEvent(/*is_allocation=*/true, chunk->allocation_id,
+                         num_bytes);
+        ++num_allocs_since_publish_;
+        MaybePublishFragmentationMetrics(/*force=*/false);
         return chunk->ptr;
       }
     }
@@ -703,6 +776,7 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   void* chunk_ptr = chunk->ptr;
   int64_t req_bytes = chunk->requested_size;
   int64_t alloc_bytes = chunk->size;
+  RecordTraceEvent(/*is_allocation=*/false, chunk->allocation_id, req_bytes);
 
   MarkFree(h);
 
@@ -718,6 +792,9 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   // correct aggregation stats (bytes_in_use, fragmentation).
   AddTraceMe("MemoryDeallocation", chunk_ptr, req_bytes, alloc_bytes);
 
+  ++num_deallocs_since_publish_;
+  MaybePublishFragmentationMetrics(/*force=*/false);
+
   if (VLOG_IS_ON(4)) {
     LOG(INFO) << "F: " << RenderOccupancy();
   }
@@ -772,6 +849,7 @@ void BFCAllocator::InsertFreeChunkIntoBin(BFCAllocator::ChunkHandle h) {
   Bin* new_bin = BinFromIndex(bin_num);
   c->bin_num = bin_num;
   new_bin->free_chunks.insert(h);
+  new_bin->free_bytes += c->size;
 }
 
 void BFCAllocator::RemoveFreeChunkIterFromBin(
@@ -781,6 +859,7 @@ void BFCAllocator::RemoveFreeChunkIterFromBin(
   Chunk* c = ChunkFromHandle(h);
   CHECK(!c->in_use() && (c->bin_num != kInvalidBinNum));
   free_chunks->erase(citer);
+  BinFromIndex(c->bin_num)->free_bytes -= c->size;
   c->bin_num = kInvalidBinNum;
 }
 
@@ -789,6 +868,7 @@ void BFCAllocator::RemoveFreeChunkFromBin(BFCAllocator::ChunkHandle h) {
   CHECK(!c->in_use() && (c->bin_num != kInvalidBinNum));
   CHECK_GT(BinFromIndex(c->bin_num)->free_chunks.erase(h), 0)
       << "Could not find chunk in bin";
+  BinFromIndex(c->bin_num)->free_bytes -= c->size;
   c->bin_num = kInvalidBinNum;
 }
 
@@ -24,6 +24,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "tensorflow/tsl/framework/allocation_trace.h"
 #include "tensorflow/tsl/framework/allocator.h"
 #include "tensorflow/tsl/framework/allocator_retry.h"
 #include "tensorflow/tsl/framework/shared_counter.h"
@@ -68,6 +69,13 @@ class BFCAllocator : public Allocator {
     // Controls when a chunk should be split, if its size exceeds the requested
     // allocation size.
     double fragmentation_fraction = 0;
+
+    // Controls which free chunk serves a request.  By default the smallest
+    // chunk that fits is used.  If true, the lowest-addressed chunk that fits
+    // in the smallest bin holding one is used instead, which packs long-lived
+    // allocations towards the start of the regions and leaves larger free
+    // ranges at their end, at the cost of scanning that bin.
+    bool best_fit_address_ordered = false;
   };
   BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator, size_t total_memory,
                const string& name, const Options& opts);
@@ -107,6 +115,15 @@ class BFCAllocator : public Allocator {
 
   MemoryDump RecordMemoryMap();
 
+  // Starts recording the allocations and deallocations made through this
+  // allocator, keeping at most the first `max_events` of them.
+  void StartAllocationTrace(size_t max_events);
+
+  // Stops recording and returns the events recorded since
+  // StartAllocationTrace().  The trace can be replayed against another
+  // allocator with ReplayAllocationTrace().
+  AllocationTrace StopAllocationTrace();
+
  private:
   struct Bin;
 
@@ -270,6 +287,8 @@ class BFCAllocator : public Allocator {
     // List of free chunks within the bin, sorted by chunk size.
     // Chunk * not owned.
     FreeChunkSet free_chunks;
+    // Total size of the chunks in free_chunks.
+    size_t free_bytes = 0;
     Bin(BFCAllocator* allocator, size_t bs)
         : bin_size(bs), free_chunks(ChunkComparator(allocator)) {}
   };
@@ -517,6 +536,22 @@ class BFCAllocator : public Allocator {
   // size over total free memory, and returns a value within [0, 1].
   double GetFragmentation() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Returns the lowest-addressed chunk of `b` that can serve an allocation of
+  // `rounded_bytes`, or b->free_chunks.end() if there is none.
+  Bin::FreeChunkSet::iterator LowestAddressFit(Bin* b, size_t rounded_bytes,
+                                               uint64 freed_before)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Publishes the fragmentation metrics of the allocator once every
+  // kFragmentationMetricsInterval allocations and deallocations, or right away
+  // if `force` is true.
+  void MaybePublishFragmentationMetrics(bool force)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Appends an event to the allocation trace, if one is being recorded.
+  void RecordTraceEvent(bool is_allocation, int64_t id, size_t num_bytes)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Information about a Bin that is useful for debugging.
   struct BinDebugInfo {
     size_t total_bytes_in_use = 0;
@@ -611,6 +646,16 @@ class BFCAllocator : public Allocator {
 
   // Stats.
   AllocatorStats stats_ TF_GUARDED_BY(lock_);
+
+  // Allocations and deallocations since the fragmentation metrics were last
+  // published.
+  static constexpr int64_t kFragmentationMetricsInterval = 1024;
+  int64_t num_allocs_since_publish_ TF_GUARDED_BY(lock_) = 0;
+  int64_t num_deallocs_since_publish_ TF_GUARDED_BY(lock_) = 0;
+
+  // The allocation trace being recorded, if `max_trace_events_` > 0.
+  size_t max_trace_events_ TF_GUARDED_BY(lock_) = 0;
+  AllocationTrace trace_ TF_GUARDED_BY(lock_);
 #ifdef TENSORFLOW_MEM_DEBUG
   int64 action_counter_ TF_GUARDED_BY(lock_) = 0;
 #define MEM_DEBUG_SIZE_HISTORY_SIZE 4096
@@ -0,0 +1,228 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/bfc_allocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tensorflow/tsl/framework/allocation_trace.h"
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/lib/monitoring/cell_reader.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/status.h"
+#include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/platform/test_benchmark.h"
+
+namespace tsl {
+namespace {
+
+using monitoring::testing::CellReader;
+
+// Hands out memory from the CPU allocator.
+class TestSubAllocator : public SubAllocator {
+ public:
+  TestSubAllocator() : SubAllocator({}, {}) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    *bytes_received = num_bytes;
+    return cpu_allocator_base()->AllocateRaw(alignment, num_bytes);
+  }
+
+  void Free(void* ptr, size_t num_bytes) override {
+    cpu_allocator_base()->DeallocateRaw(ptr);
+  }
+
+  bool SupportsCoalescing() const override { return false; }
+};
+
+std::unique_ptr<BFCAllocator> NewAllocator(const std::string& name,
+                                           bool best_fit_address_ordered) {
+  BFCAllocator::Options opts;
+  opts.allow_retry_on_failure = false;
+  opts.best_fit_address_ordered = best_fit_address_ordered;
+  return std::make_unique<BFCAllocator>(std::make_unique<TestSubAllocator>(),
+                                        size_t{1} << 30, name, opts);
+}
+
+TEST(BFCAllocatorTest, BestFitAddressOrdered) {
+  for (bool address_ordered : {false, true}) {
+    std::unique_ptr<BFCAllocator> a = NewAllocator("test", address_ordered);
+    // Leaves two free chunks in the same bin, the larger one at the lower
+    // address.
+    void* low = a->AllocateRaw(Allocator::kAllocatorAlignment, 1792);
+    void* sep1 = a->AllocateRaw(Allocator::kAllocatorAlignment, 256);
+    void* high = a->AllocateRaw(Allocator::kAllocatorAlignment, 1280);
+    void* sep2 = a->AllocateRaw(Allocator::kAllocatorAlignment, 256);
+    ASSERT_LT(low, high);
+    a->DeallocateRaw(low);
+    a->DeallocateRaw(high);
+
+    void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+    EXPECT_EQ(address_ordered ? low : high, p);
+
+    a->DeallocateRaw(p);
+    a->DeallocateRaw(sep1);
+    a->DeallocateRaw(sep2);
+  }
+}
+
+TEST(BFCAllocatorTest, RecordAndReplayTrace) {
+  std::unique_ptr<BFCAllocator> a = NewAllocator("test", false);
+  void* before = a->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  a->StartAllocationTrace(/*max_events=*/4);
+  void* p1 = a->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  void* p2 = a->AllocateRaw(Allocator::kAllocatorAlignment, 2000);
+  a->DeallocateRaw(p1);
+  a->DeallocateRaw(before);
+  a->DeallocateRaw(p2);  // Past max_events.
+  AllocationTrace trace = a->StopAllocationTrace();
+
+  ASSERT_EQ(4, trace.size());
+  EXPECT_TRUE(trace[0].is_allocation);
+  EXPECT_EQ(1000, trace[0].num_bytes);
+  EXPECT_TRUE(trace[1].is_allocation);
+  EXPECT_EQ(2000, trace[1].num_bytes);
+  EXPECT_FALSE(trace[2].is_allocation);
+  EXPECT_EQ(trace[0].id, trace[2].id);
+  EXPECT_FALSE(trace[3].is_allocation);
+
+  AllocationTrace parsed;
+  TF_ASSERT_OK(ParseAllocationTrace(SerializeAllocationTrace(trace), &parsed));
+  ASSERT_EQ(trace.size(), parsed.size());
+  for (size_t i = 0; i < trace.size(); ++i) {
+    EXPECT_EQ(trace[i].is_allocation, parsed[i].is_allocation);
+    EXPECT_EQ(trace[i].id, parsed[i].id);
+    if (trace[i].is_allocation) {
+      EXPECT_EQ(trace[i].num_bytes, parsed[i].num_bytes);
+    }
+  }
+  EXPECT_FALSE(ParseAllocationTrace("a 1\n", &parsed).ok());
+
+  std::unique_ptr<BFCAllocator> replay = NewAllocator("replay", true);
+  TF_ASSERT_OK(ReplayAllocationTrace(parsed, replay.get()));
+  absl::optional<AllocatorStats> stats = replay->GetStats();
+  EXPECT_EQ(2, stats->num_allocs);
+  EXPECT_EQ(0, stats->bytes_in_use);
+  EXPECT_EQ(1024 + 2048, stats->peak_bytes_in_use);
+}
+
+TEST(BFCAllocatorTest, FragmentationMetrics) {
+  CellReader<int64_t> largest_free_chunk(
+      "/tensorflow/core/bfc_allocator/largest_free_chunk_bytes");
+  CellReader<int64_t> bin_free_chunks(
+      "/tensorflow/core/bfc_allocator/bin_free_chunks");
+  CellReader<int64_t> churn("/tensorflow/core/bfc_allocator/churn");
+
+  std::unique_ptr<BFCAllocator> a = NewAllocator("metrics_test", false);
+  // Creating the first region publishes the metrics.
+  void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_EQ(2 << 20, largest_free_chunk.Read("metrics_test"));
+  EXPECT_EQ(1, bin_free_chunks.Read("metrics_test", "2097152"));
+  EXPECT_EQ(0, churn.Delta("metrics_test", "allocate"));
+
+  // The metrics are published again after 1024 more allocations and
+  // deallocations.
+  a->DeallocateRaw(p);
+  for (int i = 0; i < 511; ++i) {
+    a->DeallocateRaw(a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  }
+  EXPECT_EQ(512, churn.Delta("metrics_test", "allocate"));
+  EXPECT_EQ(512, churn.Delta("metrics_test", "deallocate"));
+  EXPECT_EQ(2 << 20, largest_free_chunk.Read("metrics_test"));
+}
+
+// Returns the allocation trace to replay: the one in the file named by
+// TF_BFC_ALLOCATOR_REPLAY_TRACE, as written by SerializeAllocationTrace(), or
+// else a synthetic trace of training-like steps.  Each step allocates
+// activations of 1KB to 4MB and frees them in random order, except for a few
+// that stay alive for many steps, as caches and optimizer state do.
+AllocationTrace GetReplayTrace() {
+  const char* path = getenv("TF_BFC_ALLOCATOR_REPLAY_TRACE");
+  if (path != nullptr) {
+    std::string text;
+    TF_CHECK_OK(ReadFileToString(Env::Default(), path, &text));
+    AllocationTrace trace;
+    TF_CHECK_OK(ParseAllocationTrace(text, &trace));
+    return trace;
+  }
+
+  constexpr int kNumSteps = 200;
+  constexpr int kAllocationsPerStep = 64;
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> log_size(std::log(1 << 10),
+                                                  std::log(4 << 20));
+  std::uniform_int_distribution<int> percent(0, 99);
+  AllocationTrace trace;
+  int64_t next_id = 1;
+  std::vector<std::pair<int, int64_t>> long_lived;  // (last step, id)
+  for (int step = 0; step < kNumSteps; ++step) {
+    std::vector<int64_t> activations;
+    for (int i = 0; i < kAllocationsPerStep; ++i) {
+      const int64_t id = next_id++;
+      trace.push_back(
+          {true, id, static_cast<size_t>(std::exp(log_size(rng)))});
+      if (percent(rng) < 3) {
+        long_lived.push_back({step + 20 + percent(rng), id});
+      } else {
+        activations.push_back(id);
+      }
+    }
+    std::shuffle(activations.begin(), activations.end(), rng);
+    for (int64_t id : activations) trace.push_back({false, id, 0});
+    auto expired = std::partition(
+        long_lived.begin(), long_lived.end(),
+        [step](const std::pair<int, int64_t>& l) { return l.first > step; });
+    for (auto it = expired; it != long_lived.end(); ++it) {
+      trace.push_back({false, it->second, 0});
+    }
+    long_lived.erase(expired, long_lived.end());
+  }
+  return trace;
+}
+
+// Replays an allocation trace against a BFC allocator using either the default
+// best-fit policy or the address-ordered one, and reports how much memory the
+// allocator had to reserve from its sub-allocator.
+static void BM_ReplayAllocationTrace(::testing::benchmark::State& state) {
+  const bool address_ordered = state.range(0);
+  static const AllocationTrace* trace =
+      new AllocationTrace(GetReplayTrace());
+  int64_t peak_pool_bytes = 0;
+  int64_t peak_bytes_in_use = 0;
+  for (auto s : state) {
+    std::unique_ptr<BFCAllocator> a = NewAllocator("replay", address_ordered);
+    TF_CHECK_OK(ReplayAllocationTrace(*trace, a.get()));
+    absl::optional<AllocatorStats> stats = a->GetStats();
+    peak_pool_bytes = *stats->peak_pool_bytes;
+    peak_bytes_in_use = stats->peak_bytes_in_use;
+  }
+  state.SetItemsProcessed(state.iterations() * trace->size());
+  state.SetLabel(address_ordered ? "address_ordered" : "best_fit");
+  state.counters["peak_pool_mb"] =
+      static_cast<double>(peak_pool_bytes) / (1 << 20);
+  state.counters["peak_in_use_mb"] =
+      static_cast<double>(peak_bytes_in_use) / (1 << 20);
+}
+BENCHMARK(BM_ReplayAllocationTrace)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace tsl
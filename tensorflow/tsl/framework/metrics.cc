@@ -16,8 +16,12 @@ limitations under the License.
 #include "tensorflow/tsl/framework/metrics.h"
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "tensorflow/tsl/lib/monitoring/counter.h"
+#include "tensorflow/tsl/lib/monitoring/gauge.h"
+#include "tensorflow/tsl/lib/monitoring/sampler.h"
 
 namespace tsl {
 namespace metrics {
@@ -28,6 +32,34 @@ auto* bfc_allocator_delay =
                                 "The total time spent running each graph "
                                 "optimization pass in microseconds.");
 
+auto* bfc_allocator_largest_free_chunk = monitoring::Gauge<int64_t, 1>::New(
+    "/tensorflow/core/bfc_allocator/largest_free_chunk_bytes",
+    "The size of the largest free chunk of a BFC allocator in bytes.",
+    "allocator");
+
+auto* bfc_allocator_fragmentation = monitoring::Sampler<1>::New(
+    {"/tensorflow/core/bfc_allocator/fragmentation",
+     "The fraction of the free memory of a BFC allocator that is not part of "
+     "its largest free chunk.",
+     "allocator"},
+    {monitoring::Buckets::Explicit(
+        {0.05, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 0.95})});
+
+auto* bfc_allocator_bin_free_chunks = monitoring::Gauge<int64_t, 2>::New(
+    "/tensorflow/core/bfc_allocator/bin_free_chunks",
+    "The number of free chunks in a bin of a BFC allocator.", "allocator",
+    "bin");
+
+auto* bfc_allocator_bin_free_bytes = monitoring::Gauge<int64_t, 2>::New(
+    "/tensorflow/core/bfc_allocator/bin_free_bytes",
+    "The total size of the free chunks in a bin of a BFC allocator in bytes.",
+    "allocator", "bin");
+
+auto* bfc_allocator_churn = monitoring::Counter<2>::New(
+    "/tensorflow/core/bfc_allocator/churn",
+    "The number of allocations and deallocations made by a BFC allocator.",
+    "allocator", "operation");
+
 }  // namespace
 
 void UpdateBfcAllocatorDelayTime(const uint64_t delay_usecs) {
@@ -37,5 +69,31 @@ void UpdateBfcAllocatorDelayTime(const uint64_t delay_usecs) {
   }
 }
 
+void UpdateBfcAllocatorFragmentation(
+    const std::string& allocator_name, int64_t largest_free_chunk_bytes,
+    double fragmentation, const std::vector<int64_t>& bin_sizes,
+    const std::vector<int64_t>& bin_free_chunks,
+    const std::vector<int64_t>& bin_free_bytes, int64_t num_allocs,
+    int64_t num_deallocs) {
+  bfc_allocator_largest_free_chunk->GetCell(allocator_name)
+      ->Set(largest_free_chunk_bytes);
+  bfc_allocator_fragmentation->GetCell(allocator_name)->Add(fragmentation);
+  for (size_t i = 0; i < bin_sizes.size(); ++i) {
+    const std::string bin = std::to_string(bin_sizes[i]);
+    bfc_allocator_bin_free_chunks->GetCell(allocator_name, bin)
+        ->Set(bin_free_chunks[i]);
+    bfc_allocator_bin_free_bytes->GetCell(allocator_name, bin)
+        ->Set(bin_free_bytes[i]);
+  }
+  if (num_allocs > 0) {
+    bfc_allocator_churn->GetCell(allocator_name, "allocate")
+        ->IncrementBy(num_allocs);
+  }
+  if (num_deallocs > 0) {
+    bfc_allocator_churn->GetCell(allocator_name, "deallocate")
+        ->IncrementBy(num_deallocs);
+  }
+}
+
 }  // namespace metrics
 }  // namespace tsl
@@ -17,6 +17,8 @@ limitations under the License.
 #define TENSORFLOW_TSL_FRAMEWORK_METRICS_H_
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 namespace tsl {
 namespace metrics {
@@ -24,6 +26,18 @@ namespace metrics {
 // Updates the metrics stored about time BFC allocator spents during delay.
 void UpdateBfcAllocatorDelayTime(const uint64_t delay_usecs);
 
+// Publishes a snapshot of the free memory of the BFC allocator named
+// `allocator_name`: its largest free chunk, its fragmentation (in [0, 1]), and
+// the number and total size of the free chunks in each bin, keyed by the
+// smallest chunk size of the bin.  `num_allocs` and `num_deallocs` are the
+// allocations and deallocations made since the previous snapshot.
+void UpdateBfcAllocatorFragmentation(
+    const std::string& allocator_name, int64_t largest_free_chunk_bytes,
+    double fragmentation, const std::vector<int64_t>& bin_sizes,
+    const std::vector<int64_t>& bin_free_chunks,
+    const std::vector<int64_t>& bin_free_bytes, int64_t num_allocs,
+    int64_t num_deallocs);
+
 }  // namespace metrics
 }  // namespace tsl
 
@@ -0,0 +1,426 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/slab_cpu_allocator.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>  // NOLINT
+
+#include "tensorflow/tsl/framework/allocator_registry.h"
+#include "tensorflow/tsl/platform/cpu_info.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/platform/mem.h"
+#include "tensorflow/tsl/util/env_var.h"
+
+namespace tsl {
+
+const char kSlabCPUAllocatorEnvVar[] = "TF_CPU_ALLOCATOR_USE_SLAB";
+
+namespace {
+
+// Block sizes of the size classes: multiples of 64 bytes up to 512, then four
+// classes per power of two up to SlabCPUAllocator::kMaxSlabAllocationSize.
+// Every size is a multiple of Allocator::kAllocatorAlignment, so every block
+// carved from an aligned slab is aligned too.
+constexpr size_t kClassSizes[] = {
+    64,   128,  192,  256,  320,  384,  448,  512,  640,  768,
+    896,  1024, 1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
+};
+
+// Number of bytes moved between a CPU cache and the central list at once.
+constexpr size_t kBatchBytes = 16 << 10;
+
+// The slab map covers 48-bit addresses.
+constexpr int kSlabShift = 16;
+constexpr int kSlabMapLevelBits = 16;
+constexpr uint64 kSlabMapLevelSize = uint64{1} << kSlabMapLevelBits;
+static_assert(size_t{1} << kSlabShift == SlabCPUAllocator::kSlabSize,
+              "kSlabShift must match kSlabSize");
+
+// Slabs carved from each chunk of NUMA-local memory.  A chunk has room for one
+// more, so that kNumaChunkSlabs aligned slabs fit at any page alignment.
+constexpr size_t kNumaChunkSlabs = 32;
+constexpr size_t kNumaChunkBytes =
+    (kNumaChunkSlabs + 1) * SlabCPUAllocator::kSlabSize;
+
+// Precedes each large allocation made on a NUMA node, since port::NUMAFree
+// needs the size that DeallocateRaw is not given.
+struct NumaHeader {
+  size_t offset;       // From the start of the allocation to the user data.
+  size_t total_bytes;  // Passed to port::NUMAMalloc.
+};
+
+void* Next(void* block) { return *reinterpret_cast<void**>(block); }
+void SetNext(void* block, void* next) {
+  *reinterpret_cast<void**>(block) = next;
+}
+
+}  // namespace
+
+SlabCPUAllocator::SlabCPUAllocator(int numa_node)
+    : numa_node_(numa_node),
+      num_cpu_caches_(std::max(port::NumTotalCPUs(), 1)),
+      cpu_caches_(new CpuCache[num_cpu_caches_]),
+      slab_map_(new std::atomic<uint8*>[kSlabMapLevelSize]()) {
+  static_assert(sizeof(kClassSizes) / sizeof(kClassSizes[0]) ==
+                    kNumSizeClasses,
+                "kNumSizeClasses must match kClassSizes");
+}
+
+SlabCPUAllocator::~SlabCPUAllocator() {
+  for (uint64 i = 0; i < kSlabMapLevelSize; ++i) {
+    delete[] slab_map_[i].load(std::memory_order_relaxed);
+  }
+  mutex_lock l(slabs_mu_);
+  for (void* slab : slabs_) {
+    port::AlignedFree(slab);
+  }
+  for (void* chunk : numa_chunks_) {
+    port::NUMAFree(chunk, kNumaChunkBytes);
+  }
+}
+
+// static
+int SlabCPUAllocator::SizeClass(size_t num_bytes) {
+  // Number of 64-byte units, in [0, 64].
+  const size_t units = (num_bytes + 63) >> 6;
+  if (units <= 8) return units == 0 ? 0 : static_cast<int>(units) - 1;
+  if (units <= 16) return 8 + static_cast<int>((units - 9) >> 1);
+  if (units <= 32) return 12 + static_cast<int>((units - 17) >> 2);
+  return 16 + static_cast<int>((units - 33) >> 3);
+}
+
+// static
+size_t SlabCPUAllocator::SlabBlockSize(size_t num_bytes) {
+  if (num_bytes > kMaxSlabAllocationSize) return 0;
+  return kClassSizes[SizeClass(num_bytes)];
+}
+
+// static
+int SlabCPUAllocator::BatchSize(int size_class) {
+  return std::max<int>(4, kBatchBytes / kClassSizes[size_class]);
+}
+
+int SlabCPUAllocator::SlabSizeClass(const void* ptr) const {
+  const uint64 slab = reinterpret_cast<uintptr_t>(ptr) >> kSlabShift;
+  const uint64 root = slab >> kSlabMapLevelBits;
+  if (root >= kSlabMapLevelSize) return -1;
+  const uint8* leaf = slab_map_[root].load(std::memory_order_acquire);
+  if (leaf == nullptr) return -1;
+  return static_cast<int>(leaf[slab & (kSlabMapLevelSize - 1)]) - 1;
+}
+
+SlabCPUAllocator::CpuCache* SlabCPUAllocator::CurrentCpuCache() {
+  int cpu = port::GetCurrentCPU();
+  if (cpu < 0) {
+    // Spread threads over the caches when the CPU cannot be identified.
+    static thread_local const size_t thread_hash =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+    cpu = static_cast<int>(thread_hash % num_cpu_caches_);
+  }
+  return &cpu_caches_[cpu % num_cpu_caches_];
+}
+
+char* SlabCPUAllocator::AllocateSlab() {
+  if (numa_node_ == port::kNUMANoAffinity) {
+    return static_cast<char*>(port::AlignedMalloc(kSlabSize, kSlabSize));
+  }
+  if (numa_carve_next_ == numa_carve_end_) {
+    char* chunk = static_cast<char*>(
+        port::NUMAMalloc(numa_node_, kNumaChunkBytes, kSlabSize));
+    if (chunk == nullptr) return nullptr;
+    numa_chunks_.push_back(chunk);
+    const uintptr_t start =
+        (reinterpret_cast<uintptr_t>(chunk) + kSlabSize - 1) & ~(kSlabSize - 1);
+    numa_carve_next_ = reinterpret_cast<char*>(start);
+    numa_carve_end_ = numa_carve_next_ + kNumaChunkSlabs * kSlabSize;
+  }
+  char* slab = numa_carve_next_;
+  numa_carve_next_ += kSlabSize;
+  return slab;
+}
+
+char* SlabCPUAllocator::NewSlab(int size_class) {
+  mutex_lock l(slabs_mu_);
+  char* slab = AllocateSlab();
+  if (slab == nullptr) return nullptr;
+  const uint64 index = reinterpret_cast<uintptr_t>(slab) >> kSlabShift;
+  const uint64 root = index >> kSlabMapLevelBits;
+  if (root >= kSlabMapLevelSize) {
+    // Outside the range covered by the slab map.  Memory carved from a NUMA
+    // chunk is released with the chunk.
+    if (numa_node_ == port::kNUMANoAffinity) port::AlignedFree(slab);
+    return nullptr;
+  }
+  uint8* leaf = slab_map_[root].load(std::memory_order_relaxed);
+  if (leaf == nullptr) {
+    leaf = new uint8[kSlabMapLevelSize]();
+    slab_map_[root].store(leaf, std::memory_order_release);
+  }
+  leaf[index & (kSlabMapLevelSize - 1)] = static_cast<uint8>(size_class + 1);
+  if (numa_node_ == port::kNUMANoAffinity) slabs_.push_back(slab);
+  bytes_reserved_.fetch_add(kSlabSize, std::memory_order_relaxed);
+  return slab;
+}
+
+bool SlabCPUAllocator::FetchBatch(int size_class, int n, FreeList* list) {
+  CentralList& central = central_[size_class];
+  const size_t block_size = kClassSizes[size_class];
+  mutex_lock l(central.mu);
+  while (n > 0 && central.free.head != nullptr) {
+    void* block = central.free.head;
+    central.free.head = Next(block);
+    --central.free.length;
+    SetNext(block, list->head);
+    list->head = block;
+    ++list->length;
+    --n;
+  }
+  while (n > 0) {
+    if (central.carve_next == central.carve_end) {
+      char* slab = NewSlab(size_class);
+      if (slab == nullptr) break;
+      central.carve_next = slab;
+      central.carve_end = slab + (kSlabSize / block_size) * block_size;
+    }
+    void* block = central.carve_next;
+    central.carve_next += block_size;
+    SetNext(block, list->head);
+    list->head = block;
+    ++list->length;
+    --n;
+  }
+  return list->head != nullptr;
+}
+
+void SlabCPUAllocator::ReleaseBatch(int size_class, int n, FreeList* list) {
+  DCHECK_LE(n, list->length);
+  void* first = list->head;
+  void* last = first;
+  for (int i = 1; i < n; ++i) last = Next(last);
+  list->head = Next(last);
+  list->length -= n;
+
+  CentralList& central = central_[size_class];
+  mutex_lock l(central.mu);
+  SetNext(last, central.free.head);
+  central.free.head = first;
+  central.free.length += n;
+}
+
+void* SlabCPUAllocator::AllocateFromSlab(int size_class) {
+  CpuCache* cache = CurrentCpuCache();
+  mutex_lock l(cache->mu);
+  FreeList& list = cache->lists[size_class];
+  if (list.head == nullptr &&
+      !FetchBatch(size_class, BatchSize(size_class), &list)) {
+    return nullptr;
+  }
+  void* block = list.head;
+  list.head = Next(block);
+  --list.length;
+  return block;
+}
+
+void SlabCPUAllocator::DeallocateToSlab(void* ptr, int size_class) {
+  CpuCache* cache = CurrentCpuCache();
+  mutex_lock l(cache->mu);
+  FreeList& list = cache->lists[size_class];
+  SetNext(ptr, list.head);
+  list.head = ptr;
+  ++list.length;
+  // Keep at most two batches per CPU, so that blocks freed on one CPU and
+  // allocated on another flow back through the central list.
+  const int batch_size = BatchSize(size_class);
+  if (list.length > 2 * batch_size) {
+    ReleaseBatch(size_class, batch_size, &list);
+  }
+}
+
+void* SlabCPUAllocator::AllocateLarge(size_t alignment, size_t num_bytes) {
+  if (numa_node_ == port::kNUMANoAffinity) {
+    return port::AlignedMalloc(num_bytes, alignment);
+  }
+  const size_t offset =
+      std::max<size_t>(alignment, Allocator::kAllocatorAlignment);
+  const size_t total_bytes = offset + num_bytes;
+  char* base = static_cast<char*>(port::NUMAMalloc(
+      numa_node_, total_bytes, static_cast<int>(offset)));
+  if (base == nullptr) return nullptr;
+  char* ptr = base + offset;
+  NumaHeader* header = reinterpret_cast<NumaHeader*>(ptr) - 1;
+  header->offset = offset;
+  header->total_bytes = total_bytes;
+  return ptr;
+}
+
+void SlabCPUAllocator::DeallocateLarge(void* ptr) {
+  if (numa_node_ == port::kNUMANoAffinity) {
+    port::AlignedFree(ptr);
+    return;
+  }
+  const NumaHeader* header = static_cast<const NumaHeader*>(ptr) - 1;
+  port::NUMAFree(static_cast<char*>(ptr) - header->offset,
+                 header->total_bytes);
+}
+
+size_t SlabCPUAllocator::LargeAllocatedSize(const void* ptr) const {
+  if (numa_node_ == port::kNUMANoAffinity) {
+    return port::MallocExtension_GetAllocatedSize(ptr);
+  }
+  const NumaHeader* header = static_cast<const NumaHeader*>(ptr) - 1;
+  return header->total_bytes - header->offset;
+}
+
+void SlabCPUAllocator::RecordAlloc(size_t alloc_size) {
+  num_allocs_.fetch_add(1, std::memory_order_relaxed);
+  const int64_t in_use =
+      bytes_in_use_.fetch_add(alloc_size, std::memory_order_relaxed) +
+      alloc_size;
+  int64_t peak = peak_bytes_in_use_.load(std::memory_order_relaxed);
+  while (in_use > peak && !peak_bytes_in_use_.compare_exchange_weak(
+                              peak, in_use, std::memory_order_relaxed)) {
+  }
+  int64_t largest = largest_alloc_size_.load(std::memory_order_relaxed);
+  while (static_cast<int64_t>(alloc_size) > largest &&
+         !largest_alloc_size_.compare_exchange_weak(
+             largest, alloc_size, std::memory_order_relaxed)) {
+  }
+}
+
+void SlabCPUAllocator::RecordDealloc(size_t alloc_size) {
+  bytes_in_use_.fetch_sub(alloc_size, std::memory_order_relaxed);
+}
+
+void* SlabCPUAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  void* p = nullptr;
+  size_t alloc_size = 0;
+  if (num_bytes <= kMaxSlabAllocationSize &&
+      alignment <= Allocator::kAllocatorAlignment) {
+    const int size_class = SizeClass(num_bytes);
+    p = AllocateFromSlab(size_class);
+    alloc_size = kClassSizes[size_class];
+  }
+  if (p == nullptr) {
+    p = AllocateLarge(alignment, num_bytes);
+    if (p != nullptr && CPUAllocatorStatsEnabled()) {
+      alloc_size = LargeAllocatedSize(p);
+    }
+  }
+  if (p != nullptr && CPUAllocatorStatsEnabled()) RecordAlloc(alloc_size);
+  return p;
+}
+
+void SlabCPUAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  const int size_class = SlabSizeClass(ptr);
+  if (size_class >= 0) {
+    if (CPUAllocatorStatsEnabled()) RecordDealloc(kClassSizes[size_class]);
+    DeallocateToSlab(ptr, size_class);
+    return;
+  }
+  if (CPUAllocatorStatsEnabled()) RecordDealloc(LargeAllocatedSize(ptr));
+  DeallocateLarge(ptr);
+}
+
+absl::optional<AllocatorStats> SlabCPUAllocator::GetStats() {
+  if (!CPUAllocatorStatsEnabled()) return absl::nullopt;
+  AllocatorStats stats;
+  stats.num_allocs = num_allocs_.load(std::memory_order_relaxed);
+  stats.bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+  stats.peak_bytes_in_use = peak_bytes_in_use_.load(std::memory_order_relaxed);
+  stats.largest_alloc_size =
+      largest_alloc_size_.load(std::memory_order_relaxed);
+  stats.bytes_reserved = bytes_reserved_.load(std::memory_order_relaxed);
+  stats.peak_bytes_reserved = stats.bytes_reserved;
+  return stats;
+}
+
+bool SlabCPUAllocator::ClearStats() {
+  if (!CPUAllocatorStatsEnabled()) return false;
+  num_allocs_.store(0, std::memory_order_relaxed);
+  peak_bytes_in_use_.store(bytes_in_use_.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+  largest_alloc_size_.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+size_t SlabCPUAllocator::AllocatedSizeSlow(const void* ptr) const {
+  const int size_class = SlabSizeClass(ptr);
+  if (size_class >= 0) return kClassSizes[size_class];
+  return LargeAllocatedSize(ptr);
+}
+
+namespace {
+
+class SlabCPUSubAllocator : public SubAllocator {
+ public:
+  explicit SlabCPUSubAllocator(SlabCPUAllocator* allocator)
+      : SubAllocator({}, {}), allocator_(allocator) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    *bytes_received = num_bytes;
+    return allocator_->AllocateRaw(alignment, num_bytes);
+  }
+
+  void Free(void* ptr, size_t num_bytes) override {
+    allocator_->DeallocateRaw(ptr);
+  }
+
+  bool SupportsCoalescing() const override { return false; }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return allocator_->GetMemoryType();
+  }
+
+ private:
+  std::unique_ptr<SlabCPUAllocator> allocator_;
+};
+
+REGISTER_MEM_ALLOCATOR("SlabCPUAllocator", SlabCPUAllocatorPriority(),
+                       SlabCPUAllocatorFactory);
+
+}  // namespace
+
+SlabCPUAllocatorFactory::SlabCPUAllocatorFactory()
+    : enabled_(SlabCPUAllocatorEnabled()) {}
+
+Allocator* SlabCPUAllocatorFactory::CreateAllocator() {
+  return new SlabCPUAllocator;
+}
+
+SubAllocator* SlabCPUAllocatorFactory::CreateSubAllocator(int numa_node) {
+  return new SlabCPUSubAllocator(new SlabCPUAllocator(numa_node));
+}
+
+bool SlabCPUAllocatorEnabled() {
+  bool use_slab = false;
+  Status status = ReadBoolFromEnvVar(kSlabCPUAllocatorEnvVar,
+                                     /*default_val=*/false, &use_slab);
+  if (!status.ok()) {
+    LOG(ERROR) << "SlabCPUAllocator: " << status.error_message();
+  }
+  return use_slab;
+}
+
+int SlabCPUAllocatorPriority() {
+  // The default CPU allocator is registered at 100, and the oneDNN one at 200
+  // in builds with oneDNN enabled.
+  return SlabCPUAllocatorEnabled() ? 300 : 50;
+}
+
+}  // namespace tsl
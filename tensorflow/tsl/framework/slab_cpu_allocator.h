@@ -0,0 +1,200 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_FRAMEWORK_SLAB_CPU_ALLOCATOR_H_
+#define TENSORFLOW_TSL_FRAMEWORK_SLAB_CPU_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/tsl/framework/allocator.h"
+#include "tensorflow/tsl/framework/allocator_registry.h"
+#include "tensorflow/tsl/platform/macros.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/numa.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+
+// Name of the environment variable that, when set to true, makes the
+// SlabCPUAllocator the default CPU allocator (i.e. the one returned by
+// AllocatorFactoryRegistry::GetAllocator()).  Defaults to false.
+extern const char kSlabCPUAllocatorEnvVar[];
+
+// Returns true if kSlabCPUAllocatorEnvVar is set to true.
+bool SlabCPUAllocatorEnabled();
+
+// Returns the priority the SlabCPUAllocator factory is registered with: above
+// every other CPU allocator, including the oneDNN one, if
+// kSlabCPUAllocatorEnvVar is set, and below the default CPU allocator
+// otherwise.
+int SlabCPUAllocatorPriority();
+
+// A CPU allocator that serves small requests from size-class slabs instead of
+// going to port::AlignedMalloc for every allocation.
+//
+// Requests of at most kMaxSlabAllocationSize bytes, with an alignment of at
+// most Allocator::kAllocatorAlignment, are rounded up to one of a few size
+// classes.  Free blocks of each class are kept in per-CPU caches, indexed by
+// the CPU the calling thread runs on, so that threads on different cores do
+// not contend on shared state.  A block may be freed from any thread; it goes
+// to the cache of the CPU that frees it.  Caches exchange blocks in batches
+// with a central free list per size class, which carves new blocks out of
+// kSlabSize-byte slabs obtained from port::AlignedMalloc.  Slab memory is kept
+// for reuse until the allocator is destroyed.
+//
+// Larger or more strictly aligned requests go straight to
+// port::AlignedMalloc, as with the default CPU allocator.
+//
+// An allocator constructed for a NUMA node takes its slabs and its larger
+// allocations from port::NUMAMalloc on that node instead.
+//
+// As with the default CPU allocator, GetStats() only returns statistics while
+// EnableCPUAllocatorStats() is in effect, since keeping them exact requires
+// shared counters.
+class SlabCPUAllocator : public Allocator {
+ public:
+  static constexpr size_t kMaxSlabAllocationSize = 4096;
+  static constexpr size_t kSlabSize = 64 << 10;
+
+  explicit SlabCPUAllocator(int numa_node = port::kNUMANoAffinity);
+  ~SlabCPUAllocator() override;
+
+  int numa_node() const { return numa_node_; }
+
+  string Name() override { return "slab_cpu"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  absl::optional<AllocatorStats> GetStats() override;
+  bool ClearStats() override;
+
+  size_t AllocatedSizeSlow(const void* ptr) const override;
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+
+  // Returns the size of the block that serves a request of `num_bytes`, or 0
+  // if such requests are not served from slabs.  Exposed for tests.
+  static size_t SlabBlockSize(size_t num_bytes);
+
+ private:
+  static constexpr int kNumSizeClasses = 20;
+
+  // A singly linked list threaded through the first word of free blocks.
+  struct FreeList {
+    void* head = nullptr;
+    int64_t length = 0;
+  };
+
+  // The blocks cached for one CPU.  Padded so that caches of different CPUs
+  // do not share a cache line.
+  struct alignas(64) CpuCache {
+    mutex mu;
+    FreeList lists[kNumSizeClasses] TF_GUARDED_BY(mu);
+  };
+
+  // Blocks of one size class that are not cached by any CPU, and the tail of
+  // the slab new blocks are carved from.
+  struct alignas(64) CentralList {
+    mutex mu;
+    FreeList free TF_GUARDED_BY(mu);
+    char* carve_next TF_GUARDED_BY(mu) = nullptr;
+    char* carve_end TF_GUARDED_BY(mu) = nullptr;
+  };
+
+  static int SizeClass(size_t num_bytes);
+  static int BatchSize(int size_class);
+
+  // Returns the size class of the slab containing `ptr`, or -1 if `ptr` was
+  // not allocated from a slab.
+  int SlabSizeClass(const void* ptr) const;
+
+  CpuCache* CurrentCpuCache();
+  void* AllocateFromSlab(int size_class);
+  void DeallocateToSlab(void* ptr, int size_class);
+
+  // Moves up to `n` blocks of `size_class` from the central list into `list`.
+  // Returns false if no block could be provided.
+  bool FetchBatch(int size_class, int n, FreeList* list);
+  // Moves `n` blocks from the front of `list` to the central list.
+  void ReleaseBatch(int size_class, int n, FreeList* list);
+  // Allocates a new slab for `size_class` and registers it in the slab map.
+  char* NewSlab(int size_class);
+  // Returns a new slab of kSlabSize bytes, aligned to kSlabSize.
+  char* AllocateSlab() TF_EXCLUSIVE_LOCKS_REQUIRED(slabs_mu_);
+
+  // Allocate and free memory not served from slabs, on `numa_node_` if set.
+  void* AllocateLarge(size_t alignment, size_t num_bytes);
+  void DeallocateLarge(void* ptr);
+  size_t LargeAllocatedSize(const void* ptr) const;
+
+  void RecordAlloc(size_t alloc_size);
+  void RecordDealloc(size_t alloc_size);
+
+  const int numa_node_;
+  const int num_cpu_caches_;
+  std::unique_ptr<CpuCache[]> cpu_caches_;
+  CentralList central_[kNumSizeClasses];
+
+  // Maps a slab number (address / kSlabSize) to 1 + the size class of the
+  // slab, or 0 for memory not owned by a slab.  A two-level table indexed by
+  // the high and low halves of the slab number, whose leaves are allocated
+  // when the first slab in their range is.
+  std::unique_ptr<std::atomic<uint8*>[]> slab_map_;
+
+  mutex slabs_mu_;
+  std::vector<void*> slabs_ TF_GUARDED_BY(slabs_mu_);
+  // On a NUMA node, slabs are carved out of larger chunks, since
+  // port::NUMAMalloc may only align to pages.
+  std::vector<void*> numa_chunks_ TF_GUARDED_BY(slabs_mu_);
+  char* numa_carve_next_ TF_GUARDED_BY(slabs_mu_) = nullptr;
+  char* numa_carve_end_ TF_GUARDED_BY(slabs_mu_) = nullptr;
+  std::atomic<int64_t> bytes_reserved_{0};
+
+  // Only updated while CPUAllocatorStatsEnabled().
+  std::atomic<int64_t> num_allocs_{0};
+  std::atomic<int64_t> bytes_in_use_{0};
+  std::atomic<int64_t> peak_bytes_in_use_{0};
+  std::atomic<int64_t> largest_alloc_size_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SlabCPUAllocator);
+};
+
+// Creates SlabCPUAllocators, for AllocatorFactoryRegistry. The registry picks
+// NUMA-enabled factories for sub-allocators regardless of their priority, so
+// the factory only claims to be NUMA-enabled if kSlabCPUAllocatorEnvVar was
+// set when it was created.
+class SlabCPUAllocatorFactory : public AllocatorFactory {
+ public:
+  SlabCPUAllocatorFactory();
+
+  bool NumaEnabled() override { return enabled_; }
+
+  Allocator* CreateAllocator() override;
+
+  SubAllocator* CreateSubAllocator(int numa_node) override;
+
+ private:
+  const bool enabled_;
+};
+
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_FRAMEWORK_SLAB_CPU_ALLOCATOR_H_
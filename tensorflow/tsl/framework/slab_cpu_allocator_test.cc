@@ -0,0 +1,317 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/slab_cpu_allocator.h"
+
+#include <stdlib.h>
+
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include "tensorflow/tsl/framework/allocator_registry.h"
+#include "tensorflow/tsl/platform/blocking_counter.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/numa.h"
+#include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/platform/test_benchmark.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+
+namespace tsl {
+namespace {
+
+TEST(SlabCPUAllocatorTest, SizeClasses) {
+  EXPECT_EQ(64, SlabCPUAllocator::SlabBlockSize(0));
+  EXPECT_EQ(64, SlabCPUAllocator::SlabBlockSize(1));
+  EXPECT_EQ(64, SlabCPUAllocator::SlabBlockSize(64));
+  EXPECT_EQ(128, SlabCPUAllocator::SlabBlockSize(65));
+  EXPECT_EQ(640, SlabCPUAllocator::SlabBlockSize(513));
+  EXPECT_EQ(4096, SlabCPUAllocator::SlabBlockSize(4096));
+  EXPECT_EQ(0, SlabCPUAllocator::SlabBlockSize(4097));
+  size_t previous = 0;
+  for (size_t n = 1; n <= SlabCPUAllocator::kMaxSlabAllocationSize; ++n) {
+    const size_t block_size = SlabCPUAllocator::SlabBlockSize(n);
+    EXPECT_GE(block_size, n);
+    EXPECT_GE(block_size, previous);
+    EXPECT_EQ(0, block_size % Allocator::kAllocatorAlignment) << n;
+    // At most 25% internal fragmentation above 512 bytes.
+    if (n > 512) EXPECT_LE(block_size, n + n / 4) << n;
+    previous = block_size;
+  }
+}
+
+TEST(SlabCPUAllocatorTest, AllocateAndFree) {
+  SlabCPUAllocator a;
+  std::set<void*> live;
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 10000; ++i) {
+    const size_t size =
+        1 + (i * 37) % SlabCPUAllocator::kMaxSlabAllocationSize;
+    void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, size);
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) %
+                     Allocator::kAllocatorAlignment);
+    EXPECT_TRUE(live.insert(p).second) << "pointer handed out twice";
+    EXPECT_EQ(SlabCPUAllocator::SlabBlockSize(size), a.AllocatedSizeSlow(p));
+    memset(p, i & 0xff, size);
+    ptrs.push_back(p);
+  }
+  for (void* p : ptrs) a.DeallocateRaw(p);
+}
+
+TEST(SlabCPUAllocatorTest, LargeAndOveralignedAllocations) {
+  SlabCPUAllocator a;
+  void* large = a.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20);
+  ASSERT_NE(nullptr, large);
+  memset(large, 0, 1 << 20);
+
+  void* aligned = a.AllocateRaw(4096, 100);
+  ASSERT_NE(nullptr, aligned);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(aligned) % 4096);
+
+  a.DeallocateRaw(large);
+  a.DeallocateRaw(aligned);
+  a.DeallocateRaw(nullptr);
+}
+
+TEST(SlabCPUAllocatorTest, NumaNode) {
+  SlabCPUAllocator a(/*numa_node=*/0);
+  EXPECT_EQ(0, a.numa_node());
+  std::vector<void*> ptrs;
+  // Enough blocks to carve slabs from more than one chunk.
+  for (int i = 0; i < 2048; ++i) {
+    void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, 4096);
+    ASSERT_NE(nullptr, p);
+    memset(p, i & 0xff, 4096);
+    EXPECT_EQ(4096, a.AllocatedSizeSlow(p));
+    ptrs.push_back(p);
+  }
+  void* large = a.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20);
+  ASSERT_NE(nullptr, large);
+  memset(large, 0, 1 << 20);
+  EXPECT_EQ(1 << 20, a.AllocatedSizeSlow(large));
+  void* aligned = a.AllocateRaw(4096, 100);
+  ASSERT_NE(nullptr, aligned);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(aligned) % 4096);
+  if (port::NUMAEnabled()) {
+    EXPECT_EQ(0, port::NUMAGetMemAffinity(ptrs[0]));
+    EXPECT_EQ(0, port::NUMAGetMemAffinity(large));
+  }
+  for (void* p : ptrs) a.DeallocateRaw(p);
+  a.DeallocateRaw(large);
+  a.DeallocateRaw(aligned);
+}
+
+TEST(SlabCPUAllocatorTest, PriorityWhenEnabled) {
+  // Opting in must win over the oneDNN allocator, registered at 200.
+  setenv(kSlabCPUAllocatorEnvVar, "true", /*overwrite=*/1);
+  EXPECT_GT(SlabCPUAllocatorPriority(), 200);
+  setenv(kSlabCPUAllocatorEnvVar, "false", /*overwrite=*/1);
+  EXPECT_LT(SlabCPUAllocatorPriority(), 100);
+  unsetenv(kSlabCPUAllocatorEnvVar);
+}
+
+// Stands in for the default CPU allocator factory, registered at 100.
+class DefaultCPUAllocatorFactory : public AllocatorFactory {
+ public:
+  class DefaultCPUSubAllocator : public SubAllocator {
+   public:
+    DefaultCPUSubAllocator() : SubAllocator({}, {}) {}
+    void* Alloc(size_t alignment, size_t num_bytes,
+                size_t* bytes_received) override {
+      return nullptr;
+    }
+    void Free(void* ptr, size_t num_bytes) override {}
+    bool SupportsCoalescing() const override { return false; }
+  };
+
+  Allocator* CreateAllocator() override { return new SlabCPUAllocator; }
+  SubAllocator* CreateSubAllocator(int numa_node) override {
+    return new DefaultCPUSubAllocator;
+  }
+};
+
+// Registers the default and the slab factories in a new registry, and returns
+// whether its sub-allocators come from the slab factory.
+bool SlabSubAllocatorSelected() {
+  AllocatorFactoryRegistry registry;
+  registry.Register(__FILE__, __LINE__, "DefaultCPUAllocator", 100,
+                    new DefaultCPUAllocatorFactory);
+  registry.Register(__FILE__, __LINE__, "SlabCPUAllocator",
+                    SlabCPUAllocatorPriority(), new SlabCPUAllocatorFactory);
+  return dynamic_cast<DefaultCPUAllocatorFactory::DefaultCPUSubAllocator*>(
+             registry.GetSubAllocator(port::kNUMANoAffinity)) == nullptr;
+}
+
+TEST(SlabCPUAllocatorTest, DefaultAllocatorsUnchangedWhenDisabled) {
+  unsetenv(kSlabCPUAllocatorEnvVar);
+  EXPECT_FALSE(SlabCPUAllocatorFactory().NumaEnabled());
+  EXPECT_FALSE(SlabSubAllocatorSelected());
+  // The registry of the process was set up without the variable either.
+  EXPECT_EQ("cpu",
+            AllocatorFactoryRegistry::singleton()->GetAllocator()->Name());
+
+  setenv(kSlabCPUAllocatorEnvVar, "true", /*overwrite=*/1);
+  EXPECT_TRUE(SlabCPUAllocatorFactory().NumaEnabled());
+  EXPECT_TRUE(SlabSubAllocatorSelected());
+  unsetenv(kSlabCPUAllocatorEnvVar);
+}
+
+TEST(SlabCPUAllocatorTest, CrossThreadFrees) {
+  // Blocks allocated on one set of threads are freed on another, then
+  // allocated again.
+  constexpr int kNumThreads = 8;
+  constexpr int kPerThread = 5000;
+  SlabCPUAllocator a;
+  thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+  for (int round = 0; round < 3; ++round) {
+    std::vector<std::vector<void*>> allocated(kNumThreads);
+    {
+      BlockingCounter done(kNumThreads);
+      for (int t = 0; t < kNumThreads; ++t) {
+        pool.Schedule([&a, &allocated, &done, t]() {
+          for (int i = 0; i < kPerThread; ++i) {
+            const size_t size = 16 + (i % 64) * 32;
+            void* p = a.AllocateRaw(Allocator::kAllocatorAlignment, size);
+            CHECK(p != nullptr);
+            *static_cast<int*>(p) = t;
+            allocated[t].push_back(p);
+          }
+          done.DecrementCount();
+        });
+      }
+      done.Wait();
+    }
+    std::set<void*> unique;
+    for (int t = 0; t < kNumThreads; ++t) {
+      for (void* p : allocated[t]) {
+        EXPECT_EQ(t, *static_cast<int*>(p));
+        EXPECT_TRUE(unique.insert(p).second);
+      }
+    }
+    BlockingCounter done(kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&a, &allocated, &done, t]() {
+        for (void* p : allocated[(t + 1) % kNumThreads]) a.DeallocateRaw(p);
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+  }
+}
+
+TEST(SlabCPUAllocatorTest, Stats) {
+  SlabCPUAllocator a;
+  EXPECT_FALSE(a.GetStats());
+
+  EnableCPUAllocatorStats();
+  void* p1 = a.AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  void* p2 = a.AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  absl::optional<AllocatorStats> stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(2, stats->num_allocs);
+  EXPECT_EQ(128 + 1024, stats->bytes_in_use);
+  EXPECT_EQ(128 + 1024, stats->peak_bytes_in_use);
+  EXPECT_EQ(1024, stats->largest_alloc_size);
+  EXPECT_EQ(2 * SlabCPUAllocator::kSlabSize, stats->bytes_reserved);
+
+  a.DeallocateRaw(p2);
+  stats = a.GetStats();
+  EXPECT_EQ(128, stats->bytes_in_use);
+  EXPECT_EQ(128 + 1024, stats->peak_bytes_in_use);
+
+  EXPECT_TRUE(a.ClearStats());
+  stats = a.GetStats();
+  EXPECT_EQ(0, stats->num_allocs);
+  EXPECT_EQ(128, stats->peak_bytes_in_use);
+  EXPECT_EQ(0, stats->largest_alloc_size);
+
+  a.DeallocateRaw(p1);
+  EXPECT_EQ(0, a.GetStats()->bytes_in_use);
+  DisableCPUAllocatorStats();
+}
+
+// Simulates kernels that allocate and release many small temporaries and
+// outputs on `num_threads` threads.  Every thread keeps a window of live
+// buffers and hands a quarter of its buffers to the next thread to free, as
+// happens when a tensor produced by one kernel dies on another thread.
+static void BM_SmallAllocations(::testing::benchmark::State& state) {
+  const bool use_slab = state.range(0);
+  const int num_threads = state.range(1);
+  constexpr int kOpsPerThread = 4096;
+  constexpr int kWindow = 16;
+
+  SlabCPUAllocator slab_allocator;
+  Allocator* a = use_slab ? &slab_allocator : cpu_allocator_base();
+  thread::ThreadPool pool(Env::Default(), "bench", num_threads);
+  std::vector<mutex> handoff_mu(num_threads);
+  std::vector<std::vector<void*>> handoff(num_threads);
+
+  auto work = [&](int t) {
+    void* window[kWindow] = {};
+    std::vector<void*> to_free;
+    for (int i = 0; i < kOpsPerThread; ++i) {
+      const size_t size = 32 << (i % 8);  // 32 bytes to 4 KB.
+      void*& slot = window[i % kWindow];
+      if (slot != nullptr) {
+        if (i % 4 == 0) {
+          mutex_lock l(handoff_mu[(t + 1) % num_threads]);
+          handoff[(t + 1) % num_threads].push_back(slot);
+        } else {
+          a->DeallocateRaw(slot);
+        }
+      }
+      slot = a->AllocateRaw(Allocator::kAllocatorAlignment, size);
+      *static_cast<char*>(slot) = static_cast<char>(i);
+      if (i % 256 == 0) {
+        {
+          mutex_lock l(handoff_mu[t]);
+          to_free.swap(handoff[t]);
+        }
+        for (void* p : to_free) a->DeallocateRaw(p);
+        to_free.clear();
+      }
+    }
+    for (void* p : window) a->DeallocateRaw(p);
+  };
+
+  for (auto s : state) {
+    BlockingCounter done(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&work, &done, t]() {
+        work(t);
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+    for (int t = 0; t < num_threads; ++t) {
+      for (void* p : handoff[t]) a->DeallocateRaw(p);
+      handoff[t].clear();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads * kOpsPerThread);
+  state.SetLabel(use_slab ? "slab" : "default");
+}
+BENCHMARK(BM_SmallAllocations)
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 1)
+    ->ArgPair(0, 8)
+    ->ArgPair(1, 8)
+    ->ArgPair(0, 32)
+    ->ArgPair(1, 32);
+
+}  // namespace
+}  // namespace tsl
@@ -51,7 +51,7 @@ class BufferedWritableFile : public WritableFile {
       crc32_ = crc32c::Extend(crc32_, &buffer_[buffer_pos_], append_bytes);
       buffer_pos_ += append_bytes;
       if (buffer_pos_ == buffer_.size()) {
-        TF_RETURN_IF_ERROR(file_->Append(buffer_));
+        TF_RETURN_IF_ERROR(AppendFullBuffer(&buffer_));
         buffer_pos_ = 0;
       }
       data = data + append_bytes;
@@ -87,6 +87,15 @@ class BufferedWritableFile : public WritableFile {
   uint32_t crc32() const { return crc32_; }
   void reset_crc32() { crc32_ = 0; }
 
+ protected:
+  // Writes out `buffer` once it has filled up. Overrides may take its contents
+  // by swapping in another string, which must be of the same size on return.
+  virtual Status AppendFullBuffer(std::string* buffer) {
+    return file_->Append(*buffer);
+  }
+
+  WritableFile* file() const { return file_.get(); }
+
  private:
   static constexpr int64_t kDefaultBufferSize = 1048576;
 
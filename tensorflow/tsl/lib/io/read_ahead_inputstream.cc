@@ -0,0 +1,202 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/lib/io/read_ahead_inputstream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/logging.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+// Reads mostly wait on the file system rather than use the CPU, so the shared
+// pool is not sized by the number of cores.
+constexpr int kNumDefaultThreads = 16;
+
+thread::ThreadPool* DefaultThreadPool() {
+  static thread::ThreadPool* pool =
+      new thread::ThreadPool(Env::Default(), "read_ahead", kNumDefaultThreads);
+  return pool;
+}
+
+}  // namespace
+
+ReadAheadInputStream::ReadAheadInputStream(RandomAccessFile* file,
+                                           int64_t block_size, int num_blocks,
+                                           thread::ThreadPool* thread_pool)
+    : file_(file),
+      block_size_(block_size),
+      num_blocks_(num_blocks),
+      thread_pool_(thread_pool != nullptr ? thread_pool
+                                          : DefaultThreadPool()) {
+  DCHECK_GT(block_size_, 0);
+  DCHECK_GT(num_blocks_, 0);
+}
+
+ReadAheadInputStream::~ReadAheadInputStream() {
+  mutex_lock l(mu_);
+  blocks_.clear();
+  while (num_in_flight_ > 0) {
+    cond_var_.wait(l);
+  }
+}
+
+void ReadAheadInputStream::FillQueue() {
+  while (!end_of_file_ && blocks_.size() < static_cast<size_t>(num_blocks_)) {
+    if (!blocks_.empty() && blocks_.back()->done &&
+        static_cast<int64_t>(blocks_.back()->data.size()) < block_size_) {
+      // The last block read ends the file.
+      return;
+    }
+    auto block = std::make_shared<Block>();
+    block->offset = next_block_offset_;
+    next_block_offset_ += block_size_;
+    blocks_.push_back(block);
+    ++num_in_flight_;
+    thread_pool_->Schedule([this, block]() {
+      tstring data;
+      data.resize_uninitialized(block_size_);
+      StringPiece result;
+      Status s = file_->Read(block->offset, block_size_, &result, &data[0]);
+      if (result.data() != data.data()) {
+        memmove(&data[0], result.data(), result.size());
+      }
+      data.resize(result.size());
+      // A short block marks the end of the file.
+      if (errors::IsOutOfRange(s)) s = OkStatus();
+      mutex_lock l(mu_);
+      block->data = std::move(data);
+      block->status = s;
+      block->done = true;
+      --num_in_flight_;
+      cond_var_.notify_all();
+    });
+  }
+}
+
+Status ReadAheadInputStream::WaitForFront(mutex_lock& l,
+                                          std::shared_ptr<Block>* block) {
+  if (blocks_.empty()) {
+    FillQueue();
+  }
+  *block = blocks_.front();
+  while (!(*block)->done) {
+    cond_var_.wait(l);
+  }
+  return (*block)->status;
+}
+
+void ReadAheadInputStream::Advance(int64_t n) {
+  pos_ += n;
+  const std::shared_ptr<Block>& front = blocks_.front();
+  if (pos_ == front->offset + block_size_) {
+    blocks_.pop_front();
+    FillQueue();
+  }
+}
+
+void ReadAheadInputStream::Discard(int64_t position) {
+  blocks_.clear();
+  pos_ = position;
+  next_block_offset_ = position;
+  end_of_file_ = false;
+}
+
+Status ReadAheadInputStream::ReadNBytes(int64_t bytes_to_read,
+                                        tstring* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  mutex_lock l(mu_);
+  result->clear();
+  result->resize_uninitialized(bytes_to_read);
+  int64_t bytes_read = 0;
+  Status s;
+  while (bytes_read < bytes_to_read) {
+    std::shared_ptr<Block> block;
+    s = WaitForFront(l, &block);
+    if (!s.ok()) break;
+    const int64_t start = pos_ - block->offset;
+    const int64_t n = std::min<int64_t>(block->data.size() - start,
+                                        bytes_to_read - bytes_read);
+    if (n == 0) {
+      end_of_file_ = true;
+      s = errors::OutOfRange("reached end of file");
+      break;
+    }
+    memcpy(&(*result)[bytes_read], block->data.data() + start, n);
+    bytes_read += n;
+    Advance(n);
+  }
+  result->resize(bytes_read);
+  return s;
+}
+
+Status ReadAheadInputStream::SkipNBytes(int64_t bytes_to_skip) {
+  if (bytes_to_skip < 0) {
+    return errors::InvalidArgument("Can't skip a negative number of bytes: ",
+                                   bytes_to_skip);
+  }
+  mutex_lock l(mu_);
+  const int64_t target = pos_ + bytes_to_skip;
+  if (!end_of_file_ && target > next_block_offset_) {
+    // Past the blocks issued so far, probe the last skipped byte instead of
+    // reading the whole range. If it exists, read-ahead restarts at `target`.
+    char scratch;
+    StringPiece data;
+    Status s = file_->Read(target - 1, 1, &data, &scratch);
+    if (!s.ok() && !errors::IsOutOfRange(s)) return s;
+    if (data.size() == 1) {
+      Discard(target);
+      return OkStatus();
+    }
+    // Otherwise the file ends before `target`, which the loop below finds.
+  }
+  while (pos_ < target) {
+    std::shared_ptr<Block> block;
+    TF_RETURN_IF_ERROR(WaitForFront(l, &block));
+    const int64_t start = pos_ - block->offset;
+    const int64_t n =
+        std::min<int64_t>(block->data.size() - start, target - pos_);
+    if (n == 0) {
+      end_of_file_ = true;
+      return errors::OutOfRange("reached end of file");
+    }
+    Advance(n);
+  }
+  return OkStatus();
+}
+
+int64_t ReadAheadInputStream::Tell() const {
+  mutex_lock l(mu_);
+  return pos_;
+}
+
+Status ReadAheadInputStream::Reset() {
+  mutex_lock l(mu_);
+  Discard(0);
+  return OkStatus();
+}
+
+}  // namespace io
+}  // namespace tsl
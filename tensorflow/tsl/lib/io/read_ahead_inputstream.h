@@ -0,0 +1,108 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_READ_AHEAD_INPUTSTREAM_H_
+#define TENSORFLOW_TSL_LIB_IO_READ_AHEAD_INPUTSTREAM_H_
+
+#include <deque>
+#include <memory>
+
+#include "tensorflow/tsl/lib/io/inputstream_interface.h"
+#include "tensorflow/tsl/platform/file_system.h"
+#include "tensorflow/tsl/platform/macros.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+
+namespace tsl {
+namespace io {
+
+// Reads a file sequentially in large blocks, keeping up to `num_blocks` reads
+// in flight on a thread pool ahead of the current position. Small reads, e.g.
+// of the records of a TFRecord file, are served from the completed blocks,
+// so that consuming the data overlaps with reading the rest of the file.
+//
+// Reads and skips are expected to move forward; seeking backwards with
+// Reset() discards the blocks read so far. A single instance of
+// ReadAheadInputStream is NOT safe for concurrent use by multiple threads.
+class ReadAheadInputStream : public InputStreamInterface {
+ public:
+  // Does not take ownership of `file` or `thread_pool`, which must outlive
+  // *this. If `thread_pool` is nullptr, reads are issued on a thread pool
+  // shared by the process.
+  ReadAheadInputStream(RandomAccessFile* file, int64_t block_size,
+                       int num_blocks,
+                       thread::ThreadPool* thread_pool = nullptr);
+
+  // Waits for the reads in flight to complete.
+  ~ReadAheadInputStream() override;
+
+  Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
+
+  Status SkipNBytes(int64_t bytes_to_skip) override;
+
+  int64_t Tell() const override;
+
+  Status Reset() override;
+
+ private:
+  // A range of the file, read in the background.
+  struct Block {
+    int64_t offset = 0;
+    tstring data;
+    Status status;
+    bool done = false;
+  };
+
+  // Issues reads until `num_blocks_` blocks are buffered or in flight.
+  void FillQueue() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Waits for the block at the front of the queue, issuing it if needed.
+  // Returns the error of the read if it failed.
+  Status WaitForFront(mutex_lock& l, std::shared_ptr<Block>* block)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Consumes `n` bytes of the front block, which must hold them.
+  void Advance(int64_t n) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Drops the buffered blocks and moves to `position`; the reads in flight
+  // complete in the background.
+  void Discard(int64_t position) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  RandomAccessFile* const file_;  // not owned.
+  const int64_t block_size_;
+  const int num_blocks_;
+  thread::ThreadPool* const thread_pool_;  // not owned.
+
+  mutable mutex mu_;
+  condition_variable cond_var_;
+  // Current position in the file.
+  int64_t pos_ TF_GUARDED_BY(mu_) = 0;
+  // Offset of the next block to read.
+  int64_t next_block_offset_ TF_GUARDED_BY(mu_) = 0;
+  // Set when the last block of the file was consumed.
+  bool end_of_file_ TF_GUARDED_BY(mu_) = false;
+  // Consecutive blocks, the first of which contains `pos_`.
+  std::deque<std::shared_ptr<Block>> blocks_ TF_GUARDED_BY(mu_);
+  // Number of reads that have not completed, including discarded ones.
+  int64_t num_in_flight_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ReadAheadInputStream);
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_READ_AHEAD_INPUTSTREAM_H_
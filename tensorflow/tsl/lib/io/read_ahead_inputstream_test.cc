@@ -0,0 +1,134 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/lib/io/read_ahead_inputstream.h"
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/test.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+constexpr char kContents[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+// Runs each test on a local file and on the in-memory file system.
+class ReadAheadInputStreamTest : public ::testing::TestWithParam<std::string> {
+ protected:
+  void SetUp() override {
+    Env* env = Env::Default();
+    if (GetParam() == "local") {
+      ASSERT_TRUE(env->LocalTempFilename(&fname_));
+    } else {
+      fname_ = "ram://read_ahead_inputstream_test";
+    }
+    TF_ASSERT_OK(WriteStringToFile(env, fname_, kContents));
+    TF_ASSERT_OK(env->NewRandomAccessFile(fname_, &file_));
+  }
+
+  std::string fname_;
+  std::unique_ptr<RandomAccessFile> file_;
+};
+
+TEST_P(ReadAheadInputStreamTest, ReadNBytes) {
+  for (int block_size : {1, 3, 7, 36, 64}) {
+    for (int num_blocks : {1, 2, 8}) {
+      ReadAheadInputStream in(file_.get(), block_size, num_blocks);
+      tstring read;
+      TF_ASSERT_OK(in.ReadNBytes(5, &read));
+      EXPECT_EQ(read, "01234");
+      EXPECT_EQ(in.Tell(), 5);
+      TF_ASSERT_OK(in.ReadNBytes(0, &read));
+      EXPECT_EQ(read, "");
+      TF_ASSERT_OK(in.ReadNBytes(20, &read));
+      EXPECT_EQ(read, "56789abcdefghijklmno");
+      EXPECT_EQ(in.Tell(), 25);
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(20, &read)));
+      EXPECT_EQ(read, "pqrstuvwxyz");
+      EXPECT_EQ(in.Tell(), 36);
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+      EXPECT_EQ(read, "");
+      EXPECT_EQ(in.Tell(), 36);
+    }
+  }
+}
+
+TEST_P(ReadAheadInputStreamTest, SkipNBytes) {
+  for (int block_size : {1, 3, 7, 36, 64}) {
+    for (int num_blocks : {1, 2, 8}) {
+      ReadAheadInputStream in(file_.get(), block_size, num_blocks);
+      tstring read;
+      TF_ASSERT_OK(in.SkipNBytes(3));
+      EXPECT_EQ(in.Tell(), 3);
+      TF_ASSERT_OK(in.ReadNBytes(2, &read));
+      EXPECT_EQ(read, "34");
+      TF_ASSERT_OK(in.SkipNBytes(0));
+      TF_ASSERT_OK(in.SkipNBytes(20));
+      EXPECT_EQ(in.Tell(), 25);
+      TF_ASSERT_OK(in.ReadNBytes(3, &read));
+      EXPECT_EQ(read, "pqr");
+      TF_ASSERT_OK(in.SkipNBytes(8));
+      EXPECT_EQ(in.Tell(), 36);
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+    }
+  }
+}
+
+TEST_P(ReadAheadInputStreamTest, SkipPastEndOfFile) {
+  for (int block_size : {1, 7, 64}) {
+    ReadAheadInputStream in(file_.get(), block_size, /*num_blocks=*/2);
+    tstring read;
+    TF_ASSERT_OK(in.ReadNBytes(4, &read));
+    EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(100)));
+    EXPECT_EQ(in.Tell(), 36);
+    EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+  }
+}
+
+TEST_P(ReadAheadInputStreamTest, Reset) {
+  ReadAheadInputStream in(file_.get(), /*block_size=*/4, /*num_blocks=*/2);
+  tstring read;
+  TF_ASSERT_OK(in.ReadNBytes(10, &read));
+  EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(100)));
+  TF_ASSERT_OK(in.Reset());
+  EXPECT_EQ(in.Tell(), 0);
+  TF_ASSERT_OK(in.ReadNBytes(36, &read));
+  EXPECT_EQ(read, kContents);
+}
+
+TEST_P(ReadAheadInputStreamTest, SharedThreadPool) {
+  thread::ThreadPool thread_pool(Env::Default(), "test", /*num_threads=*/2);
+  ReadAheadInputStream in1(file_.get(), /*block_size=*/5, /*num_blocks=*/4,
+                           &thread_pool);
+  ReadAheadInputStream in2(file_.get(), /*block_size=*/3, /*num_blocks=*/4,
+                           &thread_pool);
+  tstring read1, read2;
+  for (int i = 0; i < 12; ++i) {
+    TF_ASSERT_OK(in1.ReadNBytes(3, &read1));
+    TF_ASSERT_OK(in2.ReadNBytes(3, &read2));
+    EXPECT_EQ(read1, read2);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(FileSystems, ReadAheadInputStreamTest,
+                         ::testing::Values("local", "ram"));
+
+}  // anonymous namespace
+}  // namespace io
+}  // namespace tsl
@@ -31,6 +31,10 @@ limitations under the License.
 namespace tsl {
 class RandomAccessFile;
 
+namespace thread {
+class ThreadPool;
+}  // namespace thread
+
 namespace io {
 
 struct RecordReaderOptions {
@@ -46,6 +50,16 @@ struct RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64_t buffer_size = 0;
 
+  // If read_ahead_num_blocks is positive, the file is read in blocks of
+  // read_ahead_block_size bytes, with up to read_ahead_num_blocks of them read
+  // in the background ahead of the records being parsed. As with buffering,
+  // all reads must then be sequential. Takes precedence over buffer_size.
+  int read_ahead_num_blocks = 0;
+  int64_t read_ahead_block_size = 1 << 20;  // 1MB.
+  // Thread pool the blocks are read on, or nullptr for a pool shared by the
+  // process. Not owned.
+  thread::ThreadPool* read_ahead_thread_pool = nullptr;
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/tsl/platform/status.h"
 #include "tensorflow/tsl/platform/strcat.h"
 #include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/platform/test_benchmark.h"
 
 namespace tsl {
 
@@ -366,4 +367,83 @@ TEST(RecordReaderWriterTest, TestUseAfterClose) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestReadAhead) {
+  Env* env = Env::Default();
+  for (const string& fname :
+       {testing::TmpDir() + "/record_reader_writer_read_ahead_test",
+        string("ram://record_reader_writer_read_ahead_test")}) {
+    {
+      std::unique_ptr<WritableFile> file;
+      TF_CHECK_OK(env->NewWritableFile(fname, &file));
+      io::RecordWriter writer(file.get());
+      for (int i = 0; i < 100; ++i) {
+        TF_EXPECT_OK(writer.WriteRecord(strings::StrCat("record_", i)));
+      }
+      TF_CHECK_OK(writer.Close());
+    }
+
+    for (int block_size : {1, 7, 64, 1 << 20}) {
+      std::unique_ptr<RandomAccessFile> read_file;
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+      io::RecordReaderOptions options;
+      options.read_ahead_num_blocks = 4;
+      options.read_ahead_block_size = block_size;
+      io::SequentialRecordReader reader(read_file.get(), options);
+      tstring record;
+      int num_skipped;
+      for (int i = 0; i < 100; i += 2) {
+        TF_CHECK_OK(reader.ReadRecord(&record));
+        EXPECT_EQ(strings::StrCat("record_", i), record);
+        TF_CHECK_OK(reader.SkipRecords(1, &num_skipped));
+      }
+      EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&record)));
+    }
+  }
+}
+
+void BM_ReadRecords(::testing::benchmark::State& state) {
+  const int record_size = state.range(0);
+  const int read_ahead_num_blocks = state.range(1);
+  constexpr int64_t kFileSize = 64 << 20;
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    const string record(record_size, 'x');
+    for (int64_t i = 0; i < kFileSize / record_size; ++i) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Close());
+  }
+
+  io::RecordReaderOptions options;
+  options.buffer_size = 256 << 10;
+  options.read_ahead_num_blocks = read_ahead_num_blocks;
+  int64_t num_records = 0;
+  for (auto s : state) {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::SequentialRecordReader reader(read_file.get(), options);
+    tstring record;
+    while (reader.ReadRecord(&record).ok()) {
+      ++num_records;
+    }
+  }
+  state.SetBytesProcessed(num_records * record_size);
+  state.SetItemsProcessed(num_records);
+  TF_CHECK_OK(env->DeleteFile(fname));
+}
+
+// Compares buffered reads with 0 blocks read ahead against read-ahead.
+BENCHMARK(BM_ReadRecords)
+    ->ArgPair(100, 0)
+    ->ArgPair(100, 4)
+    ->ArgPair(10 << 10, 0)
+    ->ArgPair(10 << 10, 4)
+    ->ArgPair(1 << 20, 0)
+    ->ArgPair(1 << 20, 4);
+
 }  // namespace tsl